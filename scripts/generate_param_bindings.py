@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+
+"""
+Generates the ADXSPD parameter binding table from info() tags in ADXSPD.template.
+
+Records that carry an xspdVar info tag are bound to the named XSPD variable. Bindings made from
+output records are writable, and are the ones captured in presets. Supported tags:
+
+    xspdParam       asyn parameter index name (defaults to the ADXSPD_ name for the record's asyn
+                    parameter string)
+    xspdVar         variable read to populate the parameter
+    xspdType        wire type of xspdVar (int, double, bool, string, OnOff, TriggerMode,
+                    CounterMode, ShuffleMode, Compressor)
+    xspdWriteVar    variable written when the parameter is set (defaults to xspdVar)
+    xspdWriteType   wire type of xspdWriteVar (defaults to xspdType)
+    xspdComponent   detector (default) or data_port
+    xspdScale       API value = parameter value * scale (default 1)
+    xspdIdleOnly    YES to reject writes while acquiring
+    xspdRefresh     space separated list of data_type, max_frames, flatfield
+    xspdCache       readback (default) or none
+
+The output is written alongside the auto-generated parameter definitions, and is regenerated by
+the make-paramdefs pixi task.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+RECORD_RE = re.compile(
+    r'record\(\s*(\w+)\s*,\s*"([^"]+)"\s*\)\s*\{(.*?)^\}', re.S | re.M
+)
+INFO_RE = re.compile(r'info\(\s*(\w+)\s*,\s*"([^"]*)"\s*\)')
+ASYN_RE = re.compile(r'field\(\s*(?:INP|OUT)\s*,\s*"@asyn\([^"]*\)(\w+)"\s*\)')
+
+VAR_TYPES = {
+    "int": "INT",
+    "double": "DOUBLE",
+    "bool": "BOOL",
+    "string": "STRING",
+    "onoff": "ON_OFF",
+    "triggermode": "TRIGGER_MODE",
+    "countermode": "COUNTER_MODE",
+    "shufflemode": "SHUFFLE_MODE",
+    "compressor": "COMPRESSOR",
+}
+
+COMPONENTS = {"detector": "DETECTOR", "data_port": "DATA_PORT"}
+
+REFRESH_FLAGS = {
+    "data_type": "ADXSPD_REFRESH_DATA_TYPE",
+    "max_frames": "ADXSPD_REFRESH_MAX_FRAMES",
+    "flatfield": "ADXSPD_REFRESH_FLATFIELD",
+}
+
+CACHE_POLICIES = {"readback": "READBACK", "none": "NONE"}
+
+OUTPUT_RECORD_TYPES = {"ao", "bo", "mbbo", "mbboDirect", "longout", "stringout"}
+
+INDENT = "    "
+COLUMN_LIMIT = 100
+
+
+def param_name_from_asyn_string(asyn_string: str, prefix: str) -> str:
+    """Mirror the naming used by epicsdbtools paramdefs, e.g. XSPD_CR_CORR -> ADXSPD_CrCorr."""
+
+    if asyn_string.startswith(prefix + "_"):
+        asyn_string = asyn_string[len(prefix) + 1 :]
+    words = [word.capitalize() for word in asyn_string.split("_") if word]
+    return "AD" + prefix + "_" + "".join(words)
+
+
+def lookup(table: dict, key: str, tag: str, record: str) -> str:
+    try:
+        return table[key.lower()]
+    except KeyError:
+        sys.exit(f"Invalid {tag} value '{key}' for record {record}")
+
+
+def parse_bindings(template_path: str, prefix: str) -> list[dict]:
+    with open(template_path, "r") as fp:
+        # Drop commented-out lines so disabled records are not picked up
+        contents = "\n".join(line for line in fp if not line.lstrip().startswith("#"))
+
+    bindings = []
+    seen = {}
+    for match in RECORD_RE.finditer(contents):
+        record_type = match.group(1)
+        record_name = match.group(2)
+        body = match.group(3)
+        info = dict(INFO_RE.findall(body))
+        if "xspdVar" not in info:
+            continue
+
+        param = info.get("xspdParam")
+        if param is None:
+            asyn_match = ASYN_RE.search(body)
+            if asyn_match is None:
+                sys.exit(
+                    f"Record {record_name} has no asyn parameter and no xspdParam tag"
+                )
+            param = param_name_from_asyn_string(asyn_match.group(1), prefix)
+
+        if param in seen:
+            sys.exit(f"Parameter {param} bound by both {seen[param]} and {record_name}")
+        seen[param] = record_name
+
+        read_type = lookup(
+            VAR_TYPES, info.get("xspdType", "int"), "xspdType", record_name
+        )
+        write_type = read_type
+        if "xspdWriteType" in info:
+            write_type = lookup(
+                VAR_TYPES, info["xspdWriteType"], "xspdWriteType", record_name
+            )
+
+        refresh = [
+            lookup(REFRESH_FLAGS, flag, "xspdRefresh", record_name)
+            for flag in info.get("xspdRefresh", "").split()
+        ]
+
+        bindings.append(
+            {
+                "param": param,
+                "component": lookup(
+                    COMPONENTS,
+                    info.get("xspdComponent", "detector"),
+                    "xspdComponent",
+                    record_name,
+                ),
+                "read_var": info["xspdVar"],
+                "write_var": info.get("xspdWriteVar", info["xspdVar"]),
+                "read_type": read_type,
+                "write_type": write_type,
+                "scale": float(info.get("xspdScale", "1")),
+                "writable": record_type in OUTPUT_RECORD_TYPES,
+                "idle_only": info.get("xspdIdleOnly", "NO").upper() == "YES",
+                "refresh": " | ".join(refresh) if refresh else "ADXSPD_REFRESH_NONE",
+                "cache": lookup(
+                    CACHE_POLICIES,
+                    info.get("xspdCache", "readback"),
+                    "xspdCache",
+                    record_name,
+                ),
+            }
+        )
+
+    return bindings
+
+
+def format_call(binding: dict) -> list[str]:
+    """Formats a single registerParamBinding call, wrapping arguments like clang-format does."""
+
+    args = [
+        binding["param"],
+        f"ADXSPDVarComponent::{binding['component']}",
+        f'"{binding["read_var"]}"',
+        f'"{binding["write_var"]}"',
+        f"ADXSPDVarType::{binding['read_type']}",
+        f"ADXSPDVarType::{binding['write_type']}",
+        repr(binding["scale"]),
+        "true" if binding["writable"] else "false",
+        "true" if binding["idle_only"] else "false",
+        binding["refresh"],
+        f"ADXSPDCachePolicy::{binding['cache']}",
+    ]
+
+    opener = INDENT + "registerParamBinding({"
+    continuation = " " * len(opener)
+    lines = []
+    current = opener
+    for index, arg in enumerate(args):
+        token = arg + ("});" if index == len(args) - 1 else ",")
+        if current == opener:
+            current += token
+        elif len(current) + 1 + len(token) > COLUMN_LIMIT:
+            lines.append(current)
+            current = continuation + token
+        else:
+            current += " " + token
+    lines.append(current)
+    return lines
+
+
+def generate(bindings: list[dict], template_name: str, prefix: str) -> str:
+    out = [
+        "// This file is auto-generated. Do not edit directly.",
+        f"// Generated from {template_name}",
+        "",
+        f'#include "AD{prefix}.h"',
+        "",
+        f"void AD{prefix}::createParamBindings() {{",
+    ]
+    for binding in bindings:
+        out.extend(format_call(binding))
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("template", help="Path to the driver database template")
+    parser.add_argument(
+        "output_dir", help="Directory to write the generated source file to"
+    )
+    parser.add_argument(
+        "-p", "--prefix", default="XSPD", help="Asyn parameter string prefix"
+    )
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    bindings = parse_bindings(args.template, args.prefix)
+    output_path = os.path.join(args.output_dir, f"AD{args.prefix}ParamBindings.cpp")
+    with open(output_path, "w") as fp:
+        fp.write(generate(bindings, os.path.basename(args.template), args.prefix))
+    print(f"Wrote {len(bindings)} parameter bindings to {output_path}")
+
+
+if __name__ == "__main__":
+    main()
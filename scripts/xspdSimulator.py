@@ -8,6 +8,19 @@ xspdApp/tests/samples/xspd_sample_responses.json) and serves
 the REST API expected by the ADXSPD EPICS driver while streaming
 simulated image data over ZMQ.
 
+When acquisition starts, a bank of frames is generated and compressed for
+each stream (the stitched image, or each module with --no-stitched), and
+cycled through on a fixed schedule, one publisher thread per stream. The
+achieved frame rate is reported at the end of each acquisition, and
+readable as the achieved_frame_rate variable of the detector.
+
+Faults can be injected into both the REST API and the data ports (see
+FAULT_DEFAULTS), from a JSON file given with --faults, or while running:
+
+    curl -X PUT localhost:8008/sim/faults -d '{"rest_error_rate": 0.1}'
+    curl localhost:8008/sim/faults             # settings and faults injected
+    curl -X DELETE localhost:8008/sim/faults   # back to no faults
+
 Usage:
     python xspdSimulator.py [OPTIONS] dump_file
 
@@ -18,9 +31,11 @@ Example:
 from __future__ import annotations
 
 import argparse
+import asyncio
 import copy
 import enum
 import json
+import random
 import struct
 import threading
 import time
@@ -30,7 +45,7 @@ from typing import Any, Dict, List, Optional, Type
 import numpy as np
 import uvicorn
 import zmq
-from fastapi import FastAPI, Query, HTTPException
+from fastapi import FastAPI, Query, HTTPException, Request
 from fastapi.responses import JSONResponse
 
 # ---------------------------------------------------------------------------
@@ -221,6 +236,166 @@ def coerce_value(var_path: str, raw: str) -> Any:
     return val
 
 
+# ---------------------------------------------------------------------------
+# Fault injection
+# ---------------------------------------------------------------------------
+
+
+# Settings for the faults the simulator can inject, with their defaults, which
+# inject none. Rates are probabilities per request or per message. Set at
+# startup with --faults, and at any time with PUT /sim/faults, so that each
+# test can script the conditions it runs under.
+FAULT_DEFAULTS: Dict[str, Any] = {
+    # Added REST latency: fixed, uniform (mean +/- jitter), normal (jitter is
+    # the standard deviation) or exponential (jitter ignored)
+    "rest_latency_ms": 0.0,
+    "rest_latency_jitter_ms": 0.0,
+    "rest_latency_distribution": "fixed",
+    # Every rest_stall_interval_s, hold all REST requests for rest_stall_ms
+    "rest_stall_interval_s": 0.0,
+    "rest_stall_ms": 0.0,
+    # Answer with an HTTP error status instead
+    "rest_error_rate": 0.0,
+    "rest_error_code": 503,
+    # Answer a variable request with the previous variable response, or with
+    # the response for another variable
+    "rest_duplicate_rate": 0.0,
+    "rest_mismatch_rate": 0.0,
+    # Frame messages that are not sent, sent twice, swapped with the next
+    # message, or sent without their payload part
+    "zmq_drop_rate": 0.0,
+    "zmq_duplicate_rate": 0.0,
+    "zmq_reorder_rate": 0.0,
+    "zmq_truncate_rate": 0.0,
+    # Send frames in bursts of this many back to back, at the same average rate
+    "zmq_burst_frames": 1,
+    # Seed for the random choices, for reproducible runs. None seeds randomly.
+    "seed": None,
+}
+
+LATENCY_DISTRIBUTIONS = ("fixed", "uniform", "normal", "exponential")
+
+
+class FaultInjector:
+    """Decides which faults to inject, and counts those injected.
+
+    Shared by the REST handlers and publisher threads.
+    """
+
+    def __init__(self) -> None:
+        self.lock = threading.Lock()
+        self.settings: Dict[str, Any] = dict(FAULT_DEFAULTS)
+        self.injected: Dict[str, int] = {}
+        self.rng = random.Random()
+        self.last_variable_response: Optional[Dict[str, Any]] = None
+
+    def update(self, values: Dict[str, Any]) -> None:
+        """Apply fault settings. Settings not given keep their value."""
+        new_settings = dict(self.settings)
+        for key, value in values.items():
+            if key not in FAULT_DEFAULTS:
+                raise ValueError(
+                    f"Unknown fault setting '{key}'. Allowed: {list(FAULT_DEFAULTS)}"
+                )
+            default = FAULT_DEFAULTS[key]
+            if value is None or default is None:
+                new_settings[key] = value
+            elif isinstance(default, str):
+                new_settings[key] = str(value).lower()
+            else:
+                new_settings[key] = type(default)(value)
+            if key.endswith("_rate") and not 0.0 <= new_settings[key] <= 1.0:
+                raise ValueError(f"{key} must be between 0 and 1")
+        if new_settings["rest_latency_distribution"] not in LATENCY_DISTRIBUTIONS:
+            raise ValueError(
+                f"rest_latency_distribution must be one of {LATENCY_DISTRIBUTIONS}"
+            )
+        if new_settings["zmq_burst_frames"] < 1:
+            raise ValueError("zmq_burst_frames must be at least 1")
+
+        with self.lock:
+            self.settings = new_settings
+            if "seed" in values:
+                self.rng.seed(new_settings["seed"])
+
+    def reset(self) -> None:
+        """Clear all faults and counts."""
+        with self.lock:
+            self.settings = dict(FAULT_DEFAULTS)
+            self.injected = {}
+            self.rng.seed(None)
+
+    def active_settings(self) -> Dict[str, Any]:
+        """Return the settings that differ from their defaults."""
+        with self.lock:
+            settings = dict(self.settings)
+        return {k: v for k, v in settings.items() if v != FAULT_DEFAULTS[k]}
+
+    def snapshot(self) -> Dict[str, Any]:
+        with self.lock:
+            return {"settings": dict(self.settings), "injected": dict(self.injected)}
+
+    def get(self, key: str) -> Any:
+        return self.settings[key]
+
+    def count(self, fault: str, n: int = 1) -> None:
+        with self.lock:
+            self.injected[fault] = self.injected.get(fault, 0) + n
+
+    def chance(self, rate_key: str) -> bool:
+        """Roll for a fault with a rate setting, counting it if it hits."""
+        rate = self.settings[rate_key]
+        if rate <= 0.0:
+            return False
+        with self.lock:
+            hit = self.rng.random() < rate
+        if hit:
+            self.count(rate_key[: -len("_rate")])
+        return hit
+
+    def rest_delay_s(self) -> float:
+        """Time to hold a REST request for: added latency plus any stall."""
+        s = self.settings
+        mean = s["rest_latency_ms"]
+        jitter = s["rest_latency_jitter_ms"]
+        with self.lock:
+            if s["rest_latency_distribution"] == "uniform":
+                delay_ms = self.rng.uniform(mean - jitter, mean + jitter)
+            elif s["rest_latency_distribution"] == "normal":
+                delay_ms = self.rng.gauss(mean, jitter)
+            elif s["rest_latency_distribution"] == "exponential" and mean > 0:
+                delay_ms = self.rng.expovariate(1.0 / mean)
+            else:
+                delay_ms = mean
+        delay = max(0.0, delay_ms) / 1000.0
+
+        # Stalls occupy the start of each interval, on the monotonic clock
+        interval = s["rest_stall_interval_s"]
+        if interval > 0 and s["rest_stall_ms"] > 0:
+            phase = time.monotonic() % interval
+            stall = s["rest_stall_ms"] / 1000.0
+            if phase < stall:
+                delay += stall - phase
+                self.count("rest_stall")
+        return delay
+
+    def variable_response(
+        self, response: Dict[str, Any], variables: Dict[str, Any]
+    ) -> Dict[str, Any]:
+        """Return the response to send for a variable request, which may be a
+        duplicate of the previous one or carry another variable's path."""
+        with self.lock:
+            previous = self.last_variable_response
+            self.last_variable_response = response
+        if previous is not None and self.chance("rest_duplicate_rate"):
+            return previous
+        if variables and self.chance("rest_mismatch_rate"):
+            with self.lock:
+                other_path = self.rng.choice(list(variables))
+            return {**response, "path": other_path}
+        return response
+
+
 # ---------------------------------------------------------------------------
 # Simulator state
 # ---------------------------------------------------------------------------
@@ -233,8 +408,20 @@ class SimulatorState:
     def __init__(self) -> None:
         self.lock = threading.Lock()
         self.acquiring = False
-        self.frame_number = 0
         self.baseline_noise_scale = 1.0
+        self.faults = FaultInjector()
+
+        # Acquisition bookkeeping shared by the publisher threads, guarded by
+        # lock. Each start command begins a new acquisition_id.
+        self.acquisition_changed = threading.Condition(self.lock)
+        self.acquisition_id = 0
+        self.acquisition_start: Optional[float] = None  # time.monotonic()
+        self.n_streams = 0
+        self.streams_ready = 0
+        self.stream_results: List[tuple[int, int, float]] = []  # (sent, late, s)
+
+        # Pre-compressed frames per stream, with the settings they were built for
+        self.frame_banks: Dict[int, tuple[tuple, List[List[bytes]]]] = {}
 
         # Stable baseline noise maps keyed by module geometry/bit depth.
         # These are reused across frames so low-threshold baseline stays fixed.
@@ -267,6 +454,20 @@ class SimulatorState:
     def set_var(self, path: str, value: Any) -> None:
         self.variables[path] = value
 
+    def start_acquisition(self) -> None:
+        with self.acquisition_changed:
+            self.acquiring = True
+            self.acquisition_id += 1
+            self.acquisition_start = None
+            self.streams_ready = 0
+            self.stream_results = []
+            self.acquisition_changed.notify_all()
+
+    def stop_acquisition(self) -> None:
+        with self.acquisition_changed:
+            self.acquiring = False
+            self.acquisition_changed.notify_all()
+
     def get_or_create_module_baseline(
         self,
         module_id: str,
@@ -744,139 +945,349 @@ def compress_data(raw_bytes: bytes, compressor_name: str) -> bytes:
 
 
 # ---------------------------------------------------------------------------
-# ZMQ publisher thread
+# Frame bank
 # ---------------------------------------------------------------------------
 
 
-def publisher_thread(
+@dataclass(frozen=True)
+class FrameSettings:
+    """Detector settings that determine the frames published in an acquisition."""
+
+    n_frames: int
+    bit_depth: int
+    shutter_time_ms: float
+    counter_mode: str
+    compressor: str
+    threshold_low: float
+    threshold_high: float
+
+    @classmethod
+    def from_state(cls, state: SimulatorState) -> FrameSettings:
+        det_id = state.detector_id
+        thresholds = state.get_var(f"{det_id}/thresholds", [])
+        return cls(
+            n_frames=int(state.get_var(f"{det_id}/n_frames", 1)),
+            bit_depth=int(state.get_var(f"{det_id}/bit_depth", 12)),
+            shutter_time_ms=float(state.get_var(f"{det_id}/shutter_time", 1000.0)),
+            counter_mode=str(state.get_var(f"{det_id}/counter_mode", "SINGLE")).upper(),
+            compressor=str(state.get_var(f"{det_id}/compressor", "NONE")),
+            threshold_low=float(thresholds[0]) if len(thresholds) > 0 else 0.0,
+            threshold_high=float(thresholds[1]) if len(thresholds) > 1 else 5.0,
+        )
+
+
+def generate_frame(
     state: SimulatorState,
-    zmq_context: zmq.Context,
-    stitched: bool,
-    base_data_port: int,
+    module_id: Optional[str],
+    settings: FrameSettings,
+    frame_num: int,
+) -> List[bytes]:
+    """Generate and compress one frame of a stream, as sent on the wire.
+
+    module_id is None for the stitched stream. Returns one payload per
+    counter: two in dual counter mode, otherwise one.
+    """
+    if module_id is None:
+        img = generate_stitched_image(
+            state,
+            settings.bit_depth,
+            settings.threshold_low,
+            frame_num,
+            settings.shutter_time_ms,
+        )
+    else:
+        mod_w = int(state.get_var(f"{module_id}/frame_width", 1024))
+        mod_h = int(state.get_var(f"{module_id}/frame_height", 1024))
+        img = generate_module_image(
+            mod_w,
+            mod_h,
+            settings.bit_depth,
+            settings.threshold_low,
+            frame_num,
+            settings.shutter_time_ms,
+            baseline_map=state.get_or_create_module_baseline(
+                module_id, mod_w, mod_h, settings.bit_depth
+            ),
+        )
+
+    payloads = [compress_data(img.tobytes(), settings.compressor)]
+    if settings.counter_mode == "DUAL":
+        img_b = apply_high_threshold(img, settings.threshold_high)
+        payloads.append(compress_data(img_b.tobytes(), settings.compressor))
+    return payloads
+
+
+def get_frame_bank(
+    state: SimulatorState,
+    stream_index: int,
+    module_id: Optional[str],
+    settings: FrameSettings,
+    bank_size: int,
+) -> List[List[bytes]]:
+    """Return the pre-compressed frames a stream cycles through.
+
+    Built when acquisition starts, and kept for later acquisitions with the
+    same settings. Only the latest bank of each stream is kept, to bound
+    memory use.
+    """
+    # The number of frames does not change the frames themselves
+    key = (
+        settings.bit_depth,
+        settings.shutter_time_ms,
+        settings.counter_mode,
+        settings.compressor,
+        settings.threshold_low,
+        settings.threshold_high,
+        bank_size,
+    )
+    cached = state.frame_banks.get(stream_index)
+    if cached is not None and cached[0] == key:
+        return cached[1]
+
+    state.frame_banks.pop(stream_index, None)
+    start = time.monotonic()
+    bank = [generate_frame(state, module_id, settings, i) for i in range(bank_size)]
+    state.frame_banks[stream_index] = (key, bank)
+    n_bytes = sum(len(p) for frame in bank for p in frame)
+    print(
+        f"[ACQ] Stream {stream_index}: built bank of {bank_size} frames "
+        f"({n_bytes / 1e6:.1f} MB) in {time.monotonic() - start:.2f} s"
+    )
+    return bank
+
+
+# ---------------------------------------------------------------------------
+# ZMQ publisher threads
+# ---------------------------------------------------------------------------
+
+
+def send_frame(
+    faults: FaultInjector,
+    sock: zmq.Socket,
+    held: List[List[bytes]],
+    pixel_data: bytes,
+    frame_num: int,
+    trigger_num: int,
 ) -> None:
-    """Background thread that streams frames over ZMQ when acquiring."""
+    """Send a frame message, dropping, duplicating, truncating or reordering
+    it as the fault settings dictate.
 
-    # Build sockets
-    sockets: List[zmq.Socket] = []
-    if stitched:
-        sock = zmq_context.socket(zmq.PUB)
-        sock.bind(f"tcp://*:{base_data_port}")
-        sockets.append(sock)
-        print(f"[ZMQ] Stitched publisher bound to tcp://*:{base_data_port}")
-    else:
-        for i, mod_id in enumerate(state.module_ids):
-            sock = zmq_context.socket(zmq.PUB)
-            port = base_data_port + i
-            sock.bind(f"tcp://*:{port}")
-            sockets.append(sock)
-            print(f"[ZMQ] Module {mod_id} publisher bound to tcp://*:{port}")
+    A reordered message is held back in held, and sent after the next one.
+    """
+    header = struct.pack("BBBB", frame_num & 0xFF, trigger_num & 0xFF, 0, 0)
+    parts = [b"", header, pixel_data]
+    if faults.chance("zmq_drop_rate"):
+        return
+    if faults.chance("zmq_truncate_rate"):
+        parts = parts[:2]
+    if not held and faults.chance("zmq_reorder_rate"):
+        held.append(parts)
+        return
 
-    def send_frame(
-        sock: zmq.Socket, pixel_data: bytes, frame_num: int, trigger_num: int
-    ) -> None:
-        header = struct.pack("BBBB", frame_num & 0xFF, trigger_num & 0xFF, 0, 0)
-        sock.send_multipart([b"", header, pixel_data])
+    sock.send_multipart(parts, copy=False)
+    if faults.chance("zmq_duplicate_rate"):
+        sock.send_multipart(parts, copy=False)
+    while held:
+        sock.send_multipart(held.pop(), copy=False)
 
+
+def publisher_thread(
+    state: SimulatorState,
+    sock: zmq.Socket,
+    stream_index: int,
+    module_id: Optional[str],
+    frame_bank_size: int,
+) -> None:
+    """Background thread that streams the frames of one stream over ZMQ.
+
+    There is one stream per module, or a single stitched stream (module_id
+    None).
+    """
+    last_acquisition = 0
     try:
         while True:
-            # Check acquisition state
-            with state.lock:
-                local_acquiring = state.acquiring
-            if not local_acquiring:
-                time.sleep(0.05)
-                continue
-
-            # Read parameters (accept minor races for performance)
-            det_id = state.detector_id
-            n_frames = int(state.get_var(f"{det_id}/n_frames", 1))
-            bit_depth = int(state.get_var(f"{det_id}/bit_depth", 12))
-            shutter_time_ms = float(state.get_var(f"{det_id}/shutter_time", 1000.0))
-            counter_mode = str(
-                state.get_var(f"{det_id}/counter_mode", "SINGLE")
-            ).upper()
-            compressor_name = str(state.get_var(f"{det_id}/compressor", "NONE"))
-
-            thresholds = state.get_var(f"{det_id}/thresholds", [])
-            threshold_low = float(thresholds[0]) if len(thresholds) > 0 else 0.0
-            threshold_high = float(thresholds[1]) if len(thresholds) > 1 else 5.0
-
-            with state.lock:
-                frame_num = state.frame_number
-
-            if frame_num >= n_frames:
-                # Auto-stop
-                with state.lock:
-                    state.acquiring = False
-                    state.frame_number = 0
-                state.set_var(f"{det_id}/status", "ready")
-                for mod_id in state.module_ids:
-                    state.set_var(f"{mod_id}/status", "ready")
-                print(f"[ACQ] Completed {n_frames} frames, auto-stopped")
-                continue
-
-            # Sleep for shutter_time before generating/sending the frame
-            time.sleep(shutter_time_ms / 1000.0)
-
-            # Re-check acquisition state after sleep (may have been stopped)
-            with state.lock:
-                if not state.acquiring:
-                    continue
-
-            # Generate frame(s)
-            if stitched:
-                img = generate_stitched_image(
-                    state, bit_depth, threshold_low, frame_num, shutter_time_ms
-                )
-                raw = img.tobytes()
-                compressed = compress_data(raw, compressor_name)
-                send_frame(sockets[0], compressed, frame_num, 0)
-
-                if counter_mode == "DUAL":
-                    img_b = apply_high_threshold(img, threshold_high)
-                    raw_b = img_b.tobytes()
-                    compressed_b = compress_data(raw_b, compressor_name)
-                    send_frame(sockets[0], compressed_b, frame_num, 1)
-            else:
-                # Non-stitched: one frame per module per socket
-                for i, mod_id in enumerate(state.module_ids):
-                    mod_w = int(state.get_var(f"{mod_id}/frame_width", 1024))
-                    mod_h = int(state.get_var(f"{mod_id}/frame_height", 1024))
-                    img = generate_module_image(
-                        mod_w,
-                        mod_h,
-                        bit_depth,
-                        threshold_low,
-                        frame_num,
-                        shutter_time_ms,
-                        baseline_map=state.get_or_create_module_baseline(
-                            mod_id, mod_w, mod_h, bit_depth
-                        ),
-                    )
-                    raw = img.tobytes()
-                    compressed = compress_data(raw, compressor_name)
-                    send_frame(sockets[i], compressed, frame_num, 0)
-
-                    if counter_mode == "DUAL":
-                        img_b = apply_high_threshold(img, threshold_high)
-                        raw_b = img_b.tobytes()
-                        compressed_b = compress_data(raw_b, compressor_name)
-                        send_frame(sockets[i], compressed_b, frame_num, 1)
-
-            # Update counters
-            with state.lock:
-                state.frame_number += 1
-                fn = state.frame_number
+            with state.acquisition_changed:
+                while not state.acquiring or state.acquisition_id == last_acquisition:
+                    state.acquisition_changed.wait()
+                last_acquisition = state.acquisition_id
+            publish_acquisition(
+                state, sock, stream_index, module_id, frame_bank_size, last_acquisition
+            )
+    except zmq.ContextTerminated:
+        pass
+    finally:
+        sock.close(linger=0)
+
 
+def publish_acquisition(
+    state: SimulatorState,
+    sock: zmq.Socket,
+    stream_index: int,
+    module_id: Optional[str],
+    frame_bank_size: int,
+    acquisition_id: int,
+) -> None:
+    """Publish the frames of one stream for one acquisition.
+
+    Frames are sent against a fixed schedule starting when every stream is
+    ready, frame k at the end of its exposure, t0 + (k + 1) * shutter_time,
+    so the time taken to produce and send a frame does not lengthen the
+    frame period. A frame that misses its deadline is sent straight away,
+    and counted as late.
+    """
+
+    def running() -> bool:
+        return state.acquiring and state.acquisition_id == acquisition_id
+
+    settings = FrameSettings.from_state(state)
+    bank: List[List[bytes]] = []
+    if frame_bank_size > 0:
+        try:
+            bank = get_frame_bank(
+                state, stream_index, module_id, settings, frame_bank_size
+            )
+        except (RuntimeError, ValueError, MemoryError) as e:
+            print(f"[ACQ] Stream {stream_index}: failed to build frame bank: {e}")
+
+    # Wait for every stream, so they all share the same schedule
+    with state.acquisition_changed:
+        if not running():
+            return
+        state.streams_ready += 1
+        if state.streams_ready == state.n_streams:
+            state.acquisition_start = time.monotonic()
+            state.acquisition_changed.notify_all()
+        state.acquisition_changed.wait_for(
+            lambda: state.acquisition_start is not None or not running()
+        )
+        t0 = state.acquisition_start
+    if t0 is None:
+        return
+
+    period = settings.shutter_time_ms / 1000.0
+    n_sent = 0
+    n_late = 0
+    last_report = last_sent = t0
+    held: List[List[bytes]] = []  # Message held back to be reordered
+    for frame_num in range(settings.n_frames):
+        if not running():
+            break
+        # In bursts, frames are sent together at the deadline of the last one
+        burst = state.faults.get("zmq_burst_frames")
+        deadline = t0 + (frame_num // burst + 1) * burst * period
+        delay = deadline - time.monotonic()
+        if delay > 0:
+            # Woken early by a stop command
+            with state.acquisition_changed:
+                state.acquisition_changed.wait_for(lambda: not running(), timeout=delay)
+            if not running():
+                break
+        elif -delay >= period:
+            n_late += 1
+
+        if bank:
+            payloads = bank[frame_num % len(bank)]
+        else:
+            payloads = generate_frame(state, module_id, settings, frame_num)
+        for trigger_num, payload in enumerate(payloads):
+            send_frame(state.faults, sock, held, payload, frame_num, trigger_num)
+        n_sent += 1
+        last_sent = time.monotonic()
+
+        if module_id is None:
             for dp_id in state.data_port_ids:
-                state.set_var(f"{dp_id}/frames_queued", fn)
+                state.set_var(f"{dp_id}/frames_queued", n_sent)
             for mod_id in state.module_ids:
-                state.set_var(f"{mod_id}/frames_queued", fn)
+                state.set_var(f"{mod_id}/frames_queued", n_sent)
+        else:
+            state.set_var(f"{module_id}/frames_queued", n_sent)
+            if stream_index < len(state.data_port_ids):
+                dp_id = state.data_port_ids[stream_index]
+                state.set_var(f"{dp_id}/frames_queued", n_sent)
 
-    except zmq.ContextTerminated:
-        pass
-    finally:
-        for s in sockets:
-            s.close(linger=0)
+        # The first stream keeps the achieved rate up to date while acquiring
+        if stream_index == 0 and last_sent - last_report >= 1.0:
+            rate = n_sent / (last_sent - t0)
+            state.set_var(f"{state.detector_id}/achieved_frame_rate", rate)
+            last_report = last_sent
+
+    while held:
+        sock.send_multipart(held.pop(), copy=False)
+    finish_stream(state, acquisition_id, settings, n_sent, n_late, last_sent - t0)
+
+
+def finish_stream(
+    state: SimulatorState,
+    acquisition_id: int,
+    settings: FrameSettings,
+    n_sent: int,
+    n_late: int,
+    elapsed: float,
+) -> None:
+    """Record the result of one stream. The last stream to finish reports the
+    achieved frame rate, and auto-stops the acquisition once complete."""
+    with state.acquisition_changed:
+        if acquisition_id != state.acquisition_id:
+            return
+        state.stream_results.append((n_sent, n_late, elapsed))
+        if len(state.stream_results) < state.n_streams:
+            return
+        results = state.stream_results
+        completed = state.acquiring and all(r[0] >= settings.n_frames for r in results)
+        if completed:
+            state.acquiring = False
+            state.acquisition_changed.notify_all()
+
+    # The slowest stream sets the rate the detector as a whole achieved
+    achieved = min(r[0] / r[2] if r[2] > 0 else 0.0 for r in results)
+    target = 1000.0 / settings.shutter_time_ms if settings.shutter_time_ms > 0 else 0.0
+    det_id = state.detector_id
+    state.set_var(f"{det_id}/achieved_frame_rate", achieved)
+    print(
+        f"[ACQ] {'Completed' if completed else 'Stopped after'} "
+        f"{min(r[0] for r in results)} frames: achieved {achieved:.1f} Hz "
+        f"(target {target:.1f} Hz), {sum(r[1] for r in results)} late"
+    )
+
+    if completed:
+        state.set_var(f"{det_id}/status", "ready")
+        for mod_id in state.module_ids:
+            state.set_var(f"{mod_id}/status", "ready")
+        print(f"[ACQ] Completed {settings.n_frames} frames, auto-stopped")
+
+
+def start_publishers(
+    state: SimulatorState,
+    zmq_context: zmq.Context,
+    stitched: bool,
+    base_data_port: int,
+    frame_bank_size: int,
+) -> List[threading.Thread]:
+    """Bind the data port sockets and start one publisher thread per stream."""
+    streams: List[tuple[int, Optional[str]]] = []
+    if stitched:
+        streams.append((base_data_port, None))
+    else:
+        for i, mod_id in enumerate(state.module_ids):
+            streams.append((base_data_port + i, mod_id))
+    state.n_streams = len(streams)
+
+    threads = []
+    for stream_index, (port, mod_id) in enumerate(streams):
+        sock = zmq_context.socket(zmq.PUB)
+        sock.bind(f"tcp://*:{port}")
+        if mod_id is None:
+            print(f"[ZMQ] Stitched publisher bound to tcp://*:{port}")
+        else:
+            print(f"[ZMQ] Module {mod_id} publisher bound to tcp://*:{port}")
+        thread = threading.Thread(
+            target=publisher_thread,
+            args=(state, sock, stream_index, mod_id, frame_bank_size),
+            daemon=True,
+        )
+        thread.start()
+        threads.append(thread)
+    return threads
 
 
 # ---------------------------------------------------------------------------
@@ -887,6 +1298,47 @@ def publisher_thread(
 def create_app(state: SimulatorState, stitched: bool, base_data_port: int) -> FastAPI:
     app = FastAPI(title="XSPD Simulator")
 
+    @app.middleware("http")
+    async def inject_rest_faults(request: Request, call_next):
+        # The fault settings themselves are always served promptly
+        if request.url.path.startswith("/sim/"):
+            return await call_next(request)
+        delay = state.faults.rest_delay_s()
+        if delay > 0:
+            await asyncio.sleep(delay)
+        if state.faults.chance("rest_error_rate"):
+            return JSONResponse(
+                status_code=state.faults.get("rest_error_code"),
+                content={"detail": "Injected server error"},
+            )
+        return await call_next(request)
+
+    @app.get("/sim/faults")
+    def get_faults():
+        return JSONResponse(content=state.faults.snapshot())
+
+    @app.put("/sim/faults")
+    async def set_faults(request: Request):
+        try:
+            settings = await request.json()
+            if not isinstance(settings, dict):
+                raise TypeError("Fault settings must be a JSON object")
+            state.faults.update(settings)
+        except (TypeError, ValueError) as e:
+            raise HTTPException(status_code=400, detail=str(e))
+        print(f"[SIM] Fault settings: {state.faults.active_settings() or 'none'}")
+        return JSONResponse(content=state.faults.snapshot())
+
+    @app.delete("/sim/faults")
+    def reset_faults():
+        state.faults.reset()
+        print("[SIM] Fault settings reset")
+        return JSONResponse(content=state.faults.snapshot())
+
+    def variable_response(content: Dict[str, Any]) -> JSONResponse:
+        content = state.faults.variable_response(content, state.variables)
+        return JSONResponse(content=content)
+
     @app.get("/api")
     def api_root():
         return JSONResponse(content=state.api_response)
@@ -939,7 +1391,7 @@ def create_app(state: SimulatorState, stitched: bool, base_data_port: int) -> Fa
         value = state.get_var(path)
         if value is None:
             raise HTTPException(status_code=404, detail=f"Variable '{path}' not found")
-        return JSONResponse(content={"path": path, "value": value})
+        return variable_response({"path": path, "value": value})
 
     @app.put("/api/v1/devices/{device_id}/variables")
     def set_variable(
@@ -958,7 +1410,7 @@ def create_app(state: SimulatorState, stitched: bool, base_data_port: int) -> Fa
                     status_code=400, detail=f"Invalid threshold values: {value}"
                 )
             state.set_var(path, new_val)
-            return JSONResponse(content={"path": path, "value": new_val})
+            return variable_response({"path": path, "value": new_val})
 
         try:
             new_val = coerce_value(path, value)
@@ -966,7 +1418,7 @@ def create_app(state: SimulatorState, stitched: bool, base_data_port: int) -> Fa
             raise HTTPException(status_code=400, detail=str(e))
 
         state.set_var(path, new_val)
-        return JSONResponse(content={"path": path, "value": new_val})
+        return variable_response({"path": path, "value": new_val})
 
     @app.get("/api/v1/devices/{device_id}/commands")
     def list_commands(device_id: str):
@@ -982,9 +1434,7 @@ def create_app(state: SimulatorState, stitched: bool, base_data_port: int) -> Fa
             cmd = cmd[len(det_id) + 1 :]
 
         if cmd == "start":
-            with state.lock:
-                state.acquiring = True
-                state.frame_number = 0
+            state.start_acquisition()
             state.set_var(f"{det_id}/status", "busy")
             for mod_id in state.module_ids:
                 state.set_var(f"{mod_id}/status", "busy")
@@ -992,9 +1442,7 @@ def create_app(state: SimulatorState, stitched: bool, base_data_port: int) -> Fa
             return JSONResponse(content={"status": "started"})
 
         elif cmd == "stop":
-            with state.lock:
-                state.acquiring = False
-                state.frame_number = 0
+            state.stop_acquisition()
             state.set_var(f"{det_id}/status", "ready")
             for mod_id in state.module_ids:
                 state.set_var(f"{mod_id}/status", "ready")
@@ -1002,9 +1450,7 @@ def create_app(state: SimulatorState, stitched: bool, base_data_port: int) -> Fa
             return JSONResponse(content={"status": "stopped"})
 
         elif cmd == "reset":
-            with state.lock:
-                state.acquiring = False
-                state.frame_number = 0
+            state.stop_acquisition()
             state.set_var(f"{det_id}/status", "ready")
             for mod_id in state.module_ids:
                 state.set_var(f"{mod_id}/status", "ready")
@@ -1073,6 +1519,24 @@ def parse_args() -> argparse.Namespace:
         default="none",
         help="Initial compressor for ZMQ frame data (default: none)",
     )
+    parser.add_argument(
+        "--publish",
+        action=argparse.BooleanOptionalAction,
+        default=True,
+        help="Publish frames on the data ports. Use --no-publish to leave them to an external publisher such as xspdPublisher.",
+    )
+    parser.add_argument(
+        "--frame-bank",
+        type=int,
+        default=8,
+        help="Number of frames per stream generated and compressed when acquisition starts, then cycled through. Use 0 to generate every frame as it is sent (default: 8)",
+    )
+    parser.add_argument(
+        "--faults",
+        type=str,
+        default=None,
+        help="JSON file of fault injection settings applied at startup. They can be changed while running with PUT /sim/faults.",
+    )
     parser.add_argument(
         "--baseline-noise-scale",
         type=float,
@@ -1096,6 +1560,9 @@ def main() -> None:
     for mod_id in state.module_ids:
         state.set_var(f"{mod_id}/compressor", compressor_val)
     state.baseline_noise_scale = max(0.1, float(args.baseline_noise_scale))
+    if args.faults is not None:
+        with open(args.faults, "r") as f:
+            state.faults.update(json.load(f))
 
     print(f"[INIT] Device: {state.device_id}")
     print(f"[INIT] Detector: {state.detector_id}")
@@ -1103,17 +1570,19 @@ def main() -> None:
     print(f"[INIT] Data ports: {state.data_port_ids}")
     print(f"[INIT] Stitched: {args.stitched}")
     print(f"[INIT] Compressor: {args.compressor}")
+    print(f"[INIT] Frame bank: {args.frame_bank} frames per stream")
+    print(f"[INIT] Faults: {state.faults.active_settings() or 'none'}")
     print(f"[INIT] Baseline noise scale: {state.baseline_noise_scale:.2f}")
     print(f"[INIT] Variables loaded: {len(state.variables)}")
 
-    # Start ZMQ publisher thread
-    zmq_context = zmq.Context.instance()
-    pub_thread = threading.Thread(
-        target=publisher_thread,
-        args=(state, zmq_context, args.stitched, args.data_port),
-        daemon=True,
-    )
-    pub_thread.start()
+    # Start ZMQ publisher threads
+    if args.publish:
+        zmq_context = zmq.Context.instance()
+        start_publishers(
+            state, zmq_context, args.stitched, args.data_port, max(0, args.frame_bank)
+        )
+    else:
+        print("[INIT] Not publishing frames, data ports are left to an external publisher")
 
     # Create and run FastAPI app
     app = create_app(state, args.stitched, args.data_port)
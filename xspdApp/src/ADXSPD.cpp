@@ -23,11 +23,280 @@ using json = nlohmann::json;
  * @param ipPort The IP address and port of the XSPD device (e.g. 192.168.1.100:8080)
  * @param deviceId The device ID of the XSPD device to connect to (if NULL, connects to first device
  * found)
+ * @param detectorId The detector on the device to control (if NULL, the first detector)
+ * @param topologyCacheDir Directory in which to cache the detector topology (if NULL, no caching)
+ * @param numInitThreads Number of concurrent requests used to read initial state (0 for one per
+ * module)
  * @return int asynStatus code
  */
 extern "C" int ADXSPDConfig(const char* portName, const char* ip, int portNum,
-                            const char* deviceId) {
-    new ADXSPD(portName, ip, portNum, deviceId);
+                            const char* deviceId, const char* detectorId,
+                            const char* topologyCacheDir, int numInitThreads) {
+    try {
+        new ADXSPD(portName, ip, portNum, deviceId, detectorId, topologyCacheDir, numInitThreads);
+    } catch (std::exception& e) {
+        fprintf(stderr, "ERROR | ADXSPDConfig: Failed to create driver on port %s: %s\n", portName,
+                e.what());
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+static mutex driverRegistryMutex;
+static map<string, ADXSPD*> driverRegistry;  // Drivers by asyn port name, for iocsh commands
+// Metrics collections running outside the registry lock, which a driver waits out before exiting
+static int numMetricsCollections = 0;
+static condition_variable metricsCollectionsDone;
+
+/**
+ * @brief Resets the REST request statistics of the XSPD server connection used by a driver. The
+ * statistics are shared by all drivers connected to the same device.
+ *
+ * @param portName The asyn port name of the driver
+ * @return asynStatus asynSuccess, or asynError if there is no ADXSPD driver on the port
+ */
+extern "C" int ADXSPDResetRestStats(const char* portName) {
+    lock_guard<mutex> lock(driverRegistryMutex);
+    auto it = driverRegistry.find(portName == nullptr ? "" : portName);
+    if (it == driverRegistry.end()) {
+        fprintf(stderr, "ERROR | ADXSPDResetRestStats: No ADXSPD driver on port %s\n",
+                portName == nullptr ? "" : portName);
+        return asynError;
+    }
+    it->second->resetRestStats();
+    return asynSuccess;
+}
+
+/**
+ * @brief Starts or stops recording the REST requests made to the XSPD server connection used by a
+ * driver, for replay with ADXSPDReplayRest. The recording covers all drivers connected to the
+ * same device.
+ *
+ * @param portName The asyn port name of the driver
+ * @param path File to record to, or empty to stop recording
+ * @return asynStatus asynSuccess, or asynError if there is no ADXSPD driver on the port
+ */
+extern "C" int ADXSPDRecordRest(const char* portName, const char* path) {
+    lock_guard<mutex> lock(driverRegistryMutex);
+    auto it = driverRegistry.find(portName == nullptr ? "" : portName);
+    if (it == driverRegistry.end()) {
+        fprintf(stderr, "ERROR | ADXSPDRecordRest: No ADXSPD driver on port %s\n",
+                portName == nullptr ? "" : portName);
+        return asynError;
+    }
+    try {
+        it->second->recordRest(path == nullptr ? "" : path);
+    } catch (std::exception& e) {
+        fprintf(stderr, "ERROR | ADXSPDRecordRest: %s\n", e.what());
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+static vector<shared_ptr<XSPD::API>> replayApis;  // Kept alive for the life of the IOC
+
+/**
+ * @brief Makes drivers subsequently configured for an XSPD server replay a REST recording made
+ * with ADXSPDRecordRest, rather than connecting to the server. Must be called before ADXSPDConfig.
+ *
+ * @param ip The IP address of the XSPD server, as passed to ADXSPDConfig
+ * @param portNum The port number of the XSPD server, as passed to ADXSPDConfig
+ * @param deviceId The requested device ID, as passed to ADXSPDConfig
+ * @param path The recording to replay
+ * @param timeScale Multiplies the recorded response times, 0 to respond immediately
+ * @return asynStatus asynSuccess, or asynError if the recording could not be loaded
+ */
+extern "C" int ADXSPDReplayRest(const char* ip, int portNum, const char* deviceId,
+                                const char* path, double timeScale) {
+    string host = ip == nullptr ? "" : ip, recordingPath = path == nullptr ? "" : path;
+    try {
+        auto api = make_shared<XSPD::ReplayAPI>(
+            host, recordingPath, portNum == 0 ? XSPD::DEFAULT_PORT : portNum, timeScale);
+        registerSharedAPI(host, portNum, deviceId == nullptr ? "" : deviceId, api);
+        replayApis.push_back(api);
+        printf("ADXSPDReplayRest: Loaded %zu requests from %s\n", api->GetNumRecorded(),
+               recordingPath.c_str());
+    } catch (std::exception& e) {
+        fprintf(stderr, "ERROR | ADXSPDReplayRest: %s\n", e.what());
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+/**
+ * @brief Starts or stops capturing the raw data port messages received by a driver to a file, for
+ * replay with ADXSPDReplayCapture
+ *
+ * @param portName The asyn port name of the driver
+ * @param path File to capture to, or empty to stop capturing
+ * @param decode Whether captured frames are also read out as usual. If 0, frames are only written
+ * to the capture, so that bursts beyond what the downstream plugins can keep up with are kept.
+ * @return asynStatus asynSuccess, or asynError if the capture could not be started
+ */
+extern "C" int ADXSPDCapture(const char* portName, const char* path, int decode) {
+    lock_guard<mutex> lock(driverRegistryMutex);
+    auto it = driverRegistry.find(portName == nullptr ? "" : portName);
+    if (it == driverRegistry.end()) {
+        fprintf(stderr, "ERROR | ADXSPDCapture: No ADXSPD driver on port %s\n",
+                portName == nullptr ? "" : portName);
+        return asynError;
+    }
+    try {
+        it->second->capture(path == nullptr ? "" : path, decode != 0);
+    } catch (std::exception& e) {
+        fprintf(stderr, "ERROR | ADXSPDCapture: %s\n", e.what());
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+/**
+ * @brief Replays a data port capture to a driver in place of its data port. The capture is
+ * replayed from the start each time acquisition is started.
+ *
+ * @param portName The asyn port name of the driver
+ * @param path Capture file made with ADXSPDCapture, or empty to return to the data port
+ * @param speed Replay speed relative to the original timing, or 0 to replay as fast as possible
+ * @return asynStatus asynSuccess, or asynError if the capture could not be loaded
+ */
+extern "C" int ADXSPDReplayCapture(const char* portName, const char* path, double speed) {
+    lock_guard<mutex> lock(driverRegistryMutex);
+    auto it = driverRegistry.find(portName == nullptr ? "" : portName);
+    if (it == driverRegistry.end()) {
+        fprintf(stderr, "ERROR | ADXSPDReplayCapture: No ADXSPD driver on port %s\n",
+                portName == nullptr ? "" : portName);
+        return asynError;
+    }
+    try {
+        it->second->replayCapture(path == nullptr ? "" : path, speed);
+    } catch (std::exception& e) {
+        fprintf(stderr, "ERROR | ADXSPDReplayCapture: %s\n", e.what());
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+/**
+ * @brief Writes the REST request statistics of an XSPD server connection. These are shared by all
+ * drivers connected to the same device, so are labelled by device rather than by driver port.
+ *
+ * @param writer Metrics writer to add samples to
+ * @param api The shared API object
+ */
+static void collectApiMetrics(ADXSPDMetricsWriter& writer, XSPD::API& api) {
+    string deviceId;
+    try {
+        deviceId = api.GetDeviceId();
+    } catch (runtime_error&) {
+        return;  // Not initialized yet, so no requests to report
+    }
+    ADXSPDMetricLabels labels = {{"device", deviceId}};
+
+    for (auto& stats : api.GetEndpointStats()) {
+        ADXSPDMetricLabels endpointLabels = labels;
+        endpointLabels.push_back({"endpoint", stats.endpoint});
+        writer.Counter("xspd_rest_errors_total", "Failed XSPD REST requests", endpointLabels,
+                       (double) stats.numErrors);
+        writer.Counter("xspd_rest_sent_bytes_total", "Bytes sent in XSPD REST requests",
+                       endpointLabels, (double) stats.bytesSent);
+        writer.Counter("xspd_rest_received_bytes_total", "Bytes received in XSPD REST responses",
+                       endpointLabels, (double) stats.bytesReceived);
+        vector<pair<double, double>> quantiles = {
+            {0.5, stats.p50Ms / 1e3}, {0.99, stats.p99Ms / 1e3}, {1.0, stats.maxMs / 1e3}};
+        writer.Summary("xspd_rest_request_seconds", "XSPD REST request latency", endpointLabels,
+                       quantiles, stats.totalMs / 1e3, stats.numRequests);
+    }
+}
+
+/**
+ * @brief Writes the metrics of all ADXSPD drivers, once for each XSPD server connection they
+ * share, and of the shared logging backend
+ */
+static void collectAllMetrics(ADXSPDMetricsWriter& writer) {
+    writer.Gauge("xspd_log_queue_depth", "Log messages waiting to be printed", {},
+                 (double) ADXSPDLog::GetQueueDepth());
+    writer.Counter("xspd_log_dropped_total", "Log messages dropped because the queue was full", {},
+                   (double) ADXSPDLog::GetNumDropped());
+
+    // Collecting can take a while, so don't hold up driver creation and iocsh commands meanwhile
+    vector<ADXSPD*> drivers;
+    vector<shared_ptr<XSPD::API>> apis;
+    {
+        lock_guard<mutex> lock(driverRegistryMutex);
+        for (auto& [portName, pDriver] : driverRegistry) {
+            drivers.push_back(pDriver);
+            shared_ptr<XSPD::API> api = pDriver->getAPI();
+            if (find(apis.begin(), apis.end(), api) == apis.end()) apis.push_back(api);
+        }
+        numMetricsCollections++;
+    }
+
+    for (auto pDriver : drivers) pDriver->collectMetrics(writer);
+    for (auto& api : apis) collectApiMetrics(writer, *api);
+
+    lock_guard<mutex> lock(driverRegistryMutex);
+    numMetricsCollections--;
+    metricsCollectionsDone.notify_all();
+}
+
+static mutex metricsServerMutex;
+static unique_ptr<ADXSPDMetricsServer> metricsServer;
+
+/**
+ * @brief Starts or stops serving Prometheus metrics for all ADXSPD drivers at
+ * http://127.0.0.1:<port>/metrics. Scrapes never take an asyn port lock.
+ *
+ * @param port TCP port to listen on, or 0 to stop serving
+ * @return int asynStatus code
+ */
+extern "C" int ADXSPDMetricsServe(int port) {
+    lock_guard<mutex> lock(metricsServerMutex);
+    metricsServer.reset();
+    if (port <= 0) {
+        printf("INFO | ADXSPDMetricsServe: Metrics server stopped\n");
+        return asynSuccess;
+    }
+    try {
+        metricsServer = make_unique<ADXSPDMetricsServer>(port, collectAllMetrics);
+    } catch (std::exception& e) {
+        fprintf(stderr, "ERROR | ADXSPDMetricsServe: %s\n", e.what());
+        return asynError;
+    }
+    printf("INFO | ADXSPDMetricsServe: Serving metrics at http://127.0.0.1:%d/metrics\n",
+           metricsServer->GetPort());
+    return asynSuccess;
+}
+
+/**
+ * @brief Enables or disables timeline tracing for all ADXSPD drivers and XSPD API connections
+ *
+ * @param enable Nonzero to start recording trace spans, zero to stop
+ * @return int asynStatus code
+ */
+extern "C" int ADXSPDTraceEnable(int enable) {
+    ADXSPDTrace::Enable(enable != 0);
+    printf("INFO | ADXSPDTraceEnable: Tracing %s\n", enable ? "enabled" : "disabled");
+    return asynSuccess;
+}
+
+/**
+ * @brief Writes the buffered trace spans to a Chrome trace event JSON file
+ *
+ * @param path Path of the file to write
+ * @return int asynStatus code
+ */
+extern "C" int ADXSPDTraceDump(const char* path) {
+    if (path == nullptr || strlen(path) == 0) {
+        fprintf(stderr, "ERROR | ADXSPDTraceDump: No output file given\n");
+        return asynError;
+    }
+    try {
+        size_t numEvents = ADXSPDTrace::Dump(path);
+        printf("INFO | ADXSPDTraceDump: Wrote %zu trace events to %s\n", numEvents, path);
+    } catch (std::exception& e) {
+        fprintf(stderr, "ERROR | ADXSPDTraceDump: %s\n", e.what());
+        return asynError;
+    }
     return asynSuccess;
 }
 
@@ -61,18 +330,98 @@ static string formatParamName(string name) {
     return name;
 }
 
-static NDDataType_t getDataTypeForBitDepth(int bitDepth) {
-    switch (bitDepth) {
-        case 1:
-        case 6:
+static NDDataType_t getDataTypeForPixelType(ADXSPDPixelType pixelType) {
+    switch (pixelType) {
+        case ADXSPDPixelType::UINT8:
             return NDUInt8;
-        case 12:
+        case ADXSPDPixelType::UINT16:
             return NDUInt16;
-        case 24:
+        case ADXSPDPixelType::UINT32:
             return NDUInt32;
+        case ADXSPDPixelType::FLOAT32:
+            return NDFloat32;
         default:
-            throw std::invalid_argument("Unsupported bit depth");
+            throw std::invalid_argument("Unsupported pixel type");
+    }
+}
+
+static mutex sharedApiMutex;
+// By server address and device ID, both as requested and as resolved once initialized
+static map<string, weak_ptr<XSPD::API>> sharedApis;
+
+static string getSharedAPIKey(const string& ip, int portNum, const string& deviceId) {
+    return ip + ":" + std::to_string(portNum) + "/" + deviceId;
+}
+
+/**
+ * @brief Returns the API object for an XSPD device, shared by all drivers connected to it, so that
+ * they share one set of connections, request limits and variable cache.
+ *
+ * A device requested by index, or left empty for the first device, is resolved through an API
+ * already connected to the same server, so it shares the API of a driver that named the device
+ * explicitly, and vice versa.
+ *
+ * @param ip The IP address of the XSPD server
+ * @param portNum The port number of the XSPD server
+ * @param deviceId The requested device ID, as passed to ADXSPDConfig
+ * @return shared_ptr<XSPD::API> The shared API object, created if this is the first driver
+ */
+static shared_ptr<XSPD::API> getSharedAPI(string ip, int portNum, string deviceId) {
+    lock_guard<mutex> lock(sharedApiMutex);
+    string key = getSharedAPIKey(ip, portNum, deviceId);
+    shared_ptr<XSPD::API> api = sharedApis[key].lock();
+    bool byIndex = deviceId.empty() || (deviceId.length() == 1 && isdigit(deviceId[0]));
+    if (api == nullptr && byIndex) {
+        string serverPrefix = getSharedAPIKey(ip, portNum, "");
+        for (auto& [otherKey, otherApi] : sharedApis) {
+            shared_ptr<XSPD::API> connectedApi = otherApi.lock();
+            if (otherKey.rfind(serverPrefix, 0) != 0 || connectedApi == nullptr ||
+                !connectedApi->IsConnected())
+                continue;
+            try {
+                string resolvedId =
+                    connectedApi->GetDeviceAtIndex(deviceId.empty() ? 0 : stoi(deviceId));
+                auto resolved = sharedApis.find(getSharedAPIKey(ip, portNum, resolvedId));
+                if (resolved != sharedApis.end()) api = resolved->second.lock();
+            } catch (std::exception& e) {
+                // Not resolvable right now, fall back to a separate API
+            }
+            break;
+        }
     }
+    if (api == nullptr) api = make_shared<XSPD::API>(ip, portNum);
+    sharedApis[key] = api;
+    return api;
+}
+
+/**
+ * @brief Makes an initialized API object available under the device ID it resolved to, so that
+ * drivers naming that device later share it.
+ *
+ * @param ip The IP address of the XSPD server
+ * @param portNum The port number of the XSPD server
+ * @param api The initialized API object
+ */
+static void shareResolvedAPI(string ip, int portNum, shared_ptr<XSPD::API> api) {
+    lock_guard<mutex> lock(sharedApiMutex);
+    weak_ptr<XSPD::API>& entry = sharedApis[getSharedAPIKey(ip, portNum, api->GetDeviceId())];
+    if (entry.expired()) entry = api;
+}
+
+/**
+ * @brief Registers the API object drivers connecting to an XSPD server should share, instead of
+ * creating one. Used to run the driver against a fake REST layer in benchmarks. The caller must
+ * keep the API alive until the drivers using it have been created.
+ *
+ * @param ip The IP address of the XSPD server, as passed to ADXSPDConfig
+ * @param portNum The port number of the XSPD server, as passed to ADXSPDConfig
+ * @param deviceId The requested device ID, as passed to ADXSPDConfig
+ * @param api The API object to share
+ */
+void registerSharedAPI(string ip, int portNum, string deviceId, shared_ptr<XSPD::API> api) {
+    if (portNum == 0) portNum = XSPD::DEFAULT_PORT;
+    lock_guard<mutex> lock(sharedApiMutex);
+    sharedApis[getSharedAPIKey(ip, portNum, deviceId)] = api;
 }
 
 /**
@@ -95,6 +444,31 @@ static void monitorThreadC(void* drvPvt) {
     pPvt->monitorThread();
 }
 
+/**
+ * @brief Wrapper C function passed to epicsThreadCreate to create topology validation thread
+ *
+ * @param drvPvt Pointer to instance of ADXSPD driver object
+ */
+static void topologyValidationThreadC(void* drvPvt) {
+    ADXSPD* pPvt = (ADXSPD*) drvPvt;
+    pPvt->topologyValidationThread();
+}
+
+/**
+ * @brief Returns the number of milliseconds elapsed since the given start time
+ */
+static double msSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Returns the number of nanoseconds between two time points
+ */
+static uint64_t nsBetween(chrono::steady_clock::time_point start,
+                          chrono::steady_clock::time_point end) {
+    return (uint64_t) chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+}
+
 // -----------------------------------------------------------------------
 // ADXSPD Acquisition Functions
 // -----------------------------------------------------------------------
@@ -135,79 +509,1562 @@ asynStatus ADXSPD::getAPIVar(int paramIndex, XSPD::APIComponent& component, stri
 }
 
 /**
- * @brief Starts acquisition
+ * @brief Reads a bound variable from the API, converting its wire type to a numeric value
  *
- * @return asynStatus asynSuccess on success, asynError on failure
+ * @param component The XSPD API component that owns the variable
+ * @param varName The name of the variable to read
+ * @param varType The wire type of the variable
+ * @return double The value of the variable; enums are returned as their integer value
  */
-asynStatus ADXSPD::acquireStart() {
-    setIntegerParam(ADAcquire, 1);
-    setIntegerParam(ADNumImagesCounter, 0);
+static double getBoundAPIVar(XSPD::APIComponent& component, const string& varName,
+                             ADXSPDVarType varType) {
+    switch (varType) {
+        case ADXSPDVarType::INT:
+            return component.GetVar<int>(varName);
+        case ADXSPDVarType::DOUBLE:
+            return component.GetVar<double>(varName);
+        case ADXSPDVarType::BOOL:
+            return component.GetVar<bool>(varName) ? 1 : 0;
+        case ADXSPDVarType::ON_OFF:
+            return static_cast<int>(component.GetVar<XSPD::OnOff>(varName));
+        case ADXSPDVarType::TRIGGER_MODE:
+            return static_cast<int>(component.GetVar<XSPD::TriggerMode>(varName));
+        case ADXSPDVarType::COUNTER_MODE:
+            return static_cast<int>(component.GetVar<XSPD::CounterMode>(varName));
+        case ADXSPDVarType::SHUFFLE_MODE:
+            return static_cast<int>(component.GetVar<XSPD::ShuffleMode>(varName));
+        case ADXSPDVarType::COMPRESSOR:
+            return static_cast<int>(component.GetVar<XSPD::Compressor>(varName));
+        default:
+            throw invalid_argument("Unsupported numeric type for variable " + varName);
+    }
+}
 
-    try {
-        int sizeX = this->pDetector->GetActiveDataPort()->GetVar<int>("frame_width");
-        int sizeY = this->pDetector->GetActiveDataPort()->GetVar<int>("frame_height");
-        setIntegerParam(ADSizeX, sizeX);
-        setIntegerParam(ADSizeY, sizeY);
-        setIntegerParam(ADStatus, ADStatusAcquire);
+/**
+ * @brief Writes a bound variable to the API, converting a numeric value to its wire type
+ *
+ * @param component The XSPD API component that owns the variable
+ * @param varName The name of the variable to write
+ * @param varType The wire type of the variable
+ * @param value The value to write; enums are passed as their integer value
+ * @return double The readback value returned by the API
+ */
+static double setBoundAPIVar(XSPD::APIComponent& component, const string& varName,
+                             ADXSPDVarType varType, double value) {
+    int intValue = static_cast<int>(lround(value));
+    switch (varType) {
+        case ADXSPDVarType::INT:
+            return component.SetVar<int>(varName, intValue);
+        case ADXSPDVarType::DOUBLE:
+            return component.SetVar<double>(varName, value);
+        case ADXSPDVarType::BOOL:
+            return component.SetVar<bool>(varName, intValue != 0) ? 1 : 0;
+        case ADXSPDVarType::ON_OFF:
+            return static_cast<int>(
+                component.SetVar<XSPD::OnOff>(varName, static_cast<XSPD::OnOff>(intValue)));
+        case ADXSPDVarType::TRIGGER_MODE:
+            return static_cast<int>(component.SetVar<XSPD::TriggerMode>(
+                varName, static_cast<XSPD::TriggerMode>(intValue)));
+        case ADXSPDVarType::COUNTER_MODE:
+            return static_cast<int>(component.SetVar<XSPD::CounterMode>(
+                varName, static_cast<XSPD::CounterMode>(intValue)));
+        case ADXSPDVarType::SHUFFLE_MODE:
+            return static_cast<int>(component.SetVar<XSPD::ShuffleMode>(
+                varName, static_cast<XSPD::ShuffleMode>(intValue)));
+        case ADXSPDVarType::COMPRESSOR:
+            return static_cast<int>(component.SetVar<XSPD::Compressor>(
+                varName, static_cast<XSPD::Compressor>(intValue)));
+        default:
+            throw invalid_argument("Unsupported numeric type for variable " + varName);
+    }
+}
 
-        callParamCallbacks();
+/**
+ * @brief Adds an entry to the parameter binding table. Called from the auto-generated
+ * createParamBindings().
+ *
+ * @param binding The binding to register
+ */
+void ADXSPD::registerParamBinding(const ADXSPDParamBinding& binding) {
+    if (binding.paramIndex >= (int) this->bindingForParam.size())
+        this->bindingForParam.resize(binding.paramIndex + 1, -1);
+    this->bindingForParam[binding.paramIndex] = (int) this->paramBindings.size();
+    this->paramBindings.push_back(binding);
+    this->bindingCache.push_back(nullopt);
+}
 
-        this->pDetector->ExecCommand("start");
+/**
+ * @brief Looks up the API variable binding for an asyn parameter
+ *
+ * @param paramIndex The index of the asyn parameter
+ * @return const ADXSPDParamBinding* The binding, or nullptr if the parameter is not bound
+ */
+const ADXSPDParamBinding* ADXSPD::getParamBinding(int paramIndex) {
+    if (paramIndex < 0 || paramIndex >= (int) this->bindingForParam.size()) return nullptr;
+    int bindingIndex = this->bindingForParam[paramIndex];
+    if (bindingIndex < 0) return nullptr;
+    return &this->paramBindings[bindingIndex];
+}
 
-        INFO_TO_STATUS("Acquisition started");
+/**
+ * @brief Reads a bound variable from the API and sets the corresponding asyn parameter
+ *
+ * @param binding The binding describing the parameter and variable
+ * @return asynStatus asynSuccess on success, asynError on failure
+ */
+asynStatus ADXSPD::readBoundParam(const ADXSPDParamBinding& binding) {
+    XSPD::APIComponent* component = this->pDetector;
+    if (binding.component == ADXSPDVarComponent::DATA_PORT)
+        component = this->pDetector->GetActiveDataPort();
+    if (component == nullptr) {
+        ERR_TO_STATUS_ARGS("No active data port to read parameter %s from",
+                           binding.readVar.c_str());
+        return asynError;
+    }
+
+    try {
+        if (binding.readType == ADXSPDVarType::STRING) {
+            setStringParam(binding.paramIndex, component->GetVar<string>(binding.readVar).c_str());
+            return asynSuccess;
+        }
 
+        double apiValue = getBoundAPIVar(*component, binding.readVar, binding.readType);
+        this->bindingCache[this->bindingForParam[binding.paramIndex]] = apiValue;
+        if (binding.readType == ADXSPDVarType::DOUBLE)
+            setDoubleParam(binding.paramIndex, apiValue / binding.scale);
+        else
+            setIntegerParam(binding.paramIndex, (int) lround(apiValue / binding.scale));
     } catch (std::exception& e) {
-        ERR_TO_STATUS_ARGS("Failed to start acquisition: %s", e.what());
+        ERR_TO_STATUS_ARGS("Failed to read API parameter %s/%s: %s", component->GetId().c_str(),
+                           binding.readVar.c_str(), e.what());
         return asynError;
     }
     return asynSuccess;
 }
 
 /**
- * @brief stops acquisition by aborting exposure and joinging acq thread
+ * @brief Writes a bound variable to the API and sets the corresponding asyn parameter to the
+ * readback value. If the binding allows it, writes matching the last known readback are skipped.
+ *
+ * @param binding The binding describing the parameter and variable
+ * @param value The requested value, in asyn parameter units
+ * @return double The readback value, in asyn parameter units
+ */
+double ADXSPD::writeBoundParam(const ADXSPDParamBinding& binding, double value) {
+    XSPD::APIComponent* component = this->pDetector;
+    if (binding.component == ADXSPDVarComponent::DATA_PORT)
+        component = this->pDetector->GetActiveDataPort();
+    if (component == nullptr) throw runtime_error("No active data port to write parameter to");
+
+    optional<double>& cached = this->bindingCache[this->bindingForParam[binding.paramIndex]];
+    double apiValue = value * binding.scale;
+    if (binding.cachePolicy == ADXSPDCachePolicy::READBACK && cached.has_value() &&
+        cached.value() == apiValue) {
+        DEBUG_ARGS("Skipping write of %s, already set to %f", binding.writeVar.c_str(), apiValue);
+        apiValue = cached.value();
+    } else {
+        apiValue = setBoundAPIVar(*component, binding.writeVar, binding.writeType, apiValue);
+    }
+    return this->publishBoundParam(binding, apiValue);
+}
+
+/**
+ * @brief Stores the readback of a written bound variable in the binding cache, and sets the
+ * corresponding asyn parameter to it
+ *
+ * @param binding The binding describing the parameter and variable
+ * @param apiValue The readback value returned by the API
+ * @return double The readback value, in asyn parameter units
+ */
+double ADXSPD::publishBoundParam(const ADXSPDParamBinding& binding, double apiValue) {
+    this->bindingCache[this->bindingForParam[binding.paramIndex]] = apiValue;
+    double actualValue = apiValue / binding.scale;
+    if (binding.writeType == ADXSPDVarType::DOUBLE)
+        setDoubleParam(binding.paramIndex, actualValue);
+    else
+        setIntegerParam(binding.paramIndex, (int) lround(actualValue));
+    return actualValue;
+}
+
+/**
+ * @brief Re-reads derived driver and module state after a bound variable has changed
+ *
+ * @param refreshMask Combination of ADXSPD_REFRESH_* flags
+ */
+void ADXSPD::refreshDependents(int refreshMask) {
+    if (refreshMask & ADXSPD_REFRESH_DATA_TYPE) {
+        // Frames are converted to the output data type if one is set, otherwise have the type
+        // for the bit depth
+        ADXSPDFrameFormat format;
+        getIntegerParam(ADXSPD_BitDepth, &format.bitDepth);
+        getIntegerParam(ADXSPD_OutputDataType, (int*) &format.outputType);
+        try {
+            setIntegerParam(NDDataType,
+                            static_cast<int>(getDataTypeForPixelType(format.GetOutputType())));
+        } catch (std::invalid_argument& e) {
+            ERR_ARGS("Failed to determine data type for bit depth %d: %s", format.bitDepth,
+                     e.what());
+        }
+    }
+    for (auto& module : this->modules) {
+        if (refreshMask & ADXSPD_REFRESH_MAX_FRAMES) module->getMaxNumImages();
+        if (refreshMask & ADXSPD_REFRESH_FLATFIELD) module->getFlatfieldState();
+    }
+}
+
+/**
+ * @brief Returns the smallest max frame count across all modules, re-reading it from each
+ *
+ * @return int Maximum number of images that can be requested
+ */
+int ADXSPD::getMaxNumImages() {
+    int maxNumImages = INT_MAX;
+    for (auto& module : this->modules) {
+        int moduleMax = module->getMaxNumImages();
+        if (moduleMax < maxNumImages) {
+            maxNumImages = moduleMax;
+        }
+    }
+    return maxNumImages;
+}
+
+// -----------------------------------------------------------------------
+// ADXSPD Preset Functions
+// -----------------------------------------------------------------------
+
+/**
+ * @brief Builds the path of the preset file selected by the PresetDir and PresetName PVs
+ *
+ * @return string Path to the preset JSON file, or an empty string if no preset is selected
+ */
+string ADXSPD::getPresetPath() {
+    char presetDir[256], presetName[256];
+    getStringParam(ADXSPD_PresetDir, sizeof(presetDir), presetDir);
+    getStringParam(ADXSPD_PresetName, sizeof(presetName), presetName);
+    if (strlen(presetName) == 0) return "";
+
+    string path = presetDir;
+    if (!path.empty() && path.back() != '/') path += "/";
+    return path + presetName + ".json";
+}
+
+/**
+ * @brief Captures the current detector configuration to a named preset file.
+ *
+ * All writable bound variables are re-read from the detector, so that the preset reflects the
+ * actual detector state, along with the number of frames and thresholds.
  *
  * @return asynStatus asynSuccess on success, asynError on failure
  */
-asynStatus ADXSPD::acquireStop() {
-    setIntegerParam(ADAcquire, 0);
+asynStatus ADXSPD::savePreset() {
+    string presetPath = this->getPresetPath();
+    if (presetPath.empty()) {
+        ERR_TO_STATUS("No preset name set");
+        return asynError;
+    }
+
+    json preset;
+    char presetName[256];
+    getStringParam(ADXSPD_PresetName, sizeof(presetName), presetName);
+    preset["name"] = presetName;
+    preset["variables"] = json::object();
+
+    for (auto& binding : this->paramBindings) {
+        if (!binding.writable) continue;
+        if (this->readBoundParam(binding) != asynSuccess) {
+            ERR_TO_STATUS_ARGS("Failed to capture %s for preset %s", binding.readVar.c_str(),
+                               presetName);
+            return asynError;
+        }
+        preset["variables"][binding.writeVar] =
+            this->bindingCache[this->bindingForParam[binding.paramIndex]].value();
+    }
+
     try {
-        this->pDetector->ExecCommand("stop");
-        setIntegerParam(ADStatus, ADStatusIdle);
-        callParamCallbacks();
+        preset["n_frames"] = this->pDetector->GetVar<int>("n_frames");
+        preset["thresholds"] = this->pDetector->GetVar<vector<double>>("thresholds");
     } catch (std::exception& e) {
-        ERR_TO_STATUS_ARGS("Failed to stop acquisition: %s", e.what());
+        ERR_TO_STATUS_ARGS("Failed to capture preset %s: %s", presetName, e.what());
+        return asynError;
+    }
+
+    ofstream presetFile(presetPath);
+    if (!presetFile.is_open()) {
+        ERR_TO_STATUS_ARGS("Failed to open preset file %s for writing", presetPath.c_str());
         return asynError;
     }
-    return asynSuccess;
+    presetFile << preset.dump(4) << endl;
+
+    callParamCallbacks();
+    INFO_TO_STATUS_ARGS("Saved preset %s to %s", presetName, presetPath.c_str());
+    return asynSuccess;
+}
+
+/**
+ * @brief Applies a set of detector settings, in the preset file format.
+ *
+ * The settings are compared against the cached detector state, and only variables that differ
+ * are written. Variables that other settings depend on (counter mode, ROI, bit depth) are written
+ * first, one at a time in table order. The remaining variables and the thresholds do not depend on
+ * each other, so are written concurrently by a bounded set of workers. n_frames comes
+ * last. Refreshing derived state such as module max frames and the NDArray data type is deferred
+ * until all variables have been written, rather than done after each one.
+ *
+ * @param settings Settings to apply, with optional variables, thresholds and n_frames entries
+ * @return int Number of writes made to the detector
+ * @throws runtime_error if any write fails, after refreshing the state written so far
+ */
+int ADXSPD::applySettings(const json& settings) {
+    vector<const ADXSPDParamBinding*> orderedWrites, independentWrites;
+    for (auto& binding : this->paramBindings) {
+        if (!binding.writable) continue;
+        if (binding.refreshMask != 0)
+            orderedWrites.push_back(&binding);
+        else
+            independentWrites.push_back(&binding);
+    }
+
+    json variables = settings.value("variables", json::object());
+    auto needsWrite = [&](const ADXSPDParamBinding* binding) {
+        if (!variables.contains(binding->writeVar)) return false;
+        optional<double>& cached = this->bindingCache[this->bindingForParam[binding->paramIndex]];
+        return !cached.has_value() || cached.value() != variables[binding->writeVar].get<double>();
+    };
+
+    int numWrites = 0, refreshMask = ADXSPD_REFRESH_NONE;
+    try {
+        for (auto binding : orderedWrites) {
+            if (!needsWrite(binding)) continue;
+            this->writeBoundParam(*binding, variables[binding->writeVar].get<double>() /
+                                                binding->scale);
+            refreshMask |= binding->refreshMask;
+            numWrites++;
+        }
+
+        // Resolve and parse everything before starting any write, so that once writes are in
+        // flight, every one of them is waited for and published
+        struct PendingWrite {
+            const ADXSPDParamBinding* binding;
+            XSPD::APIComponent* component;
+            double apiValue;
+            optional<double> readback;
+            string error;
+        };
+        vector<PendingWrite> pendingWrites;
+        for (auto binding : independentWrites) {
+            if (!needsWrite(binding)) continue;
+            XSPD::APIComponent* component = this->pDetector;
+            if (binding->component == ADXSPDVarComponent::DATA_PORT)
+                component = this->pDetector->GetActiveDataPort();
+            if (component == nullptr)
+                throw runtime_error("No active data port to write parameter to");
+            pendingWrites.push_back(
+                {binding, component, variables[binding->writeVar].get<double>(), nullopt, ""});
+        }
+
+        vector<int> thresholdParams;
+        vector<pair<XSPD::Threshold, double>> thresholdWrites;
+        if (settings.contains("thresholds")) {
+            vector<double> thresholds = settings["thresholds"].get<vector<double>>();
+            int params[] = {ADXSPD_LowThreshold, ADXSPD_HighThreshold};
+            XSPD::Threshold thresholdIds[] = {XSPD::Threshold::LOW, XSPD::Threshold::HIGH};
+            for (size_t i = 0; i < thresholds.size() && i < 2; i++) {
+                double currentThreshold;
+                getDoubleParam(params[i], &currentThreshold);
+                if (currentThreshold == thresholds[i]) continue;
+                thresholdParams.push_back(params[i]);
+                thresholdWrites.push_back({thresholdIds[i], thresholds[i]});
+            }
+        }
+
+        // Each variable is one task, and both thresholds one more, as they are written through the
+        // one thresholds variable so one after the other. Tasks are shared out to a bounded set of
+        // workers, one per module plus one as when reading the initial state.
+        XSPD::Detector* detector = this->pDetector;
+        vector<double> thresholdReadbacks;
+        string thresholdError;
+        vector<function<void()>> tasks;
+        for (auto& write : pendingWrites) {
+            tasks.push_back([&write]() {
+                try {
+                    write.readback = setBoundAPIVar(*write.component, write.binding->writeVar,
+                                                    write.binding->writeType, write.apiValue);
+                } catch (std::exception& e) {
+                    write.error = e.what();
+                }
+            });
+        }
+        if (!thresholdWrites.empty()) {
+            tasks.push_back([&]() {
+                try {
+                    for (auto& [thresholdId, value] : thresholdWrites)
+                        thresholdReadbacks.push_back(detector->SetThreshold(thresholdId, value));
+                } catch (std::exception& e) {
+                    thresholdError = e.what();
+                }
+            });
+        }
+
+        int numWorkers = min((int) tasks.size(), (int) this->modules.size() + 1);
+        XSPD::API::ScopedConcurrency concurrency(this->pApi.get(), numWorkers);
+        atomic<size_t> nextTask{0};
+        vector<future<void>> workers;
+        for (int i = 0; i < numWorkers; i++) {
+            workers.push_back(async(launch::async, [&tasks, &nextTask]() {
+                for (size_t task = nextTask++; task < tasks.size(); task = nextTask++)
+                    tasks[task]();
+            }));
+        }
+        for (auto& worker : workers) worker.get();
+
+        // Publish every write that succeeded before reporting the first failure
+        string firstError;
+        for (auto& write : pendingWrites) {
+            if (write.readback.has_value()) {
+                this->publishBoundParam(*write.binding, write.readback.value());
+                numWrites++;
+            } else if (firstError.empty()) {
+                firstError = write.error;
+            }
+        }
+        for (size_t i = 0; i < thresholdReadbacks.size(); i++) {
+            setDoubleParam(thresholdParams[i], thresholdReadbacks[i]);
+            numWrites++;
+        }
+        if (firstError.empty()) firstError = thresholdError;
+        if (!firstError.empty()) throw runtime_error(firstError);
+
+        // n_frames is validated against the module max frame counts, so must come after the
+        // variables that change them.
+        this->refreshDependents(refreshMask & ~ADXSPD_REFRESH_MAX_FRAMES);
+        if (settings.contains("n_frames")) {
+            int numImages = settings["n_frames"].get<int>(), currentNumImages;
+            getIntegerParam(ADNumImages, &currentNumImages);
+            if (numImages != currentNumImages) {
+                int maxNumImages = this->getMaxNumImages();
+                if (numImages < 1 || numImages > maxNumImages) {
+                    throw invalid_argument("n_frames " + to_string(numImages) +
+                                           " out of range 1-" + to_string(maxNumImages));
+                }
+                numImages = this->pDetector->SetVar<int>("n_frames", numImages);
+                setIntegerParam(ADNumImages, numImages);
+                setIntegerParam(ADImageMode, numImages == 1 ? ADImageSingle : ADImageMultiple);
+                numWrites++;
+            } else if (refreshMask & ADXSPD_REFRESH_MAX_FRAMES) {
+                this->getMaxNumImages();
+            }
+        } else if (refreshMask & ADXSPD_REFRESH_MAX_FRAMES) {
+            this->getMaxNumImages();
+        }
+    } catch (std::exception& e) {
+        this->refreshDependents(refreshMask);
+        throw runtime_error(string(e.what()) + " (after " + to_string(numWrites) + " writes)");
+    }
+    return numWrites;
+}
+
+/**
+ * @brief Applies a named preset to the detector, writing only the variables that differ from the
+ * current state. The time taken and the number of writes are published to PVs.
+ *
+ * @return asynStatus asynSuccess on success, asynError on failure
+ */
+asynStatus ADXSPD::applyPreset() {
+    string presetPath = this->getPresetPath();
+    if (presetPath.empty()) {
+        ERR_TO_STATUS("No preset name set");
+        return asynError;
+    }
+
+    ifstream presetFile(presetPath);
+    if (!presetFile.is_open()) {
+        ERR_TO_STATUS_ARGS("Failed to open preset file %s", presetPath.c_str());
+        return asynError;
+    }
+
+    auto startTime = chrono::steady_clock::now();
+
+    json preset;
+    try {
+        preset = json::parse(presetFile);
+    } catch (json::parse_error& e) {
+        ERR_TO_STATUS_ARGS("Failed to parse preset file %s: %s", presetPath.c_str(), e.what());
+        return asynError;
+    }
+
+    int numWrites;
+    try {
+        numWrites = this->applySettings(preset);
+    } catch (std::exception& e) {
+        ERR_TO_STATUS_ARGS("Failed to apply preset %s: %s", presetPath.c_str(), e.what());
+        return asynError;
+    }
+
+    double switchTime = msSince(startTime);
+    setIntegerParam(ADXSPD_PresetNumWrites, numWrites);
+    setDoubleParam(ADXSPD_PresetSwitchTime, switchTime);
+    callParamCallbacks();
+    INFO_TO_STATUS_ARGS("Applied preset %s with %d writes in %.1f ms",
+                        preset.value("name", presetPath).c_str(), numWrites, switchTime);
+    return asynSuccess;
+}
+
+// -----------------------------------------------------------------------
+// ADXSPD Connection Functions
+// -----------------------------------------------------------------------
+
+/**
+ * @brief Collects the last known detector settings, in the preset file format, from the binding
+ * cache and the frame count and threshold parameters.
+ *
+ * @return json The last known settings
+ */
+json ADXSPD::getCachedSettings() {
+    json settings;
+    settings["variables"] = json::object();
+    for (auto& binding : this->paramBindings) {
+        optional<double>& cached = this->bindingCache[this->bindingForParam[binding.paramIndex]];
+        if (binding.writable && cached.has_value())
+            settings["variables"][binding.writeVar] = cached.value();
+    }
+
+    int numImages;
+    getIntegerParam(ADNumImages, &numImages);
+    if (numImages > 0) settings["n_frames"] = numImages;
+
+    // Thresholds that were never set read back as 0, and must not be created on restore
+    double lowThreshold, highThreshold;
+    getDoubleParam(ADXSPD_LowThreshold, &lowThreshold);
+    getDoubleParam(ADXSPD_HighThreshold, &highThreshold);
+    settings["thresholds"] = json::array();
+    if (lowThreshold > 0) settings["thresholds"].push_back(lowThreshold);
+    if (lowThreshold > 0 && highThreshold > 0) settings["thresholds"].push_back(highThreshold);
+    return settings;
+}
+
+/**
+ * @brief Reads the current detector settings from the API, in the preset file format. Read-only
+ * bound variables are included too, so that they can be published along with the rest. Neither
+ * the binding cache nor any parameters are touched, so the port lock need not be held.
+ *
+ * @return json The current detector settings, in API units
+ */
+json ADXSPD::readDetectorSettings() {
+    json settings;
+    settings["variables"] = json::object();
+    for (auto& binding : this->paramBindings) {
+        if (binding.readType == ADXSPDVarType::STRING) continue;
+        XSPD::APIComponent* component = this->pDetector;
+        if (binding.component == ADXSPDVarComponent::DATA_PORT)
+            component = this->pDetector->GetActiveDataPort();
+        if (component == nullptr) continue;
+        try {
+            settings["variables"][binding.writeVar] =
+                getBoundAPIVar(*component, binding.readVar, binding.readType);
+        } catch (std::exception& e) {
+            ERR_ARGS("Failed to read API parameter %s/%s: %s", component->GetId().c_str(),
+                     binding.readVar.c_str(), e.what());
+        }
+    }
+    settings["n_frames"] = this->pDetector->GetVar<int>("n_frames");
+    settings["thresholds"] = this->pDetector->GetVar<vector<double>>("thresholds");
+    return settings;
+}
+
+/**
+ * @brief Publishes settings read by readDetectorSettings() to the binding cache and parameters
+ *
+ * @param settings The detector settings, in API units
+ */
+void ADXSPD::publishDetectorSettings(const json& settings) {
+    for (auto& binding : this->paramBindings) {
+        if (!settings["variables"].contains(binding.writeVar)) continue;
+        this->publishBoundParam(binding, settings["variables"][binding.writeVar].get<double>());
+    }
+
+    int numImages = settings["n_frames"].get<int>();
+    setIntegerParam(ADNumImages, numImages);
+    setIntegerParam(ADImageMode, numImages == 1 ? ADImageSingle : ADImageMultiple);
+
+    vector<double> thresholds = settings["thresholds"].get<vector<double>>();
+    if (thresholds.size() > 0) setDoubleParam(ADXSPD_LowThreshold, thresholds[0]);
+    if (thresholds.size() > 1) setDoubleParam(ADXSPD_HighThreshold, thresholds[1]);
+    this->refreshDependents(ADXSPD_REFRESH_DATA_TYPE);
+}
+
+/**
+ * @brief Publishes the XSPD server version information, which is only available while connected
+ *
+ * @param serialNumber The detector serial number, read with Detector::GetSerialNumber()
+ */
+void ADXSPD::setVersionInfo(const string& serialNumber) {
+    setStringParam(ADXSPD_ApiVersion, this->pApi->GetApiVersion().c_str());
+    setStringParam(ADXSPD_Version, this->pApi->GetXSPDVersion().c_str());
+    setStringParam(ADSerialNumber, serialNumber.c_str());
+}
+
+/**
+ * @brief Reads the initial state of the detector and of all modules. Modules are read concurrently
+ * with each other and with the detector itself, since each module is its own asyn port and they do
+ * not share any parameter state. Phase durations are added to the startup time breakdown.
+ *
+ * @param numInitThreads Number of concurrent requests to allow, 0 for one per module
+ */
+void ADXSPD::readInitialState(int numInitThreads) {
+    auto phaseTime = chrono::steady_clock::now();
+    int numModules = (int) this->modules.size();
+    // Scoped rather than set, as other drivers sharing the API may be reading their state too
+    XSPD::API::ScopedConcurrency concurrency(
+        this->pApi.get(), numInitThreads > 0 ? numInitThreads : numModules + 1);
+    vector<future<double>> moduleStateTimes;
+    for (auto& module : this->modules) {
+        moduleStateTimes.push_back(async(launch::async, [module]() {
+            auto moduleTime = chrono::steady_clock::now();
+            module->lock();
+            try {
+                module->getInitialModuleState();
+            } catch (...) {
+                module->unlock();
+                throw;
+            }
+            module->unlock();
+            return msSince(moduleTime);
+        }));
+    }
+
+    asynStatus status = this->getInitialDetState();
+    if (status != asynSuccess) ERR("Failed to read one or more initial detector parameters.");
+    this->startupTimes.push_back({"detector state", msSince(phaseTime)});
+
+    double slowestModuleTime = 0;
+    for (size_t index = 0; index < moduleStateTimes.size(); index++) {
+        try {
+            slowestModuleTime = max(slowestModuleTime, moduleStateTimes[index].get());
+        } catch (std::exception& e) {
+            ERR_ARGS("Failed to read initial state of module %zu: %s", index + 1, e.what());
+        }
+    }
+    this->startupTimes.push_back({"slowest module state", slowestModuleTime});
+    this->startupTimes.push_back({"initial state", msSince(phaseTime)});
+    this->initialStateRead = true;
+}
+
+/**
+ * @brief Checks whether a parameter write has to reach the detector, and so must be rejected
+ * while disconnected.
+ *
+ * @param function The asyn parameter index being written
+ * @return true if the write needs a connection to the XSPD server
+ */
+bool ADXSPD::writeRequiresConnection(int function) {
+    const ADXSPDParamBinding* binding = this->getParamBinding(function);
+    return (binding != nullptr && binding->writable) || function == ADAcquire ||
+           function == ADImageMode || function == ADNumImages ||
+           function == ADXSPD_LowThreshold || function == ADXSPD_HighThreshold ||
+           function == ADXSPD_SavePreset || function == ADXSPD_ApplyPreset;
+}
+
+/**
+ * @brief Handles a lost connection to the XSPD server. Any acquisition in progress is abandoned,
+ * and reconnect attempts start with the minimum backoff delay.
+ */
+void ADXSPD::onDisconnect() {
+    this->disconnectTime = chrono::steady_clock::now();
+    this->reconnectDelay = ADXSPD_RECONNECT_MIN_DELAY;
+
+    this->lock();
+    setIntegerParam(ADXSPD_ConnectionState, static_cast<int>(this->pApi->GetState()));
+    setIntegerParam(ADAcquire, 0);
+    setIntegerParam(ADStatus, ADStatusDisconnected);
+    this->closeChunkWriter();
+    WARN_TO_STATUS("Lost connection to XSPD server, reconnecting...");
+    this->unlock();
+}
+
+/**
+ * @brief Makes a single attempt to reconnect to the XSPD server, doubling the backoff delay on
+ * failure. Once reconnected, the data port is re-subscribed, and the last known settings are
+ * restored to the detector, writing only those that the server no longer has. The detector is
+ * re-read without the port lock, which is only taken to publish the result and write back the
+ * settings. If the driver started without a connection, the initial detector state is read
+ * instead.
+ */
+void ADXSPD::reconnect() {
+    try {
+        this->pApi->Reconnect();
+    } catch (std::exception& e) {
+        WARN_ARGS("Reconnect failed, retrying in %.1f s: %s", this->reconnectDelay, e.what());
+        this->reconnectDelay = min(this->reconnectDelay * 2, ADXSPD_RECONNECT_MAX_DELAY);
+        return;
+    }
+
+    INFO("Reconnected to XSPD server, restoring detector state...");
+    this->resubscribeRequested = true;
+
+    int numWrites = 0;
+    if (!this->initialStateRead) {
+        // Nothing to restore yet. The initial read publishes as it goes, so holds the port lock,
+        // as it does when connected at startup.
+        this->lock();
+        try {
+            this->setVersionInfo(this->pDetector->GetSerialNumber());
+            this->readInitialState(this->numInitThreads);
+        } catch (std::exception& e) {
+            ERR_TO_STATUS_ARGS("Failed to read detector state after reconnect: %s", e.what());
+        }
+    } else {
+        // Re-read the detector, which may have lost its settings if the server restarted, without
+        // holding the port lock. Modules only need their own lock.
+        string serialNumber;
+        json currentSettings;
+        try {
+            serialNumber = this->pDetector->GetSerialNumber();
+            currentSettings = this->readDetectorSettings();
+            for (auto& module : this->modules) {
+                module->lock();
+                try {
+                    module->getInitialModuleState();
+                } catch (...) {
+                    module->unlock();
+                    throw;
+                }
+                module->unlock();
+            }
+        } catch (std::exception& e) {
+            ERR_ARGS("Failed to read detector state after reconnect: %s", e.what());
+        }
+
+        // Then publish what was read, and write back whatever differs from what we had before
+        this->lock();
+        try {
+            json settings = this->getCachedSettings();
+            if (currentSettings.is_null())
+                throw runtime_error("detector state could not be read");
+            this->setVersionInfo(serialNumber);
+            this->publishDetectorSettings(currentSettings);
+            numWrites = this->applySettings(settings);
+        } catch (std::exception& e) {
+            ERR_TO_STATUS_ARGS("Failed to restore detector state after reconnect: %s", e.what());
+        }
+    }
+
+    double recoveryTime = 0;
+    if (this->disconnectTime.has_value()) {
+        recoveryTime = chrono::duration<double>(chrono::steady_clock::now() -
+                                                this->disconnectTime.value())
+                           .count();
+        this->disconnectTime.reset();
+    }
+
+    int numReconnects;
+    getIntegerParam(ADXSPD_NumReconnects, &numReconnects);
+    setIntegerParam(ADXSPD_NumReconnects, numReconnects + 1);
+    setIntegerParam(ADXSPD_ConnectionState, static_cast<int>(this->pApi->GetState()));
+    setDoubleParam(ADXSPD_TimeToRecover, recoveryTime);
+    setIntegerParam(ADStatus, ADStatusIdle);
+    INFO_TO_STATUS_ARGS("Reconnected to XSPD server in %.2f s, restored %d settings", recoveryTime,
+                        numWrites);
+    this->unlock();
+}
+
+/**
+ * @brief Starts acquisition
+ *
+ * @return asynStatus asynSuccess on success, asynError on failure
+ */
+asynStatus ADXSPD::acquireStart() {
+    setIntegerParam(ADAcquire, 1);
+    setIntegerParam(ADNumImagesCounter, 0);
+
+    try {
+        int sizeX = this->pDetector->GetActiveDataPort()->GetVar<int>("frame_width");
+        int sizeY = this->pDetector->GetActiveDataPort()->GetVar<int>("frame_height");
+        setIntegerParam(ADSizeX, sizeX);
+        setIntegerParam(ADSizeY, sizeY);
+        setIntegerParam(ADStatus, ADStatusAcquire);
+
+        // A setting chosen after the last series and not yet applied by the monitor thread is
+        // applied now, so this series runs with it. This must come before opening the chunk
+        // writer, whose filter is set from the compression settings.
+        this->applyAutoTune();
+
+        if (this->openChunkWriter() != asynSuccess) {
+            setIntegerParam(ADAcquire, 0);
+            setIntegerParam(ADStatus, ADStatusIdle);
+            callParamCallbacks();
+            return asynError;
+        }
+
+        int autoTune;
+        getIntegerParam(ADXSPD_AutoTune, &autoTune);
+        if (autoTune) this->startAutoTuneSeries();
+        this->seriesStarted = true;
+        this->frameHandlerStale = true;
+
+        callParamCallbacks();
+
+        this->pDetector->ExecCommand("start");
+
+        // A capture being replayed stands in for the data port from the start of acquisition
+        this->startReplay();
+
+        INFO_TO_STATUS("Acquisition started");
+
+    } catch (std::exception& e) {
+        this->closeChunkWriter();
+        ERR_TO_STATUS_ARGS("Failed to start acquisition: %s", e.what());
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+/**
+ * @brief stops acquisition by aborting exposure and joinging acq thread
+ *
+ * @return asynStatus asynSuccess on success, asynError on failure
+ */
+asynStatus ADXSPD::acquireStop() {
+    setIntegerParam(ADAcquire, 0);
+    this->replayArmed = false;
+    this->closeChunkWriter();
+    try {
+        this->pDetector->ExecCommand("stop");
+        setIntegerParam(ADStatus, ADStatusIdle);
+        this->endAutoTuneSeries();
+        callParamCallbacks();
+    } catch (std::exception& e) {
+        ERR_TO_STATUS_ARGS("Failed to stop acquisition: %s", e.what());
+        return asynError;
+    }
+    return asynSuccess;
+}
+
+/**
+ * @brief Starts measuring the acquisition series about to start for auto-tuning, with the
+ * compression settings currently in use
+ */
+void ADXSPD::startAutoTuneSeries() {
+    int decompress, bitDepth, maxThreads;
+    double target;
+    getIntegerParam(ADXSPD_Decompress, &decompress);
+    if (!decompress) {
+        WARN("Auto-tuning needs frames decompressed in the driver, not measuring this series");
+        return;
+    }
+
+    ADXSPDTuneSetting setting;
+    getIntegerParam(ADXSPD_Compressor, (int*) &setting.compressor);
+    getIntegerParam(ADXSPD_CompressLevel, &setting.level);
+    getIntegerParam(ADXSPD_ShuffleMode, (int*) &setting.shuffleMode);
+    getIntegerParam(ADXSPD_BloscNumThreads, &setting.numThreads);
+    getIntegerParam(ADXSPD_BitDepth, &bitDepth);
+    getDoubleParam(ADXSPD_AutoTuneTarget, &target);
+    getIntegerParam(ADXSPD_AutoTuneMaxThreads, &maxThreads);
+
+    this->autoTuner.SetTargetUtilization(target / 100.0);
+    this->autoTuner.SetMaxThreads(maxThreads);
+    this->autoTuner.StartSeries(setting, bitDepth);
+}
+
+/**
+ * @brief Ends the auto-tuning series of the acquisition just stopped, and queues the setting
+ * chosen for the next one. Called from acquireStop, which the acquisition thread calls without the
+ * port lock, so the setting is applied later by applyAutoTune.
+ */
+void ADXSPD::endAutoTuneSeries() {
+    optional<ADXSPDTuneDecision> decision = this->autoTuner.EndSeries();
+    if (!decision.has_value()) return;
+    lock_guard<mutex> lock(this->tuneDecisionMutex);
+    this->pendingTuneDecision = std::move(decision);
+}
+
+/**
+ * @brief Applies the queued auto-tuned setting, if any. Called with the port lock held while idle,
+ * from the monitor thread or when the next acquisition starts.
+ *
+ * The compressor and compression level bindings are not writable, as there are no output records
+ * for them and they are not captured in presets, but auto-tuning writes them directly. This is
+ * safe as it only happens while idle, and only ever writes codec settings from the tuner's fixed
+ * ladder, or ones read back from the detector, so never an arbitrary value.
+ */
+void ADXSPD::applyAutoTune() {
+    optional<ADXSPDTuneDecision> decision;
+    {
+        lock_guard<mutex> lock(this->tuneDecisionMutex);
+        decision.swap(this->pendingTuneDecision);
+    }
+    if (!decision.has_value()) return;
+
+    const ADXSPDTuneSetting& setting = decision->setting;
+    string settingName = setting.ToString();
+    setStringParam(ADXSPD_AutoTuneSetting, settingName.c_str());
+    setStringParam(ADXSPD_AutoTuneReason, decision->reason.c_str());
+    INFO_ARGS("Auto-tune: %s. %s", settingName.c_str(), decision->reason.c_str());
+
+    if (!this->pApi->IsConnected()) {
+        WARN("Not connected to XSPD server, auto-tuned setting not applied");
+        return;
+    }
+
+    // The compressor is written first, as the level and shuffle mode it accepts depend on it
+    vector<pair<int, int>> values = {{ADXSPD_Compressor, (int) setting.compressor}};
+    if (setting.compressor != XSPD::Compressor::NONE) {
+        values.push_back({ADXSPD_CompressLevel, setting.level});
+        values.push_back({ADXSPD_ShuffleMode, (int) setting.shuffleMode});
+    }
+    try {
+        for (const auto& [paramIndex, value] : values) {
+            const ADXSPDParamBinding* binding = this->getParamBinding(paramIndex);
+            this->writeBoundParam(*binding, value);
+            this->refreshDependents(binding->refreshMask);
+        }
+    } catch (std::exception& e) {
+        ERR_ARGS("Failed to apply auto-tuned setting %s: %s", settingName.c_str(), e.what());
+        return;
+    }
+    if (XSPD::IsBloscCompressor(setting.compressor))
+        setIntegerParam(ADXSPD_BloscNumThreads, setting.numThreads);
+}
+
+/**
+ * @brief Selects the frame handler for the current decode settings. Called from the acquisition
+ * thread when the settings have changed; on failure no frames are read out until it succeeds.
+ */
+void ADXSPD::selectFrameHandler() {
+    ADXSPDFrameFormat format;
+    int decompress, outputCompressor;
+    getIntegerParam(ADXSPD_BitDepth, &format.bitDepth);
+    getIntegerParam(ADXSPD_Compressor, (int*) &format.compressor);
+    getIntegerParam(ADXSPD_CompressLevel, &format.compressionLevel);
+    getIntegerParam(ADXSPD_ShuffleMode, (int*) &format.shuffleMode);
+    getIntegerParam(ADXSPD_BloscNumThreads, &format.numThreads);
+    getIntegerParam(ADXSPD_Decompress, &decompress);
+    getIntegerParam(ADXSPD_OutputCompressor, &outputCompressor);
+    getIntegerParam(ADSizeX, &format.width);
+    getIntegerParam(ADSizeY, &format.height);
+    format.transform = this->seriesTransform;
+    format.outputType = this->saturationGuard.GetOutputType(this->seriesOutputType);
+    // Output compression, transforms and conversions all work on decoded frames, so need the
+    // driver to decompress
+    format.decompress =
+        decompress || XSPD::IsBloscCompressor(static_cast<XSPD::Compressor>(outputCompressor));
+    try {
+        format.decompress = format.decompress || format.IsTiled();
+    } catch (std::invalid_argument& e) {
+        // Unsupported bit depths are reported when creating the handler below
+    }
+
+    this->frameHandler.reset();
+    try {
+        this->frameHandler = ADXSPDFrameHandler::Create(format);
+        setIntegerParam(NDDataType,
+                        static_cast<int>(getDataTypeForPixelType(format.GetOutputType())));
+        DEBUG_ARGS("Selected frame handler %s", this->frameHandler->GetName().c_str());
+    } catch (std::exception& e) {
+        ERR_ARGS("Failed to select frame handler: %s", e.what());
+    }
+}
+
+/**
+ * @brief Subtracts two frames element-wise with floor at 0
+ *
+ * @tparam T The data type of the frame pixels
+ * @param currentFrame Pointer to the current frame data
+ * @param previousFrame Pointer to the previous frame data
+ * @param outputFrame Pointer to the output frame data
+ * @param numBytes Number of bytes in each frame
+ */
+template <typename T>
+void ADXSPD::subtractFrames(void* currentFrame, void* previousFrame, void* outputFrame,
+                            size_t numBytes) {
+    ADXSPDKernels::SubtractFrames<T>(static_cast<T*>(currentFrame), static_cast<T*>(previousFrame),
+                                     static_cast<T*>(outputFrame), numBytes / sizeof(T));
+}
+
+/**
+ * @brief Creates a ZMQ subscriber socket connected to the active data port. A receive timeout is
+ * set, so that the acquisition thread can periodically check for re-subscribe requests.
+ *
+ * @return void* The subscriber socket, or nullptr on failure
+ */
+void* ADXSPD::connectDataPort() {
+    void* zmqSubscriber = zmq_socket(this->zmqContext, ZMQ_SUB);
+    int rc = zmq_connect(zmqSubscriber, this->pDetector->GetActiveDataPort()->GetURI().c_str());
+    if (rc != 0) {
+        ERR_TO_STATUS_ARGS("Failed to connect to data port zmq socket at %s:%d",
+                           this->dataPortIp.c_str(), this->dataPortPort);
+        zmq_close(zmqSubscriber);
+        return nullptr;
+    }
+    // Subscribe to all messages
+    int recvTimeout = ADXSPD_ZMQ_RECV_TIMEOUT_MS;
+    rc = zmq_setsockopt(zmqSubscriber, ZMQ_SUBSCRIBE, "", 0);
+    if (rc == 0) rc = zmq_setsockopt(zmqSubscriber, ZMQ_RCVTIMEO, &recvTimeout, sizeof(int));
+    if (rc != 0) {
+        ERR_TO_STATUS_ARGS("Failed to set zmq socket options for data port at %s:%d",
+                           this->dataPortIp.c_str(), this->dataPortPort);
+        zmq_close(zmqSubscriber);
+        return nullptr;
+    }
+
+    INFO_ARGS("Connected to data port zmq socket at %s:%d", this->dataPortIp.c_str(),
+              this->dataPortPort);
+    return zmqSubscriber;
+}
+
+/**
+ * @brief Appends a frame to the capture file, exactly as received, if capturing. A failed write
+ * stops the capture.
+ *
+ * @param frameMessages The message parts of the frame
+ * @param receivedTime Time at which all message parts of the frame had been received
+ * @return bool Whether the frame should be read out as usual
+ */
+bool ADXSPD::captureFrame(vector<zmq_msg_t>& frameMessages,
+                          chrono::steady_clock::time_point receivedTime) {
+    TRACE_SPAN("acquisition", "capture");
+    lock_guard<mutex> lock(this->captureMutex);
+    if (this->captureWriter == nullptr) return true;
+
+    vector<ADXSPDCapturePart> parts;
+    parts.reserve(frameMessages.size());
+    for (auto& messagePart : frameMessages)
+        parts.push_back({zmq_msg_data(&messagePart), zmq_msg_size(&messagePart)});
+
+    uint64_t previousBytes = this->captureWriter->GetNumBytes();
+    try {
+        this->captureWriter->Append(parts.data(), parts.size(), receivedTime);
+    } catch (std::exception& e) {
+        ERR_ARGS("Stopping capture: %s", e.what());
+        this->captureWriter.reset();
+        this->capturing = false;
+        return true;
+    }
+    this->numFramesCaptured++;
+    this->numCaptureBytes += this->captureWriter->GetNumBytes() - previousBytes;
+    return this->captureDecode;
+}
+
+/**
+ * @brief Opens a direct chunk writer for the acquisition being started, if AutoSave is enabled.
+ * The file is named from the NDFile parameters, and its filter is set from the current compressor
+ * settings, which cannot change while acquiring.
+ *
+ * @return asynStatus asynSuccess if not writing or the file was created, else asynError
+ */
+asynStatus ADXSPD::openChunkWriter() {
+    int autoSave, directWriteOnly, autoIncrement, fileNumber;
+    getIntegerParam(NDAutoSave, &autoSave);
+    if (!autoSave) return asynSuccess;
+
+    char fullFileName[MAX_FILENAME_LEN];
+    if (this->checkPath() != asynSuccess ||
+        this->createFileName(sizeof(fullFileName), fullFileName) != asynSuccess) {
+        setIntegerParam(NDFileWriteStatus, NDFileWriteError);
+        setStringParam(NDFileWriteMessage, "Invalid file path or name");
+        ERR_TO_STATUS("Cannot write frames, invalid file path or name");
+        return asynError;
+    }
+
+    int sizeX, sizeY, compressionLevel;
+    ADXSPDFrameFormat format;
+    XSPD::Compressor compressor;
+    XSPD::ShuffleMode shuffleMode;
+    getIntegerParam(ADSizeX, &sizeX);
+    getIntegerParam(ADSizeY, &sizeY);
+    getIntegerParam(ADXSPD_BitDepth, &format.bitDepth);
+    getIntegerParam(ADXSPD_Compressor, (int*) &compressor);
+    getIntegerParam(ADXSPD_ShuffleMode, (int*) &shuffleMode);
+    getIntegerParam(ADXSPD_CompressLevel, &compressionLevel);
+    getIntegerParam(ADXSPD_DirectWriteOnly, &directWriteOnly);
+
+    try {
+        // Chunks are written as received, so with the detector's pixel type, not the output type
+        int bytesPerPixel = (int) ADXSPDFrameHandler::GetPixelSize(format.GetInputType());
+        auto writer = make_unique<ADXSPDChunkWriter>(fullFileName, sizeX, sizeY, bytesPerPixel,
+                                                     compressor, shuffleMode, compressionLevel);
+        lock_guard<mutex> lock(this->chunkWriterMutex);
+        this->chunkWriter = std::move(writer);
+        this->chunkReadOut = !directWriteOnly;
+        this->writingChunks = true;
+    } catch (std::exception& e) {
+        setIntegerParam(NDFileWriteStatus, NDFileWriteError);
+        setStringParam(NDFileWriteMessage, e.what());
+        ERR_TO_STATUS_ARGS("Cannot write frames: %s", e.what());
+        return asynError;
+    }
+
+    setStringParam(NDFullFileName, fullFileName);
+    setIntegerParam(NDFileNumCaptured, 0);
+    setIntegerParam(NDFileWriteStatus, NDFileWriteOK);
+    setStringParam(NDFileWriteMessage, "");
+    getIntegerParam(NDAutoIncrement, &autoIncrement);
+    if (autoIncrement) {
+        getIntegerParam(NDFileNumber, &fileNumber);
+        setIntegerParam(NDFileNumber, fileNumber + 1);
+    }
+    INFO_ARGS("Writing %s compressed frames to %s",
+              string(magic_enum::enum_name(compressor)).c_str(), fullFileName);
+    return asynSuccess;
+}
+
+/**
+ * @brief Writes a frame's compressed payload straight into the next HDF5 chunk, if writing. A
+ * failed write stops writing for the rest of the acquisition.
+ *
+ * @param frameMessages The message parts of the frame
+ * @return bool Whether the frame should be read out as usual
+ */
+bool ADXSPD::writeChunk(vector<zmq_msg_t>& frameMessages) {
+    TRACE_SPAN("acquisition", "write chunk");
+    lock_guard<mutex> lock(this->chunkWriterMutex);
+    if (this->chunkWriter == nullptr) return true;
+
+    // Malformed frames are left to the readout, which reports and drops them
+    if (frameMessages.size() != 3 || zmq_msg_size(&frameMessages[1]) < 4) return true;
+
+    const uint8_t* header = (const uint8_t*) zmq_msg_data(&frameMessages[1]);
+    ADXSPDChunkFrameInfo info = {
+        header[0], header[1], header[2],
+        chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count()};
+    size_t payloadSize = zmq_msg_size(&frameMessages[2]);
+    try {
+        this->chunkWriter->WriteFrame(zmq_msg_data(&frameMessages[2]), payloadSize, info);
+    } catch (std::exception& e) {
+        ERR_ARGS("Stopping direct chunk writing: %s", e.what());
+        setIntegerParam(NDFileWriteStatus, NDFileWriteError);
+        setStringParam(NDFileWriteMessage, e.what());
+        this->chunkWriter.reset();
+        this->writingChunks = false;
+        return true;
+    }
+    this->numFramesWritten++;
+    this->numChunkBytes += payloadSize;
+    setIntegerParam(NDFileNumCaptured, (int) this->chunkWriter->GetNumFrames());
+    return this->chunkReadOut;
+}
+
+/**
+ * @brief Closes the direct chunk writer, if open, completing the file
+ */
+void ADXSPD::closeChunkWriter() {
+    lock_guard<mutex> lock(this->chunkWriterMutex);
+    if (this->chunkWriter == nullptr) return;
+    this->writingChunks = false;
+    try {
+        this->chunkWriter->Close();
+        INFO_ARGS("Wrote %lu frames, %.1f MB to %s",
+                  (unsigned long) this->chunkWriter->GetNumFrames(),
+                  this->chunkWriter->GetNumBytes() / 1e6, this->chunkWriter->GetPath().c_str());
+    } catch (std::exception& e) {
+        ERR_ARGS("Failed to close %s: %s", this->chunkWriter->GetPath().c_str(), e.what());
+        setIntegerParam(NDFileWriteStatus, NDFileWriteError);
+        setStringParam(NDFileWriteMessage, e.what());
+    }
+    setIntegerParam(NDFileNumCaptured, (int) this->chunkWriter->GetNumFrames());
+    this->chunkWriter.reset();
+}
+
+/**
+ * @brief Compresses a decoded frame with blosc into a new NDArray, with its codec set so that
+ * plugins downstream can decompress it. Blosc splits the frame into blocks, which are compressed
+ * in parallel by numThreads threads.
+ *
+ * @param pArray The decoded frame
+ * @param compressor Blosc compressor to use
+ * @param shuffleMode Shuffle to apply before compressing
+ * @param level Compression level, 0-9
+ * @param numThreads Number of blosc threads
+ * @return NDArray* The compressed frame, or nullptr if it could not be compressed
+ */
+NDArray* ADXSPD::compressFrame(NDArray* pArray, XSPD::Compressor compressor,
+                               XSPD::ShuffleMode shuffleMode, int level, int numThreads) {
+    NDArrayInfo arrayInfo;
+    pArray->getInfo(&arrayInfo);
+    size_t dims[ND_ARRAY_MAX_DIMS];
+    for (int i = 0; i < pArray->ndims; i++) dims[i] = pArray->dims[i].size;
+
+    size_t maxCompressedSize = arrayInfo.totalBytes + BLOSC_MAX_OVERHEAD;
+    NDArray* pCompressed = this->pNDArrayPool->alloc(pArray->ndims, dims, pArray->dataType,
+                                                     maxCompressedSize, NULL);
+    if (pCompressed == nullptr) {
+        ERR("Failed to allocate array for compressed frame");
+        return nullptr;
+    }
+
+    string compressorName = XSPD::GetBloscSubcompressorName(compressor);
+    auto startTime = chrono::steady_clock::now();
+    int compressedSize = blosc_compress_ctx(
+        level, static_cast<int>(shuffleMode), arrayInfo.bytesPerElement, arrayInfo.totalBytes,
+        pArray->pData, pCompressed->pData, maxCompressedSize, compressorName.c_str(), 0,
+        numThreads);
+    if (compressedSize <= 0) {
+        ERR_ARGS("Failed to compress frame with blosc/%s, status %d", compressorName.c_str(),
+                 compressedSize);
+        pCompressed->release();
+        return nullptr;
+    }
+    this->outputCompressStats.record(arrayInfo.totalBytes, compressedSize,
+                                     nsBetween(startTime, chrono::steady_clock::now()));
+
+    pCompressed->epicsTS = pArray->epicsTS;
+    pCompressed->timeStamp = pArray->timeStamp;
+    pCompressed->compressedSize = compressedSize;
+    pCompressed->codec.name = "blosc";
+    pCompressed->codec.compressor = XSPD::GetBloscSubcompressorId(compressor);
+    pCompressed->codec.shuffle = static_cast<int>(shuffleMode);
+    pCompressed->codec.level = level;
+    return pCompressed;
+}
+
+/**
+ * @brief Starts replaying the loaded capture from its first frame, if there is one
+ */
+void ADXSPD::startReplay() {
+    lock_guard<mutex> lock(this->captureMutex);
+    if (this->replayReader == nullptr) return;
+    this->replayNext = 0;
+    this->replayStart = chrono::steady_clock::now();
+    this->replayArmed = true;
+}
+
+/**
+ * @brief Waits for the next frame of the capture being replayed to be due, and copies it into
+ * message parts as if it had been received from the data port. While waiting, the subscriber
+ * socket is polled, so that the wait ends when the ZMQ context is terminated; anything published
+ * on the real data port in the meantime is discarded.
+ *
+ * @param zmqSubscriber The data port subscriber socket
+ * @param frameMessages Filled with the message parts of the frame
+ * @return int 1 if a frame was received, 0 if none was due within the receive timeout, or -1 if
+ * the ZMQ context was terminated
+ */
+int ADXSPD::receiveReplayFrame(void* zmqSubscriber, vector<zmq_msg_t>& frameMessages) {
+    auto deadline =
+        chrono::steady_clock::now() + chrono::milliseconds(ADXSPD_ZMQ_RECV_TIMEOUT_MS);
+    shared_ptr<ADXSPDCaptureReader> reader;
+    size_t recordIndex = 0;
+    chrono::steady_clock::time_point dueTime = deadline;
+    {
+        lock_guard<mutex> lock(this->captureMutex);
+        if (this->replayArmed && this->replayReader != nullptr &&
+            this->replayNext < this->replayReader->GetNumRecords()) {
+            reader = this->replayReader;
+            recordIndex = this->replayNext;
+            dueTime = this->replayStart;
+            if (this->replaySpeed > 0) {
+                // Frames are replayed relative to the first, not to when the capture was started
+                uint64_t offsetNs = reader->GetRecord(recordIndex).receivedNs -
+                                    reader->GetRecord(0).receivedNs;
+                dueTime += chrono::nanoseconds((int64_t) (offsetNs / this->replaySpeed));
+            }
+        }
+    }
+
+    auto waitUntil = min(dueTime, deadline);
+    while (true) {
+        auto now = chrono::steady_clock::now();
+        if (now >= waitUntil) break;
+        long waitMs = (long) chrono::duration_cast<chrono::milliseconds>(waitUntil - now).count();
+        if (waitMs == 0) {
+            this_thread::sleep_until(waitUntil);
+            break;
+        }
+        zmq_pollitem_t pollItem = {zmqSubscriber, 0, ZMQ_POLLIN, 0};
+        int rc = zmq_poll(&pollItem, 1, waitMs);
+        if (rc < 0 && errno == ETERM) return -1;
+        if (rc > 0) {
+            zmq_msg_t discarded;
+            zmq_msg_init(&discarded);
+            while (zmq_msg_recv(&discarded, zmqSubscriber, ZMQ_DONTWAIT) >= 0) {
+            }
+            zmq_msg_close(&discarded);
+        }
+    }
+    if (reader == nullptr || chrono::steady_clock::now() < dueTime) return 0;
+
+    {
+        // Replay may have been stopped or restarted while waiting
+        lock_guard<mutex> lock(this->captureMutex);
+        if (!this->replayArmed || this->replayReader != reader || this->replayNext != recordIndex)
+            return 0;
+        this->replayNext++;
+        if (this->replayNext == reader->GetNumRecords())
+            INFO_ARGS("Replayed all %zu frames of the capture", reader->GetNumRecords());
+    }
+
+    ADXSPDCaptureRecord record = reader->GetRecord(recordIndex);
+    for (auto& part : record.parts) {
+        zmq_msg_t messagePart;
+        zmq_msg_init_size(&messagePart, part.size);
+        memcpy(zmq_msg_data(&messagePart), part.data, part.size);
+        frameMessages.push_back(messagePart);
+        this->numZmqParts++;
+        this->numZmqBytes += part.size;
+    }
+    return 1;
+}
+
+/**
+ * @brief Records the stage latencies and sizes of a frame that was read out successfully
+ *
+ * @param receivedTime Time at which all message parts of the frame had been received
+ * @param decodedTime Time at which the frame had been decompressed or copied into the NDArray
+ * @param callbacksTime Time at which the NDArray callbacks had completed
+ * @param wireBytes Size of the frame as received from the data port
+ * @param outputBytes Size of the decompressed frame
+ */
+void ADXSPD::recordFrameStats(chrono::steady_clock::time_point receivedTime,
+                              chrono::steady_clock::time_point decodedTime,
+                              chrono::steady_clock::time_point callbacksTime, size_t wireBytes,
+                              size_t outputBytes) {
+    this->stageLatency[(int) ADXSPDFrameStage::DECODE].record(nsBetween(receivedTime, decodedTime));
+    this->stageLatency[(int) ADXSPDFrameStage::CALLBACKS].record(
+        nsBetween(decodedTime, callbacksTime));
+    this->stageLatency[(int) ADXSPDFrameStage::TOTAL].record(
+        nsBetween(receivedTime, callbacksTime));
+    this->wireRateMeter.record(wireBytes, callbacksTime);
+    this->outputRateMeter.record(outputBytes, callbacksTime);
+}
+
+/**
+ * @brief Applies pending statistics resets, and publishes the latency percentiles and rates once
+ * every ADXSPD_STATS_PUBLISH_INTERVAL. Called from the acquisition thread, including while idle so
+ * that the rates decay to zero once frames stop arriving.
+ */
+void ADXSPD::updateFrameStats() {
+    if (this->statsResetRequested.exchange(false)) {
+        for (auto& histogram : this->stageLatency) histogram.reset();
+        for (auto& stats : this->codecStats) stats.reset();
+        this->outputCompressStats.reset();
+        this->wireRateMeter.reset();
+        this->outputRateMeter.reset();
+        this->lastStatsPublish = {};
+    }
+
+    auto now = chrono::steady_clock::now();
+    if (now - this->lastStatsPublish < chrono::duration<double>(ADXSPD_STATS_PUBLISH_INTERVAL))
+        return;
+    this->lastStatsPublish = now;
+
+    // Latencies are published in ms, one waveform element per ADXSPDFrameStage
+    double p50[ADXSPD_NUM_FRAME_STAGES], p99[ADXSPD_NUM_FRAME_STAGES],
+        maxLatency[ADXSPD_NUM_FRAME_STAGES];
+    for (int i = 0; i < ADXSPD_NUM_FRAME_STAGES; i++) {
+        p50[i] = this->stageLatency[i].percentile(0.5) / 1e6;
+        p99[i] = this->stageLatency[i].percentile(0.99) / 1e6;
+        maxLatency[i] = this->stageLatency[i].max() / 1e6;
+    }
+    doCallbacksFloat64Array(p50, ADXSPD_NUM_FRAME_STAGES, ADXSPD_LatencyP50, 0);
+    doCallbacksFloat64Array(p99, ADXSPD_NUM_FRAME_STAGES, ADXSPD_LatencyP99, 0);
+    doCallbacksFloat64Array(maxLatency, ADXSPD_NUM_FRAME_STAGES, ADXSPD_LatencyMax, 0);
+
+    setDoubleParam(ADXSPD_FrameRate, this->wireRateMeter.eventRate(now));
+    setDoubleParam(ADXSPD_WireRate, this->wireRateMeter.byteRate(now) / 1e6);
+    setDoubleParam(ADXSPD_OutputRate, this->outputRateMeter.byteRate(now) / 1e6);
+
+    const ADXSPDCodecStats& output = this->outputCompressStats;
+    double outputRatio =
+        output.outputBytes() > 0 ? (double) output.inputBytes() / output.outputBytes() : 0.0;
+    setDoubleParam(ADXSPD_OutputRatio, outputRatio);
+    setDoubleParam(ADXSPD_OutputCompressRate, output.inputRate() / 1e6);
+    callParamCallbacks();
+}
+
+/**
+ * @brief Publishes the combined REST request statistics of the XSPD server connection. Called
+ * from the monitor thread with the driver lock held.
+ */
+void ADXSPD::publishRestStats() {
+    XSPD::EndpointStats total = this->pApi->GetTotalStats();
+    setIntegerParam(ADXSPD_RestNumRequests, (int) total.numRequests);
+    setIntegerParam(ADXSPD_RestNumErrors, (int) total.numErrors);
+    setDoubleParam(ADXSPD_RestData, (total.bytesSent + total.bytesReceived) / 1e3);
+    setDoubleParam(ADXSPD_RestLatencyP50, total.p50Ms);
+    setDoubleParam(ADXSPD_RestLatencyP99, total.p99Ms);
+    setDoubleParam(ADXSPD_RestLatencyMax, total.maxMs);
+
+    // The endpoint the most time has been spent waiting on
+    vector<XSPD::EndpointStats> endpointStats = this->pApi->GetEndpointStats();
+    setStringParam(ADXSPD_RestSlowestEndpoint,
+                   endpointStats.empty() ? "" : endpointStats.front().endpoint.c_str());
+    callParamCallbacks();
+}
+
+/**
+ * @brief Clears the REST request statistics, see ADXSPDResetRestStats
+ */
+void ADXSPD::resetRestStats() {
+    this->pApi->ResetEndpointStats();
+    INFO("Reset REST request statistics");
+
+    this->lock();
+    this->publishRestStats();
+    this->unlock();
+}
+
+/**
+ * @brief Starts or stops recording REST requests, see ADXSPDRecordRest
+ *
+ * @param path File to record to, or empty to stop recording
+ */
+void ADXSPD::recordRest(const string& path) {
+    if (path.empty()) {
+        this->pApi->StopRecording();
+        INFO("Stopped recording REST requests");
+        return;
+    }
+    this->pApi->StartRecording(path);
+    INFO_ARGS("Recording REST requests to %s", path.c_str());
+}
+
+/**
+ * @brief Starts or stops capturing data port messages, see ADXSPDCapture
+ *
+ * @param path File to capture to, or empty to stop capturing
+ * @param decode Whether captured frames are also read out
+ */
+void ADXSPD::capture(const string& path, bool decode) {
+    unique_ptr<ADXSPDCaptureWriter> writer;
+    if (!path.empty()) writer = make_unique<ADXSPDCaptureWriter>(path);
+
+    lock_guard<mutex> lock(this->captureMutex);
+    if (this->captureWriter != nullptr) {
+        INFO_ARGS("Captured %lu frames, %.1f MB to %s",
+                  (unsigned long) this->captureWriter->GetNumRecords(),
+                  this->captureWriter->GetNumBytes() / 1e6,
+                  this->captureWriter->GetPath().c_str());
+    }
+    this->captureWriter = std::move(writer);
+    this->captureDecode = decode;
+    this->capturing = this->captureWriter != nullptr;
+    if (this->capturing) {
+        INFO_ARGS("Capturing data port messages to %s%s", path.c_str(),
+                  decode ? "" : ", without reading out frames");
+    }
 }
 
 /**
- * @brief Subtracts two frames element-wise with floor at 0
+ * @brief Replays a capture in place of the data port, see ADXSPDReplayCapture
  *
- * @tparam T The data type of the frame pixels
- * @param currentFrame Pointer to the current frame data
- * @param previousFrame Pointer to the previous frame data
- * @param outputFrame Pointer to the output frame data
- * @param numBytes Number of bytes in each frame
+ * @param path Capture file, or empty to return to the data port
+ * @param speed Replay speed relative to the original timing, or 0 to replay as fast as possible
  */
-template <typename T>
-void ADXSPD::subtractFrames(void* currentFrame, void* previousFrame, void* outputFrame,
-                            size_t numBytes) {
-    // Cast the void pointers to the appropriate type
-    T* currFrameT = static_cast<T*>(currentFrame);
-    T* prevFrameT = static_cast<T*>(previousFrame);
-    T* outFrameT = static_cast<T*>(outputFrame);
-
-    // Calculate our number of elements, and then perform subtraction with floor at 0
-    size_t numElements = numBytes / sizeof(T);
-    for (size_t i = 0; i < numElements; i++) {
-        T subtractedPixel = currFrameT[i] - prevFrameT[i];
-        if (subtractedPixel < 0) {
-            outFrameT[i] = T(0);
-        } else {
-            outFrameT[i] = subtractedPixel;
-        }
+void ADXSPD::replayCapture(const string& path, double speed) {
+    shared_ptr<ADXSPDCaptureReader> reader;
+    if (!path.empty()) reader = make_shared<ADXSPDCaptureReader>(path);
+
+    lock_guard<mutex> lock(this->captureMutex);
+    this->replayReader = reader;
+    this->replaySpeed = max(0.0, speed);
+    this->replayNext = 0;
+    this->replayArmed = false;
+    this->replaying = reader != nullptr;
+    if (reader == nullptr) {
+        INFO("Stopped replaying capture, receiving frames from the data port");
+        return;
+    }
+    if (this->replaySpeed > 0) {
+        INFO_ARGS("Replaying %zu frames (%.3f s) from %s in place of the data port, at %gx speed",
+                  reader->GetNumRecords(), reader->GetDurationNs() / 1e9, path.c_str(),
+                  this->replaySpeed);
+    } else {
+        INFO_ARGS("Replaying %zu frames from %s in place of the data port, as fast as possible",
+                  reader->GetNumRecords(), path.c_str());
+    }
+}
+
+/**
+ * @brief Writes the driver's frame, data port, and module metrics. Called from the metrics
+ * server thread, and only reads atomics and internally locked statistics, so never takes the port
+ * lock and cannot delay acquisition.
+ *
+ * @param writer Metrics writer to add samples to
+ */
+void ADXSPD::collectMetrics(ADXSPDMetricsWriter& writer) {
+    string port = this->portName;
+    ADXSPDMetricLabels labels = {{"port", port}};
+
+    writer.Gauge("xspd_connected", "1 if the XSPD server connection is up", labels,
+                 this->pApi->IsConnected() ? 1 : 0);
+    writer.Gauge("xspd_server_frames_queued", "Frames queued on the XSPD server", labels,
+                 this->framesQueued.load(memory_order_relaxed));
+
+    writer.Counter("xspd_frames_received_total", "Frames received from the data port", labels,
+                   (double) this->numFramesReceived);
+    writer.Counter("xspd_frames_decoded_total", "Frames read out into an NDArray", labels,
+                   (double) this->numFramesDecoded);
+    writer.Counter("xspd_frames_dropped_total", "Frames discarded due to malformed data or errors",
+                   labels, (double) this->numFramesDropped);
+    writer.Counter("xspd_frames_published_total", "Frames passed to NDArray callbacks", labels,
+                   (double) this->numFramesPublished);
+    writer.Gauge("xspd_frame_rate_hz", "Frame rate over the last few seconds", labels,
+                 this->wireRateMeter.eventRate());
+    writer.Gauge("xspd_wire_bytes_per_second", "Data port throughput before decompression", labels,
+                 this->wireRateMeter.byteRate());
+    writer.Gauge("xspd_output_bytes_per_second", "NDArray throughput after decompression", labels,
+                 this->outputRateMeter.byteRate());
+
+    writer.Counter("xspd_zmq_message_parts_total", "Data port message parts received", labels,
+                   (double) this->numZmqParts);
+    writer.Counter("xspd_zmq_received_bytes_total", "Data port bytes received", labels,
+                   (double) this->numZmqBytes);
+    writer.Counter("xspd_zmq_receive_timeouts_total", "Data port receive timeouts", labels,
+                   (double) this->numZmqTimeouts);
+    writer.Counter("xspd_zmq_receive_errors_total", "Data port receive errors", labels,
+                   (double) this->numZmqErrors);
+    writer.Counter("xspd_frames_captured_total", "Frames written to a capture file", labels,
+                   (double) this->numFramesCaptured);
+    writer.Counter("xspd_capture_bytes_total", "Bytes written to capture files", labels,
+                   (double) this->numCaptureBytes);
+    writer.Counter("xspd_frames_written_total", "Frames written directly to HDF5 chunks", labels,
+                   (double) this->numFramesWritten);
+    writer.Counter("xspd_chunk_bytes_total", "Compressed bytes written to HDF5 chunks", labels,
+                   (double) this->numChunkBytes);
+
+    for (int i = 0; i < ADXSPD_NUM_FRAME_STAGES; i++) {
+        ADXSPDMetricLabels stageLabels = labels;
+        stageLabels.push_back(
+            {"stage", string(magic_enum::enum_name(static_cast<ADXSPDFrameStage>(i)))});
+        writer.Summary("xspd_frame_stage_seconds", "Time spent in each frame pipeline stage",
+                       stageLabels, this->stageLatency[i], 1e-9);
+    }
+
+    for (size_t i = 0; i < this->codecStats.size(); i++) {
+        const ADXSPDCodecStats& stats = this->codecStats[i];
+        if (stats.numFrames() == 0) continue;
+        ADXSPDMetricLabels codecLabels = labels;
+        codecLabels.push_back(
+            {"codec", string(magic_enum::enum_name(magic_enum::enum_value<XSPD::Compressor>(i)))});
+        writer.Counter("xspd_decode_frames_total", "Frames decoded, by codec", codecLabels,
+                       (double) stats.numFrames());
+        writer.Counter("xspd_decode_seconds_total", "Time spent decoding frames, by codec",
+                       codecLabels, stats.totalSeconds());
+        writer.Counter("xspd_decode_input_bytes_total", "Bytes in to the decoder, by codec",
+                       codecLabels, (double) stats.inputBytes());
+        writer.Counter("xspd_decode_output_bytes_total", "Bytes out of the decoder, by codec",
+                       codecLabels, (double) stats.outputBytes());
     }
+
+    writer.Counter("xspd_output_compress_seconds_total", "Time spent compressing frames for output",
+                   labels, this->outputCompressStats.totalSeconds());
+    writer.Counter("xspd_output_compress_input_bytes_total", "Bytes in to output compression",
+                   labels, (double) this->outputCompressStats.inputBytes());
+    writer.Counter("xspd_output_compress_output_bytes_total", "Bytes out of output compression",
+                   labels, (double) this->outputCompressStats.outputBytes());
+
+    writer.Gauge("xspd_ndarray_pool_buffers", "NDArray buffers allocated by the pool", labels,
+                 this->pNDArrayPool->getNumBuffers());
+    writer.Gauge("xspd_ndarray_pool_free_buffers", "NDArray buffers free in the pool", labels,
+                 this->pNDArrayPool->getNumFree());
+    writer.Gauge("xspd_ndarray_pool_bytes", "Memory allocated by the NDArray pool", labels,
+                 (double) this->pNDArrayPool->getMemorySize());
+    writer.Gauge("xspd_ndarray_pool_max_bytes", "Memory limit of the NDArray pool", labels,
+                 (double) this->pNDArrayPool->getMaxMemory());
+
+    writer.Summary("xspd_status_poll_seconds", "Duration of detector status polls", labels,
+                   this->statusPollLatency, 1e-9);
+    for (auto& module : this->modules) module->collectMetrics(writer, port);
 }
 
 /**
@@ -224,58 +2081,88 @@ void ADXSPD::acquisitionThread() {
     // void* frameBuffer = nullptr;
     // void* prevFrameBuffer = nullptr;
 
-    int arrayCallbacks, decompress;
+    int arrayCallbacks;
     int collectedImages;
 
-    void* zmqSubscriber = zmq_socket(this->zmqContext, ZMQ_SUB);
-    int rc = zmq_connect(zmqSubscriber, this->pDetector->GetActiveDataPort()->GetURI().c_str());
-    if (rc != 0) {
-        ERR_TO_STATUS_ARGS("Failed to connect to data port zmq socket at %s:%d",
-                           this->dataPortIp.c_str(), this->dataPortPort);
-        return;
-    }
-    // Subscribe to all messages
-    rc = zmq_setsockopt(zmqSubscriber, ZMQ_SUBSCRIBE, "", 0);
-    if (rc != 0) {
-        ERR_TO_STATUS_ARGS("Failed to set zmq socket options for data port at %s:%d",
-                           this->dataPortIp.c_str(), this->dataPortPort);
-        return;
-    }
+    ADXSPDTrace::SetThreadName("acquisitionThread");
 
-    INFO_ARGS("Connected to data port zmq socket at %s:%d", this->dataPortIp.c_str(),
-              this->dataPortPort);
+    void* zmqSubscriber = this->connectDataPort();
+    if (zmqSubscriber == nullptr) return;
 
     // Run acquisition loop forever, until zmq context is terminated in the destructor
     while (true) {
+        // After a reconnect, the data port may have been restarted along with the server
+        if (this->resubscribeRequested.exchange(false)) {
+            INFO("Re-subscribing to data port...");
+            zmq_close(zmqSubscriber);
+            zmqSubscriber = this->connectDataPort();
+            if (zmqSubscriber == nullptr) return;
+            this->numZmqResubscribes++;
+        }
+
         vector<zmq_msg_t> frameMessages;
         int more;
         size_t moreSize = sizeof(more);
-        do {
-            zmq_msg_t messagePart;
-            zmq_msg_init(&messagePart);
-
-            int rc = zmq_msg_recv(&messagePart, zmqSubscriber, 0);
-            if (rc == -1) {
-                if (errno == ETERM) {
-                    // Context terminated, exit thread
-                    INFO("ZMQ context terminated, exiting acquisition thread...");
-                    zmq_msg_close(&messagePart);
-                    for (auto& msgPart : frameMessages) {
-                        zmq_msg_close(&msgPart);
+        bool timedOut = false;
+        ADXSPDTraceSpan receiveSpan("acquisition", "zmq receive");
+        if (this->replaying) {
+            int rc = this->receiveReplayFrame(zmqSubscriber, frameMessages);
+            if (rc < 0) {
+                INFO("ZMQ context terminated, exiting acquisition thread...");
+                for (auto& msgPart : frameMessages) zmq_msg_close(&msgPart);
+                zmq_close(zmqSubscriber);
+                return;
+            }
+            timedOut = rc == 0;
+            if (timedOut) this->numZmqTimeouts++;
+        } else {
+            do {
+                zmq_msg_t messagePart;
+                zmq_msg_init(&messagePart);
+
+                int rc = zmq_msg_recv(&messagePart, zmqSubscriber, 0);
+                if (rc == -1) {
+                    if (errno == ETERM) {
+                        // Context terminated, exit thread
+                        INFO("ZMQ context terminated, exiting acquisition thread...");
+                        zmq_msg_close(&messagePart);
+                        for (auto& msgPart : frameMessages) {
+                            zmq_msg_close(&msgPart);
+                        }
+                        frameMessages.clear();
+                        zmq_close(zmqSubscriber);
+                        return;
+                    } else if (errno == EAGAIN) {
+                        // No frame within the receive timeout
+                        zmq_msg_close(&messagePart);
+                        timedOut = true;
+                        this->numZmqTimeouts++;
+                        break;
                     }
-                    frameMessages.clear();
-                    zmq_close(zmqSubscriber);
-                    return;
+                    ERR("Failed to receive ZMQ message");
+                    this->numZmqErrors++;
+                    break;
                 }
-                ERR("Failed to receive ZMQ message");
-                break;
-            }
 
-            frameMessages.push_back(messagePart);
-            DEBUG_ARGS("Received message part of size %zu\n", zmq_msg_size(&messagePart));
+                frameMessages.push_back(messagePart);
+                this->numZmqParts++;
+                this->numZmqBytes += zmq_msg_size(&messagePart);
+                DEBUG_ARGS("Received message part of size %zu", zmq_msg_size(&messagePart));
+
+                zmq_getsockopt(zmqSubscriber, ZMQ_RCVMORE, &more, &moreSize);
+            } while (more);
+        }
+        receiveSpan.End();
 
-            zmq_getsockopt(zmqSubscriber, ZMQ_RCVMORE, &more, &moreSize);
-        } while (more);
+        if (timedOut && frameMessages.empty()) {
+            this->updateFrameStats();
+            continue;
+        }
+        auto receivedTime = chrono::steady_clock::now();
+        TRACE_SPAN("acquisition", "frame");
+        this->numFramesReceived++;
+        bool readOut = !this->capturing || this->captureFrame(frameMessages, receivedTime);
+        if (this->writingChunks && !this->writeChunk(frameMessages)) readOut = false;
 
         getIntegerParam(ADImageMode, (int*) &acquisitionMode);
         getIntegerParam(ADXSPD_CounterMode, (int*) &counterMode);
@@ -284,8 +2171,35 @@ void ADXSPD::acquisitionThread() {
         getIntegerParam(ADNumImages, &targetNumImages);
         getIntegerParam(ADNumImagesCounter, &collectedImages);
 
-        if (frameMessages.size() != 3) {
-            ERR_ARGS("Expected 3 message parts for frame, got %zu", frameMessages.size());
+        // If in single mode, finish acq, if in multiple mode and reached target number
+        // complete acquisition.
+        auto acquisitionComplete = [&]() {
+            return acquisitionMode == ADImageSingle ||
+                   (acquisitionMode == ADImageMultiple &&
+                    collectedImages == (targetNumImages * pow(2, static_cast<int>(counterMode))));
+        };
+
+        if (!readOut) {
+            // Capture or direct write only: the frame counts towards the acquisition, but is not
+            // read out
+            collectedImages += 1;
+            setIntegerParam(ADNumImagesCounter, collectedImages);
+            if (acquisitionComplete()) acquireStop();
+            for (auto& msgPart : frameMessages) zmq_msg_close(&msgPart);
+            callParamCallbacks();
+            this->updateFrameStats();
+            continue;
+        }
+
+        if (frameMessages.size() != 3 || zmq_msg_size(&frameMessages[1]) < 4) {
+            if (frameMessages.size() != 3) {
+                ERR_ARGS("Expected 3 message parts for frame, got %zu", frameMessages.size());
+            } else {
+                ERR_ARGS("Expected 4 byte frame header, got %zu bytes",
+                         zmq_msg_size(&frameMessages[1]));
+            }
+            this->numFramesDropped++;
+            for (auto& msgPart : frameMessages) zmq_msg_close(&msgPart);
             continue;
         } else {
             uint8_t frameNumber = *((uint8_t*) zmq_msg_data(&frameMessages[1]));
@@ -300,12 +2214,37 @@ void ADXSPD::acquisitionThread() {
                 "Received frame number %d, trigger number %d, status code %d, size %d, %ld bytes",
                 frameNumber, triggerNumber, statusCode, size, frameSizeBytes);
 
+            ADXSPDTraceSpan decodeSpan("acquisition", "decode");
+
+            // The output transform and type, and any fallback to the native type, only change
+            // between series, so the NDArrays of a series all have the same type and dimensions
+            if (this->seriesStarted.exchange(false)) {
+                getIntegerParam(ADXSPD_OutputTransform, (int*) &this->seriesTransform);
+                getIntegerParam(ADXSPD_OutputDataType, (int*) &this->seriesOutputType);
+                if (this->saturationGuard.StartSeries() && this->saturationGuard.IsFallback())
+                    WARN("Output falls back to the native data type from this series");
+                setIntegerParam(ADXSPD_OutputFallback, this->saturationGuard.IsFallback());
+                this->frameHandlerStale = true;
+            }
+
+            // Decode settings are only read when they change, not for every frame
+            if (this->frameHandlerStale.exchange(false) || this->frameHandler == nullptr)
+                this->selectFrameHandler();
+
             getIntegerParam(NDDataType, (int*) &dataType);
 
             size_t dims[2];
             int sizeX, sizeY;
             getIntegerParam(ADSizeX, &sizeX);
             getIntegerParam(ADSizeY, &sizeY);
+            if (this->frameHandler != nullptr) {
+                // Arrays take the handler's output type, and rotated frames swap their dimensions,
+                // whatever the records have been set to since the series started
+                const ADXSPDFrameFormat& format = this->frameHandler->GetFormat();
+                dataType = getDataTypeForPixelType(format.GetOutputType());
+                sizeX = format.GetOutputWidth();
+                sizeY = format.GetOutputHeight();
+            }
             dims[0] = (size_t) sizeX;
             dims[1] = (size_t) sizeY;
 
@@ -314,6 +2253,7 @@ void ADXSPD::acquisitionThread() {
 
             if (!pArray) {
                 ERR("Failed to allocate array!");
+                this->numFramesDropped++;
                 setIntegerParam(ADStatus, ADStatusError);
                 callParamCallbacks();
                 break;
@@ -330,97 +2270,57 @@ void ADXSPD::acquisitionThread() {
             setIntegerParam(NDArraySizeY, arrayInfo.ySize);
 
             getIntegerParam(NDArrayCallbacks, &arrayCallbacks);
-            getIntegerParam(ADXSPD_Decompress, &decompress);
 
-            // Decompress data if compressed
-            XSPD::Compressor compressor;
-            int compressionLevel, bloscNumThreads;
-            getIntegerParam(ADXSPD_Compressor, (int*) &compressor);
-            getIntegerParam(ADXSPD_CompressLevel, &compressionLevel);
-            getIntegerParam(ADXSPD_BloscNumThreads, &bloscNumThreads);
+            // Output compression works on the raw frame, so frames compressed on the detector are
+            // decompressed first, i.e. transcoded
+            XSPD::Compressor outputCompressor;
+            getIntegerParam(ADXSPD_OutputCompressor, (int*) &outputCompressor);
+            bool compressOutput = XSPD::IsBloscCompressor(outputCompressor);
 
             // if (counterMode == XSPD::CounterMode::DUAL)
             //     frameBuffer = calloc(1, arrayInfo.totalBytes);
             // else
             //     frameBuffer = pArray->pData;
 
-            bool readoutOk = true;
-            if (decompress && compressor != XSPD::Compressor::NONE) {
-                // If asked to decompress in the driver, decompress the data when copying it from
-                // the ZMQ message to the NDArray.
-                if (compressor == XSPD::Compressor::ZLIB) {
-                    uLongf decompressedSize = arrayInfo.totalBytes;
-                    int zlibStatus =
-                        uncompress((Bytef*) pArray->pData, &decompressedSize,
-                                   (Bytef*) zmq_msg_data(&frameMessages[2]), frameSizeBytes);
-                    if (zlibStatus != Z_OK) {
-                        ERR_ARGS("Failed to decompress frame data with zlib, status code %d",
-                                 zlibStatus);
-                        readoutOk = false;
-                    }
-                    if (decompressedSize != arrayInfo.totalBytes) {
-                        ERR_ARGS("Decompressed size %lu does not match expected size %lu",
-                                 decompressedSize, arrayInfo.totalBytes);
-                        readoutOk = false;
-                    }
-                } else if (XSPD::IsBloscCompressor(compressor)) {
-                    size_t decompressSize;
-                    decompressSize =
-                        blosc_decompress_ctx(zmq_msg_data(&frameMessages[2]), pArray->pData,
-                                             arrayInfo.totalBytes, bloscNumThreads);
-                    if (decompressSize != arrayInfo.totalBytes) {
-                        ERR_ARGS(
-                            "Failed to decompress frame data with Blosc, decompressed size %zu "
-                            "does "
-                            "not match expected size %zu",
-                            decompressSize, arrayInfo.totalBytes);
-                        readoutOk = false;
-                    }
-                }
-            } else {
-                // Otherwise, copy the framebuffer data directly to the NDArray, and set the codec
-                // information if compressed
-                if (compressor == XSPD::Compressor::ZLIB) {
+            auto codecStartTime = chrono::steady_clock::now();
+            bool readoutOk = this->frameHandler != nullptr;
+            XSPD::Compressor codec = XSPD::Compressor::NONE;
+            if (readoutOk) {
+                const ADXSPDFrameFormat& format = this->frameHandler->GetFormat();
+                compressOutput = compressOutput && format.decompress;
+                if (format.decompress) codec = format.compressor;
+
+                // Frames passed on still compressed carry the codec information for downstream
+                if (!format.decompress && format.compressor == XSPD::Compressor::ZLIB) {
 #if ADCORE_SUPPORTS_ZLIB_NDARRAYS
                     pArray->codec.name = "zlib";
-                    pArray->codec.level = compressionLevel;
-                    break;
+                    pArray->codec.level = format.compressionLevel;
 #else
                     ERR("ADCore R3-15 or later is required to support zlib-compressed "
                         "NDArrays.");
                     readoutOk = false;
-                    break;
 #endif
-                } else if (XSPD::IsBloscCompressor(compressor)) {
+                } else if (!format.decompress && XSPD::IsBloscCompressor(format.compressor)) {
                     pArray->codec.name = "blosc";
-                    pArray->codec.compressor = XSPD::GetBloscSubcompressorId(compressor);
-                    pArray->codec.level = compressionLevel;
+                    pArray->codec.compressor = XSPD::GetBloscSubcompressorId(format.compressor);
+                    pArray->codec.level = format.compressionLevel;
                     // ADCore has blosc shuffle settings defined as 0=None, 1=Byte, 2=Bit, but there
                     // is not any enumeration for this (it comes from the NDPluginCodec blosc
                     // shuffle record). The XSPD::ShuffleMode enum has been set up with the same
                     // values for ease of translation, so we can just static_cast it here. If ADCore
                     // gets an enumeration for this in the future, it should be used here.
-                    XSPD::ShuffleMode shuffleMode =
-                        this->pDetector->GetVar<XSPD::ShuffleMode>("shuffle_mode");
                     // TODO: Handle auto shuffle mode correctly.
-                    pArray->codec.shuffle = static_cast<int>(shuffleMode);
+                    pArray->codec.shuffle = static_cast<int>(format.shuffleMode);
                 }
+            }
 
-                if (!readoutOk) {
-                    // Don't attempt to copy data if we already know there's an issue with the
-                    // compression settings.
-                    ERR("Compression settings are invalid, cannot read out frame data");
-                } else if (frameSizeBytes > arrayInfo.totalBytes) {
-                    // Copy data from new frame to pArray. With fully random data it is possible
-                    // that compressed size is actually larger than the uncompressed size, so check
-                    // for that and print an error.
-                    ERR_ARGS(
-                        "Size of incoming frame data %zu bytes is larger than expected array size "
-                        "%zu bytes!",
-                        frameSizeBytes, arrayInfo.totalBytes);
+            if (readoutOk) {
+                try {
+                    this->frameHandler->Decode(zmq_msg_data(&frameMessages[2]), frameSizeBytes,
+                                               pArray->pData, arrayInfo.totalBytes);
+                } catch (std::exception& e) {
+                    ERR_ARGS("Failed to read out frame data: %s", e.what());
                     readoutOk = false;
-                } else {
-                    memcpy(pArray->pData, zmq_msg_data(&frameMessages[2]), frameSizeBytes);
                 }
             }
 
@@ -458,7 +2358,57 @@ void ADXSPD::acquisitionThread() {
             //     subtractOk = false;
             // }
 
+            auto decodedTime = chrono::steady_clock::now();
+            decodeSpan.End();
+
             if (readoutOk) {
+                auto codecIndex = magic_enum::enum_index(codec);
+                if (codecIndex.has_value()) {
+                    this->codecStats[*codecIndex].record(frameSizeBytes, arrayInfo.totalBytes,
+                                                         nsBetween(codecStartTime, decodedTime));
+                }
+                this->autoTuner.RecordFrame(frameSizeBytes, arrayInfo.totalBytes,
+                                            nsBetween(codecStartTime, decodedTime), receivedTime);
+                this->numFramesDecoded++;
+
+                // Saturated pixels are counted while converting, and checked against the limit
+                // over the whole series so far. Going over it only warns, as the fallback to the
+                // native type takes effect from the next series.
+                const ADXSPDFrameFormat& format = this->frameHandler->GetFormat();
+                bool canSaturate = format.CanSaturate();
+                epicsUInt32 numSaturated = (epicsUInt32) this->frameHandler->GetNumSaturated();
+                setIntegerParam(ADXSPD_OutputSaturated, (int) numSaturated);
+                if (canSaturate) {
+                    double saturationLimit;
+                    getDoubleParam(ADXSPD_OutputSaturationLimit, &saturationLimit);
+                    if (this->saturationGuard.RecordFrame(arrayInfo.nElements, numSaturated,
+                                                          saturationLimit)) {
+                        WARN_ARGS("%.3f%% of pixels saturated, over the %.3f%% limit, output "
+                                  "falls back to %d bit from the next series",
+                                  this->saturationGuard.GetSaturatedPercent(), saturationLimit,
+                                  (int) (8 * ADXSPDFrameHandler::GetPixelSize(
+                                                 format.GetInputType())));
+                        setIntegerParam(ADXSPD_OutputFallback, 1);
+                    }
+                }
+
+                if (compressOutput) {
+                    TRACE_SPAN("acquisition", "compress");
+                    XSPD::ShuffleMode outputShuffle;
+                    int outputLevel, outputNumThreads;
+                    getIntegerParam(ADXSPD_OutputShuffle, (int*) &outputShuffle);
+                    getIntegerParam(ADXSPD_OutputCompressLevel, &outputLevel);
+                    getIntegerParam(ADXSPD_OutputNumThreads, &outputNumThreads);
+                    // On failure the frame is passed on uncompressed
+                    NDArray* pCompressed = this->compressFrame(pArray, outputCompressor,
+                                                               outputShuffle, outputLevel,
+                                                               max(outputNumThreads, 1));
+                    if (pCompressed != nullptr) {
+                        pArray->release();
+                        pArray = pCompressed;
+                    }
+                }
+
                 // increment the array counter
                 int arrayCounter;
                 getIntegerParam(NDArrayCounter, &arrayCounter);
@@ -468,19 +2418,30 @@ void ADXSPD::acquisitionThread() {
                 // set the image unique ID to the number in the sequence
                 pArray->uniqueId = arrayCounter;
                 pArray->pAttributeList->add("ColorMode", "Color Mode", NDAttrInt32, &colorMode);
+                if (canSaturate) {
+                    pArray->pAttributeList->add("SaturatedPixels",
+                                                "Pixels saturated converting to output type",
+                                                NDAttrUInt32, &numSaturated);
+                }
 
-                getAttributes(pArray->pAttributeList);
+                {
+                    TRACE_SPAN("acquisition", "attributes");
+                    getAttributes(pArray->pAttributeList);
+                }
 
-                if (arrayCallbacks) doCallbacksGenericPointer(pArray, NDArrayData, 0);
-            }
+                if (arrayCallbacks) {
+                    TRACE_SPAN("acquisition", "callbacks");
+                    doCallbacksGenericPointer(pArray, NDArrayData, 0);
+                    this->numFramesPublished++;
+                }
 
-            // If in single mode, finish acq, if in multiple mode and reached target number
-            // complete acquisition.
-            if (acquisitionMode == ADImageSingle ||
-                (acquisitionMode == ADImageMultiple &&
-                 collectedImages == (targetNumImages * pow(2, static_cast<int>(counterMode))))) {
-                acquireStop();
+                this->recordFrameStats(receivedTime, decodedTime, chrono::steady_clock::now(),
+                                       frameSizeBytes, arrayInfo.totalBytes);
+            } else {
+                this->numFramesDropped++;
             }
+
+            if (acquisitionComplete()) acquireStop();
             pArray->release();
         }
 
@@ -495,6 +2456,7 @@ void ADXSPD::acquisitionThread() {
 
         // refresh all PVs
         callParamCallbacks();
+        this->updateFrameStats();
     }
 
     if (zmqSubscriber != nullptr) {
@@ -507,11 +2469,26 @@ void ADXSPD::acquisitionThread() {
  * @brief Main monitoring loop for ADXSPD
  */
 void ADXSPD::monitorThread() {
-    double pollInterval;
+    double pollInterval, modulePollInterval;
     int monitorEnabled;
+    chrono::steady_clock::time_point lastModulePoll;
+    ADXSPDTrace::SetThreadName("monitorThread");
     while (true) {
+        // While disconnected, back off between reconnect attempts instead of polling status
+        if (!this->pApi->IsConnected()) {
+            if (!this->disconnectTime.has_value()) this->onDisconnect();
+            if (epicsEventWaitWithTimeout(this->shutdownEventId, this->reconnectDelay) ==
+                epicsEventWaitOK) {
+                INFO("Shutdown event received, exiting monitor thread...");
+                break;
+            }
+            this->reconnect();
+            continue;
+        }
+
         getDoubleParam(ADXSPD_MonitorInterval, &pollInterval);
         getIntegerParam(ADXSPD_MonitorMode, &monitorEnabled);
+        getDoubleParam(ADXSPD_ModulePollInterval, &modulePollInterval);
 
         // Don't allow polling faster than minimum interval
         if (pollInterval <= ADXSPD_MIN_STATUS_POLL_INTERVAL)
@@ -522,13 +2499,30 @@ void ADXSPD::monitorThread() {
             break;
         }
 
+        this->lock();
+        setIntegerParam(ADXSPD_LogDropped, (int) ADXSPDLog::GetNumDropped());
+        this->publishRestStats();
+        int acquiring;
+        getIntegerParam(ADAcquire, &acquiring);
+        if (!acquiring) {
+            this->applyAutoTune();
+            callParamCallbacks();
+        }
+        this->unlock();
+
         // If monitoring is disabled, don't poll module statuses
         if (monitorEnabled == 0) continue;
 
-        this->lock();
+        {
+            TRACE_SPAN("lock", "monitor lock wait");
+            this->lock();
+        }
+        ADXSPDTraceSpan pollSpan("monitor", "status poll");
+        auto pollStartTime = chrono::steady_clock::now();
 
         try {
             XSPD::Status status = this->pDetector->GetVar<XSPD::Status>("status");
+            this->statusPollLatency.record(nsBetween(pollStartTime, chrono::steady_clock::now()));
             int adStatus = ADStatusIdle;
             switch (status) {
                 case XSPD::Status::READY:
@@ -544,22 +2538,39 @@ void ADXSPD::monitorThread() {
                     break;
             }
             setIntegerParam(ADStatus, adStatus);
-
-            // Reading out module status takes too long. Probably should become a "GetModuleStatus"
-            // PV that can have its Scan rate updated from I/O Intr to some rate.
-            // for (auto& module : this->modules) {
-            //    module->checkStatus();
-            //}
         } catch (std::runtime_error& e) {
             ERR_TO_STATUS_ARGS("Failed to update detector status: %s", e.what());
             setIntegerParam(ADStatus, ADStatusError);
         }
 
-        this->getDataPortVar<int>(ADXSPD_FramesQueued, "frames_queued");
+        this->readBoundParam(*this->getParamBinding(ADXSPD_FramesQueued));
+        int framesQueued;
+        getIntegerParam(ADXSPD_FramesQueued, &framesQueued);
+        this->framesQueued.store(framesQueued, memory_order_relaxed);
 
         this->unlock();
+        pollSpan.End();
 
         callParamCallbacks();
+
+        // Reading out module status takes several requests per module, so it runs at its own
+        // lower rate, under each module's lock rather than the driver's.
+        auto now = chrono::steady_clock::now();
+        if (modulePollInterval > 0 &&
+            now - lastModulePoll >= chrono::duration<double>(modulePollInterval)) {
+            lastModulePoll = now;
+            ADXSPDTraceSpan moduleSpan("monitor", "module status poll");
+            for (auto& module : this->modules) {
+                module->lock();
+                try {
+                    module->checkStatus();
+                } catch (std::exception& e) {
+                    WARN_ARGS("Failed to poll status of module %s: %s", module->portName,
+                              e.what());
+                }
+                module->unlock();
+            }
+        }
     }
 }
 
@@ -572,15 +2583,6 @@ void ADXSPD::monitorThread() {
 asynStatus ADXSPD::getInitialDetState() {
     int status = asynSuccess;
 
-    try {
-        // Get initial exposure time setting; XSPD API uses milliseconds, but ADAcquireTime is in
-        // seconds
-        setDoubleParam(ADAcquireTime, this->pDetector->GetVar<double>("shutter_time") / 1000.0);
-    } catch (std::exception& e) {
-        ERR_ARGS("Failed to read initial acquire time: %s", e.what());
-        status |= asynError;
-    }
-
     try {
         // Set ADNumImages and ADImageMode based on n_frames
         int numImages = this->pDetector->GetVar<int>("n_frames");
@@ -594,16 +2596,6 @@ asynStatus ADXSPD::getInitialDetState() {
         status |= asynError;
     }
 
-    try {
-        // Get initial bit depth and set data type accordingly
-        int bitDepth = this->pDetector->GetVar<int>("bit_depth");
-        setIntegerParam(ADXSPD_BitDepth, bitDepth);
-        setIntegerParam(NDDataType, static_cast<int>(getDataTypeForBitDepth(bitDepth)));
-    } catch (std::exception& e) {
-        ERR_ARGS("Failed to read initial bit depth: %s", e.what());
-        status |= asynError;
-    }
-
     try {
         // Get initial threshold settings.
         vector<double> thresholds = this->pDetector->GetVar<vector<double>>("thresholds");
@@ -614,24 +2606,12 @@ asynStatus ADXSPD::getInitialDetState() {
         status |= asynError;
     }
 
-    // Retrieve all remaining initial parameters.
-    status |= this->getDataPortVar<int>(ADMaxSizeX, "frame_width");
-    status |= this->getDataPortVar<int>(ADMaxSizeY, "frame_height");
-    status |= this->getDetVar<int>(ADXSPD_SummedFrames, "summed_frames");
-    status |= this->getDetVar<int>(ADXSPD_CompressLevel, "compression_level");
-    status |= this->getDetVar<XSPD::Compressor>(ADXSPD_Compressor, "compressor");
-    status |= this->getDetVar<double>(ADXSPD_BeamEnergy, "beam_energy");
-    status |= this->getDetVar<XSPD::OnOff>(ADXSPD_GatingMode, "gating_mode");
-    status |= this->getDetVar<bool>(ADXSPD_FFCorrection, "flatfield_enabled");
-    status |= this->getDetVar<XSPD::OnOff>(ADXSPD_ChargeSumming, "charge_summing");
-    status |= this->getDetVar<XSPD::TriggerMode>(ADTriggerMode, "trigger_mode");
-    status |= this->getDetVar<bool>(ADXSPD_CrCorr, "countrate_correction_enabled");
-    status |= this->getDetVar<XSPD::CounterMode>(ADXSPD_CounterMode, "counter_mode");
-    status |= this->getDetVar<bool>(ADXSPD_SaturationFlag, "saturation_flag_enabled");
-    status |= this->getDetVar<XSPD::ShuffleMode>(ADXSPD_ShuffleMode, "shuffle_mode");
-    status |= this->getDetVar<string>(ADModel, "type");
-    status |= this->getDataPortVar<int>(ADXSPD_FramesQueued, "frames_queued");
-    status |= this->getDetVar<int>(ADXSPD_RoiRows, "roi_rows");
+    // Retrieve all remaining initial parameters from the binding table, then update the state that
+    // depends on them.
+    for (auto& binding : this->paramBindings) {
+        status |= this->readBoundParam(binding);
+    }
+    this->refreshDependents(ADXSPD_REFRESH_DATA_TYPE);
 
     // Sensor information is stored as user-data, so we can't guarantee it will be available or
     // correct, so treat failure to read these parameters as a warning rather than an error.
@@ -650,6 +2630,108 @@ asynStatus ADXSPD::getInitialDetState() {
     return static_cast<asynStatus>(status);
 }
 
+// -----------------------------------------------------------------------
+// ADXSPD Startup Functions
+// -----------------------------------------------------------------------
+
+/**
+ * @brief Path of the cached topology file for the given cache ID (system and detector ID)
+ */
+string ADXSPD::getTopologyCachePath(string cacheId) {
+    return this->topologyCacheDir + "/xspd_topology_" + cacheId + ".json";
+}
+
+/**
+ * @brief Cache ID of a topology. Several detectors may share one system, so both are included.
+ */
+static string getTopologyCacheId(const json& topology) {
+    return topology["system_id"].get<string>() + "_" + topology["detector_id"].get<string>();
+}
+
+/**
+ * @brief Path of the index mapping XSPD server address, device ID and detector ID to cache ID
+ */
+string ADXSPD::getTopologyIndexPath() {
+    return this->topologyCacheDir + "/xspd_topology_index.json";
+}
+
+/**
+ * @brief Loads the cached topology for the configured XSPD server and device, if any
+ *
+ * @return json The cached topology, or null if caching is disabled or nothing is cached
+ */
+json ADXSPD::loadTopologyCache() {
+    if (this->topologyCacheDir.empty()) return json();
+
+    try {
+        ifstream indexFile(this->getTopologyIndexPath());
+        if (!indexFile.is_open()) return json();
+        json index = json::parse(indexFile);
+        if (!index.contains(this->topologyCacheKey)) return json();
+
+        string cachePath = this->getTopologyCachePath(index[this->topologyCacheKey]);
+        ifstream cacheFile(cachePath);
+        if (!cacheFile.is_open()) return json();
+        INFO_ARGS("Loading cached detector topology from %s", cachePath.c_str());
+        return json::parse(cacheFile);
+    } catch (json::exception& e) {
+        WARN_ARGS("Failed to load cached detector topology: %s", e.what());
+        return json();
+    }
+}
+
+/**
+ * @brief Writes the current topology to the cache, keyed by system and detector ID, and indexes
+ * it under the configured XSPD server, device and detector.
+ */
+void ADXSPD::saveTopologyCache() {
+    if (this->topologyCacheDir.empty()) return;
+
+    json topology = this->pApi->GetTopology(this->pDetector->GetId());
+    string cacheId = getTopologyCacheId(topology);
+    string cachePath = this->getTopologyCachePath(cacheId);
+    ofstream cacheFile(cachePath);
+    if (!cacheFile.is_open()) {
+        WARN_ARGS("Failed to write detector topology cache %s", cachePath.c_str());
+        return;
+    }
+    cacheFile << topology.dump(4) << endl;
+
+    json index = json::object();
+    try {
+        ifstream indexFile(this->getTopologyIndexPath());
+        if (indexFile.is_open()) index = json::parse(indexFile);
+    } catch (json::exception& e) {
+        WARN_ARGS("Replacing unreadable topology cache index: %s", e.what());
+    }
+    index[this->topologyCacheKey] = cacheId;
+    ofstream(this->getTopologyIndexPath()) << index.dump(4) << endl;
+    INFO_ARGS("Cached detector topology %s in %s", cacheId.c_str(), cachePath.c_str());
+}
+
+/**
+ * @brief Re-discovers the detector topology after a warm start from the cache. If the detector no
+ * longer matches, the stale cache entry is removed so that the next start does a full discovery.
+ */
+void ADXSPD::topologyValidationThread() {
+    auto startTime = chrono::steady_clock::now();
+    try {
+        json topology = this->pApi->GetTopology(this->pDetector->GetId());
+        if (this->pApi->ValidateTopology(topology)) {
+            INFO_ARGS("Cached detector topology is up to date (validated in %.1f ms)",
+                      msSince(startTime));
+            return;
+        }
+
+        remove(this->getTopologyCachePath(getTopologyCacheId(topology)).c_str());
+        this->lock();
+        WARN_TO_STATUS("Detector topology changed since it was cached, restart the IOC to apply");
+        this->unlock();
+    } catch (std::exception& e) {
+        WARN_ARGS("Failed to validate cached detector topology: %s", e.what());
+    }
+}
+
 //-------------------------------------------------------------------------
 // ADDriver function overwrites
 //-------------------------------------------------------------------------
@@ -670,8 +2752,18 @@ asynStatus ADXSPD::writeInt32(asynUser* pasynUser, epicsInt32 value) {
     const char* paramName;
     getParamName(function, &paramName);
 
-    if (acquiring && find(this->onlyIdleParams.begin(), this->onlyIdleParams.end(), function) !=
-                         this->onlyIdleParams.end()) {
+    ADXSPDTraceSpan span("asyn", "writeInt32", paramName);
+    if (span.IsActive()) ADXSPDTrace::SetThreadName(epicsThreadGetNameSelf());
+
+    if (!this->pApi->IsConnected() && this->writeRequiresConnection(function)) {
+        ERR_TO_STATUS_ARGS("Cannot set parameter %s, not connected to XSPD server", paramName);
+        return asynError;
+    }
+
+    // Read-only bound parameters, e.g. ADMaxSizeX, are handled like any other parameter
+    const ADXSPDParamBinding* binding = this->getParamBinding(function);
+    if (binding != nullptr && !binding->writable) binding = nullptr;
+    if (acquiring && binding != nullptr && binding->idleOnly) {
         ERR_TO_STATUS_ARGS("Cannot set parameter %s while acquiring", paramName);
         return asynError;
     }
@@ -696,13 +2788,7 @@ asynStatus ADXSPD::writeInt32(asynUser* pasynUser, epicsInt32 value) {
                 break;
         }
     } else if (function == ADNumImages) {
-        int maxNumImages = INT_MAX;
-        for (auto& module : this->modules) {
-            int moduleMax = module->getMaxNumImages();
-            if (moduleMax < maxNumImages) {
-                maxNumImages = moduleMax;
-            }
-        }
+        int maxNumImages = this->getMaxNumImages();
         if (value < 1 || value > maxNumImages) {
             ERR_TO_STATUS_ARGS("Invalid n_frames: %d (valid range: 1-%d)", value, maxNumImages);
             return asynError;
@@ -714,62 +2800,50 @@ asynStatus ADXSPD::writeInt32(asynUser* pasynUser, epicsInt32 value) {
             setIntegerParam(ADImageMode, ADImageSingle);
         else
             setIntegerParam(ADImageMode, ADImageMultiple);
-    } else if (function < ADXSPD_FIRST_PARAM && function != ADTriggerMode) {
-        status = ADDriver::writeInt32(pasynUser, value);
-    } else {
-        try {
-            int actualValue = value;
-            string endpoint;
-            if (function == ADXSPD_BitDepth) {
-                actualValue = this->pDetector->SetVar<int>("bit_depth", value);
-                setIntegerParam(NDDataType, static_cast<int>(getDataTypeForBitDepth(actualValue)));
-                for (auto& module : this->modules) {
-                    module->getMaxNumImages();
-                }
-            } else if (function == ADXSPD_SummedFrames) {
-                actualValue = this->pDetector->SetVar<int>("summed_frames", value);
-            } else if (function == ADXSPD_RoiRows) {
-                actualValue = static_cast<int>(this->pDetector->SetVar<int>("roi_rows", value));
-                for (auto& module : this->modules) {
-                    module->getMaxNumImages();
-                }
-            } else if (function == ADXSPD_GatingMode) {
-                actualValue = static_cast<int>(this->pDetector->SetVar<XSPD::OnOff>(
-                    "gating_mode", static_cast<XSPD::OnOff>(value)));
-                // } else if (function == ADXSPD_CompressLevel) {
-                //      actualValue = this->pDetector->SetVar<int>("compression_level", value);
-            } else if (function == ADXSPD_FFCorrection) {
-                actualValue = static_cast<int>(this->pDetector->SetVar<XSPD::OnOff>(
-                    "flatfield_correction", static_cast<XSPD::OnOff>(value)));
-            } else if (function == ADXSPD_ChargeSumming) {
-                actualValue = static_cast<int>(this->pDetector->SetVar<XSPD::OnOff>(
-                    "charge_summing", static_cast<XSPD::OnOff>(value)));
-            } else if (function == ADTriggerMode) {
-                actualValue = static_cast<int>(this->pDetector->SetVar<XSPD::TriggerMode>(
-                    "trigger_mode", static_cast<XSPD::TriggerMode>(value)));
-            } else if (function == ADXSPD_CrCorr) {
-                actualValue = static_cast<int>(this->pDetector->SetVar<XSPD::OnOff>(
-                    "countrate_correction", static_cast<XSPD::OnOff>(value)));
-            } else if (function == ADXSPD_CounterMode) {
-                actualValue = static_cast<int>(this->pDetector->SetVar<XSPD::CounterMode>(
-                    "counter_mode", static_cast<XSPD::CounterMode>(value)));
-                for (auto& module : this->modules) {
-                    module->getMaxNumImages();
-                    module->getFlatfieldState();  // FF is different for each counter mode
-                }
-            } else if (function == ADXSPD_SaturationFlag) {
-                actualValue = static_cast<int>(this->pDetector->SetVar<XSPD::OnOff>(
-                    "saturation_flag", static_cast<XSPD::OnOff>(value)));
-            } else if (function == ADXSPD_ShuffleMode) {
-                actualValue = static_cast<int>(this->pDetector->SetVar<XSPD::ShuffleMode>(
-                    "shuffle_mode", static_cast<XSPD::ShuffleMode>(value)));
-            } else if (function == ADXSPD_MonitorInterval) {
-                if (value < ADXSPD_MIN_STATUS_POLL_INTERVAL) {
-                    actualValue = ADXSPD_MIN_STATUS_POLL_INTERVAL;
-                }
+    } else if (function == ADXSPD_SavePreset || function == ADXSPD_ApplyPreset) {
+        if (value) {
+            if (acquiring) {
+                ERR_TO_STATUS_ARGS("Cannot %s preset while acquiring",
+                                   function == ADXSPD_SavePreset ? "save" : "apply");
+                return asynError;
             }
-
-            setIntegerParam(function, actualValue);
+            status = function == ADXSPD_SavePreset ? this->savePreset() : this->applyPreset();
+        }
+        setIntegerParam(function, 0);
+    } else if (function == ADXSPD_LogLevel) {
+        auto logLevel = magic_enum::enum_cast<ADXSPDLogLevel>(value);
+        if (!logLevel.has_value()) {
+            ERR_TO_STATUS_ARGS("Invalid log level %d", value);
+            return asynError;
+        }
+        this->logLevel = logLevel.value();
+        setIntegerParam(function, value);
+    } else if (function == ADXSPD_TraceEnable) {
+        // Tracing is process-wide, so this also enables tracing for other drivers in the IOC
+        ADXSPDTrace::Enable(value != 0);
+        setIntegerParam(function, value != 0);
+        INFO_TO_STATUS_ARGS("Tracing %s", value ? "enabled" : "disabled");
+    } else if (function == ADXSPD_TraceDump) {
+        if (value) {
+            char traceFile[256];
+            getStringParam(ADXSPD_TraceFile, sizeof(traceFile), traceFile);
+            try {
+                size_t numEvents = ADXSPDTrace::Dump(traceFile);
+                INFO_TO_STATUS_ARGS("Wrote %zu trace events to %s", numEvents, traceFile);
+            } catch (std::runtime_error& e) {
+                ERR_TO_STATUS_ARGS("Failed to dump trace: %s", e.what());
+                status = asynError;
+            }
+        }
+        setIntegerParam(function, 0);
+    } else if (function == ADXSPD_ResetStats) {
+        // Histograms and rate meters are only written by the acquisition thread, so let it reset
+        if (value) this->statsResetRequested = true;
+        setIntegerParam(function, 0);
+    } else if (binding != nullptr) {
+        try {
+            int actualValue = (int) lround(this->writeBoundParam(*binding, value));
+            this->refreshDependents(binding->refreshMask);
             if (actualValue != value) {
                 WARN_ARGS("Requested value %d for parameter %s, but set value is %d", value,
                           paramName, actualValue);
@@ -784,6 +2858,30 @@ asynStatus ADXSPD::writeInt32(asynUser* pasynUser, epicsInt32 value) {
             ERR_TO_STATUS_ARGS("Runtime error when setting parameter %s: %s", paramName, e.what());
             return asynError;
         }
+    } else if (function < ADXSPD_FIRST_PARAM) {
+        status = ADDriver::writeInt32(pasynUser, value);
+    } else {
+        setIntegerParam(function, value);
+        INFO_TO_STATUS_ARGS("Set %s to %d", formatParamName(paramName).c_str(), value);
+    }
+
+    // Picked up by the acquisition thread before it decodes the next frame
+    if (function == ADXSPD_BitDepth || function == ADXSPD_Compressor ||
+        function == ADXSPD_CompressLevel || function == ADXSPD_ShuffleMode ||
+        function == ADXSPD_BloscNumThreads || function == ADXSPD_Decompress ||
+        function == ADXSPD_OutputCompressor)
+        this->frameHandlerStale = true;
+    // Output transform and type changes are picked up from the start of the next series, and a
+    // new output type clears any fallback to the native type
+    if (function == ADXSPD_OutputDataType ||
+        (function == ADXSPD_OutputFallbackReset && value)) {
+        int acquiring;
+        getIntegerParam(ADAcquire, &acquiring);
+        this->saturationGuard.RequestReset();
+        if (!acquiring) {
+            setIntegerParam(ADXSPD_OutputFallback, 0);
+            this->refreshDependents(ADXSPD_REFRESH_DATA_TYPE);
+        }
     }
     callParamCallbacks();
 
@@ -810,29 +2908,34 @@ asynStatus ADXSPD::writeFloat64(asynUser* pasynUser, epicsFloat64 value) {
     int acquiring;
     asynStatus status = asynSuccess;
     getIntegerParam(ADAcquire, &acquiring);
-    double actualValue;
 
     const char* paramName;
     getParamName(function, &paramName);
 
-    if (acquiring && find(this->onlyIdleParams.begin(), this->onlyIdleParams.end(), function) !=
-                         this->onlyIdleParams.end()) {
+    ADXSPDTraceSpan span("asyn", "writeFloat64", paramName);
+    if (span.IsActive()) ADXSPDTrace::SetThreadName(epicsThreadGetNameSelf());
+
+    if (!this->pApi->IsConnected() && this->writeRequiresConnection(function)) {
+        ERR_TO_STATUS_ARGS("Cannot set param %s, not connected to XSPD server", paramName);
+        return asynError;
+    }
+
+    // Read-only bound parameters, e.g. ADMaxSizeX, are handled like any other parameter
+    const ADXSPDParamBinding* binding = this->getParamBinding(function);
+    if (binding != nullptr && !binding->writable) binding = nullptr;
+    if (acquiring && binding != nullptr && binding->idleOnly) {
         ERR_TO_STATUS_ARGS("Cannot set param %s while acquiring", paramName);
         return asynError;
     }
 
-    if (function == ADAcquireTime) {
-        actualValue = this->pDetector->SetVar<double>("shutter_time", value * 1000.0) /
-                      1000.0;  // XSPD API uses milliseconds
-        setDoubleParam(ADAcquireTime, actualValue);
-        INFO_TO_STATUS_ARGS("Set acquire time to %f seconds", actualValue);
-    } else if (function < ADXSPD_FIRST_PARAM) {
+    if (binding == nullptr && function < ADXSPD_FIRST_PARAM) {
         status = ADDriver::writeFloat64(pasynUser, value);
     } else {
         try {
             double actualValue = value;
-            if (function == ADXSPD_BeamEnergy) {
-                actualValue = this->pDetector->SetVar<double>("beam_energy", value);
+            if (binding != nullptr) {
+                actualValue = this->writeBoundParam(*binding, value);
+                this->refreshDependents(binding->refreshMask);
             } else if (function == ADXSPD_LowThreshold) {
                 actualValue = this->pDetector->SetThreshold(XSPD::Threshold::LOW, value);
             } else if (function == ADXSPD_HighThreshold) {
@@ -840,6 +2943,10 @@ asynStatus ADXSPD::writeFloat64(asynUser* pasynUser, epicsFloat64 value) {
             } else if (function == ADXSPD_MonitorInterval &&
                        value < ADXSPD_MIN_STATUS_POLL_INTERVAL) {
                 actualValue = ADXSPD_MIN_STATUS_POLL_INTERVAL;
+            } else if (function == ADXSPD_VarCacheTTL) {
+                // Shared by all drivers using the same API
+                actualValue = max(0.0, value);
+                this->pApi->SetVarCacheTTL(actualValue);
             }
             setDoubleParam(function, actualValue);
             if (actualValue != value) {
@@ -869,14 +2976,146 @@ asynStatus ADXSPD::writeFloat64(asynUser* pasynUser, epicsFloat64 value) {
     }
 }
 
+/**
+ * @brief Prints the count and latency percentiles of a histogram of ns values as a report row
+ */
+static void reportLatency(FILE* fp, const char* name, const ADXSPDLatencyHistogram& histogram) {
+    fprintf(fp, "    %-24s %10lu %10.3f %10.3f %10.3f\n", name, (unsigned long) histogram.count(),
+            histogram.percentile(0.5) / 1e6, histogram.percentile(0.99) / 1e6,
+            histogram.max() / 1e6);
+}
+
+/**
+ * @brief Prints the frame pipeline section of the driver report. Only reads atomic counters, so
+ * it is safe to call while the acquisition thread is running.
+ *
+ * @param fp File pointer to write report to
+ * @param details Level of detail for the report
+ */
+void ADXSPD::reportFrameStats(FILE* fp, int details) {
+    fprintf(fp, "  Data port %s (tcp://%s:%d):\n", this->dataPortId.c_str(),
+            this->dataPortIp.c_str(), this->dataPortPort);
+    fprintf(fp, "    Message parts: %lu (%.1f MB), timeouts: %lu, errors: %lu, resubscribes: %lu\n",
+            (unsigned long) this->numZmqParts, this->numZmqBytes / 1e6,
+            (unsigned long) this->numZmqTimeouts, (unsigned long) this->numZmqErrors,
+            (unsigned long) this->numZmqResubscribes);
+
+    fprintf(fp, "    Frames queued on server: %d, log messages queued: %zu\n",
+            this->framesQueued.load(memory_order_relaxed), ADXSPDLog::GetQueueDepth());
+
+    fprintf(fp, "  Frames received: %lu, decoded: %lu, dropped: %lu, published: %lu\n",
+            (unsigned long) this->numFramesReceived, (unsigned long) this->numFramesDecoded,
+            (unsigned long) this->numFramesDropped, (unsigned long) this->numFramesPublished);
+    fprintf(fp, "  Frame rate: %.1f Hz, wire: %.1f MB/s, output: %.1f MB/s\n",
+            this->wireRateMeter.eventRate(), this->wireRateMeter.byteRate() / 1e6,
+            this->outputRateMeter.byteRate() / 1e6);
+
+    fprintf(fp, "  NDArray pool: %d buffers, %d free, %.1f of %.1f MB allocated\n",
+            this->pNDArrayPool->getNumBuffers(), this->pNDArrayPool->getNumFree(),
+            this->pNDArrayPool->getMemorySize() / 1e6, this->pNDArrayPool->getMaxMemory() / 1e6);
+
+    if (details < 2) return;
+
+    fprintf(fp, "  Frame stage latencies:\n");
+    fprintf(fp, "    %-24s %10s %10s %10s %10s\n", "Stage", "Frames", "p50 ms", "p99 ms",
+            "Max ms");
+    for (int i = 0; i < ADXSPD_NUM_FRAME_STAGES; i++) {
+        string stageName(magic_enum::enum_name(static_cast<ADXSPDFrameStage>(i)));
+        reportLatency(fp, stageName.c_str(), this->stageLatency[i]);
+    }
+
+    fprintf(fp, "  Decode throughput by codec (NONE = copied without decompressing):\n");
+    fprintf(fp, "    %-24s %10s %10s %10s %10s %10s\n", "Codec", "Frames", "In MB", "Out MB",
+            "Ratio", "Out MB/s");
+    for (size_t i = 0; i < this->codecStats.size(); i++) {
+        const ADXSPDCodecStats& stats = this->codecStats[i];
+        if (stats.numFrames() == 0) continue;
+        string codecName(magic_enum::enum_name(magic_enum::enum_value<XSPD::Compressor>(i)));
+        double ratio = stats.inputBytes() > 0 ? (double) stats.outputBytes() / stats.inputBytes()
+                                              : 0.0;
+        fprintf(fp, "    %-24s %10lu %10.1f %10.1f %10.2f %10.1f\n", codecName.c_str(),
+                (unsigned long) stats.numFrames(), stats.inputBytes() / 1e6,
+                stats.outputBytes() / 1e6, ratio, stats.outputRate() / 1e6);
+    }
+
+    const ADXSPDCodecStats& output = this->outputCompressStats;
+    if (output.numFrames() > 0) {
+        fprintf(fp, "  Output compression: %lu frames, %.1f -> %.1f MB, %.1f MB/s\n",
+                (unsigned long) output.numFrames(), output.inputBytes() / 1e6,
+                output.outputBytes() / 1e6, output.inputRate() / 1e6);
+    }
+
+    int autoTune;
+    getIntegerParam(ADXSPD_AutoTune, &autoTune);
+    if (autoTune) {
+        char tuneSetting[256], tuneReason[256];
+        getStringParam(ADXSPD_AutoTuneSetting, sizeof(tuneSetting), tuneSetting);
+        getStringParam(ADXSPD_AutoTuneReason, sizeof(tuneReason), tuneReason);
+        fprintf(fp, "  Auto-tune: %s\n", tuneSetting[0] ? tuneSetting : "no series measured yet");
+        if (tuneReason[0]) fprintf(fp, "    %s\n", tuneReason);
+    }
+}
+
 /**
  * @brief Override of ADDriver base function - reports driver status
  *
+ * details = 1 prints connection state, REST totals, and frame pipeline counters and rates.
+ * details >= 2 adds stage latencies, per-codec throughput, per-endpoint REST statistics, poll
+ * timings, and startup times. The ADDriver report is printed after, at the same level of detail.
+ *
  * @param fp File pointer to write report to
  * @param details Level of detail for the report
  */
 void ADXSPD::report(FILE* fp, int details) {
     if (details > 0) {
+        fprintf(fp, "ADXSPD %s, detector %s with %zu modules\n", this->portName,
+                this->detectorId.c_str(), this->modules.size());
+        fprintf(fp, "  XSPD server %s: %s\n", this->topologyCacheKey.c_str(),
+                string(magic_enum::enum_name(this->pApi->GetState())).c_str());
+        fprintf(fp, "  Log messages dropped: %lu\n", (unsigned long) ADXSPDLog::GetNumDropped());
+
+        // Shared by all drivers connected to the same device
+        XSPD::EndpointStats total = this->pApi->GetTotalStats();
+        fprintf(fp, "  REST requests: %lu, errors: %lu, p50: %.2f ms, p99: %.2f ms, max: %.2f ms\n",
+                (unsigned long) total.numRequests, (unsigned long) total.numErrors, total.p50Ms,
+                total.p99Ms, total.maxMs);
+
+        this->reportFrameStats(fp, details);
+
+        if (details > 1) {
+            fprintf(fp, "  Status poll timings:\n");
+            fprintf(fp, "    %-24s %10s %10s %10s %10s\n", "Source", "Polls", "p50 ms",
+                    "p99 ms", "Max ms");
+            reportLatency(fp, "detector", this->statusPollLatency);
+            // With module polling disabled, modules only hold the single sample from connecting
+            double modulePollInterval;
+            getDoubleParam(ADXSPD_ModulePollInterval, &modulePollInterval);
+            if (modulePollInterval > 0) {
+                for (auto& module : this->modules) {
+                    reportLatency(fp, module->portName, module->getPollLatency());
+                }
+            } else {
+                fprintf(fp, "    Module status polling disabled\n");
+            }
+
+            fprintf(fp, "  REST requests by endpoint:\n");
+            fprintf(fp, "    %-56s %8s %6s %10s %10s %10s %8s %8s %8s\n", "Endpoint", "Requests",
+                    "Errors", "Sent kB", "Recv kB", "Total ms", "p50 ms", "p99 ms", "Max ms");
+            vector<XSPD::EndpointStats> endpointStats = this->pApi->GetEndpointStats();
+            endpointStats.push_back(total);
+            for (auto& stats : endpointStats) {
+                fprintf(fp, "    %-56s %8lu %6lu %10.1f %10.1f %10.1f %8.2f %8.2f %8.2f\n",
+                        stats.endpoint.c_str(), (unsigned long) stats.numRequests,
+                        (unsigned long) stats.numErrors, stats.bytesSent / 1e3,
+                        stats.bytesReceived / 1e3, stats.totalMs, stats.p50Ms, stats.p99Ms,
+                        stats.maxMs);
+            }
+
+            fprintf(fp, "  Startup times:\n");
+            for (auto& [phase, duration] : this->startupTimes) {
+                fprintf(fp, "    %-24s %10.1f ms\n", phase.c_str(), duration);
+            }
+        }
         ADDriver::report(fp, details);
     }
 }
@@ -893,43 +3132,86 @@ void ADXSPD::report(FILE* fp, int details) {
  * @param portNum The port number of the XSPD device (e.g. 8080)
  * @param deviceId The device ID of the XSPD device to connect to (if NULL, connects to first device
  * found)
+ * @param detectorId The detector on the device to control (if NULL, the first detector)
+ * @param topologyCacheDir Directory in which to cache the detector topology (if NULL, no caching)
+ * @param numInitThreads Number of concurrent requests used to read initial state (0 for one per
+ * module)
  */
-ADXSPD::ADXSPD(const char* portName, const char* ip, int portNum, const char* deviceId)
-    : ADDriver(portName, 1, (int) NUM_ADXSPD_PARAMS, 0, 0, 0, 0, 0, 1, 0, 0) {
-    // Create ADXSPD specific asyn parameters
+ADXSPD::ADXSPD(const char* portName, const char* ip, int portNum, const char* deviceId,
+               const char* detectorId, const char* topologyCacheDir, int numInitThreads)
+    : ADDriver(portName, 1, (int) NUM_ADXSPD_PARAMS, 0, 0, asynFloat64ArrayMask,
+               asynFloat64ArrayMask, 0, 1, 0, 0) {
+    // Create ADXSPD specific asyn parameters, and bind them to their XSPD API variables
     createAllParams();
+    createParamBindings();
 
     // Sets driver version PV (version numbers defined in header file)
     char versionString[25];
     snprintf(versionString, sizeof(versionString), "%d.%d.%d", ADXSPD_VERSION, ADXSPD_REVISION,
              ADXSPD_MODIFICATION);
     setStringParam(NDDriverVersion, versionString);
+    setStringParam(ADXSPD_AutoTuneSetting, "");
+    setStringParam(ADXSPD_AutoTuneReason, "");
 
     INFO_ARGS("Connecting to XSPD api at %s:%d...", ip, portNum);
 
+    auto startupTime = chrono::steady_clock::now();
     if (portNum == 0) portNum = XSPD::DEFAULT_PORT;
-    this->pApi = new XSPD::API(string(ip), portNum);
-    if (deviceId == nullptr) {
-        INFO("No device ID specified, will connect to first available device.");
-        this->pDetector = this->pApi->Initialize();
-    } else {
-        INFO_ARGS("Requested device ID: %s", deviceId);
-        this->pDetector = this->pApi->Initialize(string(deviceId));
+    string requestedDeviceId = deviceId == nullptr ? "" : deviceId;
+    string requestedDetectorId = detectorId == nullptr ? "" : detectorId;
+    this->pApi = getSharedAPI(string(ip), portNum, requestedDeviceId);
+
+    // If a topology cache is configured, and we have seen this device before, skip discovery and
+    // revalidate the cached topology in the background once we are up and running.
+    this->topologyCacheDir = topologyCacheDir == nullptr ? "" : topologyCacheDir;
+    this->topologyCacheKey = string(ip) + ":" + std::to_string(portNum) + "/" +
+                             requestedDeviceId + "/" + requestedDetectorId;
+    json cachedTopology = this->loadTopologyCache();
+    bool warmStart = false;
+    if (!cachedTopology.is_null()) {
+        // With a cached topology we can come up even if the server is down, and connect later
+        try {
+            this->pDetector = this->pApi->InitializeFromTopology(cachedTopology, true);
+            warmStart = true;
+        } catch (std::runtime_error& e) {
+            WARN_ARGS("Failed to start from cached topology, running discovery: %s", e.what());
+        }
     }
 
-    INFO_ARGS("Connected to detector w/ ID: %s", this->pDetector->GetId().c_str());
+    if (!warmStart) {
+        if (deviceId == nullptr) {
+            INFO("No device ID specified, will connect to first available device.");
+        } else {
+            INFO_ARGS("Requested device ID: %s", deviceId);
+        }
+        if (detectorId != nullptr) INFO_ARGS("Requested detector ID: %s", detectorId);
+        this->pDetector = this->pApi->Initialize(requestedDeviceId, requestedDetectorId);
+        this->saveTopologyCache();
+    }
+    this->detectorId = this->pDetector->GetId();
+    shareResolvedAPI(string(ip), portNum, this->pApi);
+    this->startupTimes.push_back(
+        {warmStart ? "api init (cached)" : "api init", msSince(startupTime)});
 
+    this->numInitThreads = numInitThreads;
     this->zmqContext = zmq_ctx_new();
 
-    setStringParam(ADXSPD_ApiVersion, this->pApi->GetApiVersion().c_str());
-    setStringParam(ADXSPD_Version, this->pApi->GetXSPDVersion().c_str());
-    setStringParam(ADSerialNumber, this->pDetector->GetSerialNumber().c_str());
+    if (this->pApi->IsConnected()) {
+        INFO_ARGS("Connected to detector w/ ID: %s", this->pDetector->GetId().c_str());
+        this->setVersionInfo(this->pDetector->GetSerialNumber());
+    } else {
+        WARN_ARGS("XSPD server unreachable, starting detector %s from cached topology",
+                  this->pDetector->GetId().c_str());
+    }
+    setIntegerParam(ADXSPD_ConnectionState, static_cast<int>(this->pApi->GetState()));
+    setIntegerParam(ADXSPD_LogLevel, static_cast<int>(this->getLogLevel()));
     setStringParam(ADManufacturer, "X-Spectrum GmbH");
     setStringParam(ADModel, this->detectorId.c_str());
     setStringParam(ADSDKVersion, this->pApi->GetLibXSPVersion().c_str());
     setStringParam(ADFirmwareVersion, this->pDetector->GetFirmwareVersion().c_str());
 
     // Initialize our modules
+    auto phaseTime = chrono::steady_clock::now();
     vector<XSPD::Module*> moduleList = this->pDetector->GetModules();
     int numModules = (int) moduleList.size();
     setIntegerParam(ADXSPD_NumModules, numModules);
@@ -937,9 +3219,21 @@ ADXSPD::ADXSPD(const char* portName, const char* ip, int portNum, const char* de
         string modulePortName = string(portName) + "_MOD" + std::to_string(index + 1);
         this->modules.push_back(new ADXSPDModule(modulePortName.c_str(), moduleList[index], this));
     }
-
-    asynStatus status = this->getInitialDetState();
-    if (status != asynSuccess) ERR("Failed to read one or more initial detector parameters.");
+    this->startupTimes.push_back({"module ports", msSince(phaseTime)});
+
+    // If we started without a connection, the monitor thread reads the initial state once the
+    // server is reachable.
+    if (this->pApi->IsConnected()) this->readInitialState(numInitThreads);
+    this->startupTimes.push_back({"total", msSince(startupTime)});
+
+    string startupSummary;
+    for (auto& [phase, duration] : this->startupTimes) {
+        char phaseSummary[64];
+        snprintf(phaseSummary, sizeof(phaseSummary), "%s%s %.1f ms",
+                 startupSummary.empty() ? "" : ", ", phase.c_str(), duration);
+        startupSummary += phaseSummary;
+    }
+    INFO_ARGS("Startup time breakdown: %s", startupSummary.c_str());
 
     // Create a shutdown event so we can signal to other threads to exit.
     this->shutdownEventId = epicsEventCreate(epicsEventEmpty);
@@ -960,6 +3254,19 @@ ADXSPD::ADXSPD(const char* portName, const char* ip, int portNum, const char* de
     this->monitorThreadId =
         epicsThreadCreateOpt("monitorThread", (EPICSTHREADFUNC) monitorThreadC, this, &monitorOpts);
 
+    // After a warm start, make sure the cached topology still matches the detector. If we are not
+    // connected yet, the topology is validated when reconnecting instead.
+    if (warmStart && this->pApi->IsConnected()) {
+        this->topologyValidationThreadId =
+            epicsThreadCreateOpt("topologyValidationThread",
+                                 (EPICSTHREADFUNC) topologyValidationThreadC, this, &monitorOpts);
+    }
+
+    {
+        lock_guard<mutex> lock(driverRegistryMutex);
+        driverRegistry[this->portName] = this;
+    }
+
     // when epics is exited, delete the instance of this class
     epicsAtExit(exitCallbackC, this);
 }
@@ -970,6 +3277,13 @@ ADXSPD::ADXSPD(const char* portName, const char* ip, int portNum, const char* de
 ADXSPD::~ADXSPD() {
     INFO("Shutting down ADXSPD driver...");
 
+    {
+        // Collections already running may still be using this driver
+        unique_lock<mutex> lock(driverRegistryMutex);
+        driverRegistry.erase(this->portName);
+        metricsCollectionsDone.wait(lock, [] { return numMetricsCollections == 0; });
+    }
+
     int acquiring;
     getIntegerParam(ADAcquire, &acquiring);
     if (acquiring) {
@@ -985,6 +3299,11 @@ ADXSPD::~ADXSPD() {
         epicsThreadMustJoin(this->monitorThreadId);
     }
 
+    if (this->topologyValidationThreadId != nullptr) {
+        INFO("Waiting for topology validation thread to join...");
+        epicsThreadMustJoin(this->topologyValidationThreadId);
+    }
+
     if (this->zmqContext != nullptr) {
         INFO("Destroying zmq context...");
         zmq_ctx_destroy(this->zmqContext);
@@ -1000,12 +3319,13 @@ ADXSPD::~ADXSPD() {
     }
 
     INFO("Releasing detector and API objects...");
-    delete this->pApi;
+    this->pApi.reset();
 
     // This seems to intermittently segfault, leave commented for now.
     // this->shutdownPortDriver();
 
     INFO("Done.");
+    ADXSPDLog::Flush();
 }
 
 //-------------------------------------------------------------
@@ -1016,19 +3336,101 @@ static const iocshArg XSPDConfigArg0 = {"Port name", iocshArgString};
 static const iocshArg XSPDConfigArg1 = {"IP Address", iocshArgString};
 static const iocshArg XSPDConfigArg2 = {"Port Number", iocshArgInt};
 static const iocshArg XSPDConfigArg3 = {"Device ID", iocshArgString};
+static const iocshArg XSPDConfigArg4 = {"Detector ID", iocshArgString};
+static const iocshArg XSPDConfigArg5 = {"Topology cache directory", iocshArgString};
+static const iocshArg XSPDConfigArg6 = {"Init threads", iocshArgInt};
 
 /* Array of config args */
-static const iocshArg* const XSPDConfigArgs[] = {&XSPDConfigArg0, &XSPDConfigArg1, &XSPDConfigArg2,
-                                                 &XSPDConfigArg3};
+static const iocshArg* const XSPDConfigArgs[] = {&XSPDConfigArg0, &XSPDConfigArg1,
+                                                 &XSPDConfigArg2, &XSPDConfigArg3,
+                                                 &XSPDConfigArg4, &XSPDConfigArg5,
+                                                 &XSPDConfigArg6};
 /* what function to call at config */
 static void configXSPDCallFunc(const iocshArgBuf* args) {
-    ADXSPDConfig(args[0].sval, args[1].sval, args[2].ival, args[3].sval);
+    ADXSPDConfig(args[0].sval, args[1].sval, args[2].ival, args[3].sval, args[4].sval,
+                 args[5].sval, args[6].ival);
 }
 
 /* Function definition */
-static const iocshFuncDef configXSPDFuncDef = {"ADXSPDConfig", 4, XSPDConfigArgs};
+static const iocshFuncDef configXSPDFuncDef = {"ADXSPDConfig", 7, XSPDConfigArgs};
+static const iocshArg XSPDResetRestStatsArg0 = {"Port name", iocshArgString};
+static const iocshArg* const XSPDResetRestStatsArgs[] = {&XSPDResetRestStatsArg0};
+static void resetRestStatsXSPDCallFunc(const iocshArgBuf* args) {
+    ADXSPDResetRestStats(args[0].sval);
+}
+static const iocshFuncDef resetRestStatsXSPDFuncDef = {"ADXSPDResetRestStats", 1,
+                                                       XSPDResetRestStatsArgs};
+
+static const iocshArg XSPDRecordRestArg0 = {"Port name", iocshArgString};
+static const iocshArg XSPDRecordRestArg1 = {"Output file (empty to stop)", iocshArgString};
+static const iocshArg* const XSPDRecordRestArgs[] = {&XSPDRecordRestArg0, &XSPDRecordRestArg1};
+static void recordRestXSPDCallFunc(const iocshArgBuf* args) {
+    ADXSPDRecordRest(args[0].sval, args[1].sval);
+}
+static const iocshFuncDef recordRestXSPDFuncDef = {"ADXSPDRecordRest", 2, XSPDRecordRestArgs};
+
+static const iocshArg XSPDReplayRestArg0 = {"IP Address", iocshArgString};
+static const iocshArg XSPDReplayRestArg1 = {"Port Number", iocshArgInt};
+static const iocshArg XSPDReplayRestArg2 = {"Device ID", iocshArgString};
+static const iocshArg XSPDReplayRestArg3 = {"Recording file", iocshArgString};
+static const iocshArg XSPDReplayRestArg4 = {"Time scale", iocshArgDouble};
+static const iocshArg* const XSPDReplayRestArgs[] = {&XSPDReplayRestArg0, &XSPDReplayRestArg1,
+                                                     &XSPDReplayRestArg2, &XSPDReplayRestArg3,
+                                                     &XSPDReplayRestArg4};
+static void replayRestXSPDCallFunc(const iocshArgBuf* args) {
+    ADXSPDReplayRest(args[0].sval, args[1].ival, args[2].sval, args[3].sval, args[4].dval);
+}
+static const iocshFuncDef replayRestXSPDFuncDef = {"ADXSPDReplayRest", 5, XSPDReplayRestArgs};
+
+static const iocshArg XSPDCaptureArg0 = {"Port name", iocshArgString};
+static const iocshArg XSPDCaptureArg1 = {"Output file (empty to stop)", iocshArgString};
+static const iocshArg XSPDCaptureArg2 = {"Read out frames (0 to capture only)", iocshArgInt};
+static const iocshArg* const XSPDCaptureArgs[] = {&XSPDCaptureArg0, &XSPDCaptureArg1,
+                                                  &XSPDCaptureArg2};
+static void captureXSPDCallFunc(const iocshArgBuf* args) {
+    ADXSPDCapture(args[0].sval, args[1].sval, args[2].ival);
+}
+static const iocshFuncDef captureXSPDFuncDef = {"ADXSPDCapture", 3, XSPDCaptureArgs};
+
+static const iocshArg XSPDReplayCaptureArg0 = {"Port name", iocshArgString};
+static const iocshArg XSPDReplayCaptureArg1 = {"Capture file (empty to stop)", iocshArgString};
+static const iocshArg XSPDReplayCaptureArg2 = {"Speed (0 for maximum)", iocshArgDouble};
+static const iocshArg* const XSPDReplayCaptureArgs[] = {
+    &XSPDReplayCaptureArg0, &XSPDReplayCaptureArg1, &XSPDReplayCaptureArg2};
+static void replayCaptureXSPDCallFunc(const iocshArgBuf* args) {
+    ADXSPDReplayCapture(args[0].sval, args[1].sval, args[2].dval);
+}
+static const iocshFuncDef replayCaptureXSPDFuncDef = {"ADXSPDReplayCapture", 3,
+                                                      XSPDReplayCaptureArgs};
+
+static const iocshArg XSPDTraceEnableArg0 = {"Enable", iocshArgInt};
+static const iocshArg* const XSPDTraceEnableArgs[] = {&XSPDTraceEnableArg0};
+static void traceEnableXSPDCallFunc(const iocshArgBuf* args) { ADXSPDTraceEnable(args[0].ival); }
+static const iocshFuncDef traceEnableXSPDFuncDef = {"ADXSPDTraceEnable", 1, XSPDTraceEnableArgs};
+
+static const iocshArg XSPDTraceDumpArg0 = {"Output file", iocshArgString};
+static const iocshArg* const XSPDTraceDumpArgs[] = {&XSPDTraceDumpArg0};
+static void traceDumpXSPDCallFunc(const iocshArgBuf* args) { ADXSPDTraceDump(args[0].sval); }
+static const iocshFuncDef traceDumpXSPDFuncDef = {"ADXSPDTraceDump", 1, XSPDTraceDumpArgs};
+
+static const iocshArg XSPDMetricsServeArg0 = {"Port (0 to stop)", iocshArgInt};
+static const iocshArg* const XSPDMetricsServeArgs[] = {&XSPDMetricsServeArg0};
+static void metricsServeXSPDCallFunc(const iocshArgBuf* args) { ADXSPDMetricsServe(args[0].ival); }
+static const iocshFuncDef metricsServeXSPDFuncDef = {"ADXSPDMetricsServe", 1,
+                                                     XSPDMetricsServeArgs};
+
 /* IOC register function */
-static void ADXSPDRegister(void) { iocshRegister(&configXSPDFuncDef, configXSPDCallFunc); }
+static void ADXSPDRegister(void) {
+    iocshRegister(&configXSPDFuncDef, configXSPDCallFunc);
+    iocshRegister(&resetRestStatsXSPDFuncDef, resetRestStatsXSPDCallFunc);
+    iocshRegister(&recordRestXSPDFuncDef, recordRestXSPDCallFunc);
+    iocshRegister(&replayRestXSPDFuncDef, replayRestXSPDCallFunc);
+    iocshRegister(&captureXSPDFuncDef, captureXSPDCallFunc);
+    iocshRegister(&replayCaptureXSPDFuncDef, replayCaptureXSPDCallFunc);
+    iocshRegister(&traceEnableXSPDFuncDef, traceEnableXSPDCallFunc);
+    iocshRegister(&traceDumpXSPDFuncDef, traceDumpXSPDCallFunc);
+    iocshRegister(&metricsServeXSPDFuncDef, metricsServeXSPDCallFunc);
+}
 
 /* external function for IOC registration */
 extern "C" {
@@ -22,6 +22,36 @@
 // API interface header
 #include "XSPDAPI.h"
 
+// Declarative parameter <-> API variable bindings
+#include "ADXSPDParamBinding.h"
+
+// Lock-free frame pipeline latency histograms and rate meters
+#include "ADXSPDStats.h"
+
+// Timeline tracing spans
+#include "ADXSPDTrace.h"
+
+// Asynchronous logging backend used by the log macros below
+#include "ADXSPDLog.h"
+
+// Prometheus metrics exporter
+#include "ADXSPDMetrics.h"
+
+// Per-pixel frame kernels
+#include "ADXSPDKernels.h"
+
+// Memory mapped data port capture files
+#include "ADXSPDCapture.h"
+
+// Direct chunk HDF5 writing of detector-compressed frames
+#include "ADXSPDChunkWriter.h"
+
+// Compression and decode thread auto-tuning
+#include "ADXSPDAutoTune.h"
+
+// Frame handlers specialized per decode path and pixel type
+#include "ADXSPDFrameHandler.h"
+
 // Include third party libraries
 #include <blosc.h>
 #include <cpr/cpr.h>
@@ -43,14 +73,26 @@
 // Standard library includes
 #include <stdlib.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 // ADCore includes
 #include "ADDriver.h"
@@ -65,111 +107,104 @@
 using json = nlohmann::json;
 using namespace std;
 
+// Log messages go through the asynchronous backend in ADXSPDLog.h, and are rate limited per call
+// site. Nothing is formatted unless the level is enabled and the call site is within its limit.
+// Status messages set by the _TO_STATUS variants are not rate limited.
+#define ADXSPD_LOG(level, fmt, ...)                                       \
+    if (this->getLogLevel() >= level) {                                   \
+        static ADXSPDLogSite logSite(level, driverName, __func__);        \
+        if (logSite.Allow()) ADXSPDLog::Write(logSite, fmt, __VA_ARGS__); \
+    }
+
 // Error message formatters
-#define ERR(msg)                                      \
-    if (this->getLogLevel() >= ADXSPDLogLevel::ERROR) \
-        fprintf(stderr, "ERROR | %s::%s: %s\n", driverName, __func__, msg);
-
-#define ERR_ARGS(fmt, ...)                            \
-    if (this->getLogLevel() >= ADXSPDLogLevel::ERROR) \
-        fprintf(stderr, "ERROR | %s::%s: " fmt "\n", driverName, __func__, __VA_ARGS__);
-
-#define ERR_TO_STATUS(msg)                                                  \
-    if (this->getLogLevel() >= ADXSPDLogLevel::ERROR) {                     \
-        fprintf(stderr, "ERROR | %s::%s: %s\n", driverName, __func__, msg); \
-        setStringParam(ADStatusMessage, msg);                               \
-        setIntegerParam(ADStatus, ADStatusError);                           \
-        callParamCallbacks();                                               \
+#define ERR(msg) ADXSPD_LOG(ADXSPDLogLevel::ERROR, "%s", msg)
+
+#define ERR_ARGS(fmt, ...) ADXSPD_LOG(ADXSPDLogLevel::ERROR, fmt, __VA_ARGS__)
+
+#define ERR_TO_STATUS(msg)                              \
+    if (this->getLogLevel() >= ADXSPDLogLevel::ERROR) { \
+        ADXSPD_LOG(ADXSPDLogLevel::ERROR, "%s", msg);   \
+        setStringParam(ADStatusMessage, msg);           \
+        setIntegerParam(ADStatus, ADStatusError);       \
+        callParamCallbacks();                           \
     }
 
-#define ERR_TO_STATUS_ARGS(fmt, ...)                                           \
-    if (this->getLogLevel() >= ADXSPDLogLevel::ERROR) {                        \
-        char errMsg[256];                                                      \
-        snprintf(errMsg, sizeof(errMsg), fmt, __VA_ARGS__);                    \
-        fprintf(stderr, "ERROR | %s::%s: %s\n", driverName, __func__, errMsg); \
-        setStringParam(ADStatusMessage, errMsg);                               \
-        setIntegerParam(ADStatus, ADStatusError);                              \
-        callParamCallbacks();                                                  \
+#define ERR_TO_STATUS_ARGS(fmt, ...)                        \
+    if (this->getLogLevel() >= ADXSPDLogLevel::ERROR) {     \
+        char errMsg[256];                                   \
+        snprintf(errMsg, sizeof(errMsg), fmt, __VA_ARGS__); \
+        ADXSPD_LOG(ADXSPDLogLevel::ERROR, "%s", errMsg);    \
+        setStringParam(ADStatusMessage, errMsg);            \
+        setIntegerParam(ADStatus, ADStatusError);           \
+        callParamCallbacks();                               \
     }
 
 // Warning message formatters
-#define WARN(msg)                                       \
-    if (this->getLogLevel() >= ADXSPDLogLevel::WARNING) \
-        fprintf(stderr, "WARNING | %s::%s: %s\n", driverName, __func__, msg);
-
-#define WARN_ARGS(fmt, ...)                             \
-    if (this->getLogLevel() >= ADXSPDLogLevel::WARNING) \
-        fprintf(stderr, "WARNING | %s::%s: " fmt "\n", driverName, __func__, __VA_ARGS__);
-
-#define WARN_TO_STATUS(msg)                                                   \
-    if (this->getLogLevel() >= ADXSPDLogLevel::WARNING) {                     \
-        fprintf(stderr, "WARNING | %s::%s: %s\n", driverName, __func__, msg); \
-        setStringParam(ADStatusMessage, msg);                                 \
-        callParamCallbacks();                                                 \
+#define WARN(msg) ADXSPD_LOG(ADXSPDLogLevel::WARNING, "%s", msg)
+
+#define WARN_ARGS(fmt, ...) ADXSPD_LOG(ADXSPDLogLevel::WARNING, fmt, __VA_ARGS__)
+
+#define WARN_TO_STATUS(msg)                               \
+    if (this->getLogLevel() >= ADXSPDLogLevel::WARNING) { \
+        ADXSPD_LOG(ADXSPDLogLevel::WARNING, "%s", msg);   \
+        setStringParam(ADStatusMessage, msg);             \
+        callParamCallbacks();                             \
     }
 
-#define WARN_TO_STATUS_ARGS(fmt, ...)                                             \
-    if (this->getLogLevel() >= ADXSPDLogLevel::WARNING) {                         \
-        char warnMsg[256];                                                        \
-        snprintf(warnMsg, sizeof(warnMsg), fmt, __VA_ARGS__);                     \
-        fprintf(stderr, "WARNING | %s::%s: %s\n", driverName, __func__, warnMsg); \
-        setStringParam(ADStatusMessage, warnMsg);                                 \
-        callParamCallbacks();                                                     \
+#define WARN_TO_STATUS_ARGS(fmt, ...)                         \
+    if (this->getLogLevel() >= ADXSPDLogLevel::WARNING) {     \
+        char warnMsg[256];                                    \
+        snprintf(warnMsg, sizeof(warnMsg), fmt, __VA_ARGS__); \
+        ADXSPD_LOG(ADXSPDLogLevel::WARNING, "%s", warnMsg);   \
+        setStringParam(ADStatusMessage, warnMsg);             \
+        callParamCallbacks();                                 \
     }
 
 // Info message formatters
-#define INFO(msg)                                    \
-    if (this->getLogLevel() >= ADXSPDLogLevel::INFO) \
-        fprintf(stdout, "INFO | %s::%s: %s\n", driverName, __func__, msg);
-
-#define INFO_ARGS(fmt, ...)                          \
-    if (this->getLogLevel() >= ADXSPDLogLevel::INFO) \
-        fprintf(stdout, "INFO | %s::%s: " fmt "\n", driverName, __func__, __VA_ARGS__);
-
-#define INFO_TO_STATUS(msg)                                                \
-    if (this->getLogLevel() >= ADXSPDLogLevel::INFO) {                     \
-        fprintf(stdout, "INFO | %s::%s: %s\n", driverName, __func__, msg); \
-        setStringParam(ADStatusMessage, msg);                              \
-        callParamCallbacks();                                              \
+#define INFO(msg) ADXSPD_LOG(ADXSPDLogLevel::INFO, "%s", msg)
+
+#define INFO_ARGS(fmt, ...) ADXSPD_LOG(ADXSPDLogLevel::INFO, fmt, __VA_ARGS__)
+
+#define INFO_TO_STATUS(msg)                            \
+    if (this->getLogLevel() >= ADXSPDLogLevel::INFO) { \
+        ADXSPD_LOG(ADXSPDLogLevel::INFO, "%s", msg);   \
+        setStringParam(ADStatusMessage, msg);          \
+        callParamCallbacks();                          \
     }
 
-#define INFO_TO_STATUS_ARGS(fmt, ...)                                          \
-    if (this->getLogLevel() >= ADXSPDLogLevel::INFO) {                         \
-        char infoMsg[256];                                                     \
-        snprintf(infoMsg, sizeof(infoMsg), fmt, __VA_ARGS__);                  \
-        fprintf(stdout, "INFO | %s::%s: %s\n", driverName, __func__, infoMsg); \
-        setStringParam(ADStatusMessage, infoMsg);                              \
-        callParamCallbacks();                                                  \
+#define INFO_TO_STATUS_ARGS(fmt, ...)                         \
+    if (this->getLogLevel() >= ADXSPDLogLevel::INFO) {        \
+        char infoMsg[256];                                    \
+        snprintf(infoMsg, sizeof(infoMsg), fmt, __VA_ARGS__); \
+        ADXSPD_LOG(ADXSPDLogLevel::INFO, "%s", infoMsg);      \
+        setStringParam(ADStatusMessage, infoMsg);             \
+        callParamCallbacks();                                 \
     }
 
 // Debug message formatters
-#define DEBUG(msg)                                    \
-    if (this->getLogLevel() >= ADXSPDLogLevel::DEBUG) \
-        fprintf(stdout, "DEBUG | %s::%s: %s\n", driverName, __func__, msg);
-
-#define DEBUG_ARGS(fmt, ...)                          \
-    if (this->getLogLevel() >= ADXSPDLogLevel::DEBUG) \
-        fprintf(stdout, "DEBUG | %s::%s: " fmt "\n", driverName, __func__, __VA_ARGS__);
-
-enum class ADXSPDLogLevel {
-    NONE = 0,      // No logging
-    ERROR = 10,    // Error messages only
-    WARNING = 20,  // Warnings and errors
-    INFO = 30,     // Info, warnings, and errors
-    DEBUG = 40     // Debugging information
-};
+#define DEBUG(msg) ADXSPD_LOG(ADXSPDLogLevel::DEBUG, "%s", msg)
+
+#define DEBUG_ARGS(fmt, ...) ADXSPD_LOG(ADXSPDLogLevel::DEBUG, fmt, __VA_ARGS__)
 
 #define ADXSPD_MIN_STATUS_POLL_INTERVAL 0.5  // Minimum status poll interval in seconds
+#define ADXSPD_RECONNECT_MIN_DELAY 0.5       // Initial delay between reconnect attempts in seconds
+#define ADXSPD_RECONNECT_MAX_DELAY 10.0      // Maximum delay between reconnect attempts in seconds
+#define ADXSPD_ZMQ_RECV_TIMEOUT_MS 500       // Data port receive timeout in milliseconds
+#define ADXSPD_STATS_PUBLISH_INTERVAL 1.0    // Interval between frame statistics updates in seconds
 
 class ADXSPDModule;  // Forward declaration of module class
 
+void registerSharedAPI(string ip, int portNum, string deviceId, shared_ptr<XSPD::API> api);
+
 /*
  * Class definition of the ADXSPD driver
  */
 class ADXSPD : ADDriver {
    public:
     // Constructor for the ADXSPD driver
-    ADXSPD(const char* portName, const char* ip, int portNum, const char* deviceId = nullptr);
+    ADXSPD(const char* portName, const char* ip, int portNum, const char* deviceId = nullptr,
+           const char* detectorId = nullptr, const char* topologyCacheDir = nullptr,
+           int numInitThreads = 0);
 
     // ADDriver overrides
     virtual asynStatus writeInt32(asynUser* pasynUser, epicsInt32 value);
@@ -182,8 +217,9 @@ class ADXSPD : ADDriver {
     // Must be public, since it is called from an external C function
     void acquisitionThread();
     void monitorThread();
+    void topologyValidationThread();
 
-    ADXSPDLogLevel getLogLevel() { return this->logLevel; }
+    ADXSPDLogLevel getLogLevel() { return this->logLevel.load(memory_order_relaxed); }
 
     asynStatus getInitialDetState();
     asynStatus acquireStart();
@@ -210,6 +246,24 @@ class ADXSPD : ADDriver {
         return getAPIVar<T>(paramIndex, *(this->pDetector->GetActiveDataPort()), varName);
     }
 
+    const ADXSPDParamBinding* getParamBinding(int paramIndex);
+    asynStatus readBoundParam(const ADXSPDParamBinding& binding);
+    double writeBoundParam(const ADXSPDParamBinding& binding, double value);
+    double publishBoundParam(const ADXSPDParamBinding& binding, double apiValue);
+    void refreshDependents(int refreshMask);
+    int getMaxNumImages();
+
+    void resetRestStats();
+    void recordRest(const string& path);
+    void capture(const string& path, bool decode);
+    void replayCapture(const string& path, double speed);
+    void collectMetrics(ADXSPDMetricsWriter& writer);
+    shared_ptr<XSPD::API> getAPI() { return this->pApi; }
+
+    asynStatus savePreset();
+    asynStatus applyPreset();
+    int applySettings(const json& settings);
+
    protected:
 // Load auto-generated parameter string and index definitions
 #include "ADXSPDParamDefs.h"
@@ -218,15 +272,58 @@ class ADXSPD : ADDriver {
     const char* driverName = "ADXSPD";
     void createAllParams();
 
+    // Auto-generated from info tags in ADXSPD.template, see ADXSPDParamBindings.cpp
+    void createParamBindings();
+    void registerParamBinding(const ADXSPDParamBinding& binding);
+
+    string getPresetPath();
+
+    json getCachedSettings();
+    json readDetectorSettings();
+    void publishDetectorSettings(const json& settings);
+    void setVersionInfo(const string& serialNumber);
+    void readInitialState(int numInitThreads);
+    bool writeRequiresConnection(int function);
+    void onDisconnect();
+    void reconnect();
+    void* connectDataPort();
+    bool captureFrame(vector<zmq_msg_t>& frameMessages,
+                      chrono::steady_clock::time_point receivedTime);
+    void startReplay();
+    asynStatus openChunkWriter();
+    bool writeChunk(vector<zmq_msg_t>& frameMessages);
+    void closeChunkWriter();
+    void startAutoTuneSeries();
+    void endAutoTuneSeries();
+    void selectFrameHandler();
+    void applyAutoTune();
+    NDArray* compressFrame(NDArray* pArray, XSPD::Compressor compressor,
+                           XSPD::ShuffleMode shuffleMode, int level, int numThreads);
+    int receiveReplayFrame(void* zmqSubscriber, vector<zmq_msg_t>& frameMessages);
+
+    void recordFrameStats(chrono::steady_clock::time_point receivedTime,
+                          chrono::steady_clock::time_point decodedTime,
+                          chrono::steady_clock::time_point callbacksTime, size_t wireBytes,
+                          size_t outputBytes);
+    void updateFrameStats();
+    void publishRestStats();
+    void reportFrameStats(FILE* fp, int details);
+
+    string getTopologyCachePath(string cacheId);
+    string getTopologyIndexPath();
+    json loadTopologyCache();
+    void saveTopologyCache();
+
     epicsThreadId acquisitionThreadId;
     epicsThreadId monitorThreadId;
+    epicsThreadId topologyValidationThreadId = nullptr;
 
     epicsEventId shutdownEventId;
 
     void* zmqContext;
 
     vector<ADXSPDModule*> modules;
-    XSPD::API* pApi;
+    shared_ptr<XSPD::API> pApi;  // Shared with other drivers connected to the same device
     XSPD::Detector* pDetector;
 
     string apiUri;        // IP address and port for the device
@@ -238,11 +335,86 @@ class ADXSPD : ADDriver {
     string dataPortIp;
     int dataPortPort;
 
-    vector<int> onlyIdleParams = {
-        ADTriggerMode, ADAcquireTime, ADXSPD_BitDepth, ADXSPD_ShuffleMode, ADXSPD_CounterMode,
-    };
-
-    ADXSPDLogLevel logLevel = ADXSPDLogLevel::INFO;  // Logging level for the driver
+    string topologyCacheDir;  // Directory for cached topology files, empty if disabled
+    string topologyCacheKey;  // XSPD server address and requested device ID
+    vector<pair<string, double>> startupTimes;  // Startup phase durations in ms
+    int numInitThreads;                         // Concurrent requests when reading initial state
+    bool initialStateRead = false;              // Set once initial detector state has been read
+
+    optional<chrono::steady_clock::time_point> disconnectTime;  // When the connection was lost
+    double reconnectDelay = ADXSPD_RECONNECT_MIN_DELAY;         // Current reconnect backoff in s
+    atomic<bool> resubscribeRequested{false};  // Set on reconnect, cleared by acquisition thread
+
+    // Per-frame pipeline statistics, written by the acquisition thread only
+    array<ADXSPDLatencyHistogram, ADXSPD_NUM_FRAME_STAGES> stageLatency;  // Indexed by stage
+    ADXSPDRateMeter wireRateMeter;    // Frames and compressed bytes received from the data port
+    ADXSPDRateMeter outputRateMeter;  // Decompressed bytes delivered in NDArrays
+    chrono::steady_clock::time_point lastStatsPublish;
+    atomic<bool> statsResetRequested{false};  // Set by ResetStats, cleared by acquisition thread
+
+    // Decode throughput of each codec, indexed by XSPD::Compressor. Frames copied into the NDArray
+    // without decompressing are counted under NONE.
+    array<ADXSPDCodecStats, magic_enum::enum_count<XSPD::Compressor>()> codecStats;
+
+    // Output compression of decoded frames before callbacks, see compressFrame
+    ADXSPDCodecStats outputCompressStats;
+
+    // Frame and data port counters since startup, written by the acquisition thread only
+    atomic<uint64_t> numFramesReceived{0};   // Multipart messages received from the data port
+    atomic<uint64_t> numFramesDecoded{0};    // Frames read out into an NDArray
+    atomic<uint64_t> numFramesDropped{0};    // Frames discarded due to malformed data or errors
+    atomic<uint64_t> numFramesPublished{0};  // Frames passed to NDArray callbacks
+    atomic<uint64_t> numZmqParts{0};         // Message parts received
+    atomic<uint64_t> numZmqBytes{0};         // Bytes received in all message parts
+    atomic<uint64_t> numZmqTimeouts{0};      // Receive timeouts while waiting for a frame
+    atomic<uint64_t> numZmqErrors{0};        // Receive errors other than timeouts
+    atomic<uint64_t> numZmqResubscribes{0};  // Data port re-subscriptions after a reconnect
+    atomic<uint64_t> numFramesCaptured{0};   // Frames written to a capture file
+    atomic<uint64_t> numCaptureBytes{0};     // Bytes written to capture files
+    atomic<uint64_t> numFramesWritten{0};    // Frames written to HDF5 chunks
+    atomic<uint64_t> numChunkBytes{0};       // Compressed bytes written to HDF5 chunks
+
+    // Data port capture and replay, see ADXSPDCapture and ADXSPDReplayCapture
+    mutex captureMutex;  // Protects the capture writer and replay state below
+    unique_ptr<ADXSPDCaptureWriter> captureWriter;    // Frames are appended as they are received
+    bool captureDecode = true;                        // Whether captured frames are also read out
+    atomic<bool> capturing{false};                    // Set while captureWriter is open
+    shared_ptr<ADXSPDCaptureReader> replayReader;     // Capture standing in for the data port
+    double replaySpeed = 1.0;                         // Replay speed factor, 0 for no delays
+    size_t replayNext = 0;                            // Next record to replay
+    chrono::steady_clock::time_point replayStart;     // When replay of the acquisition started
+    atomic<bool> replaying{false};                    // Set while replayReader is loaded
+    atomic<bool> replayArmed{false};                  // Set while acquiring from the replay
+
+    // Direct chunk writing, enabled with AutoSave
+    mutex chunkWriterMutex;                     // Protects the chunk writer
+    unique_ptr<ADXSPDChunkWriter> chunkWriter;  // Frames are written as they are received
+    bool chunkReadOut = true;                   // Whether written frames are also read out
+    atomic<bool> writingChunks{false};          // Set while chunkWriter is open
+
+    ADXSPDAutoTuner autoTuner;  // Measures each series and picks the setting for the next
+    mutex tuneDecisionMutex;    // Protects pendingTuneDecision
+    optional<ADXSPDTuneDecision> pendingTuneDecision;  // Applied under the port lock while idle
+
+    // Frame handler for the current decode settings, used by the acquisition thread only
+    unique_ptr<ADXSPDFrameHandler> frameHandler;
+    atomic<bool> frameHandlerStale{true};  // Set on arm and decode setting changes
+
+    // Output transform and type are read at the start of each series, so that they never change
+    // within one, and are used by the acquisition thread only
+    atomic<bool> seriesStarted{true};  // Set on arm, cleared by acquisition thread
+    ADXSPDFrameTransform seriesTransform = ADXSPDFrameTransform::NONE;
+    ADXSPDPixelType seriesOutputType = ADXSPDPixelType::NATIVE;
+    ADXSPDSaturationGuard saturationGuard;  // Falls back to the native type between series
+
+    ADXSPDLatencyHistogram statusPollLatency;  // Monitor thread detector status polls, in ns
+    atomic<int> framesQueued{0};               // Last polled frames queued on the server
+
+    vector<ADXSPDParamBinding> paramBindings;
+    vector<int> bindingForParam;            // asyn param index -> index into paramBindings, or -1
+    vector<optional<double>> bindingCache;  // Last API value read or written for each binding
+
+    atomic<ADXSPDLogLevel> logLevel{ADXSPDLogLevel::INFO};  // Logging level for the driver
 };
 
 #endif
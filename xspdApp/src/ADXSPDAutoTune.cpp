@@ -0,0 +1,268 @@
+/*
+ * Compression and decode thread auto-tuning for the ADXSPD driver
+ *
+ * See ADXSPDAutoTune.h for how settings are chosen.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#include "ADXSPDAutoTune.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+const vector<ADXSPDTuneSetting> ADXSPDAutoTuner::ladder = {
+    {XSPD::Compressor::NONE, 0, XSPD::ShuffleMode::NO_SHUFFLE, 1},
+    {XSPD::Compressor::BLOSC_LZ4, 5, XSPD::ShuffleMode::SHUFFLE_BYTE, 1},
+    {XSPD::Compressor::BLOSC_LZ4, 5, XSPD::ShuffleMode::SHUFFLE_BIT, 1},
+    {XSPD::Compressor::BLOSC_ZSTD, 1, XSPD::ShuffleMode::SHUFFLE_BIT, 1},
+    {XSPD::Compressor::BLOSC_ZSTD, 5, XSPD::ShuffleMode::SHUFFLE_BIT, 1},
+};
+
+static string formatString(const char* fmt, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    return buffer;
+}
+
+/**
+ * @brief Describes the setting as it would be selected in the driver, e.g.
+ * "blosc/lz4 level 5, bit shuffle, 2 threads"
+ */
+string ADXSPDTuneSetting::ToString() const {
+    if (this->compressor == XSPD::Compressor::NONE) return "none";
+    if (!XSPD::IsBloscCompressor(this->compressor))
+        return formatString("zlib level %d", this->level);
+
+    const char* shuffleName = this->shuffleMode == XSPD::ShuffleMode::SHUFFLE_BYTE ? "byte"
+                              : this->shuffleMode == XSPD::ShuffleMode::SHUFFLE_BIT ? "bit"
+                              : this->shuffleMode == XSPD::ShuffleMode::AUTO_SHUFFLE ? "auto"
+                                                                                    : "no";
+    return formatString("blosc/%s level %d, %s shuffle, %d thread%s",
+                        XSPD::GetBloscSubcompressorName(this->compressor).c_str(), this->level,
+                        shuffleName, this->numThreads, this->numThreads == 1 ? "" : "s");
+}
+
+/**
+ * @brief Creates a tuner with no measurements
+ *
+ * @param targetUtilization Fraction of the acquisition thread's time decoding may take, 0-1
+ * @param maxThreads Most blosc decompression threads to use
+ */
+ADXSPDAutoTuner::ADXSPDAutoTuner(double targetUtilization, int maxThreads)
+    : targetUtilization(targetUtilization), maxThreads(max(maxThreads, 1)) {}
+
+void ADXSPDAutoTuner::SetTargetUtilization(double targetUtilization) {
+    lock_guard<mutex> lock(this->tunerMutex);
+    this->targetUtilization = targetUtilization;
+}
+
+void ADXSPDAutoTuner::SetMaxThreads(int maxThreads) {
+    lock_guard<mutex> lock(this->tunerMutex);
+    this->maxThreads = max(maxThreads, 1);
+}
+
+/**
+ * @brief Starts measuring a series acquired with the given setting. Any series not ended is
+ * discarded.
+ */
+void ADXSPDAutoTuner::StartSeries(const ADXSPDTuneSetting& setting, int bitDepth) {
+    lock_guard<mutex> lock(this->tunerMutex);
+    this->seriesActive = true;
+    this->seriesSetting = setting;
+    // Only blosc decompression is threaded, so the thread count does not matter otherwise
+    if (!XSPD::IsBloscCompressor(setting.compressor)) this->seriesSetting.numThreads = 1;
+    this->seriesBitDepth = bitDepth;
+    this->seriesFrames = 0;
+    this->seriesWireBytes = 0;
+    this->seriesDecodedBytes = 0;
+    this->seriesDecodeNs = 0;
+}
+
+/**
+ * @brief Records a frame decoded by the driver. Ignored if no series is being measured.
+ *
+ * @param wireBytes Size of the frame as received from the data port
+ * @param decodedBytes Size of the decoded frame
+ * @param decodeNs Time spent decoding the frame
+ * @param receivedTime Time the frame was received
+ */
+void ADXSPDAutoTuner::RecordFrame(uint64_t wireBytes, uint64_t decodedBytes, uint64_t decodeNs,
+                                  chrono::steady_clock::time_point receivedTime) {
+    lock_guard<mutex> lock(this->tunerMutex);
+    if (!this->seriesActive) return;
+    if (this->seriesFrames == 0) this->seriesFirstFrame = receivedTime;
+    this->seriesLastFrame = receivedTime;
+    this->seriesFrames++;
+    this->seriesWireBytes += wireBytes;
+    this->seriesDecodedBytes += decodedBytes;
+    this->seriesDecodeNs += decodeNs;
+}
+
+/**
+ * @brief Ends the series being measured, adds its measurements to those of its setting, and
+ * chooses the setting for the next series
+ *
+ * @return optional<ADXSPDTuneDecision> The next setting and the reason for it, or nullopt if no
+ * series was being measured, or it was too short to measure
+ */
+optional<ADXSPDTuneDecision> ADXSPDAutoTuner::EndSeries() {
+    lock_guard<mutex> lock(this->tunerMutex);
+    if (!this->seriesActive) return nullopt;
+    this->seriesActive = false;
+
+    double seconds =
+        chrono::duration<double>(this->seriesLastFrame - this->seriesFirstFrame).count();
+    if (this->seriesFrames < ADXSPD_TUNE_MIN_FRAMES || seconds <= 0.0 ||
+        this->seriesWireBytes == 0 || this->seriesDecodedBytes == 0)
+        return nullopt;
+
+    // Frames arrive over the time between the first and last, one interval fewer than frames
+    double frameRate = (this->seriesFrames - 1) / seconds;
+    double decodedBytesPerSecond = frameRate * this->seriesDecodedBytes / this->seriesFrames;
+    double ratio = (double) this->seriesDecodedBytes / this->seriesWireBytes;
+    double decodeNsPerByte = (double) this->seriesDecodeNs / this->seriesDecodedBytes;
+
+    ADXSPDTuneObservation& observation =
+        this->observations[{this->seriesBitDepth, this->seriesSetting}];
+    if (observation.numSeries == 0) {
+        observation.ratio = ratio;
+        observation.decodeNsPerByte = decodeNsPerByte;
+    } else {
+        observation.ratio += ADXSPD_TUNE_EMA_WEIGHT * (ratio - observation.ratio);
+        observation.decodeNsPerByte +=
+            ADXSPD_TUNE_EMA_WEIGHT * (decodeNsPerByte - observation.decodeNsPerByte);
+    }
+    observation.numSeries++;
+
+    return this->Choose(this->seriesSetting, this->seriesBitDepth, decodedBytesPerSecond);
+}
+
+/**
+ * @brief Gets the running measurements of a setting at a bit depth, if it has been measured
+ */
+optional<ADXSPDTuneObservation> ADXSPDAutoTuner::GetObservation(const ADXSPDTuneSetting& setting,
+                                                                int bitDepth) const {
+    lock_guard<mutex> lock(this->tunerMutex);
+    auto it = this->observations.find({bitDepth, setting});
+    if (it == this->observations.end()) return nullopt;
+    return it->second;
+}
+
+/**
+ * @brief Discards all measurements, e.g. after a change to the detector that invalidates them
+ */
+void ADXSPDAutoTuner::Reset() {
+    lock_guard<mutex> lock(this->tunerMutex);
+    this->observations.clear();
+    this->seriesActive = false;
+}
+
+/**
+ * @brief Checks whether a setting has been measured at a bit depth. Called with the lock held.
+ *
+ * @param anyThreads Whether a measurement of the same codec with any thread count counts
+ */
+bool ADXSPDAutoTuner::IsMeasured(const ADXSPDTuneSetting& setting, int bitDepth,
+                                 bool anyThreads) const {
+    for (const auto& [key, observation] : this->observations) {
+        if (key.first != bitDepth) continue;
+        if (anyThreads ? key.second.SameCodec(setting) : key.second == setting) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Chooses the setting for the next series. Called with the lock held.
+ *
+ * @param current The setting of the series just measured
+ * @param bitDepth Bit depth of the series just measured
+ * @param decodedBytesPerSecond Decoded data rate of the series just measured, at which the decode
+ * utilization of every measured setting is compared
+ */
+ADXSPDTuneDecision ADXSPDAutoTuner::Choose(const ADXSPDTuneSetting& current, int bitDepth,
+                                           double decodedBytesPerSecond) const {
+    auto utilization = [&](const ADXSPDTuneObservation& observation) {
+        return observation.decodeNsPerByte * decodedBytesPerSecond / 1e9;
+    };
+    double target = this->targetUtilization;
+    double currentUtilization = utilization(this->observations.at({bitDepth, current}));
+    bool threaded = XSPD::IsBloscCompressor(current.compressor);
+
+    if (currentUtilization > target) {
+        // Over the target: spread blosc decompression over more threads, if not yet tried
+        ADXSPDTuneSetting next = current;
+        next.numThreads = min(current.numThreads * 2, this->maxThreads);
+        if (threaded && next.numThreads > current.numThreads && !IsMeasured(next, bitDepth, false))
+            return {next, formatString("Decoding at %.0f%%, over the %.0f%% target; trying %d "
+                                       "threads",
+                                       100 * currentUtilization, 100 * target, next.numThreads)};
+    } else {
+        // Headroom: try the next stronger compression not yet measured
+        size_t position = 1;
+        for (size_t i = 0; i < ladder.size(); i++)
+            if (ladder[i].SameCodec(current)) position = i + 1;
+        for (size_t i = position; i < ladder.size(); i++) {
+            if (IsMeasured(ladder[i], bitDepth, true)) continue;
+            ADXSPDTuneSetting next = ladder[i];
+            next.numThreads = max(1, min(current.numThreads, this->maxThreads));
+            return {next, formatString("Decoding at %.0f%%, under the %.0f%% target; trying %s",
+                                       100 * currentUtilization, 100 * target,
+                                       next.ToString().c_str())};
+        }
+
+        // Well under the target: free up threads, if fewer have not been tried
+        ADXSPDTuneSetting next = current;
+        next.numThreads = current.numThreads / 2;
+        if (threaded && next.numThreads >= 1 && currentUtilization < target / 2 &&
+            !IsMeasured(next, bitDepth, false))
+            return {next, formatString("Decoding at %.0f%%, under half the %.0f%% target; trying "
+                                       "%d thread%s",
+                                       100 * currentUtilization, 100 * target, next.numThreads,
+                                       next.numThreads == 1 ? "" : "s")};
+    }
+
+    // Everything worth trying has been measured: the best ratio under the target, preferring fewer
+    // threads and then faster decoding among settings with about the same ratio
+    using Entry = decltype(this->observations)::value_type;
+    const Entry* best = nullptr;
+    const Entry* fastest = nullptr;
+    for (const auto& entry : this->observations) {
+        if (entry.first.first != bitDepth) continue;
+        double entryUtilization = utilization(entry.second);
+        if (fastest == nullptr || entryUtilization < utilization(fastest->second))
+            fastest = &entry;
+        if (entryUtilization > target) continue;
+        if (best == nullptr) {
+            best = &entry;
+            continue;
+        }
+        double bestRatio = best->second.ratio;
+        bool betterRatio = entry.second.ratio > bestRatio * (1 + ADXSPD_TUNE_RATIO_TOLERANCE);
+        bool sameRatio = entry.second.ratio >= bestRatio * (1 - ADXSPD_TUNE_RATIO_TOLERANCE);
+        int threads = entry.first.second.numThreads, bestThreads = best->first.second.numThreads;
+        bool fewerThreads = threads < bestThreads;
+        bool faster = threads == bestThreads && entryUtilization < utilization(best->second);
+        if (betterRatio || (sameRatio && (fewerThreads || faster))) best = &entry;
+    }
+
+    if (best == nullptr) {
+        return {fastest->first.second,
+                formatString("No measured setting decodes under the %.0f%% target; using the "
+                             "fastest, at %.0f%%",
+                             100 * target, 100 * utilization(fastest->second))};
+    }
+    return {best->first.second,
+            formatString("Best measured under the %.0f%% target: ratio %.2f, %.1f MB/s on the "
+                         "wire, decoding at %.0f%%",
+                         100 * target, best->second.ratio,
+                         decodedBytesPerSecond / best->second.ratio / 1e6,
+                         100 * utilization(best->second))};
+}
@@ -0,0 +1,126 @@
+/*
+ * Compression and decode thread auto-tuning for the ADXSPD driver
+ *
+ * Measures, for each acquisition series, the compression ratio achieved on the wire and the time
+ * the driver spent decoding frames, and from these picks the compressor, level, shuffle and blosc
+ * thread count for the next series. The aim is the best compression ratio, so the least wire
+ * bandwidth, that keeps the decode stage below a target utilization of the acquisition thread.
+ *
+ * Decode time is kept per byte of decoded data, so measurements from one series can be compared
+ * at the data rate of the next. Measurements are kept separately for each bit depth, as the ratio
+ * and decode speed of a codec depend strongly on it. Settings not yet measured are explored one
+ * series at a time: stronger compression from a fixed ladder while there is headroom, and more
+ * blosc threads while decoding is over the target.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#ifndef ADXSPD_AUTO_TUNE_H
+#define ADXSPD_AUTO_TUNE_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "XSPDAPI.h"
+
+using namespace std;
+
+#define ADXSPD_TUNE_MIN_FRAMES 10         // Frames a series needs for its measurements to be used
+#define ADXSPD_TUNE_EMA_WEIGHT 0.5        // Weight of a new series in the running measurements
+#define ADXSPD_TUNE_RATIO_TOLERANCE 0.01  // Relative ratio difference treated as equal
+
+/**
+ * @brief Compression and decode settings chosen between
+ */
+struct ADXSPDTuneSetting {
+    XSPD::Compressor compressor = XSPD::Compressor::NONE;
+    int level = 0;
+    XSPD::ShuffleMode shuffleMode = XSPD::ShuffleMode::NO_SHUFFLE;
+    int numThreads = 1;  // Blosc decompression threads
+
+    bool SameCodec(const ADXSPDTuneSetting& other) const {
+        return this->compressor == other.compressor && this->level == other.level &&
+               this->shuffleMode == other.shuffleMode;
+    }
+    bool operator==(const ADXSPDTuneSetting& other) const {
+        return this->SameCodec(other) && this->numThreads == other.numThreads;
+    }
+    bool operator!=(const ADXSPDTuneSetting& other) const { return !(*this == other); }
+    bool operator<(const ADXSPDTuneSetting& other) const {
+        return tie(this->compressor, this->level, this->shuffleMode, this->numThreads) <
+               tie(other.compressor, other.level, other.shuffleMode, other.numThreads);
+    }
+
+    string ToString() const;
+};
+
+/**
+ * @brief Running measurements of a setting at one bit depth
+ */
+struct ADXSPDTuneObservation {
+    double ratio = 1.0;            // Decoded bytes per byte on the wire
+    double decodeNsPerByte = 0.0;  // Decode time per decoded byte
+    int numSeries = 0;
+};
+
+struct ADXSPDTuneDecision {
+    ADXSPDTuneSetting setting;  // Setting to use for the next series
+    string reason;
+};
+
+/**
+ * @brief Measures acquisition series and chooses the setting for the next. Thread safe; frames are
+ * recorded from the acquisition thread.
+ */
+class ADXSPDAutoTuner {
+   public:
+    ADXSPDAutoTuner(double targetUtilization = 0.5, int maxThreads = 8);
+
+    void SetTargetUtilization(double targetUtilization);
+    void SetMaxThreads(int maxThreads);
+
+    void StartSeries(const ADXSPDTuneSetting& setting, int bitDepth);
+    void RecordFrame(uint64_t wireBytes, uint64_t decodedBytes, uint64_t decodeNs,
+                     chrono::steady_clock::time_point receivedTime);
+    optional<ADXSPDTuneDecision> EndSeries();
+
+    optional<ADXSPDTuneObservation> GetObservation(const ADXSPDTuneSetting& setting,
+                                                   int bitDepth) const;
+    void Reset();
+
+    // Codec settings explored in order while decoding has headroom, roughly by increasing
+    // decode cost and compression ratio
+    static const vector<ADXSPDTuneSetting> ladder;
+
+   private:
+    ADXSPDTuneDecision Choose(const ADXSPDTuneSetting& current, int bitDepth,
+                              double decodedBytesPerSecond) const;
+    bool IsMeasured(const ADXSPDTuneSetting& setting, int bitDepth, bool anyThreads) const;
+
+    mutable mutex tunerMutex;
+    double targetUtilization;
+    int maxThreads;
+    map<pair<int, ADXSPDTuneSetting>, ADXSPDTuneObservation> observations;
+
+    // The series being measured
+    bool seriesActive = false;
+    ADXSPDTuneSetting seriesSetting;
+    int seriesBitDepth = 0;
+    uint64_t seriesFrames = 0;
+    uint64_t seriesWireBytes = 0;
+    uint64_t seriesDecodedBytes = 0;
+    uint64_t seriesDecodeNs = 0;
+    chrono::steady_clock::time_point seriesFirstFrame;
+    chrono::steady_clock::time_point seriesLastFrame;
+};
+
+#endif
@@ -0,0 +1,306 @@
+/*
+ * Data port capture files for the ADXSPD driver
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#include "ADXSPDCapture.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+static_assert(sizeof(ADXSPDCaptureFileHeader) == 64, "Capture file header must be 64 bytes");
+static_assert(sizeof(ADXSPDCaptureRecordHeader) == 16, "Capture record header must be 16 bytes");
+
+static string errnoMessage() { return string(strerror(errno)); }
+
+static size_t alignRecord(size_t size) { return (size + 7) & ~(size_t) 7; }
+
+/**
+ * @brief Creates a capture file, overwriting any existing file and index at the path
+ *
+ * @param path Capture file to write
+ */
+ADXSPDCaptureWriter::ADXSPDCaptureWriter(const string& path) : path(path) {
+    this->fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (this->fd < 0)
+        throw runtime_error("Failed to create capture file " + path + ": " + errnoMessage());
+
+    this->indexFile = fopen((path + ".idx").c_str(), "wb");
+    if (this->indexFile == nullptr) {
+        string message = errnoMessage();
+        close(this->fd);
+        this->fd = -1;
+        throw runtime_error("Failed to create capture index " + path + ".idx: " + message);
+    }
+
+    try {
+        this->Reserve(ADXSPD_CAPTURE_GROW_SIZE);
+    } catch (...) {
+        this->Close();
+        throw;
+    }
+
+    ADXSPDCaptureFileHeader* header = (ADXSPDCaptureFileHeader*) this->mapping;
+    memset(header, 0, sizeof(ADXSPDCaptureFileHeader));
+    memcpy(header->magic, ADXSPD_CAPTURE_MAGIC, sizeof(header->magic));
+    header->version = ADXSPD_CAPTURE_VERSION;
+    header->headerSize = sizeof(ADXSPDCaptureFileHeader);
+    header->startTimeNs = (int64_t) chrono::duration_cast<chrono::nanoseconds>(
+                              chrono::system_clock::now().time_since_epoch())
+                              .count();
+    this->dataEnd = sizeof(ADXSPDCaptureFileHeader);
+    header->dataEnd = this->dataEnd;
+    this->startTime = chrono::steady_clock::now();
+}
+
+ADXSPDCaptureWriter::~ADXSPDCaptureWriter() { this->Close(); }
+
+/**
+ * @brief Makes sure the file and mapping hold at least size bytes, growing them by at least
+ * ADXSPD_CAPTURE_GROW_SIZE. Disk space is allocated up front where supported, so that running out
+ * of space fails here rather than with a SIGBUS when writing to the mapping.
+ */
+void ADXSPDCaptureWriter::Reserve(size_t size) {
+    if (size <= this->mappingSize) return;
+    size_t newSize = max(size, this->mappingSize + ADXSPD_CAPTURE_GROW_SIZE);
+
+#ifdef __linux__
+    int rc = posix_fallocate(this->fd, 0, (off_t) newSize);
+#else
+    int rc = ftruncate(this->fd, (off_t) newSize) == 0 ? 0 : errno;
+#endif
+    if (rc != 0) {
+        throw runtime_error("Failed to extend capture file " + this->path + " to " +
+                            to_string(newSize) + " bytes: " + strerror(rc));
+    }
+
+    if (this->mapping != nullptr) munmap(this->mapping, this->mappingSize);
+    this->mapping = nullptr;
+    void* mapping = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if (mapping == MAP_FAILED) {
+        this->mappingSize = 0;
+        throw runtime_error("Failed to map capture file " + this->path + ": " + errnoMessage());
+    }
+    this->mapping = (uint8_t*) mapping;
+    this->mappingSize = newSize;
+}
+
+/**
+ * @brief Appends a message to the capture
+ *
+ * @param parts The message parts, in the order they were received
+ * @param numParts Number of message parts
+ * @param receivedTime Time at which the message was received
+ */
+void ADXSPDCaptureWriter::Append(const ADXSPDCapturePart* parts, size_t numParts,
+                                 chrono::steady_clock::time_point receivedTime) {
+    if (this->mapping == nullptr) throw runtime_error("Capture file " + this->path + " is closed");
+
+    size_t recordSize = sizeof(ADXSPDCaptureRecordHeader) + numParts * sizeof(uint32_t);
+    for (size_t i = 0; i < numParts; i++) {
+        if (parts[i].size > UINT32_MAX)
+            throw runtime_error("Message part of " + to_string(parts[i].size) +
+                                " bytes is too large to capture");
+        recordSize += parts[i].size;
+    }
+    recordSize = alignRecord(recordSize);
+    if (recordSize > UINT32_MAX) throw runtime_error("Message is too large to capture");
+    this->Reserve(this->dataEnd + recordSize);
+
+    auto elapsed = chrono::duration_cast<chrono::nanoseconds>(receivedTime - this->startTime);
+    ADXSPDCaptureRecordHeader recordHeader;
+    recordHeader.recordSize = (uint32_t) recordSize;
+    recordHeader.numParts = (uint32_t) numParts;
+    recordHeader.receivedNs = (uint64_t) max((int64_t) 0, (int64_t) elapsed.count());
+
+    uint8_t* pos = this->mapping + this->dataEnd;
+    memcpy(pos, &recordHeader, sizeof(recordHeader));
+    pos += sizeof(recordHeader);
+    for (size_t i = 0; i < numParts; i++) {
+        uint32_t partSize = (uint32_t) parts[i].size;
+        memcpy(pos, &partSize, sizeof(partSize));
+        pos += sizeof(partSize);
+    }
+    for (size_t i = 0; i < numParts; i++) {
+        if (parts[i].size > 0) memcpy(pos, parts[i].data, parts[i].size);
+        pos += parts[i].size;
+    }
+
+    // Only publish the record in the header once all of it has been written
+    ADXSPDCaptureIndexEntry entry = {this->dataEnd, recordHeader.receivedNs};
+    this->dataEnd += recordSize;
+    this->numRecords++;
+    ADXSPDCaptureFileHeader* header = (ADXSPDCaptureFileHeader*) this->mapping;
+    header->dataEnd = this->dataEnd;
+    header->numRecords = this->numRecords;
+
+    fwrite(&entry, sizeof(entry), 1, this->indexFile);
+}
+
+/**
+ * @brief Closes the capture, truncating the file to the records written
+ */
+void ADXSPDCaptureWriter::Close() {
+    if (this->mapping != nullptr) {
+        munmap(this->mapping, this->mappingSize);
+        this->mapping = nullptr;
+        this->mappingSize = 0;
+    }
+    if (this->fd >= 0) {
+        // Should truncating fail, the unused tail is left in place, and is ignored by readers
+        int rc = this->dataEnd > 0 ? ftruncate(this->fd, (off_t) this->dataEnd) : 0;
+        (void) rc;
+        close(this->fd);
+        this->fd = -1;
+    }
+    if (this->indexFile != nullptr) {
+        fclose(this->indexFile);
+        this->indexFile = nullptr;
+    }
+}
+
+/**
+ * @brief Opens a capture file, loading its index, or rebuilding it if it is missing or was not
+ * completely written
+ *
+ * @param path Capture file to read
+ */
+ADXSPDCaptureReader::ADXSPDCaptureReader(const string& path) {
+    this->fd = open(path.c_str(), O_RDONLY);
+    if (this->fd < 0)
+        throw runtime_error("Failed to open capture file " + path + ": " + errnoMessage());
+
+    struct stat fileStat;
+    if (fstat(this->fd, &fileStat) != 0 ||
+        (size_t) fileStat.st_size < sizeof(ADXSPDCaptureFileHeader)) {
+        close(this->fd);
+        throw runtime_error(path + " is not a capture file");
+    }
+    this->mappingSize = (size_t) fileStat.st_size;
+    void* mapping = mmap(nullptr, this->mappingSize, PROT_READ, MAP_SHARED, this->fd, 0);
+    if (mapping == MAP_FAILED) {
+        string message = errnoMessage();
+        close(this->fd);
+        throw runtime_error("Failed to map capture file " + path + ": " + message);
+    }
+    this->mapping = (const uint8_t*) mapping;
+
+    ADXSPDCaptureFileHeader header;
+    memcpy(&header, this->mapping, sizeof(header));
+    if (memcmp(header.magic, ADXSPD_CAPTURE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != ADXSPD_CAPTURE_VERSION || header.dataEnd > this->mappingSize ||
+        header.headerSize < sizeof(ADXSPDCaptureFileHeader)) {
+        munmap((void*) this->mapping, this->mappingSize);
+        close(this->fd);
+        throw runtime_error(path + " is not a version " + to_string(ADXSPD_CAPTURE_VERSION) +
+                            " capture file");
+    }
+    this->startTimeNs = header.startTimeNs;
+    this->dataEnd = header.dataEnd;  // Ignore the unused tail of a capture still being written
+
+    // Use index entries only as long as they agree with the records they point to
+    uint64_t offset = header.headerSize;
+    FILE* indexFile = fopen((path + ".idx").c_str(), "rb");
+    if (indexFile != nullptr) {
+        ADXSPDCaptureIndexEntry entry;
+        ADXSPDCaptureRecordHeader recordHeader;
+        while (fread(&entry, sizeof(entry), 1, indexFile) == 1) {
+            if (entry.offset != offset || !this->ReadRecordHeader(offset, recordHeader) ||
+                recordHeader.receivedNs != entry.receivedNs)
+                break;
+            this->index.push_back(entry);
+            offset += recordHeader.recordSize;
+        }
+        fclose(indexFile);
+    }
+
+    // Then scan for any records the index is missing
+    ADXSPDCaptureRecordHeader recordHeader;
+    while (this->ReadRecordHeader(offset, recordHeader)) {
+        this->index.push_back({offset, recordHeader.receivedNs});
+        offset += recordHeader.recordSize;
+    }
+}
+
+ADXSPDCaptureReader::~ADXSPDCaptureReader() {
+    if (this->mapping != nullptr) munmap((void*) this->mapping, this->mappingSize);
+    if (this->fd >= 0) close(this->fd);
+}
+
+/**
+ * @brief Reads the header of the record at an offset, checking that the whole record lies within
+ * the complete part of the file
+ *
+ * @return true if there is a valid record at the offset
+ */
+bool ADXSPDCaptureReader::ReadRecordHeader(uint64_t offset,
+                                           ADXSPDCaptureRecordHeader& header) const {
+    if (offset + sizeof(header) > this->dataEnd) return false;
+    memcpy(&header, this->mapping + offset, sizeof(header));
+    size_t minSize = sizeof(header) + (size_t) header.numParts * sizeof(uint32_t);
+    return header.recordSize >= minSize && header.recordSize % 8 == 0 &&
+           offset + header.recordSize <= this->dataEnd;
+}
+
+/**
+ * @brief Gets the time between the capture being started and the last record being received
+ */
+uint64_t ADXSPDCaptureReader::GetDurationNs() const {
+    return this->index.empty() ? 0 : this->index.back().receivedNs;
+}
+
+/**
+ * @brief Gets a record by its position in the capture
+ *
+ * @param recordIndex Index of the record, less than GetNumRecords()
+ * @return ADXSPDCaptureRecord The record, with its parts pointing into the mapped file
+ */
+ADXSPDCaptureRecord ADXSPDCaptureReader::GetRecord(size_t recordIndex) const {
+    if (recordIndex >= this->index.size())
+        throw out_of_range("Capture record " + to_string(recordIndex) + " out of range");
+
+    uint64_t offset = this->index[recordIndex].offset;
+    ADXSPDCaptureRecordHeader header;
+    memcpy(&header, this->mapping + offset, sizeof(header));
+
+    ADXSPDCaptureRecord record;
+    record.receivedNs = header.receivedNs;
+    record.parts.resize(header.numParts);
+    const uint8_t* sizes = this->mapping + offset + sizeof(header);
+    const uint8_t* data = sizes + header.numParts * sizeof(uint32_t);
+    const uint8_t* recordEnd = this->mapping + offset + header.recordSize;
+    for (uint32_t i = 0; i < header.numParts; i++) {
+        uint32_t partSize;
+        memcpy(&partSize, sizes + i * sizeof(uint32_t), sizeof(partSize));
+        if (data + partSize > recordEnd)
+            throw runtime_error("Capture record " + to_string(recordIndex) + " is corrupt");
+        record.parts[i] = {data, partSize};
+        data += partSize;
+    }
+    return record;
+}
+
+/**
+ * @brief Finds the first record received at or after a time
+ *
+ * @param receivedNs Time since the capture was started, in ns
+ * @return size_t Index of the record, or GetNumRecords() if all were received earlier
+ */
+size_t ADXSPDCaptureReader::FindRecord(uint64_t receivedNs) const {
+    auto entry = lower_bound(this->index.begin(), this->index.end(), receivedNs,
+                             [](const ADXSPDCaptureIndexEntry& entry, uint64_t time) {
+                                 return entry.receivedNs < time;
+                             });
+    return (size_t) (entry - this->index.begin());
+}
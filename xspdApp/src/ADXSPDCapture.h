@@ -0,0 +1,139 @@
+/*
+ * Data port capture files for the ADXSPD driver
+ *
+ * A capture holds the multipart ZMQ messages received from a data port exactly as they were sent,
+ * compressed payloads and headers included, with the time each was received, so that a run can be
+ * replayed through the driver later. Captures are written to an append-only, memory mapped file,
+ * which is grown in large steps so that appending a frame is a memcpy into the mapping. The header
+ * records how much of the file holds complete records after every append, so a capture is readable
+ * even if the IOC does not exit cleanly.
+ *
+ * File layout, in host byte order:
+ *   ADXSPDCaptureFileHeader
+ *   Records, each 8 byte aligned: ADXSPDCaptureRecordHeader, one uint32_t size per message part,
+ *   then the data of each part
+ *
+ * A sidecar index file, the capture path with ".idx" appended, holds the offset and receive time of
+ * each record for seeking. Records missing from it are recovered by scanning the capture.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#ifndef ADXSPD_CAPTURE_H
+#define ADXSPD_CAPTURE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define ADXSPD_CAPTURE_MAGIC "XSPDCAP1"
+#define ADXSPD_CAPTURE_VERSION 1
+#define ADXSPD_CAPTURE_GROW_SIZE (256ul << 20)  // Bytes the capture file is extended by when full
+
+struct ADXSPDCaptureFileHeader {
+    char magic[8];         // ADXSPD_CAPTURE_MAGIC, without the NUL
+    uint32_t version;      // ADXSPD_CAPTURE_VERSION
+    uint32_t headerSize;   // sizeof(ADXSPDCaptureFileHeader)
+    uint64_t dataEnd;      // Offset just past the last complete record
+    uint64_t numRecords;   // Complete records in the file
+    int64_t startTimeNs;   // Wall clock time the capture was started, in ns since the Unix epoch
+    uint8_t reserved[24];  // Zero
+};
+
+struct ADXSPDCaptureRecordHeader {
+    uint32_t recordSize;  // Including this header, the part sizes and padding
+    uint32_t numParts;
+    uint64_t receivedNs;  // Time the message was received, in ns since the capture was started
+};
+
+struct ADXSPDCaptureIndexEntry {
+    uint64_t offset;      // Offset of the record in the capture file
+    uint64_t receivedNs;  // Receive time of the record
+};
+
+struct ADXSPDCapturePart {
+    const void* data;
+    size_t size;
+};
+
+/**
+ * @brief A single captured message. Parts point into the reader's mapping of the capture file, so
+ * are only valid for the lifetime of the reader.
+ */
+struct ADXSPDCaptureRecord {
+    uint64_t receivedNs;
+    vector<ADXSPDCapturePart> parts;
+};
+
+/**
+ * @brief Appends messages to a capture file. Not thread safe; a capture is written by a single
+ * acquisition thread.
+ */
+class ADXSPDCaptureWriter {
+   public:
+    explicit ADXSPDCaptureWriter(const string& path);
+    ~ADXSPDCaptureWriter();
+
+    ADXSPDCaptureWriter(const ADXSPDCaptureWriter&) = delete;
+    ADXSPDCaptureWriter& operator=(const ADXSPDCaptureWriter&) = delete;
+
+    void Append(const ADXSPDCapturePart* parts, size_t numParts,
+                chrono::steady_clock::time_point receivedTime);
+    void Close();
+
+    string GetPath() const { return this->path; }
+    uint64_t GetNumRecords() const { return this->numRecords; }
+    uint64_t GetNumBytes() const { return this->dataEnd; }
+
+   private:
+    void Reserve(size_t size);
+
+    string path;
+    int fd = -1;
+    uint8_t* mapping = nullptr;
+    size_t mappingSize = 0;
+    size_t dataEnd = 0;
+    uint64_t numRecords = 0;
+    FILE* indexFile = nullptr;
+    chrono::steady_clock::time_point startTime;
+};
+
+/**
+ * @brief Reads a capture file, mapped read-only. Records appended after the reader was opened are
+ * not seen.
+ */
+class ADXSPDCaptureReader {
+   public:
+    explicit ADXSPDCaptureReader(const string& path);
+    ~ADXSPDCaptureReader();
+
+    ADXSPDCaptureReader(const ADXSPDCaptureReader&) = delete;
+    ADXSPDCaptureReader& operator=(const ADXSPDCaptureReader&) = delete;
+
+    size_t GetNumRecords() const { return this->index.size(); }
+    int64_t GetStartTimeNs() const { return this->startTimeNs; }
+    uint64_t GetDurationNs() const;
+
+    ADXSPDCaptureRecord GetRecord(size_t recordIndex) const;
+    size_t FindRecord(uint64_t receivedNs) const;
+
+   private:
+    bool ReadRecordHeader(uint64_t offset, ADXSPDCaptureRecordHeader& header) const;
+
+    int fd = -1;
+    const uint8_t* mapping = nullptr;
+    size_t mappingSize = 0;
+    size_t dataEnd = 0;  // End of the last complete record when the reader was opened
+    int64_t startTimeNs = 0;
+    vector<ADXSPDCaptureIndexEntry> index;
+};
+
+#endif
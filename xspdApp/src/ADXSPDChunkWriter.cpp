@@ -0,0 +1,330 @@
+/*
+ * Direct chunk HDF5 writer for the ADXSPD driver
+ *
+ * See ADXSPDChunkWriter.h for the file layout. Built only when the IOC is built with HDF5
+ * (WITH_HDF5=YES); otherwise opening a writer throws.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#include "ADXSPDChunkWriter.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+#ifdef ADXSPD_WITH_HDF5
+
+#include <hdf5.h>
+#if !H5_VERSION_GE(1, 10, 3)
+#include <hdf5_hl.h>
+#define H5Dwrite_chunk H5DOwrite_chunk
+#endif
+
+static_assert(sizeof(hid_t) == sizeof(int64_t), "HDF5 1.10 or later is required");
+
+// HDF5 is not thread safe unless built so, and writers may be open in several drivers at once
+static mutex hdf5Mutex;
+
+// Datasets under /entry/instrument/NDAttributes, in the order of attrDatasets
+static const char* const attrNames[] = {"FrameNumber", "TriggerNumber", "StatusCode", "TimeStamp",
+                                        "CompressedSize"};
+
+/**
+ * @brief Closes an HDF5 identifier when it goes out of scope
+ */
+class HDF5Handle {
+   public:
+    HDF5Handle(hid_t id, herr_t (*closeFunc)(hid_t), const string& action)
+        : id(id), closeFunc(closeFunc) {
+        if (id < 0) throw runtime_error("Failed to " + action);
+    }
+    ~HDF5Handle() { this->closeFunc(this->id); }
+
+    HDF5Handle(const HDF5Handle&) = delete;
+    HDF5Handle& operator=(const HDF5Handle&) = delete;
+
+    operator hid_t() const { return this->id; }
+
+   private:
+    hid_t id;
+    herr_t (*closeFunc)(hid_t);
+};
+
+static void checkStatus(herr_t status, const string& action) {
+    if (status < 0) throw runtime_error("Failed to " + action);
+}
+
+/**
+ * @brief Creates a group, along with any missing parents, tagged with a NeXus class
+ */
+static void createGroup(hid_t file, const string& name, const string& nxClass) {
+    HDF5Handle lcpl(H5Pcreate(H5P_LINK_CREATE), H5Pclose, "create link property list");
+    checkStatus(H5Pset_create_intermediate_group(lcpl, 1), "set intermediate group creation");
+    HDF5Handle group(H5Gcreate2(file, name.c_str(), lcpl, H5P_DEFAULT, H5P_DEFAULT), H5Gclose,
+                     "create group " + name);
+
+    HDF5Handle type(H5Tcopy(H5T_C_S1), H5Tclose, "create string type");
+    checkStatus(H5Tset_size(type, nxClass.size()), "set string size");
+    HDF5Handle space(H5Screate(H5S_SCALAR), H5Sclose, "create scalar dataspace");
+    HDF5Handle attr(H5Acreate2(group, "NX_class", type, space, H5P_DEFAULT, H5P_DEFAULT), H5Aclose,
+                    "create NX_class attribute on " + name);
+    checkStatus(H5Awrite(attr, type, nxClass.c_str()), "write NX_class attribute on " + name);
+}
+
+/**
+ * @brief Creates an empty, extensible 1-D dataset for a frame attribute
+ */
+static hid_t createAttrDataset(hid_t file, const string& name, hid_t type) {
+    hsize_t dims[1] = {0};
+    hsize_t maxDims[1] = {H5S_UNLIMITED};
+    hsize_t chunkDims[1] = {ADXSPD_CHUNK_ATTR_BATCH};
+    HDF5Handle space(H5Screate_simple(1, dims, maxDims), H5Sclose, "create dataspace");
+    HDF5Handle dcpl(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, "create dataset property list");
+    checkStatus(H5Pset_chunk(dcpl, 1, chunkDims), "set attribute chunk size");
+    hid_t dataset = H5Dcreate2(file, name.c_str(), type, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    if (dataset < 0) throw runtime_error("Failed to create dataset " + name);
+    return dataset;
+}
+
+/**
+ * @brief Appends values to the end of a 1-D dataset, which is extended to hold them
+ */
+static void appendToDataset(hid_t dataset, hid_t memType, const void* data, hsize_t start,
+                            hsize_t count) {
+    hsize_t newSize[1] = {start + count};
+    checkStatus(H5Dset_extent(dataset, newSize), "extend attribute dataset");
+    HDF5Handle fileSpace(H5Dget_space(dataset), H5Sclose, "get attribute dataspace");
+    hsize_t offset[1] = {start};
+    hsize_t dims[1] = {count};
+    checkStatus(H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, nullptr, dims, nullptr),
+                "select attribute hyperslab");
+    HDF5Handle memSpace(H5Screate_simple(1, dims, nullptr), H5Sclose, "create memory dataspace");
+    checkStatus(H5Dwrite(dataset, memType, memSpace, fileSpace, H5P_DEFAULT, data),
+                "write frame attributes");
+}
+
+/**
+ * @brief Creates an HDF5 file for frames compressed by the detector. An existing file at the path
+ * is overwritten.
+ *
+ * @param path Path of the file to create
+ * @param width Frame width in pixels
+ * @param height Frame height in pixels
+ * @param bytesPerPixel Bytes per pixel of uncompressed frames: 1, 2 or 4
+ * @param compressor The compressor frames are compressed with on the detector
+ * @param shuffleMode Shuffle the detector applies before blosc compression
+ * @param level Compression level, recorded in the filter parameters
+ */
+ADXSPDChunkWriter::ADXSPDChunkWriter(const string& path, int width, int height,
+                                     int bytesPerPixel, XSPD::Compressor compressor,
+                                     XSPD::ShuffleMode shuffleMode, int level)
+    : path(path) {
+    hid_t pixelType;
+    switch (bytesPerPixel) {
+        case 1:
+            pixelType = H5T_NATIVE_UINT8;
+            break;
+        case 2:
+            pixelType = H5T_NATIVE_UINT16;
+            break;
+        case 4:
+            pixelType = H5T_NATIVE_UINT32;
+            break;
+        default:
+            throw invalid_argument("Unsupported bytes per pixel " + to_string(bytesPerPixel));
+    }
+    if (width <= 0 || height <= 0)
+        throw invalid_argument("Invalid frame size " + to_string(width) + "x" + to_string(height));
+    this->frameBytes = (size_t) width * height * bytesPerPixel;
+    this->compressed = compressor != XSPD::Compressor::NONE;
+
+    lock_guard<mutex> lock(hdf5Mutex);
+    this->file = H5Fcreate(path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if (this->file < 0) throw runtime_error("Failed to create HDF5 file " + path);
+
+    try {
+        createGroup(this->file, "/entry", "NXentry");
+        createGroup(this->file, "/entry/data", "NXdata");
+        createGroup(this->file, "/entry/instrument", "NXinstrument");
+        createGroup(this->file, "/entry/instrument/NDAttributes", "NXcollection");
+
+        HDF5Handle dcpl(H5Pcreate(H5P_DATASET_CREATE), H5Pclose, "create dataset property list");
+        hsize_t chunkDims[3] = {1, (hsize_t) height, (hsize_t) width};
+        checkStatus(H5Pset_chunk(dcpl, 3, chunkDims), "set chunk size");
+        // Every chunk is written whole, so never spend time writing fill values
+        checkStatus(H5Pset_fill_time(dcpl, H5D_FILL_TIME_NEVER), "set fill time");
+
+        if (compressor == XSPD::Compressor::ZLIB) {
+            checkStatus(H5Pset_deflate(dcpl, (unsigned int) min(max(level, 0), 9)),
+                        "set deflate filter");
+        } else if (XSPD::IsBloscCompressor(compressor)) {
+            // Parameters as set by the hdf5-blosc filter: filter and blosc format versions,
+            // type size, chunk size, level, shuffle and compressor. Blosc reads the shuffle and
+            // compressor from each chunk's own header, so these only describe how it was written.
+            if (shuffleMode == XSPD::ShuffleMode::AUTO_SHUFFLE)
+                shuffleMode = XSPD::ShuffleMode::SHUFFLE_BYTE;
+            unsigned int cdValues[7] = {2,
+                                        2,
+                                        (unsigned int) bytesPerPixel,
+                                        (unsigned int) this->frameBytes,
+                                        (unsigned int) level,
+                                        (unsigned int) shuffleMode,
+                                        (unsigned int) XSPD::GetBloscSubcompressorId(compressor)};
+            // Optional, so the file can be created without the blosc plugin installed; chunks are
+            // written already compressed and never pass through the filter here
+            checkStatus(H5Pset_filter(dcpl, ADXSPD_CHUNK_BLOSC_FILTER_ID, H5Z_FLAG_OPTIONAL, 7,
+                                      cdValues),
+                        "set blosc filter");
+        }
+
+        hsize_t dims[3] = {0, (hsize_t) height, (hsize_t) width};
+        hsize_t maxDims[3] = {H5S_UNLIMITED, (hsize_t) height, (hsize_t) width};
+        HDF5Handle space(H5Screate_simple(3, dims, maxDims), H5Sclose, "create dataspace");
+        this->dataset = H5Dcreate2(this->file, "/entry/data/data", pixelType, space, H5P_DEFAULT,
+                                   dcpl, H5P_DEFAULT);
+        if (this->dataset < 0) throw runtime_error("Failed to create dataset /entry/data/data");
+
+        const hid_t attrTypes[] = {H5T_NATIVE_UINT8, H5T_NATIVE_UINT8, H5T_NATIVE_UINT8,
+                                   H5T_NATIVE_DOUBLE, H5T_NATIVE_UINT32};
+        for (size_t i = 0; i < sizeof(attrNames) / sizeof(attrNames[0]); i++) {
+            this->attrDatasets.push_back(createAttrDataset(
+                this->file, string("/entry/instrument/NDAttributes/") + attrNames[i],
+                attrTypes[i]));
+        }
+    } catch (...) {
+        this->CloseHandles();
+        throw;
+    }
+
+    this->pendingInfo.reserve(ADXSPD_CHUNK_ATTR_BATCH);
+    this->pendingSizes.reserve(ADXSPD_CHUNK_ATTR_BATCH);
+}
+
+ADXSPDChunkWriter::~ADXSPDChunkWriter() {
+    try {
+        this->Close();
+    } catch (std::exception&) {
+        // Nothing more can be done about a failed close when destroyed
+    }
+}
+
+/**
+ * @brief Writes a frame as received from the data port into the next chunk of the dataset
+ *
+ * @param data The frame payload, compressed with the writer's compressor
+ * @param size Size of the payload in bytes
+ * @param info Frame header information, written to the attribute datasets
+ */
+void ADXSPDChunkWriter::WriteFrame(const void* data, size_t size,
+                                   const ADXSPDChunkFrameInfo& info) {
+    if (!this->compressed && size != this->frameBytes)
+        throw invalid_argument("Frame of " + to_string(size) + " bytes, expected " +
+                               to_string(this->frameBytes));
+    if (size > UINT32_MAX) throw invalid_argument("Frame of " + to_string(size) + " bytes");
+
+    lock_guard<mutex> lock(hdf5Mutex);
+    if (this->dataset < 0) throw runtime_error("HDF5 file " + this->path + " is closed");
+
+    if (this->numFrames == this->extent) this->Extend(this->extent + ADXSPD_CHUNK_EXTEND_FRAMES);
+    hsize_t offset[3] = {this->numFrames, 0, 0};
+    checkStatus(H5Dwrite_chunk(this->dataset, H5P_DEFAULT, 0, offset, size, data),
+                "write chunk for frame " + to_string(this->numFrames));
+    this->numFrames++;
+    this->numBytes += size;
+
+    this->pendingInfo.push_back(info);
+    this->pendingSizes.push_back((uint32_t) size);
+    if (this->pendingInfo.size() >= ADXSPD_CHUNK_ATTR_BATCH) this->FlushAttributes();
+}
+
+/**
+ * @brief Writes any buffered frame attributes, trims the dataset to the frames written, and closes
+ * the file. Does nothing if already closed.
+ */
+void ADXSPDChunkWriter::Close() {
+    lock_guard<mutex> lock(hdf5Mutex);
+    if (this->file < 0) return;
+    try {
+        this->FlushAttributes();
+        this->Extend(this->numFrames);
+    } catch (...) {
+        this->CloseHandles();
+        throw;
+    }
+    this->CloseHandles();
+}
+
+/**
+ * @brief Sets the number of frames the dataset has room for. Called with the HDF5 lock held.
+ */
+void ADXSPDChunkWriter::Extend(uint64_t numFrames) {
+    HDF5Handle space(H5Dget_space(this->dataset), H5Sclose, "get dataspace");
+    hsize_t dims[3];
+    H5Sget_simple_extent_dims(space, dims, nullptr);
+    dims[0] = numFrames;
+    checkStatus(H5Dset_extent(this->dataset, dims), "extend dataset");
+    this->extent = numFrames;
+}
+
+/**
+ * @brief Appends buffered frame attributes to their datasets. Called with the HDF5 lock held.
+ */
+void ADXSPDChunkWriter::FlushAttributes() {
+    size_t count = this->pendingInfo.size();
+    if (count == 0) return;
+
+    vector<uint8_t> frameNumbers(count), triggerNumbers(count), statusCodes(count);
+    vector<double> timeStamps(count);
+    for (size_t i = 0; i < count; i++) {
+        frameNumbers[i] = this->pendingInfo[i].frameNumber;
+        triggerNumbers[i] = this->pendingInfo[i].triggerNumber;
+        statusCodes[i] = this->pendingInfo[i].statusCode;
+        timeStamps[i] = this->pendingInfo[i].timeStamp;
+    }
+
+    const hid_t memTypes[] = {H5T_NATIVE_UINT8, H5T_NATIVE_UINT8, H5T_NATIVE_UINT8,
+                              H5T_NATIVE_DOUBLE, H5T_NATIVE_UINT32};
+    const void* values[] = {frameNumbers.data(), triggerNumbers.data(), statusCodes.data(),
+                            timeStamps.data(), this->pendingSizes.data()};
+    for (size_t i = 0; i < this->attrDatasets.size(); i++)
+        appendToDataset(this->attrDatasets[i], memTypes[i], values[i], this->numAttrsWritten,
+                        count);
+
+    this->numAttrsWritten += count;
+    this->pendingInfo.clear();
+    this->pendingSizes.clear();
+}
+
+/**
+ * @brief Closes all open HDF5 identifiers. Called with the HDF5 lock held.
+ */
+void ADXSPDChunkWriter::CloseHandles() {
+    for (int64_t attrDataset : this->attrDatasets) H5Dclose(attrDataset);
+    this->attrDatasets.clear();
+    if (this->dataset >= 0) H5Dclose(this->dataset);
+    if (this->file >= 0) H5Fclose(this->file);
+    this->dataset = -1;
+    this->file = -1;
+}
+
+#else
+
+ADXSPDChunkWriter::ADXSPDChunkWriter(const string& path, int width, int height,
+                                     int bytesPerPixel, XSPD::Compressor compressor,
+                                     XSPD::ShuffleMode shuffleMode, int level)
+    : path(path) {
+    throw runtime_error("ADXSPD was built without HDF5 support, cannot write " + path);
+}
+
+ADXSPDChunkWriter::~ADXSPDChunkWriter() {}
+
+void ADXSPDChunkWriter::WriteFrame(const void* data, size_t size,
+                                   const ADXSPDChunkFrameInfo& info) {}
+
+void ADXSPDChunkWriter::Close() {}
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * Direct chunk HDF5 writer for the ADXSPD driver
+ *
+ * Writes frames to HDF5 exactly as they were compressed by the detector, one frame per chunk, with
+ * H5Dwrite_chunk, so that compressed payloads from the data port are never decompressed and
+ * recompressed on the way to disk. The dataset carries the filter matching the detector's
+ * compressor (deflate for zlib, the registered blosc filter for blosc compressors), so the file
+ * reads back with any HDF5 reader that has the filter available.
+ *
+ * File layout, following NDFileHDF5 so existing analysis code finds the data:
+ *   /entry/data/data                     [frames, height, width], chunked [1, height, width]
+ *   /entry/instrument/NDAttributes/NAME  [frames], one dataset per frame attribute
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#ifndef ADXSPD_CHUNK_WRITER_H
+#define ADXSPD_CHUNK_WRITER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "XSPDAPI.h"
+
+using namespace std;
+
+#define ADXSPD_CHUNK_BLOSC_FILTER_ID 32001  // HDF5 filter ID registered for blosc
+#define ADXSPD_CHUNK_EXTEND_FRAMES 1024     // Frames the dataset is extended by when full
+#define ADXSPD_CHUNK_ATTR_BATCH 1024        // Frame attributes buffered before being written
+
+/**
+ * @brief Per-frame information written alongside each chunk, from the data port frame header
+ */
+struct ADXSPDChunkFrameInfo {
+    uint8_t frameNumber;
+    uint8_t triggerNumber;
+    uint8_t statusCode;
+    double timeStamp;  // Time the frame was received, in seconds since the Unix epoch
+};
+
+/**
+ * @brief Writes detector-compressed frames straight into HDF5 chunks. Not thread safe; a file is
+ * written by a single acquisition thread. HDF5 calls from all writers in the process are
+ * serialized, as HDF5 is usually not built thread safe.
+ */
+class ADXSPDChunkWriter {
+   public:
+    ADXSPDChunkWriter(const string& path, int width, int height, int bytesPerPixel,
+                      XSPD::Compressor compressor, XSPD::ShuffleMode shuffleMode, int level);
+    ~ADXSPDChunkWriter();
+
+    ADXSPDChunkWriter(const ADXSPDChunkWriter&) = delete;
+    ADXSPDChunkWriter& operator=(const ADXSPDChunkWriter&) = delete;
+
+    void WriteFrame(const void* data, size_t size, const ADXSPDChunkFrameInfo& info);
+    void Close();
+
+    string GetPath() const { return this->path; }
+    uint64_t GetNumFrames() const { return this->numFrames; }
+    uint64_t GetNumBytes() const { return this->numBytes; }
+
+   private:
+    void Extend(uint64_t numFrames);
+    void FlushAttributes();
+    void CloseHandles();
+
+    string path;
+    size_t frameBytes;  // Uncompressed size of a frame, the size of each chunk
+    bool compressed;
+    uint64_t numFrames = 0;
+    uint64_t numBytes = 0;     // Compressed bytes written to chunks
+    uint64_t extent = 0;       // Frames the dataset currently has room for
+    uint64_t numAttrsWritten = 0;
+
+    // HDF5 handles, as int64_t so that hdf5.h is not needed to include this header. Negative when
+    // not open.
+    int64_t file = -1;
+    int64_t dataset = -1;
+    vector<int64_t> attrDatasets;
+
+    vector<ADXSPDChunkFrameInfo> pendingInfo;
+    vector<uint32_t> pendingSizes;
+};
+
+#endif
@@ -0,0 +1,578 @@
+/*
+ * Frame handlers for the ADXSPD driver
+ *
+ * See ADXSPDFrameHandler.h. Each handler combines a payload decoder for its decode path with the
+ * pixel types it reads and writes, and the table below holds one instantiation of each.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#include "ADXSPDFrameHandler.h"
+
+#include <blosc.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "ADXSPDKernels.h"
+
+static string formatError(const char* fmt, size_t first, size_t second) {
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), fmt, first, second);
+    return buffer;
+}
+
+/**
+ * @brief Gets the decode path for the format's compressor and decompress setting
+ */
+ADXSPDDecodePath ADXSPDFrameFormat::GetDecodePath() const {
+    if (!this->decompress || this->compressor == XSPD::Compressor::NONE)
+        return ADXSPDDecodePath::COPY;
+    if (this->compressor == XSPD::Compressor::ZLIB) return ADXSPDDecodePath::INFLATE;
+    return ADXSPDDecodePath::BLOSC;
+}
+
+/**
+ * @brief Gets the pixel type frames are received in for the format's bit depth
+ *
+ * @throws invalid_argument if the bit depth is not supported
+ */
+ADXSPDPixelType ADXSPDFrameFormat::GetInputType() const {
+    switch (this->bitDepth) {
+        case 1:
+        case 6:
+            return ADXSPDPixelType::UINT8;
+        case 12:
+            return ADXSPDPixelType::UINT16;
+        case 24:
+            return ADXSPDPixelType::UINT32;
+        default:
+            throw invalid_argument("Unsupported bit depth " + to_string(this->bitDepth));
+    }
+}
+
+ADXSPDPixelType ADXSPDFrameFormat::GetOutputType() const {
+    if (this->outputType == ADXSPDPixelType::NATIVE) return this->GetInputType();
+    return this->outputType;
+}
+
+/**
+ * @brief Gets the width of decoded frames, which rotating by 90 or 270 degrees swaps with height
+ */
+int ADXSPDFrameFormat::GetOutputWidth() const {
+    switch (this->transform) {
+        case ADXSPDFrameTransform::ROT90:
+        case ADXSPDFrameTransform::ROT270:
+        case ADXSPDFrameTransform::ROT90_MIRROR:
+        case ADXSPDFrameTransform::ROT270_MIRROR:
+            return this->height;
+        default:
+            return this->width;
+    }
+}
+
+int ADXSPDFrameFormat::GetOutputHeight() const {
+    switch (this->transform) {
+        case ADXSPDFrameTransform::ROT90:
+        case ADXSPDFrameTransform::ROT270:
+        case ADXSPDFrameTransform::ROT90_MIRROR:
+        case ADXSPDFrameTransform::ROT270_MIRROR:
+            return this->width;
+        default:
+            return this->height;
+    }
+}
+
+/**
+ * @brief Checks whether frames need a tiled handler, i.e. are transformed or converted
+ */
+bool ADXSPDFrameFormat::IsTiled() const {
+    return this->transform != ADXSPDFrameTransform::NONE ||
+           this->GetOutputType() != this->GetInputType();
+}
+
+/**
+ * @brief Checks whether converting to the output type can saturate pixels, i.e. the output type is
+ * an integer type narrower than the input type
+ */
+bool ADXSPDFrameFormat::CanSaturate() const {
+    ADXSPDPixelType outputType = this->GetOutputType();
+    return outputType != ADXSPDPixelType::FLOAT32 && outputType < this->GetInputType();
+}
+
+/**
+ * @brief Decodes payloads for one decode path, keeping any decompression state between frames.
+ * Specialized for each path below. Decode() decodes a whole frame into the frame buffer, while
+ * Start(), Next() and Finish() decode it a band at a time, for tiled handlers.
+ */
+template <ADXSPDDecodePath Path>
+class ADXSPDPayloadDecoder;
+
+template <>
+class ADXSPDPayloadDecoder<ADXSPDDecodePath::COPY> {
+   public:
+    explicit ADXSPDPayloadDecoder(const ADXSPDFrameFormat&) {}
+
+    size_t Decode(const void* payload, size_t payloadBytes, void* frame, size_t frameBytes) {
+        // With fully random data the compressed size can be larger than the uncompressed size
+        if (payloadBytes > frameBytes) {
+            throw invalid_argument(formatError(
+                "Size of incoming frame data %zu bytes is larger than expected array size %zu "
+                "bytes",
+                payloadBytes, frameBytes));
+        }
+        memcpy(frame, payload, payloadBytes);
+        return payloadBytes;
+    }
+
+    // Bands are read straight from the payload, without copying
+    void Start(const void* payload, size_t payloadBytes, size_t frameBytes) {
+        if (payloadBytes != frameBytes) {
+            throw invalid_argument(formatError(
+                "Size of incoming frame data %zu bytes does not match expected size %zu bytes",
+                payloadBytes, frameBytes));
+        }
+        this->next = static_cast<const uint8_t*>(payload);
+    }
+    const void* Next(size_t numBytes) {
+        const uint8_t* band = this->next;
+        this->next += numBytes;
+        return band;
+    }
+    void Finish() {}
+
+   private:
+    const uint8_t* next = nullptr;
+};
+
+template <>
+class ADXSPDPayloadDecoder<ADXSPDDecodePath::INFLATE> {
+   public:
+    // The stream is initialized once, and only reset between frames, so its window and state are
+    // not allocated for every frame as with uncompress()
+    explicit ADXSPDPayloadDecoder(const ADXSPDFrameFormat& format) {
+        memset(&this->stream, 0, sizeof(this->stream));
+        int status = inflateInit(&this->stream);
+        if (status != Z_OK)
+            throw runtime_error("Failed to initialize zlib stream, status code " +
+                                to_string(status));
+    }
+    ~ADXSPDPayloadDecoder() { inflateEnd(&this->stream); }
+    ADXSPDPayloadDecoder(const ADXSPDPayloadDecoder&) = delete;
+    ADXSPDPayloadDecoder& operator=(const ADXSPDPayloadDecoder&) = delete;
+
+    size_t Decode(const void* payload, size_t payloadBytes, void* frame, size_t frameBytes) {
+        inflateReset(&this->stream);
+        this->stream.next_in = (Bytef*) payload;
+        this->stream.avail_in = (uInt) payloadBytes;
+        this->stream.next_out = (Bytef*) frame;
+        this->stream.avail_out = (uInt) frameBytes;
+
+        int status = inflate(&this->stream, Z_FINISH);
+        if (status != Z_STREAM_END) {
+            if (status == Z_BUF_ERROR && this->stream.avail_out == 0)
+                throw runtime_error(formatError(
+                    "Decompressed size is larger than expected size %zu (%zu bytes compressed)",
+                    frameBytes, payloadBytes));
+            throw runtime_error("Failed to decompress frame data with zlib, status code " +
+                                to_string(status));
+        }
+        if (this->stream.total_out != frameBytes) {
+            throw runtime_error(
+                formatError("Decompressed size %zu does not match expected size %zu",
+                            this->stream.total_out, frameBytes));
+        }
+        return frameBytes;
+    }
+
+    void Start(const void* payload, size_t payloadBytes, size_t frameBytes) {
+        inflateReset(&this->stream);
+        this->stream.next_in = (Bytef*) payload;
+        this->stream.avail_in = (uInt) payloadBytes;
+        this->frameBytes = frameBytes;
+        this->ended = false;
+    }
+    const void* Next(size_t numBytes) {
+        if (this->band.size() < numBytes) this->band.resize(numBytes);
+        this->stream.next_out = this->band.data();
+        this->stream.avail_out = (uInt) numBytes;
+        while (this->stream.avail_out > 0 && !this->ended) {
+            int status = inflate(&this->stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                this->ended = true;
+            } else if (status == Z_BUF_ERROR) {
+                break;  // The payload ran out before the band was complete
+            } else if (status != Z_OK) {
+                throw runtime_error("Failed to decompress frame data with zlib, status code " +
+                                    to_string(status));
+            }
+        }
+        if (this->stream.avail_out > 0) {
+            throw runtime_error(
+                formatError("Decompressed size %zu is smaller than expected size %zu",
+                            this->stream.total_out, this->frameBytes));
+        }
+        return this->band.data();
+    }
+    void Finish() {
+        if (this->ended) return;
+        // All that is left of the payload should be the end of the stream, with no more data
+        Bytef extra;
+        this->stream.next_out = &extra;
+        this->stream.avail_out = 1;
+        int status = inflate(&this->stream, Z_FINISH);
+        if (status != Z_STREAM_END || this->stream.total_out > this->frameBytes) {
+            throw runtime_error(formatError(
+                "Decompressed size is larger than expected size %zu (%zu bytes compressed)",
+                this->frameBytes, this->stream.total_in));
+        }
+    }
+
+   private:
+    z_stream stream;
+    vector<Bytef> band;
+    size_t frameBytes = 0;
+    bool ended = false;
+};
+
+template <>
+class ADXSPDPayloadDecoder<ADXSPDDecodePath::BLOSC> {
+   public:
+    explicit ADXSPDPayloadDecoder(const ADXSPDFrameFormat& format)
+        : numThreads(max(format.numThreads, 1)) {}
+
+    size_t Decode(const void* payload, size_t payloadBytes, void* frame, size_t frameBytes) {
+        checkHeader(payload, payloadBytes, frameBytes);
+        int decompressedBytes = blosc_decompress_ctx(payload, frame, frameBytes, this->numThreads);
+        if (decompressedBytes < 0 || (size_t) decompressedBytes != frameBytes) {
+            throw runtime_error("Failed to decompress frame data with Blosc, status code " +
+                                to_string(decompressedBytes));
+        }
+        return frameBytes;
+    }
+
+    // Bands are decompressed with blosc_getitem, which decodes only the blocks holding them. It
+    // has no threaded equivalent, so tiled blosc handlers are single threaded.
+    void Start(const void* payload, size_t payloadBytes, size_t frameBytes) {
+        checkHeader(payload, payloadBytes, frameBytes);
+        int flags;
+        blosc_cbuffer_metainfo(payload, &this->typeSize, &flags);
+        this->typeSize = max(this->typeSize, (size_t) 1);
+        this->payload = payload;
+        this->offset = 0;
+    }
+    const void* Next(size_t numBytes) {
+        if (numBytes % this->typeSize != 0) {
+            throw runtime_error(formatError(
+                "Band of %zu bytes is not a multiple of the Blosc type size %zu", numBytes,
+                this->typeSize));
+        }
+        if (this->band.size() < numBytes) this->band.resize(numBytes);
+        int decompressedBytes =
+            blosc_getitem(this->payload, (int) (this->offset / this->typeSize),
+                          (int) (numBytes / this->typeSize), this->band.data());
+        if (decompressedBytes < 0 || (size_t) decompressedBytes != numBytes) {
+            throw runtime_error("Failed to decompress frame data with Blosc, status code " +
+                                to_string(decompressedBytes));
+        }
+        this->offset += numBytes;
+        return this->band.data();
+    }
+    void Finish() {}
+
+   private:
+    // Check the size recorded in the header first, so a frame of the wrong size is rejected
+    // before any threads are started to decompress it
+    static void checkHeader(const void* payload, size_t payloadBytes, size_t frameBytes) {
+        if (payloadBytes < BLOSC_MIN_HEADER_LENGTH)
+            throw runtime_error(formatError("Blosc frame of %zu bytes is shorter than its %zu "
+                                            "byte header",
+                                            payloadBytes, BLOSC_MIN_HEADER_LENGTH));
+        size_t numBytes, compressedBytes, blockSize;
+        blosc_cbuffer_sizes(payload, &numBytes, &compressedBytes, &blockSize);
+        if (numBytes != frameBytes || compressedBytes > payloadBytes) {
+            throw runtime_error(formatError(
+                "Blosc frame holds %zu bytes, does not match expected size %zu", numBytes,
+                frameBytes));
+        }
+    }
+
+    int numThreads;
+    vector<uint8_t> band;
+    const void* payload = nullptr;
+    size_t typeSize = 1;
+    size_t offset = 0;
+};
+
+/**
+ * @brief Frame handler decoding frames of pixel type T as they are, straight into the frame buffer
+ */
+template <typename T, ADXSPDDecodePath Path>
+class ADXSPDFrameHandlerImpl : public ADXSPDFrameHandler {
+   public:
+    explicit ADXSPDFrameHandlerImpl(const ADXSPDFrameFormat& format)
+        : ADXSPDFrameHandler(format), decoder(format) {}
+
+    size_t Decode(const void* payload, size_t payloadBytes, void* frame,
+                  size_t frameBytes) override {
+        return this->decoder.Decode(payload, payloadBytes, frame, frameBytes);
+    }
+
+   private:
+    ADXSPDPayloadDecoder<Path> decoder;
+};
+
+/**
+ * @brief Frame handler decoding frames of pixel type TIn a band of rows at a time, writing each
+ * band out transformed and converted to pixel type TOut
+ */
+template <typename TIn, typename TOut, ADXSPDDecodePath Path>
+class ADXSPDTiledFrameHandler : public ADXSPDFrameHandler {
+   public:
+    explicit ADXSPDTiledFrameHandler(const ADXSPDFrameFormat& format)
+        : ADXSPDFrameHandler(format), decoder(format) {
+        // Input pixel (x, y) is written to output index origin + x * xStride + y * yStride
+        ptrdiff_t width = format.width, height = format.height;
+        switch (format.transform) {
+            case ADXSPDFrameTransform::NONE:
+                this->setStrides(0, 1, width);
+                break;
+            case ADXSPDFrameTransform::ROT90:
+                this->setStrides(height - 1, height, -1);
+                break;
+            case ADXSPDFrameTransform::ROT180:
+                this->setStrides(width * height - 1, -1, -width);
+                break;
+            case ADXSPDFrameTransform::ROT270:
+                this->setStrides((width - 1) * height, -height, 1);
+                break;
+            case ADXSPDFrameTransform::MIRROR:
+                this->setStrides(width - 1, -1, width);
+                break;
+            case ADXSPDFrameTransform::ROT90_MIRROR:
+                this->setStrides(0, height, 1);
+                break;
+            case ADXSPDFrameTransform::ROT180_MIRROR:
+                this->setStrides((height - 1) * width, 1, -width);
+                break;
+            case ADXSPDFrameTransform::ROT270_MIRROR:
+                this->setStrides(width * height - 1, -height, -1);
+                break;
+        }
+    }
+
+    size_t Decode(const void* payload, size_t payloadBytes, void* frame,
+                  size_t frameBytes) override {
+        size_t width = this->format.width, height = this->format.height;
+        size_t outputBytes = width * height * sizeof(TOut);
+        if (frameBytes < outputBytes) {
+            throw invalid_argument(
+                formatError("Frame buffer of %zu bytes is smaller than the %zu byte output frame",
+                            frameBytes, outputBytes));
+        }
+
+        this->numSaturated = 0;
+        this->decoder.Start(payload, payloadBytes, width * height * sizeof(TIn));
+        for (size_t y = 0; y < height; y += ADXSPD_FRAME_TILE_SIZE) {
+            size_t numRows = min((size_t) ADXSPD_FRAME_TILE_SIZE, height - y);
+            const void* band = this->decoder.Next(numRows * width * sizeof(TIn));
+            this->writeBand(static_cast<const TIn*>(band), y, numRows, static_cast<TOut*>(frame));
+        }
+        this->decoder.Finish();
+        return outputBytes;
+    }
+
+   private:
+    void setStrides(ptrdiff_t origin, ptrdiff_t xStride, ptrdiff_t yStride) {
+        this->origin = origin;
+        this->xStride = xStride;
+        this->yStride = yStride;
+    }
+
+    /**
+     * @brief Writes a band of decoded rows, the first of which is row firstRow of the frame
+     */
+    void writeBand(const TIn* __restrict band, size_t firstRow, size_t numRows,
+                   TOut* __restrict output) {
+        size_t width = this->format.width;
+        if (this->xStride == 1) {
+            // Rows stay rows, so each is converted in one contiguous pass
+            for (size_t y = 0; y < numRows; y++) {
+                TOut* row = output + this->origin + (ptrdiff_t) (firstRow + y) * this->yStride;
+                this->numSaturated += ADXSPDKernels::ConvertPixels(band + y * width, row, width);
+            }
+            return;
+        }
+
+        // Otherwise write a tile of columns at a time, so the output lines a tile touches stay in
+        // cache until it is written
+        for (size_t x0 = 0; x0 < width; x0 += ADXSPD_FRAME_TILE_SIZE) {
+            size_t x1 = min(x0 + ADXSPD_FRAME_TILE_SIZE, width);
+            for (size_t y = 0; y < numRows; y++) {
+                const TIn* row = band + y * width;
+                ptrdiff_t index = this->origin + (ptrdiff_t) (firstRow + y) * this->yStride +
+                                  (ptrdiff_t) x0 * this->xStride;
+                for (size_t x = x0; x < x1; x++, index += this->xStride) {
+                    this->numSaturated += ADXSPDKernels::IsSaturated<TIn, TOut>(row[x]);
+                    output[index] = ADXSPDKernels::ConvertPixel<TIn, TOut>(row[x]);
+                }
+            }
+        }
+    }
+
+    ADXSPDPayloadDecoder<Path> decoder;
+    ptrdiff_t origin = 0;
+    ptrdiff_t xStride = 1;
+    ptrdiff_t yStride = 0;
+};
+
+// Input pixel type, decode path, output pixel type, and whether the handler is tiled
+using ADXSPDFrameHandlerKey = tuple<ADXSPDPixelType, ADXSPDDecodePath, ADXSPDPixelType, bool>;
+using ADXSPDFrameHandlerFactory = unique_ptr<ADXSPDFrameHandler> (*)(const ADXSPDFrameFormat&);
+
+template <typename Handler>
+static unique_ptr<ADXSPDFrameHandler> createHandler(const ADXSPDFrameFormat& format) {
+    return make_unique<Handler>(format);
+}
+
+/**
+ * @brief Adds the handlers reading pixel type TIn for a decode path, for every output pixel type
+ */
+template <typename TIn, ADXSPDPixelType InType, ADXSPDDecodePath Path>
+static void addHandlers(map<ADXSPDFrameHandlerKey, ADXSPDFrameHandlerFactory>& table) {
+    table[{InType, Path, InType, false}] = createHandler<ADXSPDFrameHandlerImpl<TIn, Path>>;
+    table[{InType, Path, ADXSPDPixelType::UINT8, true}] =
+        createHandler<ADXSPDTiledFrameHandler<TIn, uint8_t, Path>>;
+    table[{InType, Path, ADXSPDPixelType::UINT16, true}] =
+        createHandler<ADXSPDTiledFrameHandler<TIn, uint16_t, Path>>;
+    table[{InType, Path, ADXSPDPixelType::UINT32, true}] =
+        createHandler<ADXSPDTiledFrameHandler<TIn, uint32_t, Path>>;
+    table[{InType, Path, ADXSPDPixelType::FLOAT32, true}] =
+        createHandler<ADXSPDTiledFrameHandler<TIn, float, Path>>;
+}
+
+template <ADXSPDDecodePath Path>
+static void addHandlers(map<ADXSPDFrameHandlerKey, ADXSPDFrameHandlerFactory>& table) {
+    addHandlers<uint8_t, ADXSPDPixelType::UINT8, Path>(table);
+    addHandlers<uint16_t, ADXSPDPixelType::UINT16, Path>(table);
+    addHandlers<uint32_t, ADXSPDPixelType::UINT32, Path>(table);
+}
+
+static const map<ADXSPDFrameHandlerKey, ADXSPDFrameHandlerFactory>& getHandlerTable() {
+    static const map<ADXSPDFrameHandlerKey, ADXSPDFrameHandlerFactory> table = [] {
+        map<ADXSPDFrameHandlerKey, ADXSPDFrameHandlerFactory> handlers;
+        addHandlers<ADXSPDDecodePath::COPY>(handlers);
+        addHandlers<ADXSPDDecodePath::INFLATE>(handlers);
+        addHandlers<ADXSPDDecodePath::BLOSC>(handlers);
+        return handlers;
+    }();
+    return table;
+}
+
+/**
+ * @brief Gets the size of a pixel type in bytes
+ *
+ * @throws invalid_argument for NATIVE, which has no size of its own
+ */
+size_t ADXSPDFrameHandler::GetPixelSize(ADXSPDPixelType pixelType) {
+    switch (pixelType) {
+        case ADXSPDPixelType::UINT8:
+            return sizeof(uint8_t);
+        case ADXSPDPixelType::UINT16:
+            return sizeof(uint16_t);
+        case ADXSPDPixelType::UINT32:
+            return sizeof(uint32_t);
+        case ADXSPDPixelType::FLOAT32:
+            return sizeof(float);
+        default:
+            throw invalid_argument("Pixel type " + to_string(static_cast<int>(pixelType)) +
+                                   " has no size");
+    }
+}
+
+/**
+ * @brief Creates the handler for a frame format
+ *
+ * @throws invalid_argument if no handler supports the format
+ * @throws runtime_error if the handler's decompression state cannot be set up
+ */
+unique_ptr<ADXSPDFrameHandler> ADXSPDFrameHandler::Create(const ADXSPDFrameFormat& format) {
+    bool tiled = format.IsTiled();
+    if (tiled && !format.decompress && format.compressor != XSPD::Compressor::NONE)
+        throw invalid_argument("Frames passed on compressed cannot be transformed or converted");
+    if (tiled && (format.width <= 0 || format.height <= 0))
+        throw invalid_argument("Frames cannot be transformed or converted without their size");
+
+    ADXSPDFrameHandlerKey key = {format.GetInputType(), format.GetDecodePath(),
+                                 format.GetOutputType(), tiled};
+    const auto& table = getHandlerTable();
+    auto it = table.find(key);
+    if (it == table.end()) {
+        throw invalid_argument("No frame handler for " + to_string(format.bitDepth) +
+                               " bit frames with output type " +
+                               to_string(static_cast<int>(format.outputType)));
+    }
+    return it->second(format);
+}
+
+/**
+ * @brief Describes the handler, e.g. "uint16 blosc, 4 threads" or "uint32 inflate, rot90 to
+ * uint16"
+ */
+string ADXSPDFrameHandler::GetName() const {
+    static const char* pixelTypeNames[] = {"native", "uint8", "uint16", "uint32", "float32"};
+    static const char* transformNames[] = {"none",          "rot90",       "rot180",
+                                           "rot270",        "mirror",      "rot90 mirror",
+                                           "rot180 mirror", "rot270 mirror"};
+
+    string name = pixelTypeNames[static_cast<int>(this->format.GetInputType())];
+    switch (this->format.GetDecodePath()) {
+        case ADXSPDDecodePath::COPY:
+            name += this->format.compressor == XSPD::Compressor::NONE ? " copy" : " passthrough";
+            break;
+        case ADXSPDDecodePath::INFLATE:
+            name += " inflate";
+            break;
+        case ADXSPDDecodePath::BLOSC:
+            name += " blosc, " + to_string(max(this->format.numThreads, 1)) + " threads";
+            break;
+    }
+    if (this->format.IsTiled()) {
+        name += string(", ") + transformNames[static_cast<int>(this->format.transform)] + " to " +
+                pixelTypeNames[static_cast<int>(this->format.GetOutputType())];
+    }
+    return name;
+}
+
+bool ADXSPDSaturationGuard::StartSeries() {
+    bool wasFallback = this->fallback;
+    if (this->resetRequested.exchange(false)) this->fallbackPending = false;
+    this->fallback = this->fallbackPending;
+    this->pixelsConverted = 0;
+    this->pixelsSaturated = 0;
+    return this->fallback != wasFallback;
+}
+
+bool ADXSPDSaturationGuard::RecordFrame(uint64_t numPixels, uint64_t numSaturated,
+                                        double limitPercent) {
+    this->pixelsConverted += numPixels;
+    this->pixelsSaturated += numSaturated;
+    if (limitPercent <= 0 || this->fallbackPending || this->GetSaturatedPercent() <= limitPercent)
+        return false;
+    this->fallbackPending = true;
+    return true;
+}
+
+double ADXSPDSaturationGuard::GetSaturatedPercent() const {
+    if (this->pixelsConverted == 0) return 0;
+    return 100.0 * this->pixelsSaturated / this->pixelsConverted;
+}
@@ -0,0 +1,185 @@
+/*
+ * Frame handlers for the ADXSPD driver
+ *
+ * A frame handler turns the payload of one data port message into the pixels of an NDArray. The
+ * handler for an acquisition is chosen once, from a table of handlers specialized at compile time
+ * on the pixel type, decode path and pixel transform, so the frame loop does not branch on these
+ * for every frame. Handlers keep their decompression state between frames, so there is no
+ * per-frame setup cost.
+ *
+ * Frames that are rotated, mirrored or converted to another pixel type are handled by tiled
+ * handlers, which do all of this in the same pass as decoding: each band of rows is decoded into a
+ * small scratch buffer that stays in cache, and written out to the frame buffer in tiles, already
+ * transformed. Each frame is so written to memory once, rather than once by the decompressor and
+ * again by each of NDPluginTransform and NDPluginProcess downstream.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#ifndef ADXSPD_FRAME_HANDLER_H
+#define ADXSPD_FRAME_HANDLER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "XSPDAPI.h"
+
+using namespace std;
+
+#define ADXSPD_FRAME_TILE_SIZE 64  // Rows per band, and columns per tile, of tiled handlers
+
+/**
+ * @brief How a payload gets into the frame buffer
+ */
+enum class ADXSPDDecodePath {
+    COPY = 0,     // Uncompressed, or passed on still compressed
+    INFLATE = 1,  // zlib
+    BLOSC = 2,
+};
+
+/**
+ * @brief Orientation transform applied to each decoded frame, in the order of the NDPluginTransform
+ * Type record. Rotations are clockwise, and mirroring flips left to right after rotating.
+ */
+enum class ADXSPDFrameTransform {
+    NONE = 0,
+    ROT90 = 1,
+    ROT180 = 2,
+    ROT270 = 3,
+    MIRROR = 4,
+    ROT90_MIRROR = 5,
+    ROT180_MIRROR = 6,
+    ROT270_MIRROR = 7,
+};
+
+/**
+ * @brief Pixel types of decoded frames. Conversions to narrower integer types saturate.
+ */
+enum class ADXSPDPixelType {
+    NATIVE = 0,  // The detector's type for its bit depth
+    UINT8 = 1,
+    UINT16 = 2,
+    UINT32 = 3,
+    FLOAT32 = 4,
+};
+
+/**
+ * @brief Everything a frame handler is selected and configured from
+ */
+struct ADXSPDFrameFormat {
+    int bitDepth = 12;
+    int width = 0;  // Frame size as received, needed by tiled handlers only
+    int height = 0;
+    XSPD::Compressor compressor = XSPD::Compressor::NONE;
+    int compressionLevel = 0;
+    XSPD::ShuffleMode shuffleMode = XSPD::ShuffleMode::NO_SHUFFLE;
+    bool decompress = true;  // Whether compressed payloads are decoded, or passed on as they are
+    int numThreads = 1;      // Blosc decompression threads
+    ADXSPDFrameTransform transform = ADXSPDFrameTransform::NONE;
+    ADXSPDPixelType outputType = ADXSPDPixelType::NATIVE;
+
+    ADXSPDDecodePath GetDecodePath() const;
+    ADXSPDPixelType GetInputType() const;
+    ADXSPDPixelType GetOutputType() const;
+    int GetOutputWidth() const;
+    int GetOutputHeight() const;
+    bool IsTiled() const;
+    bool CanSaturate() const;
+};
+
+/**
+ * @brief Decodes frames of one format. Not thread safe; each handler is used by one thread.
+ */
+class ADXSPDFrameHandler {
+   public:
+    virtual ~ADXSPDFrameHandler() = default;
+
+    /**
+     * @brief Decodes one payload into a frame buffer
+     *
+     * @param payload Frame data as received from the data port
+     * @param payloadBytes Size of the payload
+     * @param frame Frame buffer to decode into
+     * @param frameBytes Size of the frame buffer
+     * @return size_t Bytes written to the frame buffer
+     * @throws invalid_argument if the payload does not fit the frame buffer
+     * @throws runtime_error if the payload cannot be decoded
+     */
+    virtual size_t Decode(const void* payload, size_t payloadBytes, void* frame,
+                          size_t frameBytes) = 0;
+
+    const ADXSPDFrameFormat& GetFormat() const { return this->format; }
+    string GetName() const;
+
+    // Number of pixels saturated converting the last frame decoded to the output type
+    size_t GetNumSaturated() const { return this->numSaturated; }
+
+    static unique_ptr<ADXSPDFrameHandler> Create(const ADXSPDFrameFormat& format);
+    static size_t GetPixelSize(ADXSPDPixelType pixelType);
+
+   protected:
+    explicit ADXSPDFrameHandler(const ADXSPDFrameFormat& format) : format(format) {}
+
+    ADXSPDFrameFormat format;
+    size_t numSaturated = 0;
+};
+
+/**
+ * @brief Decides when frames converted to a narrower output type fall back to the native type.
+ * Saturation is measured over each series, and a fallback decided in one series takes effect from
+ * the start of the next, so the output type never changes within a series. The fallback then
+ * stays until reset. Used by the acquisition thread, except for RequestReset().
+ */
+class ADXSPDSaturationGuard {
+   public:
+    /**
+     * @brief Starts a series, applying any fallback decided or reset requested since the last
+     *
+     * @return bool Whether the output type for the new series differs from the last series
+     */
+    bool StartSeries();
+
+    /**
+     * @brief Records a converted frame
+     *
+     * @param numPixels Pixels in the frame
+     * @param numSaturated Pixels that saturated converting it
+     * @param limitPercent Saturated percentage of the series' pixels over which to fall back, 0
+     * to never fall back
+     * @return bool Whether the series has just gone over the limit
+     */
+    bool RecordFrame(uint64_t numPixels, uint64_t numSaturated, double limitPercent);
+
+    // Requests the fallback be cleared, from the start of the next series
+    void RequestReset() { this->resetRequested = true; }
+
+    // Whether the current series is output in the native type
+    bool IsFallback() const { return this->fallback; }
+
+    // Whether the next series will be output in the native type
+    bool IsFallbackPending() const { return this->fallbackPending; }
+
+    double GetSaturatedPercent() const;
+
+    /**
+     * @brief Gets the output type to use for the current series for the configured output type
+     */
+    ADXSPDPixelType GetOutputType(ADXSPDPixelType configuredType) const {
+        return this->fallback ? ADXSPDPixelType::NATIVE : configuredType;
+    }
+
+   private:
+    uint64_t pixelsConverted = 0;
+    uint64_t pixelsSaturated = 0;
+    bool fallback = false;
+    bool fallbackPending = false;
+    atomic<bool> resetRequested{false};
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * Per-pixel frame kernels for the ADXSPD driver
+ *
+ * Kept header-only and free of driver state, so the same code the driver runs can be unit tested
+ * and benchmarked on its own. Loops are written over plain pointers with no aliasing between
+ * input and output, so the compiler can vectorize them.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#ifndef ADXSPD_KERNELS_H
+#define ADXSPD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+using namespace std;
+
+class ADXSPDKernels {
+   public:
+    /**
+     * @brief Subtracts two frames element-wise with a floor at 0, as for the two counters of a
+     * dual counter mode frame pair.
+     *
+     * @param currentFrame The frame to subtract from
+     * @param previousFrame The frame to subtract
+     * @param outputFrame Output, may not overlap the inputs
+     * @param numElements Number of pixels in each frame
+     */
+    template <typename T>
+    static void SubtractFrames(const T* __restrict currentFrame, const T* __restrict previousFrame,
+                               T* __restrict outputFrame, size_t numElements) {
+        for (size_t i = 0; i < numElements; i++) {
+            outputFrame[i] =
+                currentFrame[i] > previousFrame[i] ? T(currentFrame[i] - previousFrame[i]) : T(0);
+        }
+    }
+
+    /**
+     * @brief Adds a frame element-wise into an accumulator, e.g. to sum frames in software. The
+     * accumulator should be wide enough not to overflow for the number of frames summed.
+     *
+     * @param frame The frame to add
+     * @param accumulator Running sum, may not overlap the frame
+     * @param numElements Number of pixels in the frame
+     */
+    template <typename T, typename AccT>
+    static void AccumulateFrame(const T* __restrict frame, AccT* __restrict accumulator,
+                                size_t numElements) {
+        for (size_t i = 0; i < numElements; i++) accumulator[i] += frame[i];
+    }
+
+    /**
+     * @brief Checks whether converting from TIn to TOut can saturate, i.e. TOut is an integer type
+     * narrower than TIn
+     */
+    template <typename TIn, typename TOut>
+    static constexpr bool CanSaturate() {
+        return is_integral_v<TOut> && numeric_limits<TOut>::max() < numeric_limits<TIn>::max();
+    }
+
+    /**
+     * @brief Converts a pixel to another type, saturating at the maximum of narrower integer types
+     */
+    template <typename TIn, typename TOut>
+    static inline TOut ConvertPixel(TIn value) {
+        if constexpr (CanSaturate<TIn, TOut>()) {
+            return value > numeric_limits<TOut>::max() ? numeric_limits<TOut>::max() : TOut(value);
+        } else {
+            return static_cast<TOut>(value);
+        }
+    }
+
+    /**
+     * @brief Checks whether a pixel saturates when converted, see ConvertPixel
+     */
+    template <typename TIn, typename TOut>
+    static inline bool IsSaturated(TIn value) {
+        if constexpr (CanSaturate<TIn, TOut>()) return value > numeric_limits<TOut>::max();
+        return false;
+    }
+
+    /**
+     * @brief Converts pixels to another type, see ConvertPixel, counting saturated pixels in the
+     * same pass
+     *
+     * @param input Pixels to convert
+     * @param output Converted pixels, may not overlap the input
+     * @param numElements Number of pixels
+     * @return size_t Number of pixels that saturated
+     */
+    template <typename TIn, typename TOut>
+    static size_t ConvertPixels(const TIn* __restrict input, TOut* __restrict output,
+                                size_t numElements) {
+        size_t numSaturated = 0;
+        for (size_t i = 0; i < numElements; i++) {
+            numSaturated += IsSaturated<TIn, TOut>(input[i]);
+            output[i] = ConvertPixel<TIn, TOut>(input[i]);
+        }
+        return numSaturated;
+    }
+};
+
+#endif
@@ -0,0 +1,303 @@
+/*
+ * Asynchronous, rate limited logging backend for the ADXSPD log macros
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#include "ADXSPDLog.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <functional>
+#include <thread>
+
+static_assert((ADXSPD_LOG_QUEUE_SIZE & (ADXSPD_LOG_QUEUE_SIZE - 1)) == 0,
+              "ADXSPD_LOG_QUEUE_SIZE must be a power of 2");
+
+static int64_t steadyMs() {
+    auto sinceEpoch = chrono::steady_clock::now().time_since_epoch();
+    return chrono::duration_cast<chrono::milliseconds>(sinceEpoch).count();
+}
+
+static const char* getLevelName(ADXSPDLogLevel level) {
+    switch (level) {
+        case ADXSPDLogLevel::ERROR:
+            return "ERROR";
+        case ADXSPDLogLevel::WARNING:
+            return "WARNING";
+        case ADXSPDLogLevel::INFO:
+            return "INFO";
+        default:
+            return "DEBUG";
+    }
+}
+
+static void printLine(ADXSPDLogLevel level, const char* line) {
+    FILE* stream = level <= ADXSPDLogLevel::WARNING ? stderr : stdout;
+    fputs(line, stream);
+    fputc('\n', stream);
+}
+
+/**
+ * @brief Bounded multi-producer, single-consumer queue of formatted messages, and the thread that
+ * drains it. Each slot carries a sequence number, so producers claim a slot with a single CAS and
+ * publish it with a release store once the message has been formatted in place.
+ */
+struct ADXSPDLog::Backend {
+    struct Slot {
+        atomic<size_t> sequence;
+        ADXSPDLogLevel level;
+        char text[ADXSPD_LOG_MESSAGE_SIZE];
+    };
+
+    Backend() {
+        for (size_t i = 0; i < ADXSPD_LOG_QUEUE_SIZE; i++) {
+            this->slots[i].sequence.store(i, memory_order_relaxed);
+        }
+        this->drainThread = thread(&ADXSPDLog::Drain, std::ref(*this));
+    }
+
+    ~Backend() {
+        this->stopRequested = true;
+        this->drainThread.join();
+    }
+
+    Slot* Claim(size_t& pos) {
+        pos = this->enqueuePos.load(memory_order_relaxed);
+        while (true) {
+            Slot& slot = this->slots[pos & (ADXSPD_LOG_QUEUE_SIZE - 1)];
+            intptr_t diff = (intptr_t) slot.sequence.load(memory_order_acquire) - (intptr_t) pos;
+            if (diff == 0) {
+                if (this->enqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    return &slot;
+            } else if (diff < 0) {
+                return nullptr;  // Full
+            } else {
+                pos = this->enqueuePos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    void Publish(Slot* slot, size_t pos) { slot->sequence.store(pos + 1, memory_order_release); }
+
+    Slot* Peek() {
+        Slot& slot = this->slots[this->dequeuePos & (ADXSPD_LOG_QUEUE_SIZE - 1)];
+        if (slot.sequence.load(memory_order_acquire) != this->dequeuePos + 1) return nullptr;
+        return &slot;
+    }
+
+    void Pop(Slot* slot) {
+        slot->sequence.store(this->dequeuePos + ADXSPD_LOG_QUEUE_SIZE, memory_order_release);
+        this->dequeuePos++;
+        this->numDrained.store(this->dequeuePos, memory_order_release);
+    }
+
+    Slot slots[ADXSPD_LOG_QUEUE_SIZE];
+    atomic<size_t> enqueuePos{0};
+    size_t dequeuePos = 0;  // Only used by the drain thread
+    atomic<size_t> numDrained{0};
+
+    atomic<uint64_t> numDropped{0};                   // Dropped since last reported
+    atomic<uint64_t> totalDropped{0};                 // Dropped since startup
+    atomic<ADXSPDLogSite*> suppressedSites{nullptr};  // Sites that have suppressed messages
+    atomic<void (*)(ADXSPDLogLevel, const char*)> sink{printLine};
+
+    atomic<bool> stopRequested{false};
+    thread drainThread;
+};
+
+/**
+ * @brief Gets the backend, starting the logging thread on first use
+ */
+ADXSPDLog::Backend& ADXSPDLog::GetBackend() {
+    static Backend backend;
+    return backend;
+}
+
+/**
+ * @brief Checks whether a message from this site is within the rate limit, counting it as
+ * suppressed if not.
+ *
+ * @return true if the message should be logged
+ */
+bool ADXSPDLogSite::Allow() {
+    int64_t now = steadyMs();
+    int64_t windowStart = this->windowStartMs.load(memory_order_relaxed);
+    if (now - windowStart >= ADXSPD_LOG_RATE_WINDOW_MS &&
+        this->windowStartMs.compare_exchange_strong(windowStart, now, memory_order_relaxed)) {
+        this->numInWindow.store(0, memory_order_relaxed);
+    }
+
+    if (this->numInWindow.fetch_add(1, memory_order_relaxed) < ADXSPD_LOG_RATE_LIMIT) return true;
+
+    this->numSuppressed.fetch_add(1, memory_order_relaxed);
+    if (!this->registered.exchange(true)) ADXSPDLog::AddSuppressedSite(*this);
+    return false;
+}
+
+/**
+ * @brief Adds a site to the list the logging thread checks for unreported suppressed messages
+ */
+void ADXSPDLog::AddSuppressedSite(ADXSPDLogSite& site) {
+    Backend& backend = GetBackend();
+    ADXSPDLogSite* head = backend.suppressedSites.load(memory_order_relaxed);
+    do {
+        site.next = head;
+    } while (!backend.suppressedSites.compare_exchange_weak(head, &site, memory_order_release,
+                                                           memory_order_relaxed));
+}
+
+/**
+ * @brief Queues a formatted line. Drops it if the queue is full.
+ */
+void ADXSPDLog::Enqueue(ADXSPDLogLevel level, const char* fmt, ...) {
+    Backend& backend = GetBackend();
+    size_t pos;
+    Backend::Slot* slot = backend.Claim(pos);
+    if (slot == nullptr) {
+        backend.numDropped.fetch_add(1, memory_order_relaxed);
+        backend.totalDropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+    va_end(args);
+    slot->level = level;
+    backend.Publish(slot, pos);
+}
+
+/**
+ * @brief Formats a message from a call site into the queue. Any messages the site suppressed
+ * since it last logged are reported first.
+ *
+ * @param site The call site logging the message
+ * @param fmt printf style format string
+ */
+void ADXSPDLog::Write(ADXSPDLogSite& site, const char* fmt, ...) {
+    uint64_t numSuppressed = site.numSuppressed.exchange(0, memory_order_relaxed);
+    if (numSuppressed > 0) {
+        Enqueue(site.level, "%s | %s::%s: suppressed %llu messages", getLevelName(site.level),
+                site.driverName, site.func, (unsigned long long) numSuppressed);
+    }
+
+    Backend& backend = GetBackend();
+    size_t pos;
+    Backend::Slot* slot = backend.Claim(pos);
+    if (slot == nullptr) {
+        backend.numDropped.fetch_add(1, memory_order_relaxed);
+        backend.totalDropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    int prefixLength = snprintf(slot->text, sizeof(slot->text), "%s | %s::%s: ",
+                                getLevelName(site.level), site.driverName, site.func);
+    if (prefixLength > 0 && (size_t) prefixLength < sizeof(slot->text)) {
+        va_list args;
+        va_start(args, fmt);
+        vsnprintf(slot->text + prefixLength, sizeof(slot->text) - prefixLength, fmt, args);
+        va_end(args);
+    }
+    slot->level = site.level;
+    backend.Publish(slot, pos);
+}
+
+/**
+ * @brief Reports suppressed messages of sites that have been quiet for a full rate window, since
+ * they will not report them themselves until they log again.
+ *
+ * @param force Report all suppressed messages, regardless of the rate window
+ */
+void ADXSPDLog::ReportSuppressed(Backend& backend, bool force) {
+    auto sink = backend.sink.load(memory_order_relaxed);
+    int64_t now = steadyMs();
+    for (ADXSPDLogSite* site = backend.suppressedSites.load(memory_order_acquire);
+         site != nullptr; site = site->next) {
+        if (site->numSuppressed.load(memory_order_relaxed) == 0) continue;
+        if (!force && now - site->windowStartMs.load(memory_order_relaxed) <
+                          ADXSPD_LOG_RATE_WINDOW_MS)
+            continue;
+
+        uint64_t numSuppressed = site->numSuppressed.exchange(0, memory_order_relaxed);
+        if (numSuppressed == 0) continue;
+        char line[ADXSPD_LOG_MESSAGE_SIZE];
+        snprintf(line, sizeof(line), "%s | %s::%s: suppressed %llu messages",
+                 getLevelName(site->level), site->driverName, site->func,
+                 (unsigned long long) numSuppressed);
+        sink(site->level, line);
+    }
+}
+
+/**
+ * @brief Logging thread. Prints queued messages and summaries until the backend is destroyed.
+ */
+void ADXSPDLog::Drain(Backend& backend) {
+    while (true) {
+        bool stopping = backend.stopRequested.load();
+        auto sink = backend.sink.load(memory_order_relaxed);
+
+        size_t numPrinted = 0;
+        for (Backend::Slot* slot = backend.Peek(); slot != nullptr; slot = backend.Peek()) {
+            sink(slot->level, slot->text);
+            backend.Pop(slot);
+            numPrinted++;
+        }
+
+        uint64_t numDropped = backend.numDropped.exchange(0, memory_order_relaxed);
+        if (numDropped > 0) {
+            char line[128];
+            snprintf(line, sizeof(line), "WARNING | ADXSPDLog: dropped %llu messages, queue full",
+                     (unsigned long long) numDropped);
+            sink(ADXSPDLogLevel::WARNING, line);
+        }
+
+        ReportSuppressed(backend, stopping);
+        if (numPrinted > 0 || numDropped > 0) {
+            fflush(stdout);
+            fflush(stderr);
+        }
+
+        if (stopping) break;
+        this_thread::sleep_for(chrono::milliseconds(ADXSPD_LOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+/**
+ * @brief Blocks until every message queued before the call has been printed, or one second has
+ * passed.
+ */
+void ADXSPDLog::Flush() {
+    Backend& backend = GetBackend();
+    size_t target = backend.enqueuePos.load(memory_order_acquire);
+    auto deadline = chrono::steady_clock::now() + chrono::seconds(1);
+    while (backend.numDrained.load(memory_order_acquire) < target &&
+           chrono::steady_clock::now() < deadline) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief Gets the number of messages dropped because the queue was full, since startup
+ */
+uint64_t ADXSPDLog::GetNumDropped() {
+    return GetBackend().totalDropped.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of messages queued and not yet printed
+ */
+size_t ADXSPDLog::GetQueueDepth() {
+    Backend& backend = GetBackend();
+    size_t drained = backend.numDrained.load(memory_order_acquire);
+    size_t enqueued = backend.enqueuePos.load(memory_order_acquire);
+    return enqueued > drained ? enqueued - drained : 0;
+}
+
+void ADXSPDLog::SetSink(void (*sink)(ADXSPDLogLevel level, const char* line)) {
+    GetBackend().sink.store(sink == nullptr ? printLine : sink, memory_order_relaxed);
+}
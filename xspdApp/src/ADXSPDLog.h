@@ -0,0 +1,87 @@
+/*
+ * Asynchronous, rate limited logging backend for the ADXSPD log macros
+ *
+ * Messages are formatted by the calling thread directly into a slot of a bounded lock-free queue,
+ * and written to stdout / stderr by a background thread, so logging never blocks on the console.
+ * Each call site is rate limited independently; messages over the limit are counted and reported
+ * as a single "suppressed N messages" line once the site's rate window has passed. If the queue is
+ * full, messages are dropped and the number dropped is reported once there is room again.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#ifndef ADXSPD_LOG_H
+#define ADXSPD_LOG_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+#define ADXSPD_LOG_QUEUE_SIZE 4096        // Messages buffered for the logging thread, power of 2
+#define ADXSPD_LOG_MESSAGE_SIZE 512       // Max length of a formatted message, including the NUL
+#define ADXSPD_LOG_RATE_LIMIT 20          // Messages printed per call site per rate window
+#define ADXSPD_LOG_RATE_WINDOW_MS 1000    // Length of the rate limiting window in milliseconds
+#define ADXSPD_LOG_DRAIN_INTERVAL_MS 10   // Max delay before a queued message is printed
+
+enum class ADXSPDLogLevel {
+    NONE = 0,      // No logging
+    ERROR = 10,    // Error messages only
+    WARNING = 20,  // Warnings and errors
+    INFO = 30,     // Info, warnings, and errors
+    DEBUG = 40     // Debugging information
+};
+
+/**
+ * @brief A single location that logs messages, holding its rate limiting state. Declared as a
+ * function-local static by the log macros, and never destroyed while the logging thread runs.
+ */
+class ADXSPDLogSite {
+   public:
+    ADXSPDLogSite(ADXSPDLogLevel level, const char* driverName, const char* func)
+        : level(level), driverName(driverName), func(func) {}
+
+    bool Allow();
+
+    const ADXSPDLogLevel level;
+    const char* const driverName;
+    const char* const func;
+
+   private:
+    friend class ADXSPDLog;
+
+    atomic<int64_t> windowStartMs{INT64_MIN / 2};  // Start of the current rate window
+    atomic<uint32_t> numInWindow{0};               // Messages logged in the current window
+    atomic<uint64_t> numSuppressed{0};             // Messages suppressed and not yet reported
+    atomic<bool> registered{false};
+    ADXSPDLogSite* next = nullptr;  // Next site with suppressed messages to check
+};
+
+class ADXSPDLog {
+   public:
+    static void Write(ADXSPDLogSite& site, const char* fmt, ...)
+        __attribute__((format(printf, 2, 3)));
+    static void Flush();
+
+    static uint64_t GetNumDropped();
+    static size_t GetQueueDepth();
+
+    // Hook for tests, called by the logging thread for each line instead of printing it
+    static void SetSink(void (*sink)(ADXSPDLogLevel level, const char* line));
+
+   private:
+    friend class ADXSPDLogSite;
+    struct Backend;
+    static Backend& GetBackend();
+    static void Enqueue(ADXSPDLogLevel level, const char* fmt, ...)
+        __attribute__((format(printf, 2, 3)));
+    static void AddSuppressedSite(ADXSPDLogSite& site);
+    static void ReportSuppressed(Backend& backend, bool force);
+    static void Drain(Backend& backend);
+};
+
+#endif
@@ -0,0 +1,260 @@
+/*
+ * Prometheus metrics exporter for the ADXSPD driver
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#include "ADXSPDMetrics.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * @brief Formats a sample value. Integral values such as counters are printed exactly.
+ */
+static string formatValue(double value) {
+    if (std::isnan(value)) return "NaN";
+    if (std::isinf(value)) return value > 0 ? "+Inf" : "-Inf";
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.15g", value);
+    return buffer;
+}
+
+/**
+ * @brief Escapes backslashes, newlines, and optionally double quotes, as required for label
+ * values (quotes included) and HELP text (quotes left as-is).
+ */
+static string escape(const string& text, bool escapeQuotes) {
+    string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        if (c == '\\')
+            escaped += "\\\\";
+        else if (c == '\n')
+            escaped += "\\n";
+        else if (c == '"' && escapeQuotes)
+            escaped += "\\\"";
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+/**
+ * @brief Formats a label set, e.g. {port="XSPD1",stage="DECODE"}
+ *
+ * @param labels Label names and values, in the order they should be printed
+ * @return string Formatted label set, or an empty string if there are no labels
+ */
+string ADXSPDMetricsWriter::FormatLabels(const ADXSPDMetricLabels& labels) {
+    if (labels.empty()) return "";
+    string formatted = "{";
+    for (size_t i = 0; i < labels.size(); i++) {
+        if (i > 0) formatted += ",";
+        formatted += labels[i].first + "=\"" + escape(labels[i].second, true) + "\"";
+    }
+    return formatted + "}";
+}
+
+ADXSPDMetricsWriter::Family& ADXSPDMetricsWriter::GetFamily(const string& name, const string& help,
+                                                            const string& type) {
+    auto it = this->families.find(name);
+    if (it != this->families.end()) return it->second;
+    this->familyOrder.push_back(name);
+    return this->families[name] = Family{help, type, {}};
+}
+
+void ADXSPDMetricsWriter::AddSample(Family& family, const string& name,
+                                   const ADXSPDMetricLabels& labels, double value) {
+    family.samples.push_back(name + FormatLabels(labels) + " " + formatValue(value));
+}
+
+/**
+ * @brief Adds a sample of a monotonically increasing counter. By convention the name should end
+ * in _total.
+ */
+void ADXSPDMetricsWriter::Counter(const string& name, const string& help,
+                                  const ADXSPDMetricLabels& labels, double value) {
+    this->AddSample(this->GetFamily(name, help, "counter"), name, labels, value);
+}
+
+/**
+ * @brief Adds a sample of a value that can go up and down
+ */
+void ADXSPDMetricsWriter::Gauge(const string& name, const string& help,
+                                const ADXSPDMetricLabels& labels, double value) {
+    this->AddSample(this->GetFamily(name, help, "gauge"), name, labels, value);
+}
+
+/**
+ * @brief Adds the quantiles, sum, and count of a distribution
+ *
+ * @param quantiles Quantile and value pairs, e.g. {0.99, 0.012}
+ * @param sum Sum of all observed values
+ * @param count Number of observed values
+ */
+void ADXSPDMetricsWriter::Summary(const string& name, const string& help,
+                                  const ADXSPDMetricLabels& labels,
+                                  const vector<pair<double, double>>& quantiles, double sum,
+                                  uint64_t count) {
+    Family& family = this->GetFamily(name, help, "summary");
+    for (auto& [quantile, value] : quantiles) {
+        ADXSPDMetricLabels quantileLabels = labels;
+        quantileLabels.push_back({"quantile", formatValue(quantile)});
+        this->AddSample(family, name, quantileLabels, value);
+    }
+    this->AddSample(family, name + "_sum", labels, sum);
+    this->AddSample(family, name + "_count", labels, (double) count);
+}
+
+/**
+ * @brief Adds the median, p99, and max of a latency histogram as a summary
+ *
+ * @param scale Factor converting recorded values to the metric's unit, e.g. 1e-9 for ns -> s
+ */
+void ADXSPDMetricsWriter::Summary(const string& name, const string& help,
+                                  const ADXSPDMetricLabels& labels,
+                                  const ADXSPDLatencyHistogram& histogram, double scale) {
+    this->Summary(name, help, labels,
+                  {{0.5, histogram.percentile(0.5) * scale},
+                   {0.99, histogram.percentile(0.99) * scale},
+                   {1.0, histogram.max() * scale}},
+                  histogram.sum() * scale, histogram.count());
+}
+
+/**
+ * @brief Renders all families in the Prometheus text exposition format, version 0.0.4
+ */
+string ADXSPDMetricsWriter::Render() const {
+    string output;
+    for (auto& name : this->familyOrder) {
+        const Family& family = this->families.at(name);
+        output += "# HELP " + name + " " + escape(family.help, false) + "\n";
+        output += "# TYPE " + name + " " + family.type + "\n";
+        for (auto& sample : family.samples) output += sample + "\n";
+    }
+    return output;
+}
+
+/**
+ * @brief Starts serving metrics on localhost
+ *
+ * @param port TCP port to listen on, or 0 to pick a free port (see GetPort)
+ * @param collector Called on each scrape to write the current metrics. Called from the server
+ * thread, so must not take any asyn port locks.
+ */
+ADXSPDMetricsServer::ADXSPDMetricsServer(int port, function<void(ADXSPDMetricsWriter&)> collector)
+    : port(port), collector(collector) {
+    this->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (this->listenFd < 0)
+        throw runtime_error("Failed to create metrics socket: " + string(strerror(errno)));
+
+    int reuse = 1;
+    setsockopt(this->listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((uint16_t) port);
+    socklen_t addressLength = sizeof(address);
+    if (bind(this->listenFd, (sockaddr*) &address, sizeof(address)) != 0 ||
+        listen(this->listenFd, 8) != 0 ||
+        getsockname(this->listenFd, (sockaddr*) &address, &addressLength) != 0) {
+        string error = strerror(errno);
+        close(this->listenFd);
+        throw runtime_error("Failed to listen on 127.0.0.1:" + to_string(port) + ": " + error);
+    }
+    this->port = ntohs(address.sin_port);
+
+    this->serverThread = thread(&ADXSPDMetricsServer::Serve, this);
+}
+
+ADXSPDMetricsServer::~ADXSPDMetricsServer() {
+    this->stopRequested = true;
+    this->serverThread.join();
+    close(this->listenFd);
+}
+
+/**
+ * @brief Server thread. Handles one connection at a time until the server is destroyed.
+ */
+void ADXSPDMetricsServer::Serve() {
+    while (!this->stopRequested) {
+        pollfd listenPoll = {this->listenFd, POLLIN, 0};
+        if (poll(&listenPoll, 1, ADXSPD_METRICS_POLL_INTERVAL_MS) <= 0) continue;
+
+        int clientFd = accept(this->listenFd, nullptr, nullptr);
+        if (clientFd < 0) continue;
+        this->HandleConnection(clientFd);
+        close(clientFd);
+    }
+}
+
+/**
+ * @brief Reads a single HTTP request, and responds with the metrics for GET /metrics
+ */
+void ADXSPDMetricsServer::HandleConnection(int clientFd) {
+    timeval timeout = {ADXSPD_METRICS_IO_TIMEOUT_S, 0};
+    setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Only the request line matters, but read the full headers so the client sees a clean close
+    string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == string::npos &&
+           request.size() < ADXSPD_METRICS_MAX_REQUEST_SIZE) {
+        ssize_t numRead = recv(clientFd, buffer, sizeof(buffer), 0);
+        if (numRead <= 0) return;
+        request.append(buffer, numRead);
+    }
+
+    string requestLine = request.substr(0, request.find("\r\n"));
+    size_t methodEnd = requestLine.find(' ');
+    size_t pathEnd = requestLine.find_first_of(" ?", methodEnd + 1);
+    string method = requestLine.substr(0, methodEnd);
+    string path = methodEnd == string::npos
+                      ? ""
+                      : requestLine.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+
+    string status = "200 OK";
+    string body;
+    if (method != "GET") {
+        status = "405 Method Not Allowed";
+    } else if (path != "/metrics") {
+        status = "404 Not Found";
+    } else {
+        try {
+            ADXSPDMetricsWriter writer;
+            this->collector(writer);
+            body = writer.Render();
+        } catch (std::exception& e) {
+            status = "500 Internal Server Error";
+            body = string(e.what()) + "\n";
+        }
+    }
+
+    string response = "HTTP/1.1 " + status +
+                      "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8"
+                      "\r\nContent-Length: " +
+                      to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    size_t numSent = 0;
+    while (numSent < response.size()) {
+        ssize_t rc =
+            send(clientFd, response.data() + numSent, response.size() - numSent, MSG_NOSIGNAL);
+        if (rc <= 0) return;
+        numSent += rc;
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Prometheus metrics exporter for the ADXSPD driver
+ *
+ * ADXSPDMetricsWriter builds a scrape response in the Prometheus text exposition format, grouping
+ * the samples of each metric family under a single HELP / TYPE header. ADXSPDMetricsServer is a
+ * minimal single-threaded HTTP server bound to localhost, which answers GET /metrics with the
+ * output of a collector callback. Collectors only read atomics and internally locked statistics,
+ * so scraping never takes an asyn port lock or delays acquisition.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#ifndef ADXSPD_METRICS_H
+#define ADXSPD_METRICS_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ADXSPDStats.h"
+
+using namespace std;
+
+#define ADXSPD_METRICS_POLL_INTERVAL_MS 200   // Max delay before a stop request is noticed
+#define ADXSPD_METRICS_MAX_REQUEST_SIZE 8192  // Requests with longer headers are rejected
+#define ADXSPD_METRICS_IO_TIMEOUT_S 2         // Send / receive timeout of a single connection
+
+// Label names and values of a single sample, e.g. {{"port", "XSPD1"}, {"stage", "DECODE"}}
+typedef vector<pair<string, string>> ADXSPDMetricLabels;
+
+class ADXSPDMetricsWriter {
+   public:
+    void Counter(const string& name, const string& help, const ADXSPDMetricLabels& labels,
+                 double value);
+    void Gauge(const string& name, const string& help, const ADXSPDMetricLabels& labels,
+               double value);
+    void Summary(const string& name, const string& help, const ADXSPDMetricLabels& labels,
+                 const vector<pair<double, double>>& quantiles, double sum, uint64_t count);
+    void Summary(const string& name, const string& help, const ADXSPDMetricLabels& labels,
+                 const ADXSPDLatencyHistogram& histogram, double scale);
+
+    string Render() const;
+
+    static string FormatLabels(const ADXSPDMetricLabels& labels);
+
+   private:
+    struct Family {
+        string help;
+        string type;
+        vector<string> samples;
+    };
+
+    Family& GetFamily(const string& name, const string& help, const string& type);
+    void AddSample(Family& family, const string& name, const ADXSPDMetricLabels& labels,
+                   double value);
+
+    vector<string> familyOrder;  // Families in the order they were first written
+    map<string, Family> families;
+};
+
+class ADXSPDMetricsServer {
+   public:
+    ADXSPDMetricsServer(int port, function<void(ADXSPDMetricsWriter&)> collector);
+    ~ADXSPDMetricsServer();
+
+    ADXSPDMetricsServer(const ADXSPDMetricsServer&) = delete;
+    ADXSPDMetricsServer& operator=(const ADXSPDMetricsServer&) = delete;
+
+    int GetPort() const { return this->port; }
+
+   private:
+    void Serve();
+    void HandleConnection(int clientFd);
+
+    int port;  // Port actually bound, if 0 was requested
+    int listenFd = -1;
+    function<void(ADXSPDMetricsWriter&)> collector;
+    atomic<bool> stopRequested{false};
+    thread serverThread;
+};
+
+#endif
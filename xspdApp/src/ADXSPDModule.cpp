@@ -10,6 +10,8 @@
 #include "ADXSPDModule.h"
 
 void ADXSPDModule::checkStatus() {
+    auto startTime = chrono::steady_clock::now();
+
     // Module status/health checks
     setDoubleParam(ADXSPDModule_SensCurr, this->module->GetVar<double>("sensor_current"));
 
@@ -17,8 +19,12 @@ void ADXSPDModule::checkStatus() {
     setDoubleParam(ADXSPDModule_BoardTemp, temps[0]);
     setDoubleParam(ADXSPDModule_FpgaTemp, temps[1]);
     setDoubleParam(ADXSPDModule_HumTemp, temps[2]);
+    for (size_t i = 0; i < this->lastTemps.size() && i < temps.size(); i++)
+        this->lastTemps[i].store(temps[i], memory_order_relaxed);
 
-    setDoubleParam(ADXSPDModule_Hum, this->module->GetVar<double>("humidity"));
+    double humidity = this->module->GetVar<double>("humidity");
+    setDoubleParam(ADXSPDModule_Hum, humidity);
+    this->lastHumidity.store(humidity, memory_order_relaxed);
 
     // Module flatfield state
     setStringParam(ADXSPDModule_FfStatus, this->module->GetVar<string>("flatfield_status").c_str());
@@ -26,6 +32,36 @@ void ADXSPDModule::checkStatus() {
     // Module readout check
     setIntegerParam(ADXSPDModule_FramesQueued, this->module->GetVar<int>("frames_queued"));
     getMaxNumImages();
+
+    auto elapsed = chrono::steady_clock::now() - startTime;
+    this->pollLatency.record(chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+}
+
+/**
+ * @brief Writes the module's last polled temperatures and humidity, and its status poll timings.
+ * Only reads atomics, so does not take the port lock.
+ *
+ * @param writer Metrics writer to add samples to
+ * @param driverPort Asyn port name of the parent driver
+ */
+void ADXSPDModule::collectMetrics(ADXSPDMetricsWriter& writer, const string& driverPort) {
+    ADXSPDMetricLabels labels = {{"port", driverPort}, {"module", this->portName}};
+    const char* sensorNames[] = {"board", "fpga", "humidity_sensor"};
+    for (size_t i = 0; i < this->lastTemps.size(); i++) {
+        double temp = this->lastTemps[i].load(memory_order_relaxed);
+        if (std::isnan(temp)) continue;
+        ADXSPDMetricLabels sensorLabels = labels;
+        sensorLabels.push_back({"sensor", sensorNames[i]});
+        writer.Gauge("xspd_module_temperature_celsius", "Last polled module temperature",
+                     sensorLabels, temp);
+    }
+    double humidity = this->lastHumidity.load(memory_order_relaxed);
+    if (!std::isnan(humidity)) {
+        writer.Gauge("xspd_module_humidity_percent", "Last polled module humidity", labels,
+                     humidity);
+    }
+    writer.Summary("xspd_module_status_poll_seconds", "Duration of module status polls", labels,
+                   this->pollLatency, 1e-9);
 }
 
 void ADXSPDModule::getFlatfieldState() {
@@ -119,9 +155,9 @@ ADXSPDModule::ADXSPDModule(const char* portName, XSPD::Module* module, ADXSPD* p
       parent(parent),
       module(module) /* Default stack size*/
 {
+    // Initial module state is read by the parent driver, so that all modules can be read in
+    // parallel.
     this->createAllParams();
-
-    this->getInitialModuleState();
     INFO_ARGS("Configured ADXSPDModule w/ port %s for module %s", portName,
               module->GetId().c_str());
 }
@@ -29,14 +29,22 @@ class ADXSPDModule : public asynPortDriver {
     void getFlatfieldState();
     int getMaxNumImages();
 
+    const ADXSPDLatencyHistogram& getPollLatency() const { return this->pollLatency; }
+    void collectMetrics(ADXSPDMetricsWriter& writer, const string& driverPort);
+
    protected:
     // Module parameters
 #include "ADXSPDModuleParamDefs.h"
 
    private:
     const char* driverName = "ADXSPDModule";
-    ADXSPD* parent;        // Pointer to the parent ADXSPD driver object
-    XSPD::Module* module;  // Pointer to the XSPD module object
+    ADXSPD* parent;                      // Pointer to the parent ADXSPD driver object
+    XSPD::Module* module;                // Pointer to the XSPD module object
+    ADXSPDLatencyHistogram pollLatency;  // Duration of each checkStatus call in ns
+
+    // Last polled values, for the metrics exporter. NaN until first polled.
+    array<atomic<double>, 3> lastTemps = {NAN, NAN, NAN};  // Board, FPGA, humidity sensor
+    atomic<double> lastHumidity{NAN};
     void createAllParams();
 
     template <typename T>
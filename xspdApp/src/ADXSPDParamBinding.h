@@ -0,0 +1,71 @@
+/*
+ * Declarative bindings between ADXSPD asyn parameters and XSPD API variables.
+ *
+ * Each binding describes how a single asyn parameter maps onto a detector (or data port)
+ * variable: which variable is read and written, its type on the wire, any unit scaling, whether
+ * it may only be changed while idle, which derived state must be refreshed after a write, and
+ * whether the last readback may be used to skip redundant writes.
+ *
+ * The table itself is generated from info() tags in ADXSPD.template into
+ * ADXSPDParamBindings.cpp, see scripts/generate_param_bindings.py.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#ifndef ADXSPD_PARAM_BINDING_H
+#define ADXSPD_PARAM_BINDING_H
+
+#include <string>
+
+using namespace std;
+
+// Derived state that must be re-read after a bound variable changes. Combined as a bitmask.
+#define ADXSPD_REFRESH_NONE 0x0
+#define ADXSPD_REFRESH_DATA_TYPE 0x1   // NDDataType follows bit depth
+#define ADXSPD_REFRESH_MAX_FRAMES 0x2  // Per-module max frame counts
+#define ADXSPD_REFRESH_FLATFIELD 0x4   // Per-module flatfield state
+
+// Type of a variable as exchanged with the XSPD API
+enum class ADXSPDVarType {
+    INT = 0,
+    DOUBLE = 1,
+    BOOL = 2,
+    STRING = 3,
+    ON_OFF = 4,
+    TRIGGER_MODE = 5,
+    COUNTER_MODE = 6,
+    SHUFFLE_MODE = 7,
+    COMPRESSOR = 8,
+};
+
+// API component that owns a bound variable
+enum class ADXSPDVarComponent {
+    DETECTOR = 0,
+    DATA_PORT = 1,
+};
+
+// Whether the last value read back from the API may be trusted to skip identical writes
+enum class ADXSPDCachePolicy {
+    NONE = 0,      // Always go to the API
+    READBACK = 1,  // Skip writes that match the last readback
+};
+
+struct ADXSPDParamBinding {
+    int paramIndex;                 // asyn parameter index
+    ADXSPDVarComponent component;   // Component the variable lives on
+    string readVar;                 // Variable read to populate the parameter
+    string writeVar;                // Variable written when the parameter is set
+    ADXSPDVarType readType;         // Wire type of readVar
+    ADXSPDVarType writeType;        // Wire type of writeVar and its readback
+    double scale;                   // API value = parameter value * scale
+    bool writable;                  // Set from an output record, and captured in presets. The
+                                    // driver itself may still write others, e.g. auto-tuning
+    bool idleOnly;                  // Reject writes while acquiring
+    int refreshMask;                // ADXSPD_REFRESH_* flags to apply after a write
+    ADXSPDCachePolicy cachePolicy;  // Readback cache policy
+};
+
+#endif
@@ -0,0 +1,68 @@
+// This file is auto-generated. Do not edit directly.
+// Generated from ADXSPD.template
+
+#include "ADXSPD.h"
+
+void ADXSPD::createParamBindings() {
+    registerParamBinding({ADTriggerMode, ADXSPDVarComponent::DETECTOR, "trigger_mode",
+                          "trigger_mode", ADXSPDVarType::TRIGGER_MODE, ADXSPDVarType::TRIGGER_MODE,
+                          1.0, true, true, ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADAcquireTime, ADXSPDVarComponent::DETECTOR, "shutter_time",
+                          "shutter_time", ADXSPDVarType::DOUBLE, ADXSPDVarType::DOUBLE, 1000.0,
+                          true, true, ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADModel, ADXSPDVarComponent::DETECTOR, "type", "type",
+                          ADXSPDVarType::STRING, ADXSPDVarType::STRING, 1.0, false, false,
+                          ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::NONE});
+    registerParamBinding({ADMaxSizeX, ADXSPDVarComponent::DATA_PORT, "frame_width", "frame_width",
+                          ADXSPDVarType::INT, ADXSPDVarType::INT, 1.0, false, false,
+                          ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::NONE});
+    registerParamBinding({ADMaxSizeY, ADXSPDVarComponent::DATA_PORT, "frame_height", "frame_height",
+                          ADXSPDVarType::INT, ADXSPDVarType::INT, 1.0, false, false,
+                          ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::NONE});
+    registerParamBinding({ADXSPD_CompressLevel, ADXSPDVarComponent::DETECTOR, "compression_level",
+                          "compression_level", ADXSPDVarType::INT, ADXSPDVarType::INT, 1.0, false,
+                          false, ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_Compressor, ADXSPDVarComponent::DETECTOR, "compressor",
+                          "compressor", ADXSPDVarType::COMPRESSOR, ADXSPDVarType::COMPRESSOR, 1.0,
+                          false, false, ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_BeamEnergy, ADXSPDVarComponent::DETECTOR, "beam_energy",
+                          "beam_energy", ADXSPDVarType::DOUBLE, ADXSPDVarType::DOUBLE, 1.0, true,
+                          false, ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_SaturationFlag, ADXSPDVarComponent::DETECTOR,
+                          "saturation_flag_enabled", "saturation_flag", ADXSPDVarType::BOOL,
+                          ADXSPDVarType::ON_OFF, 1.0, true, false, ADXSPD_REFRESH_NONE,
+                          ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_ChargeSumming, ADXSPDVarComponent::DETECTOR, "charge_summing",
+                          "charge_summing", ADXSPDVarType::ON_OFF, ADXSPDVarType::ON_OFF, 1.0, true,
+                          false, ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_FFCorrection, ADXSPDVarComponent::DETECTOR, "flatfield_enabled",
+                          "flatfield_correction", ADXSPDVarType::BOOL, ADXSPDVarType::ON_OFF, 1.0,
+                          true, false, ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_GatingMode, ADXSPDVarComponent::DETECTOR, "gating_mode",
+                          "gating_mode", ADXSPDVarType::ON_OFF, ADXSPDVarType::ON_OFF, 1.0, true,
+                          false, ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_CounterMode, ADXSPDVarComponent::DETECTOR, "counter_mode",
+                          "counter_mode", ADXSPDVarType::COUNTER_MODE, ADXSPDVarType::COUNTER_MODE,
+                          1.0, true, true, ADXSPD_REFRESH_MAX_FRAMES | ADXSPD_REFRESH_FLATFIELD,
+                          ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_ShuffleMode, ADXSPDVarComponent::DETECTOR, "shuffle_mode",
+                          "shuffle_mode", ADXSPDVarType::SHUFFLE_MODE, ADXSPDVarType::SHUFFLE_MODE,
+                          1.0, true, true, ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_SummedFrames, ADXSPDVarComponent::DETECTOR, "summed_frames",
+                          "summed_frames", ADXSPDVarType::INT, ADXSPDVarType::INT, 1.0, true, false,
+                          ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_RoiRows, ADXSPDVarComponent::DETECTOR, "roi_rows", "roi_rows",
+                          ADXSPDVarType::INT, ADXSPDVarType::INT, 1.0, true, false,
+                          ADXSPD_REFRESH_MAX_FRAMES, ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_FramesQueued, ADXSPDVarComponent::DATA_PORT, "frames_queued",
+                          "frames_queued", ADXSPDVarType::INT, ADXSPDVarType::INT, 1.0, false,
+                          false, ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::NONE});
+    registerParamBinding({ADXSPD_BitDepth, ADXSPDVarComponent::DETECTOR, "bit_depth", "bit_depth",
+                          ADXSPDVarType::INT, ADXSPDVarType::INT, 1.0, true, true,
+                          ADXSPD_REFRESH_DATA_TYPE | ADXSPD_REFRESH_MAX_FRAMES,
+                          ADXSPDCachePolicy::READBACK});
+    registerParamBinding({ADXSPD_CrCorr, ADXSPDVarComponent::DETECTOR,
+                          "countrate_correction_enabled", "countrate_correction",
+                          ADXSPDVarType::BOOL, ADXSPDVarType::ON_OFF, 1.0, true, false,
+                          ADXSPD_REFRESH_NONE, ADXSPDCachePolicy::READBACK});
+}
@@ -35,4 +35,53 @@ void ADXSPD::createAllParams() {
     createParam(ADXSPD_MonitorIntervalString, asynParamFloat64, &ADXSPD_MonitorInterval);
     createParam(ADXSPD_DecompressString, asynParamInt32, &ADXSPD_Decompress);
     createParam(ADXSPD_BloscNumThreadsString, asynParamInt32, &ADXSPD_BloscNumThreads);
+    createParam(ADXSPD_PresetDirString, asynParamOctet, &ADXSPD_PresetDir);
+    createParam(ADXSPD_PresetNameString, asynParamOctet, &ADXSPD_PresetName);
+    createParam(ADXSPD_SavePresetString, asynParamInt32, &ADXSPD_SavePreset);
+    createParam(ADXSPD_ApplyPresetString, asynParamInt32, &ADXSPD_ApplyPreset);
+    createParam(ADXSPD_PresetNumWritesString, asynParamInt32, &ADXSPD_PresetNumWrites);
+    createParam(ADXSPD_PresetSwitchTimeString, asynParamFloat64, &ADXSPD_PresetSwitchTime);
+    createParam(ADXSPD_ConnectionStateString, asynParamInt32, &ADXSPD_ConnectionState);
+    createParam(ADXSPD_TimeToRecoverString, asynParamFloat64, &ADXSPD_TimeToRecover);
+    createParam(ADXSPD_NumReconnectsString, asynParamInt32, &ADXSPD_NumReconnects);
+    createParam(ADXSPD_VarCacheTTLString, asynParamFloat64, &ADXSPD_VarCacheTTL);
+    createParam(ADXSPD_LatencyP50String, asynParamFloat64Array, &ADXSPD_LatencyP50);
+    createParam(ADXSPD_LatencyP99String, asynParamFloat64Array, &ADXSPD_LatencyP99);
+    createParam(ADXSPD_LatencyMaxString, asynParamFloat64Array, &ADXSPD_LatencyMax);
+    createParam(ADXSPD_FrameRateString, asynParamFloat64, &ADXSPD_FrameRate);
+    createParam(ADXSPD_WireRateString, asynParamFloat64, &ADXSPD_WireRate);
+    createParam(ADXSPD_OutputRateString, asynParamFloat64, &ADXSPD_OutputRate);
+    createParam(ADXSPD_ResetStatsString, asynParamInt32, &ADXSPD_ResetStats);
+    createParam(ADXSPD_RestNumRequestsString, asynParamInt32, &ADXSPD_RestNumRequests);
+    createParam(ADXSPD_RestNumErrorsString, asynParamInt32, &ADXSPD_RestNumErrors);
+    createParam(ADXSPD_RestDataString, asynParamFloat64, &ADXSPD_RestData);
+    createParam(ADXSPD_RestLatencyP50String, asynParamFloat64, &ADXSPD_RestLatencyP50);
+    createParam(ADXSPD_RestLatencyP99String, asynParamFloat64, &ADXSPD_RestLatencyP99);
+    createParam(ADXSPD_RestLatencyMaxString, asynParamFloat64, &ADXSPD_RestLatencyMax);
+    createParam(ADXSPD_RestSlowestEndpointString, asynParamOctet, &ADXSPD_RestSlowestEndpoint);
+    createParam(ADXSPD_TraceEnableString, asynParamInt32, &ADXSPD_TraceEnable);
+    createParam(ADXSPD_TraceFileString, asynParamOctet, &ADXSPD_TraceFile);
+    createParam(ADXSPD_TraceDumpString, asynParamInt32, &ADXSPD_TraceDump);
+    createParam(ADXSPD_LogLevelString, asynParamInt32, &ADXSPD_LogLevel);
+    createParam(ADXSPD_LogDroppedString, asynParamInt32, &ADXSPD_LogDropped);
+    createParam(ADXSPD_DirectWriteOnlyString, asynParamInt32, &ADXSPD_DirectWriteOnly);
+    createParam(ADXSPD_OutputCompressorString, asynParamInt32, &ADXSPD_OutputCompressor);
+    createParam(ADXSPD_OutputShuffleString, asynParamInt32, &ADXSPD_OutputShuffle);
+    createParam(ADXSPD_OutputCompressLevelString, asynParamInt32, &ADXSPD_OutputCompressLevel);
+    createParam(ADXSPD_OutputNumThreadsString, asynParamInt32, &ADXSPD_OutputNumThreads);
+    createParam(ADXSPD_OutputRatioString, asynParamFloat64, &ADXSPD_OutputRatio);
+    createParam(ADXSPD_OutputCompressRateString, asynParamFloat64, &ADXSPD_OutputCompressRate);
+    createParam(ADXSPD_AutoTuneString, asynParamInt32, &ADXSPD_AutoTune);
+    createParam(ADXSPD_AutoTuneTargetString, asynParamFloat64, &ADXSPD_AutoTuneTarget);
+    createParam(ADXSPD_AutoTuneMaxThreadsString, asynParamInt32, &ADXSPD_AutoTuneMaxThreads);
+    createParam(ADXSPD_AutoTuneSettingString, asynParamOctet, &ADXSPD_AutoTuneSetting);
+    createParam(ADXSPD_AutoTuneReasonString, asynParamOctet, &ADXSPD_AutoTuneReason);
+    createParam(ADXSPD_OutputTransformString, asynParamInt32, &ADXSPD_OutputTransform);
+    createParam(ADXSPD_OutputDataTypeString, asynParamInt32, &ADXSPD_OutputDataType);
+    createParam(ADXSPD_OutputSaturationLimitString, asynParamFloat64,
+                &ADXSPD_OutputSaturationLimit);
+    createParam(ADXSPD_OutputSaturatedString, asynParamInt32, &ADXSPD_OutputSaturated);
+    createParam(ADXSPD_OutputFallbackString, asynParamInt32, &ADXSPD_OutputFallback);
+    createParam(ADXSPD_OutputFallbackResetString, asynParamInt32, &ADXSPD_OutputFallbackReset);
+    createParam(ADXSPD_ModulePollIntervalString, asynParamFloat64, &ADXSPD_ModulePollInterval);
 }
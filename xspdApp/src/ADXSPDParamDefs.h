@@ -36,6 +36,54 @@
 #define ADXSPD_MonitorIntervalString "XSPD_MONITOR_INTERVAL"
 #define ADXSPD_DecompressString "XSPD_DECOMPRESS"
 #define ADXSPD_BloscNumThreadsString "XSPD_BLOSC_NUM_THREADS"
+#define ADXSPD_PresetDirString "XSPD_PRESET_DIR"
+#define ADXSPD_PresetNameString "XSPD_PRESET_NAME"
+#define ADXSPD_SavePresetString "XSPD_SAVE_PRESET"
+#define ADXSPD_ApplyPresetString "XSPD_APPLY_PRESET"
+#define ADXSPD_PresetNumWritesString "XSPD_PRESET_NUM_WRITES"
+#define ADXSPD_PresetSwitchTimeString "XSPD_PRESET_SWITCH_TIME"
+#define ADXSPD_ConnectionStateString "XSPD_CONNECTION_STATE"
+#define ADXSPD_TimeToRecoverString "XSPD_TIME_TO_RECOVER"
+#define ADXSPD_NumReconnectsString "XSPD_NUM_RECONNECTS"
+#define ADXSPD_VarCacheTTLString "XSPD_VAR_CACHE_TTL"
+#define ADXSPD_LatencyP50String "XSPD_LATENCY_P50"
+#define ADXSPD_LatencyP99String "XSPD_LATENCY_P99"
+#define ADXSPD_LatencyMaxString "XSPD_LATENCY_MAX"
+#define ADXSPD_FrameRateString "XSPD_FRAME_RATE"
+#define ADXSPD_WireRateString "XSPD_WIRE_RATE"
+#define ADXSPD_OutputRateString "XSPD_OUTPUT_RATE"
+#define ADXSPD_ResetStatsString "XSPD_RESET_STATS"
+#define ADXSPD_RestNumRequestsString "XSPD_REST_NUM_REQUESTS"
+#define ADXSPD_RestNumErrorsString "XSPD_REST_NUM_ERRORS"
+#define ADXSPD_RestDataString "XSPD_REST_DATA"
+#define ADXSPD_RestLatencyP50String "XSPD_REST_LATENCY_P50"
+#define ADXSPD_RestLatencyP99String "XSPD_REST_LATENCY_P99"
+#define ADXSPD_RestLatencyMaxString "XSPD_REST_LATENCY_MAX"
+#define ADXSPD_RestSlowestEndpointString "XSPD_REST_SLOWEST_ENDPOINT"
+#define ADXSPD_TraceEnableString "XSPD_TRACE_ENABLE"
+#define ADXSPD_TraceFileString "XSPD_TRACE_FILE"
+#define ADXSPD_TraceDumpString "XSPD_TRACE_DUMP"
+#define ADXSPD_LogLevelString "XSPD_LOG_LEVEL"
+#define ADXSPD_LogDroppedString "XSPD_LOG_DROPPED"
+#define ADXSPD_DirectWriteOnlyString "XSPD_DIRECT_WRITE_ONLY"
+#define ADXSPD_OutputCompressorString "XSPD_OUTPUT_COMPRESSOR"
+#define ADXSPD_OutputShuffleString "XSPD_OUTPUT_SHUFFLE"
+#define ADXSPD_OutputCompressLevelString "XSPD_OUTPUT_COMPRESS_LEVEL"
+#define ADXSPD_OutputNumThreadsString "XSPD_OUTPUT_NUM_THREADS"
+#define ADXSPD_OutputRatioString "XSPD_OUTPUT_RATIO"
+#define ADXSPD_OutputCompressRateString "XSPD_OUTPUT_COMPRESS_RATE"
+#define ADXSPD_AutoTuneString "XSPD_AUTO_TUNE"
+#define ADXSPD_AutoTuneTargetString "XSPD_AUTO_TUNE_TARGET"
+#define ADXSPD_AutoTuneMaxThreadsString "XSPD_AUTO_TUNE_MAX_THREADS"
+#define ADXSPD_AutoTuneSettingString "XSPD_AUTO_TUNE_SETTING"
+#define ADXSPD_AutoTuneReasonString "XSPD_AUTO_TUNE_REASON"
+#define ADXSPD_OutputTransformString "XSPD_OUTPUT_TRANSFORM"
+#define ADXSPD_OutputDataTypeString "XSPD_OUTPUT_DATA_TYPE"
+#define ADXSPD_OutputSaturationLimitString "XSPD_OUTPUT_SATURATION_LIMIT"
+#define ADXSPD_OutputSaturatedString "XSPD_OUTPUT_SATURATED"
+#define ADXSPD_OutputFallbackString "XSPD_OUTPUT_FALLBACK"
+#define ADXSPD_OutputFallbackResetString "XSPD_OUTPUT_FALLBACK_RESET"
+#define ADXSPD_ModulePollIntervalString "XSPD_MODULE_POLL_INTERVAL"
 
 // Parameter index definitions
 int ADXSPD_ApiVersion;
@@ -69,10 +117,58 @@ int ADXSPD_MonitorMode;
 int ADXSPD_MonitorInterval;
 int ADXSPD_Decompress;
 int ADXSPD_BloscNumThreads;
+int ADXSPD_PresetDir;
+int ADXSPD_PresetName;
+int ADXSPD_SavePreset;
+int ADXSPD_ApplyPreset;
+int ADXSPD_PresetNumWrites;
+int ADXSPD_PresetSwitchTime;
+int ADXSPD_ConnectionState;
+int ADXSPD_TimeToRecover;
+int ADXSPD_NumReconnects;
+int ADXSPD_VarCacheTTL;
+int ADXSPD_LatencyP50;
+int ADXSPD_LatencyP99;
+int ADXSPD_LatencyMax;
+int ADXSPD_FrameRate;
+int ADXSPD_WireRate;
+int ADXSPD_OutputRate;
+int ADXSPD_ResetStats;
+int ADXSPD_RestNumRequests;
+int ADXSPD_RestNumErrors;
+int ADXSPD_RestData;
+int ADXSPD_RestLatencyP50;
+int ADXSPD_RestLatencyP99;
+int ADXSPD_RestLatencyMax;
+int ADXSPD_RestSlowestEndpoint;
+int ADXSPD_TraceEnable;
+int ADXSPD_TraceFile;
+int ADXSPD_TraceDump;
+int ADXSPD_LogLevel;
+int ADXSPD_LogDropped;
+int ADXSPD_DirectWriteOnly;
+int ADXSPD_OutputCompressor;
+int ADXSPD_OutputShuffle;
+int ADXSPD_OutputCompressLevel;
+int ADXSPD_OutputNumThreads;
+int ADXSPD_OutputRatio;
+int ADXSPD_OutputCompressRate;
+int ADXSPD_AutoTune;
+int ADXSPD_AutoTuneTarget;
+int ADXSPD_AutoTuneMaxThreads;
+int ADXSPD_AutoTuneSetting;
+int ADXSPD_AutoTuneReason;
+int ADXSPD_OutputTransform;
+int ADXSPD_OutputDataType;
+int ADXSPD_OutputSaturationLimit;
+int ADXSPD_OutputSaturated;
+int ADXSPD_OutputFallback;
+int ADXSPD_OutputFallbackReset;
+int ADXSPD_ModulePollInterval;
 
 #define ADXSPD_FIRST_PARAM ADXSPD_ApiVersion
-#define ADXSPD_LAST_PARAM ADXSPD_BloscNumThreads
+#define ADXSPD_LAST_PARAM ADXSPD_ModulePollInterval
 
-#define NUM_ADXSPD_PARAMS 31
+#define NUM_ADXSPD_PARAMS 79
 
 #endif
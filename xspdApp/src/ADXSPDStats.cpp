@@ -0,0 +1,204 @@
+/*
+ * Lock-free frame pipeline statistics for the ADXSPD driver
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#include "ADXSPDStats.h"
+
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Maps a value onto its log-linear bucket
+ *
+ * @param value Value to bucket, clamped to MAX_VALUE
+ * @return Index of the bucket holding value
+ */
+size_t ADXSPDLatencyHistogram::bucketIndex(uint64_t value) {
+    if (value > MAX_VALUE) value = MAX_VALUE;
+    if (value < SUB_BUCKETS) return (size_t) value;
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - ADXSPD_HIST_SUB_BUCKET_BITS;
+    size_t subBucket = (size_t) (value >> shift) - SUB_BUCKETS;
+    return SUB_BUCKETS * (shift + 1) + subBucket;
+}
+
+/**
+ * @brief Gets the largest value that maps onto a bucket
+ *
+ * @param index Bucket index
+ * @return Highest value equivalent to the bucket
+ */
+uint64_t ADXSPDLatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) return index;
+
+    int shift = (int) (index / SUB_BUCKETS) - 1;
+    uint64_t subBucket = SUB_BUCKETS + index % SUB_BUCKETS;
+    return ((subBucket + 1) << shift) - 1;
+}
+
+/**
+ * @brief Records a single value. Safe to call concurrently with readers and other writers.
+ *
+ * @param value Value to record, in ns for frame stage latencies
+ */
+void ADXSPDLatencyHistogram::record(uint64_t value) {
+    this->buckets[bucketIndex(value)].fetch_add(1, memory_order_relaxed);
+    this->totalCount.fetch_add(1, memory_order_relaxed);
+    this->totalSum.fetch_add(value, memory_order_relaxed);
+
+    uint64_t currentMax = this->maxValue.load(memory_order_relaxed);
+    while (value > currentMax &&
+           !this->maxValue.compare_exchange_weak(currentMax, value, memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Clears all recorded values
+ */
+void ADXSPDLatencyHistogram::reset() {
+    for (auto& bucket : this->buckets) bucket.store(0, memory_order_relaxed);
+    this->totalCount.store(0, memory_order_relaxed);
+    this->totalSum.store(0, memory_order_relaxed);
+    this->maxValue.store(0, memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the value at a given quantile of the recorded distribution
+ *
+ * The result is the upper bound of the bucket holding the quantile, capped to the recorded max.
+ * Values recorded while the histogram is being read may or may not be included.
+ *
+ * @param quantile Quantile in [0, 1], e.g. 0.99 for p99
+ * @return Value at the quantile, or 0 if nothing has been recorded
+ */
+uint64_t ADXSPDLatencyHistogram::percentile(double quantile) const {
+    uint64_t total = this->count();
+    if (total == 0) return 0;
+
+    quantile = std::min(std::max(quantile, 0.0), 1.0);
+    uint64_t target = std::max<uint64_t>((uint64_t) ceil(quantile * total), 1);
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        cumulative += this->buckets[i].load(memory_order_relaxed);
+        if (cumulative >= target) return std::min(bucketUpperBound(i), this->max());
+    }
+    return this->max();
+}
+
+int64_t ADXSPDRateMeter::sliceId(chrono::steady_clock::time_point now) {
+    return chrono::duration_cast<chrono::milliseconds>(now.time_since_epoch()).count() /
+           ADXSPD_RATE_SLICE_MS;
+}
+
+/**
+ * @brief Records a single event. Must only be called from one thread at a time.
+ *
+ * @param bytes Number of bytes associated with the event
+ * @param now Time of the event
+ */
+void ADXSPDRateMeter::record(uint64_t bytes, chrono::steady_clock::time_point now) {
+    int64_t id = sliceId(now);
+    Slice& slice = this->slices[id % ADXSPD_RATE_NUM_SLICES];
+    if (slice.id.load(memory_order_relaxed) != id) {
+        slice.events.store(0, memory_order_relaxed);
+        slice.bytes.store(0, memory_order_relaxed);
+        slice.id.store(id, memory_order_release);
+    }
+    slice.events.fetch_add(1, memory_order_relaxed);
+    slice.bytes.fetch_add(bytes, memory_order_relaxed);
+
+    int64_t noFirstSlice = -1;
+    this->firstSliceId.compare_exchange_strong(noFirstSlice, id, memory_order_relaxed);
+}
+
+/**
+ * @brief Clears the rolling window
+ */
+void ADXSPDRateMeter::reset() {
+    for (auto& slice : this->slices) {
+        slice.id.store(-1, memory_order_relaxed);
+        slice.events.store(0, memory_order_relaxed);
+        slice.bytes.store(0, memory_order_relaxed);
+    }
+    this->firstSliceId.store(-1, memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the length of the rolling window, shortened if the first event was more recent
+ */
+double ADXSPDRateMeter::windowSeconds(chrono::steady_clock::time_point now) const {
+    int64_t first = this->firstSliceId.load(memory_order_relaxed);
+    if (first < 0) return 0.0;
+
+    int64_t start = std::max(first, sliceId(now) - ADXSPD_RATE_NUM_SLICES + 1);
+    double nowMs = chrono::duration<double, milli>(now.time_since_epoch()).count();
+    return (nowMs - (double) (start * ADXSPD_RATE_SLICE_MS)) / 1000.0;
+}
+
+template <typename F>
+uint64_t ADXSPDRateMeter::sum(chrono::steady_clock::time_point now, F field) const {
+    int64_t current = sliceId(now);
+    uint64_t total = 0;
+    for (const auto& slice : this->slices) {
+        int64_t id = slice.id.load(memory_order_acquire);
+        if (id > current - ADXSPD_RATE_NUM_SLICES && id <= current)
+            total += field(slice).load(memory_order_relaxed);
+    }
+    return total;
+}
+
+double ADXSPDRateMeter::eventRate(chrono::steady_clock::time_point now) const {
+    double window = this->windowSeconds(now);
+    if (window <= 0.0) return 0.0;
+    return this->sum(now, [](const Slice& s) -> const atomic<uint64_t>& { return s.events; }) /
+           window;
+}
+
+double ADXSPDRateMeter::byteRate(chrono::steady_clock::time_point now) const {
+    double window = this->windowSeconds(now);
+    if (window <= 0.0) return 0.0;
+    return this->sum(now, [](const Slice& s) -> const atomic<uint64_t>& { return s.bytes; }) /
+           window;
+}
+
+/**
+ * @brief Records a single decoded frame. Safe to call concurrently with readers.
+ *
+ * @param inputBytes Size of the frame before decoding
+ * @param outputBytes Size of the decoded frame
+ * @param ns Time spent decoding the frame
+ */
+void ADXSPDCodecStats::record(uint64_t inputBytes, uint64_t outputBytes, uint64_t ns) {
+    this->frames.fetch_add(1, memory_order_relaxed);
+    this->bytesIn.fetch_add(inputBytes, memory_order_relaxed);
+    this->bytesOut.fetch_add(outputBytes, memory_order_relaxed);
+    this->totalNs.fetch_add(ns, memory_order_relaxed);
+}
+
+/**
+ * @brief Clears all recorded frames
+ */
+void ADXSPDCodecStats::reset() {
+    this->frames.store(0, memory_order_relaxed);
+    this->bytesIn.store(0, memory_order_relaxed);
+    this->bytesOut.store(0, memory_order_relaxed);
+    this->totalNs.store(0, memory_order_relaxed);
+}
+
+double ADXSPDCodecStats::outputRate() const {
+    double seconds = this->totalSeconds();
+    if (seconds <= 0.0) return 0.0;
+    return this->outputBytes() / seconds;
+}
+
+double ADXSPDCodecStats::inputRate() const {
+    double seconds = this->totalSeconds();
+    if (seconds <= 0.0) return 0.0;
+    return this->inputBytes() / seconds;
+}
@@ -0,0 +1,123 @@
+/*
+ * Lock-free frame pipeline statistics for the ADXSPD driver
+ *
+ * ADXSPDLatencyHistogram is an HDR-style log-linear histogram: values below 2^SUB_BUCKET_BITS
+ * get a bucket each, and every power of two above that is split into 2^SUB_BUCKET_BITS linear
+ * sub-buckets, so percentiles are accurate to ~3% over the full range. Recording is a single
+ * relaxed atomic increment, so the acquisition thread never blocks on readers.
+ *
+ * ADXSPDRateMeter keeps per-slice event and byte counts over a short rolling window, and is used
+ * for the frame rate and wire / output throughput meters.
+ *
+ * ADXSPDCodecStats accumulates the bytes in and out of a decode path, and the time spent in it, so
+ * that the throughput of each codec can be compared in the driver report. It is also used for the
+ * output compression stage.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#ifndef ADXSPD_STATS_H
+#define ADXSPD_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+#define ADXSPD_HIST_SUB_BUCKET_BITS 5  // 32 linear sub-buckets per power of two
+#define ADXSPD_HIST_MAX_VALUE_BITS 40  // Values are clamped to 2^40 ns (~18 minutes)
+#define ADXSPD_RATE_NUM_SLICES 10      // Number of slices in the rolling rate window
+#define ADXSPD_RATE_SLICE_MS 500       // Width of a single rate slice in ms
+
+// Pipeline stages timed for each frame, in the order they are published in the latency waveforms
+enum class ADXSPDFrameStage {
+    DECODE = 0,     // Frame received -> decompressed / copied into the NDArray
+    CALLBACKS = 1,  // Decoded -> attributes attached and plugin callbacks complete
+    TOTAL = 2,      // Frame received -> callbacks complete
+};
+
+#define ADXSPD_NUM_FRAME_STAGES 3
+
+class ADXSPDLatencyHistogram {
+   public:
+    static constexpr size_t SUB_BUCKETS = size_t(1) << ADXSPD_HIST_SUB_BUCKET_BITS;
+    static constexpr size_t NUM_BUCKETS =
+        SUB_BUCKETS * (ADXSPD_HIST_MAX_VALUE_BITS - ADXSPD_HIST_SUB_BUCKET_BITS + 1);
+    static constexpr uint64_t MAX_VALUE = (uint64_t(1) << ADXSPD_HIST_MAX_VALUE_BITS) - 1;
+
+    ADXSPDLatencyHistogram() { reset(); }
+
+    void record(uint64_t value);
+    void reset();
+
+    uint64_t count() const { return totalCount.load(memory_order_relaxed); }
+    uint64_t max() const { return maxValue.load(memory_order_relaxed); }
+    uint64_t sum() const { return totalSum.load(memory_order_relaxed); }
+    uint64_t percentile(double quantile) const;
+
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t bucketUpperBound(size_t index);
+
+   private:
+    array<atomic<uint64_t>, NUM_BUCKETS> buckets;
+    atomic<uint64_t> totalCount;
+    atomic<uint64_t> totalSum;
+    atomic<uint64_t> maxValue;
+};
+
+class ADXSPDRateMeter {
+   public:
+    ADXSPDRateMeter() { reset(); }
+
+    void record(uint64_t bytes, chrono::steady_clock::time_point now = chrono::steady_clock::now());
+    void reset();
+
+    // Events and bytes per second over the rolling window ending at now
+    double eventRate(chrono::steady_clock::time_point now = chrono::steady_clock::now()) const;
+    double byteRate(chrono::steady_clock::time_point now = chrono::steady_clock::now()) const;
+
+   private:
+    struct Slice {
+        atomic<int64_t> id;  // Absolute slice number this entry currently holds
+        atomic<uint64_t> events;
+        atomic<uint64_t> bytes;
+    };
+
+    static int64_t sliceId(chrono::steady_clock::time_point now);
+    double windowSeconds(chrono::steady_clock::time_point now) const;
+    template <typename F>
+    uint64_t sum(chrono::steady_clock::time_point now, F field) const;
+
+    array<Slice, ADXSPD_RATE_NUM_SLICES> slices;
+    atomic<int64_t> firstSliceId;  // Slice of the first event since reset, -1 if none
+};
+
+class ADXSPDCodecStats {
+   public:
+    void record(uint64_t inputBytes, uint64_t outputBytes, uint64_t ns);
+    void reset();
+
+    uint64_t numFrames() const { return frames.load(memory_order_relaxed); }
+    uint64_t inputBytes() const { return bytesIn.load(memory_order_relaxed); }
+    uint64_t outputBytes() const { return bytesOut.load(memory_order_relaxed); }
+    double totalSeconds() const { return totalNs.load(memory_order_relaxed) / 1e9; }
+
+    // Decoded bytes per second of time spent decoding, 0 if nothing has been recorded
+    double outputRate() const;
+    // Input bytes per second of time spent, i.e. throughput of a compression stage
+    double inputRate() const;
+
+   private:
+    atomic<uint64_t> frames{0};
+    atomic<uint64_t> bytesIn{0};
+    atomic<uint64_t> bytesOut{0};
+    atomic<uint64_t> totalNs{0};
+};
+
+#endif
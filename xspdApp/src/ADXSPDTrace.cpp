@@ -0,0 +1,242 @@
+/*
+ * Timeline tracing for the ADXSPD driver and XSPD API
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#include "ADXSPDTrace.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+/**
+ * @brief Ring buffer of events recorded by a single thread. Only the owning thread writes events;
+ * the name is protected by the registry mutex.
+ */
+struct ADXSPDTrace::ThreadBuffer {
+    int threadId;
+    string threadName;
+    atomic<uint64_t> numRecorded{0};  // Total events recorded, the next slot is this % size
+    vector<ADXSPDTraceEvent> events = vector<ADXSPDTraceEvent>(ADXSPD_TRACE_BUFFER_SIZE);
+    uint64_t exitOrder = 0;  // Nonzero once the owning thread has exited, in order of exit
+    bool dumped = false;     // Events written out or cleared since the owning thread exited
+};
+
+// Buffers of exited threads are kept until their events have been dumped, and then reused
+static mutex traceRegistryMutex;
+static int nextThreadId = 1;
+static uint64_t nextExitOrder = 1;
+
+/**
+ * @brief Gets the buffers of all threads that have recorded events. traceRegistryMutex must be
+ * held by the caller.
+ */
+vector<unique_ptr<ADXSPDTrace::ThreadBuffer>>& ADXSPDTrace::GetRegistry() {
+    static vector<unique_ptr<ThreadBuffer>> registry;
+    return registry;
+}
+
+static const chrono::steady_clock::time_point traceOrigin = chrono::steady_clock::now();
+
+/**
+ * @brief Returns the current trace timestamp in ns. Never returns 0.
+ */
+uint64_t ADXSPDTrace::Now() {
+    auto elapsed = chrono::steady_clock::now() - traceOrigin;
+    return (uint64_t) chrono::duration_cast<chrono::nanoseconds>(elapsed).count() + 1;
+}
+
+/**
+ * @brief Hands the calling thread's buffer back to the registry when the thread exits
+ */
+struct ThreadBufferOwner {
+    ADXSPDTrace::ThreadBuffer* buffer = nullptr;
+
+    ~ThreadBufferOwner() {
+        if (this->buffer == nullptr) return;
+        lock_guard<mutex> lock(traceRegistryMutex);
+        this->buffer->exitOrder = nextExitOrder++;
+        this->buffer->dumped = this->buffer->numRecorded.load(memory_order_relaxed) == 0;
+    }
+};
+
+// Calling thread's buffer, assigned on its first event, and the name it should be given
+static thread_local ThreadBufferOwner threadBuffer;
+static thread_local string threadName;
+
+/**
+ * @brief Gets the calling thread's buffer on first use. The buffer of an exited thread whose
+ * events have been dumped is reused. Otherwise a new one is created, unless too many exited
+ * threads' buffers are waiting to be dumped, in which case the oldest of them is reused.
+ */
+ADXSPDTrace::ThreadBuffer* ADXSPDTrace::GetThreadBuffer() {
+    if (threadBuffer.buffer != nullptr) return threadBuffer.buffer;
+
+    lock_guard<mutex> lock(traceRegistryMutex);
+    auto& registry = GetRegistry();
+    ThreadBuffer* buffer = nullptr;
+    ThreadBuffer* oldestExited = nullptr;
+    int numExited = 0;
+    for (auto& candidate : registry) {
+        if (candidate->exitOrder == 0) continue;
+        if (candidate->dumped) {
+            buffer = candidate.get();
+            break;
+        }
+        numExited++;
+        if (oldestExited == nullptr || candidate->exitOrder < oldestExited->exitOrder)
+            oldestExited = candidate.get();
+    }
+    if (buffer == nullptr && numExited >= ADXSPD_TRACE_MAX_EXITED) buffer = oldestExited;
+    if (buffer == nullptr) {
+        registry.push_back(make_unique<ThreadBuffer>());
+        buffer = registry.back().get();
+    }
+
+    buffer->threadId = nextThreadId++;
+    buffer->threadName = threadName.empty() ? "thread-" + to_string(buffer->threadId) : threadName;
+    buffer->numRecorded.store(0, memory_order_relaxed);
+    buffer->exitOrder = 0;
+    buffer->dumped = false;
+    threadBuffer.buffer = buffer;
+    return buffer;
+}
+
+/**
+ * @brief Names the calling thread in the trace timeline. The buffer itself is only allocated once
+ * the thread records its first event, so this is cheap to call while tracing is disabled.
+ *
+ * @param name Thread name, e.g. the EPICS thread name
+ */
+void ADXSPDTrace::SetThreadName(const string& name) {
+    if (name == threadName) return;
+    threadName = name;
+    if (threadBuffer.buffer != nullptr) {
+        lock_guard<mutex> lock(traceRegistryMutex);
+        threadBuffer.buffer->threadName = name;
+    }
+}
+
+/**
+ * @brief Records a completed span in the calling thread's buffer
+ *
+ * @param category Span category, must be a string literal
+ * @param name Span name, must be a string literal
+ * @param startNs Start time from Now()
+ * @param endNs End time from Now()
+ * @param detail Optional detail string, copied and truncated to ADXSPD_TRACE_DETAIL_SIZE - 1
+ */
+void ADXSPDTrace::Record(const char* category, const char* name, uint64_t startNs, uint64_t endNs,
+                         const char* detail) {
+    ThreadBuffer* buffer = GetThreadBuffer();
+    uint64_t index = buffer->numRecorded.load(memory_order_relaxed);
+    ADXSPDTraceEvent& event = buffer->events[index % ADXSPD_TRACE_BUFFER_SIZE];
+    event.category = category;
+    event.name = name;
+    event.startNs = startNs;
+    event.durationNs = endNs > startNs ? endNs - startNs : 0;
+    if (detail != nullptr) {
+        strncpy(event.detail, detail, ADXSPD_TRACE_DETAIL_SIZE - 1);
+        event.detail[ADXSPD_TRACE_DETAIL_SIZE - 1] = '\0';
+    } else {
+        event.detail[0] = '\0';
+    }
+    buffer->numRecorded.store(index + 1, memory_order_release);
+}
+
+/**
+ * @brief Writes all buffered events to a Chrome trace event JSON file. Events recorded while the
+ * dump is in progress may be torn, so tracing should ideally be disabled first.
+ *
+ * @param path Path of the file to write
+ * @return size_t Number of events written
+ */
+size_t ADXSPDTrace::Dump(const string& path) {
+    json traceEvents = json::array();
+    size_t numEvents = 0;
+    {
+        lock_guard<mutex> lock(traceRegistryMutex);
+        for (auto& buffer : GetRegistry()) {
+            traceEvents.push_back({{"name", "thread_name"},
+                                   {"ph", "M"},
+                                   {"pid", 1},
+                                   {"tid", buffer->threadId},
+                                   {"args", {{"name", buffer->threadName}}}});
+
+            uint64_t numRecorded = buffer->numRecorded.load(memory_order_acquire);
+            uint64_t first = numRecorded > ADXSPD_TRACE_BUFFER_SIZE
+                                 ? numRecorded - ADXSPD_TRACE_BUFFER_SIZE
+                                 : 0;
+            for (uint64_t i = first; i < numRecorded; i++) {
+                const ADXSPDTraceEvent& event = buffer->events[i % ADXSPD_TRACE_BUFFER_SIZE];
+                json traceEvent = {{"name", event.name},
+                                   {"cat", event.category},
+                                   {"ph", "X"},
+                                   {"ts", event.startNs / 1e3},
+                                   {"dur", event.durationNs / 1e3},
+                                   {"pid", 1},
+                                   {"tid", buffer->threadId}};
+                if (event.detail[0] != '\0') traceEvent["args"] = {{"detail", event.detail}};
+                traceEvents.push_back(traceEvent);
+                numEvents++;
+            }
+            if (buffer->exitOrder != 0) buffer->dumped = true;
+        }
+    }
+
+    ofstream file(path);
+    if (!file.is_open()) throw runtime_error("Failed to open trace file " + path);
+    file << json({{"traceEvents", traceEvents}, {"displayTimeUnit", "ms"}})
+                .dump(-1, ' ', false, json::error_handler_t::replace);
+    if (!file.good()) throw runtime_error("Failed to write trace file " + path);
+    return numEvents;
+}
+
+/**
+ * @brief Discards all buffered events. Should only be called while tracing is disabled.
+ */
+void ADXSPDTrace::Clear() {
+    lock_guard<mutex> lock(traceRegistryMutex);
+    for (auto& buffer : GetRegistry()) {
+        buffer->numRecorded.store(0, memory_order_release);
+        if (buffer->exitOrder != 0) buffer->dumped = true;
+    }
+}
+
+ADXSPDTraceSpan::ADXSPDTraceSpan(const char* category, const char* name, const char* detail)
+    : category(category), name(name) {
+    if (!ADXSPDTrace::IsEnabled()) return;
+    this->startNs = ADXSPDTrace::Now();
+    this->detail[0] = '\0';
+    if (detail != nullptr) this->SetDetail(detail);
+}
+
+/**
+ * @brief Sets the detail string shown in the span's arguments. Only call if IsActive(), to avoid
+ * building the detail string while tracing is disabled.
+ */
+void ADXSPDTraceSpan::SetDetail(const char* detail) {
+    if (!this->IsActive()) return;
+    strncpy(this->detail, detail, ADXSPD_TRACE_DETAIL_SIZE - 1);
+    this->detail[ADXSPD_TRACE_DETAIL_SIZE - 1] = '\0';
+}
+
+/**
+ * @brief Ends the span early. Further calls, including from the destructor, do nothing.
+ */
+void ADXSPDTraceSpan::End() {
+    if (!this->IsActive()) return;
+    ADXSPDTrace::Record(this->category, this->name, this->startNs, ADXSPDTrace::Now(),
+                        this->detail);
+    this->startNs = 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Timeline tracing for the ADXSPD driver and XSPD API
+ *
+ * Spans are recorded into a fixed-size ring buffer owned by the recording thread, so recording
+ * never takes a lock or allocates; once a buffer is full the oldest events are overwritten. When a
+ * thread exits, its buffer is kept until its events have been dumped, then reused by the next new
+ * thread, so short-lived worker threads don't each hold on to a buffer. While
+ * tracing is disabled, a span costs a single relaxed atomic load. Tracing is process-wide, shared
+ * by all drivers, and is dumped on demand in the Chrome trace event JSON format, which can be
+ * opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Author: Jakub Wlodek
+ *
+ * Copyright (c) : Brookhaven National Laboratory, 2025
+ *
+ */
+
+#ifndef ADXSPD_TRACE_H
+#define ADXSPD_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#define ADXSPD_TRACE_BUFFER_SIZE 16384  // Events kept per thread
+#define ADXSPD_TRACE_MAX_EXITED 16      // Buffers of exited threads kept until the next dump
+#define ADXSPD_TRACE_DETAIL_SIZE 64     // Max length of a span's detail string, including the NUL
+
+struct ADXSPDTraceEvent {
+    const char* category;  // Must be a string literal
+    const char* name;      // Must be a string literal
+    uint64_t startNs;
+    uint64_t durationNs;
+    char detail[ADXSPD_TRACE_DETAIL_SIZE];
+};
+
+class ADXSPDTrace {
+   public:
+    static void Enable(bool enable) { enabled.store(enable, memory_order_relaxed); }
+    static bool IsEnabled() { return enabled.load(memory_order_relaxed); }
+
+    static uint64_t Now();
+    static void SetThreadName(const string& name);
+    static void Record(const char* category, const char* name, uint64_t startNs, uint64_t endNs,
+                       const char* detail);
+    static size_t Dump(const string& path);
+    static void Clear();
+
+    struct ThreadBuffer;
+
+   private:
+    static vector<unique_ptr<ThreadBuffer>>& GetRegistry();
+    static ThreadBuffer* GetThreadBuffer();
+
+    static inline atomic<bool> enabled{false};
+};
+
+/**
+ * @brief RAII span, recorded from construction until End() or destruction if tracing was enabled
+ * when it was constructed.
+ */
+class ADXSPDTraceSpan {
+   public:
+    ADXSPDTraceSpan(const char* category, const char* name, const char* detail = nullptr);
+    ~ADXSPDTraceSpan() { End(); }
+
+    ADXSPDTraceSpan(const ADXSPDTraceSpan&) = delete;
+    ADXSPDTraceSpan& operator=(const ADXSPDTraceSpan&) = delete;
+
+    bool IsActive() const { return this->startNs != 0; }
+    void SetDetail(const char* detail);
+    void End();
+
+   private:
+    const char* category;
+    const char* name;
+    uint64_t startNs = 0;  // 0 if not recording
+    char detail[ADXSPD_TRACE_DETAIL_SIZE];
+};
+
+#define ADXSPD_TRACE_CONCAT_(a, b) a##b
+#define ADXSPD_TRACE_CONCAT(a, b) ADXSPD_TRACE_CONCAT_(a, b)
+
+// Traces the remainder of the enclosing scope
+#define TRACE_SPAN(category, name) \
+    ADXSPDTraceSpan ADXSPD_TRACE_CONCAT(traceSpan, __LINE__)(category, name)
+
+#define TRACE_SPAN_DETAIL(category, name, detail) \
+    ADXSPDTraceSpan ADXSPD_TRACE_CONCAT(traceSpan, __LINE__)(category, name, detail)
+
+#endif
@@ -1,6 +1,8 @@
 
 #include "XSPDAPI.h"
 
+#include <thread>
+
 /**
  * @brief Parses a version string into its major, minor, and patch components
  *
@@ -127,14 +129,11 @@ string XSPD::API::GetDeviceAtIndex(int deviceIndex) {
 }
 
 /**
- * @brief Initializes the API and connects to the specified device
- *
- * @param deviceId The device ID to connect to (if empty, connects to the first device)
- * @return Pointer to the initialized Detector object
+ * @brief Reads the API and XSPD versions, and checks that the XSPD version is supported
  */
-XSPD::Detector* XSPD::API::Initialize(string deviceId) {
+void XSPD::API::CheckApiVersion() {
     // Get API version information
-    json apiVersionInfo = SubmitRequest(this->baseUri + "/api", XSPD::RequestType::GET);
+    json apiVersionInfo = Submit(this->baseUri + "/api", XSPD::RequestType::GET);
 
     // Extract version strings for api and xspd
     try {
@@ -155,73 +154,399 @@ XSPD::Detector* XSPD::API::Initialize(string deviceId) {
                             to_string(MIN_XSPD_MINOR_VERSION) + "." +
                             to_string(MIN_XSPD_PATCH_VERSION) + ".");
     }
+}
 
-    // Identify the deviceId to connect to
-    if (deviceId.length() == 1 && isdigit(deviceId[0])) {
-        int deviceIndex = stoi(deviceId);
-        this->deviceId = GetDeviceAtIndex(deviceIndex);
-    } else if (!deviceId.empty()) {
-        if (!DeviceExists(deviceId)) {
-            throw invalid_argument("Device with ID " + deviceId + " does not exist.");
+/**
+ * @brief Queries the device for its system ID, and the modules and data ports of one detector.
+ *
+ * @param detectorId The detector to describe (if empty, the first detector on the device)
+ * @param useCachedInfo Reuse device info from a previous discovery, if there was one. Used when
+ * several detectors on one device are initialized, so the device is only queried once.
+ * @return json Topology description, in the format returned by GetTopology()
+ */
+json XSPD::API::DiscoverTopology(string detectorId, bool useCachedInfo) {
+    json deviceInfo, dataPortInfo;
+    {
+        lock_guard<mutex> lock(this->topologyMutex);
+        if (useCachedInfo) {
+            deviceInfo = this->deviceInfo;
+            dataPortInfo = this->dataPortInfo;
         }
-        this->deviceId = deviceId;
-    } else {
-        this->deviceId = GetDeviceAtIndex(0);  // Default to first device
     }
+    bool cached = !deviceInfo.is_null();
 
     // Retrieve detector information
-    json deviceInfo;
+    json topology;
     try {
-        deviceInfo = GetVar<json>("info");
-        this->systemId = deviceInfo["id"].get<string>();
+        if (!cached) deviceInfo = GetVar<json>("info");
+        topology["system_id"] = deviceInfo["id"].get<string>();
     } catch (out_of_range& e) {
         throw runtime_error("Failed to retrieve device info for device ID " + this->deviceId +
                             ": " + string(e.what()));
     }
+    topology["device_id"] = this->deviceId;
 
     // Get libxsp version if available
-    if (deviceInfo.contains("libxsp version"))
-        this->libxspVersion = deviceInfo["libxsp version"].get<string>();
+    topology["libxsp_version"] = deviceInfo.value("libxsp version", "");
 
     if (!deviceInfo.contains("detectors") || deviceInfo["detectors"].empty())
         throw runtime_error("No detector information found for device ID " + this->deviceId);
 
-    // Only support single detector for now
-    json detectorInfo = deviceInfo["detectors"][0];
-    if (!detectorInfo.contains("detector-id") || !detectorInfo.contains("modules"))
-        throw runtime_error(
-            "Detector information is missing 'detector-id' or 'modules' field for device ID " +
-            this->deviceId);
+    // Select the requested detector, defaulting to the first one
+    json detectorInfo;
+    for (auto& candidate : deviceInfo["detectors"]) {
+        if (!candidate.contains("detector-id") || !candidate.contains("modules"))
+            throw runtime_error(
+                "Detector information is missing 'detector-id' or 'modules' field for device ID " +
+                this->deviceId);
+        if (detectorId.empty() || candidate["detector-id"] == detectorId) {
+            detectorInfo = candidate;
+            break;
+        }
+    }
+    if (detectorInfo.is_null())
+        throw invalid_argument("Detector with ID " + detectorId + " not found on device " +
+                               this->deviceId);
 
-    this->detector = make_unique<Detector>(this, detectorInfo["detector-id"].get<string>());
+    detectorId = detectorInfo["detector-id"].get<string>();
+    topology["detector_id"] = detectorId;
+    topology["modules"] = json::array();
     for (auto& moduleJson : detectorInfo["modules"]) {
         int numChips = moduleJson["chips"].get<int>();
         vector<string> chipIds;
         for (int i = 0; i < numChips; i++) {
             chipIds.push_back(moduleJson["chip-ids"][i].get<string>());
         }
-        auto pmodule = make_unique<Module>(this, moduleJson["module"].get<string>(),
-                                           moduleJson["firmware"].get<string>(), chipIds);
-        this->detector->RegisterModule(std::move(pmodule));
+        topology["modules"].push_back({{"id", moduleJson["module"].get<string>()},
+                                       {"firmware", moduleJson["firmware"].get<string>()},
+                                       {"chip_ids", chipIds}});
     }
 
-    json dataPortInfo = Get("devices/" + this->deviceId)["system"]["data-ports"];
+    if (!cached) dataPortInfo = Get("devices/" + this->deviceId)["system"]["data-ports"];
     if (dataPortInfo.empty())
         throw runtime_error("No data ports found for device ID " + this->deviceId);
 
+    topology["data_ports"] = json::array();
     for (auto& dpInfo : dataPortInfo) {
         if (!dpInfo.contains("id") || !dpInfo.contains("ip") || !dpInfo.contains("port"))
             throw runtime_error(
                 "Data port information is missing 'id', 'ip', or 'port' field for device ID " +
                 this->deviceId);
 
+        // Data ports reference the detector or module they serve, e.g. "lambda/1"
+        if (dpInfo.contains("ref")) {
+            string ref = dpInfo["ref"].get<string>();
+            if (ref != detectorId && ref.rfind(detectorId + "/", 0) != 0) continue;
+        }
+        topology["data_ports"].push_back(
+            {{"id", dpInfo["id"]}, {"ip", dpInfo["ip"]}, {"port", dpInfo["port"]}});
+    }
+    if (topology["data_ports"].empty())
+        throw runtime_error("No data ports found for detector " + detectorId + " on device ID " +
+                            this->deviceId);
+
+    lock_guard<mutex> lock(this->topologyMutex);
+    this->deviceInfo = deviceInfo;
+    this->dataPortInfo = dataPortInfo;
+    return topology;
+}
+
+/**
+ * @brief Creates the detector, module and data port objects described by a topology
+ *
+ * @param topology Topology description, in the format returned by GetTopology()
+ * @return Pointer to the initialized Detector object
+ */
+XSPD::Detector* XSPD::API::LoadTopology(json topology) {
+    string topologyDeviceId = topology["device_id"].get<string>();
+    string detectorId = topology["detector_id"].get<string>();
+
+    auto pdetector = make_unique<Detector>(this, detectorId);
+    for (auto& moduleJson : topology["modules"]) {
+        auto pmodule = make_unique<Module>(this, moduleJson["id"].get<string>(),
+                                           moduleJson["firmware"].get<string>(),
+                                           moduleJson["chip_ids"].get<vector<string>>());
+        pdetector->RegisterModule(std::move(pmodule));
+    }
+
+    for (auto& dpInfo : topology["data_ports"]) {
         auto pdataPort =
             make_unique<DataPort>(this, dpInfo["id"].get<string>(), dpInfo["ip"].get<string>(),
                                   dpInfo["port"].get<int>());
-        this->detector->RegisterDataPort(std::move(pdataPort));
+        pdetector->RegisterDataPort(std::move(pdataPort));
+    }
+
+    lock_guard<mutex> lock(this->topologyMutex);
+    if (!this->topologies.empty() && topologyDeviceId != this->deviceId)
+        throw invalid_argument("Detector " + detectorId + " belongs to device " +
+                               topologyDeviceId + ", not " + this->deviceId);
+    if (this->detectors.count(detectorId) > 0)
+        throw invalid_argument("Detector " + detectorId + " is already initialized");
+
+    this->deviceId = topologyDeviceId;
+    this->systemId = topology["system_id"].get<string>();
+    this->libxspVersion = topology["libxsp_version"].get<string>();
+    if (this->firstDetectorId.empty()) this->firstDetectorId = detectorId;
+    this->topologies[detectorId] = topology;
+    this->detectors[detectorId] = std::move(pdetector);
+    return this->detectors[detectorId].get();
+}
+
+/**
+ * @brief Initializes the API and connects to the specified device and detector. If the API is
+ * already initialized, e.g. by another driver sharing it, only the detector is added.
+ *
+ * @param deviceId The device ID to connect to (if empty, connects to the first device)
+ * @param detectorId The detector ID on the device (if empty, the first detector)
+ * @return Pointer to the initialized Detector object
+ */
+XSPD::Detector* XSPD::API::Initialize(string deviceId, string detectorId) {
+    bool initialized;
+    {
+        lock_guard<mutex> lock(this->topologyMutex);
+        initialized = !this->topologies.empty();
+    }
+    if (initialized) return this->LoadTopology(this->DiscoverTopology(detectorId, true));
+
+    this->state = APIState::CHECKING_API_VERSION;
+    this->CheckApiVersion();
+
+    // Identify the deviceId to connect to
+    this->state = APIState::RETRIEVING_DEVICE_LIST;
+    if (deviceId.length() == 1 && isdigit(deviceId[0])) {
+        int deviceIndex = stoi(deviceId);
+        this->deviceId = GetDeviceAtIndex(deviceIndex);
+    } else if (!deviceId.empty()) {
+        if (!DeviceExists(deviceId)) {
+            throw invalid_argument("Device with ID " + deviceId + " does not exist.");
+        }
+        this->deviceId = deviceId;
+    } else {
+        this->deviceId = GetDeviceAtIndex(0);  // Default to first device
+    }
+
+    this->state = APIState::RETRIEVING_DEVICE_INFO;
+    Detector* detector = this->LoadTopology(this->DiscoverTopology(detectorId));
+    this->state = APIState::INITIALIZED;
+    return detector;
+}
+
+/**
+ * @brief Initializes the API from a previously discovered topology, skipping device discovery.
+ *
+ * Only the API version is checked against the device, unless the API is already initialized. The
+ * topology should be revalidated with ValidateTopology() once the caller is up and running.
+ *
+ * @param topology Topology description, as returned by GetTopology() on a previous run
+ * @param allowOffline If true and the server cannot be reached, the topology is loaded anyway and
+ * the API is left DISCONNECTED, to be brought up later with Reconnect()
+ * @return Pointer to the initialized Detector object
+ */
+XSPD::Detector* XSPD::API::InitializeFromTopology(json topology, bool allowOffline) {
+    bool initialized;
+    {
+        lock_guard<mutex> lock(this->topologyMutex);
+        initialized = !this->topologies.empty();
+    }
+
+    bool offline = false;
+    if (!initialized) {
+        this->state = APIState::CHECKING_API_VERSION;
+        try {
+            this->CheckApiVersion();
+        } catch (ConnectionError& e) {
+            if (!allowOffline) throw;
+            offline = true;
+        }
+    } else if (!this->IsConnected() && !allowOffline) {
+        throw ConnectionError("Not connected to XSPD server at " + this->baseUri);
+    }
+
+    try {
+        Detector* detector = this->LoadTopology(topology);
+        if (!initialized) this->state = offline ? APIState::DISCONNECTED : APIState::INITIALIZED;
+        return detector;
+    } catch (json::exception& e) {
+        if (!initialized) this->state = APIState::NOT_INITIALIZED;
+        throw runtime_error("Invalid cached topology: " + string(e.what()));
+    }
+}
+
+/**
+ * @brief Re-establishes the connection to the device after it was lost.
+ *
+ * The API version is re-checked, and the topology of every initialized detector is re-discovered.
+ * Existing Detector, Module and DataPort objects remain valid, so the topology must not have
+ * changed. If another driver sharing the API already reconnected, this returns immediately.
+ *
+ * @throws ConnectionError if the server still cannot be reached
+ * @throws runtime_error if the server responds, but the device no longer matches the topology
+ */
+void XSPD::API::Reconnect() {
+    lock_guard<mutex> reconnectLock(this->reconnectMutex);
+    if (this->IsConnected()) return;
+
+    map<string, json> expectedTopologies;
+    {
+        lock_guard<mutex> lock(this->topologyMutex);
+        expectedTopologies = this->topologies;
+    }
+    if (expectedTopologies.empty()) throw runtime_error("XSPD API not initialized!");
+
+    this->state = APIState::CHECKING_API_VERSION;
+    try {
+        this->CheckApiVersion();
+        this->state = APIState::RETRIEVING_DEVICE_INFO;
+        bool refreshed = false;
+        for (auto& [detectorId, topology] : expectedTopologies) {
+            if (this->DiscoverTopology(detectorId, refreshed) != topology)
+                throw runtime_error("Device " + this->deviceId + " detector " + detectorId +
+                                    " topology changed while disconnected, restart required");
+            refreshed = true;
+        }
+    } catch (std::exception& e) {
+        this->state = APIState::DISCONNECTED;
+        throw;
+    }
+    this->state = APIState::INITIALIZED;
+}
+
+/**
+ * @brief Retrieves the topology (system ID, detector, modules, data ports) of a detector
+ *
+ * @param detectorId The detector to describe (if empty, the first detector initialized)
+ * @return json The topology description, suitable for passing to InitializeFromTopology()
+ */
+json XSPD::API::GetTopology(string detectorId) {
+    lock_guard<mutex> lock(this->topologyMutex);
+    if (this->topologies.empty()) throw runtime_error("XSPD API not initialized!");
+    if (detectorId.empty()) detectorId = this->firstDetectorId;
+    if (this->topologies.count(detectorId) == 0)
+        throw invalid_argument("Detector " + detectorId + " is not initialized");
+    return this->topologies[detectorId];
+}
+
+/**
+ * @brief Re-discovers the topology of a detector and compares it against the given one
+ *
+ * @param topology The topology to validate
+ * @return true if the device still matches the topology, false otherwise
+ */
+bool XSPD::API::ValidateTopology(json topology) {
+    return this->DiscoverTopology(topology["detector_id"].get<string>()) == topology;
+}
+
+/**
+ * @brief Sets the maximum number of variable requests that may be in flight at once.
+ *
+ * Defaults to 1, which serializes all requests. Raising this allows independent components (e.g.
+ * several modules) to be queried concurrently.
+ *
+ * @param maxRequests Maximum number of concurrent requests, at least 1
+ */
+void XSPD::API::SetMaxConcurrentRequests(int maxRequests) {
+    {
+        lock_guard<mutex> lock(this->requestMutex);
+        this->maxConcurrentRequests = max(1, maxRequests);
+    }
+    this->requestSlotFreed.notify_all();
+}
+
+/**
+ * @brief Retrieves the configured maximum number of variable requests that may be in flight at
+ * once, not including any temporary raise from a ScopedConcurrency guard
+ *
+ * @return int Maximum number of concurrent requests
+ */
+int XSPD::API::GetMaxConcurrentRequests() {
+    lock_guard<mutex> lock(this->requestMutex);
+    return this->maxConcurrentRequests;
+}
+
+/**
+ * @brief Sets how long variable reads are cached for. Drivers sharing the API share the cache,
+ * so a variable read by one is not re-requested by another within this time. Writes update the
+ * cache with their readback, and commands clear it.
+ *
+ * @param seconds Maximum age of a cached read, or 0 to disable caching (the default)
+ */
+void XSPD::API::SetVarCacheTTL(double seconds) {
+    lock_guard<mutex> lock(this->varCacheMutex);
+    this->varCacheTTL = max(0.0, seconds);
+    if (this->varCacheTTL == 0) this->varCache.clear();
+}
+
+/**
+ * @brief Looks up a variable response in the cache
+ *
+ * @param varPath The path to the variable
+ * @param response Set to the cached response, if one was found
+ * @return true if a response no older than the cache TTL was found
+ */
+bool XSPD::API::GetCachedVar(const string& varPath, json& response) {
+    lock_guard<mutex> lock(this->varCacheMutex);
+    if (this->varCacheTTL == 0) return false;
+    auto entry = this->varCache.find(varPath);
+    if (entry == this->varCache.end()) return false;
+
+    chrono::duration<double> age = chrono::steady_clock::now() - entry->second.first;
+    if (age.count() > this->varCacheTTL) {
+        this->varCache.erase(entry);
+        return false;
+    }
+    response = entry->second.second;
+    return true;
+}
+
+/**
+ * @brief Stores a variable response in the cache, if caching is enabled
+ *
+ * @param varPath The path to the variable
+ * @param response The response to cache
+ */
+void XSPD::API::CacheVar(const string& varPath, const json& response) {
+    lock_guard<mutex> lock(this->varCacheMutex);
+    if (this->varCacheTTL == 0) return;
+    this->varCache[varPath] = {chrono::steady_clock::now(), response};
+}
+
+/**
+ * @brief Computes the number of variable requests currently allowed in flight. Caller must hold
+ * requestMutex.
+ *
+ * @return int The configured limit, or the largest scoped limit if that is higher
+ */
+int XSPD::API::GetRequestLimit() {
+    if (this->scopedRequestLimits.empty()) return this->maxConcurrentRequests;
+    return max(this->maxConcurrentRequests, *this->scopedRequestLimits.rbegin());
+}
+
+XSPD::API::RequestSlot::RequestSlot(API* api) : api(api) {
+    unique_lock<mutex> lock(api->requestMutex);
+    api->requestSlotFreed.wait(lock,
+                               [api]() { return api->activeRequests < api->GetRequestLimit(); });
+    api->activeRequests++;
+}
+
+XSPD::API::RequestSlot::~RequestSlot() {
+    {
+        lock_guard<mutex> lock(this->api->requestMutex);
+        this->api->activeRequests--;
+    }
+    this->api->requestSlotFreed.notify_one();
+}
+
+XSPD::API::ScopedConcurrency::ScopedConcurrency(API* api, int maxRequests) : api(api) {
+    {
+        lock_guard<mutex> lock(api->requestMutex);
+        this->request = api->scopedRequestLimits.insert(max(1, maxRequests));
     }
+    api->requestSlotFreed.notify_all();
+}
 
-    return this->detector.get();
+XSPD::API::ScopedConcurrency::~ScopedConcurrency() {
+    lock_guard<mutex> lock(this->api->requestMutex);
+    this->api->scopedRequestLimits.erase(this->request);
 }
 
 /**
@@ -282,21 +607,45 @@ string XSPD::API::GetSystemId() {
  * @return json Parsed JSON response from the API
  */
 json XSPD::API::SubmitRequest(string uri, XSPD::RequestType reqType) {
+    ADXSPDTraceSpan span("rest", "SubmitRequest");
+    if (span.IsActive()) span.SetDetail(GetEndpointName(uri, reqType).c_str());
+
+    // Reuse an idle session if there is one, so that its connection is kept alive
+    unique_ptr<cpr::Session> session;
+    {
+        lock_guard<mutex> lock(this->sessionMutex);
+        if (!this->idleSessions.empty()) {
+            session = std::move(this->idleSessions.back());
+            this->idleSessions.pop_back();
+        }
+    }
+    if (session == nullptr) session = make_unique<cpr::Session>();
+
     cpr::Response response;
     string verbMsg;
+    session->SetUrl(cpr::Url(uri));
     switch (reqType) {
         case XSPD::RequestType::GET:
-            response = cpr::Get(cpr::Url(uri));
+            response = session->Get();
             verbMsg = "get data from " + uri;
             break;
         case XSPD::RequestType::PUT:
-            response = cpr::Put(cpr::Url(uri));
+            response = session->Put();
             verbMsg = "put data to " + uri;
             break;
         default:
             throw invalid_argument("Unsupported request type");
     }
 
+    {
+        lock_guard<mutex> lock(this->sessionMutex);
+        this->idleSessions.push_back(std::move(session));
+    }
+    this->RecordBytesReceived(uri, reqType, response.text.size());
+
+    // A status code of 0 means no response was received at all
+    if (response.status_code == 0)
+        throw ConnectionError("Failed to " + verbMsg + ": " + response.error.message);
     if (response.status_code != 200)
         throw runtime_error("Failed to " + verbMsg + ": " + response.error.message);
 
@@ -310,6 +659,251 @@ json XSPD::API::SubmitRequest(string uri, XSPD::RequestType reqType) {
     }
 }
 
+/**
+ * @brief Submits a request, tracking the connection state. While DISCONNECTED, requests fail
+ * immediately rather than waiting on an unreachable server.
+ *
+ * @param uri The full URI to make the request to
+ * @param reqType The type of HTTP request (GET, PUT, etc.)
+ * @return json Parsed JSON response from the API
+ */
+json XSPD::API::Submit(string uri, XSPD::RequestType reqType) {
+    if (this->state == APIState::DISCONNECTED)
+        throw ConnectionError("Not connected to XSPD server at " + this->baseUri);
+
+    auto startTime = chrono::steady_clock::now();
+    auto elapsedNs = [&startTime]() {
+        auto elapsed = chrono::steady_clock::now() - startTime;
+        return (uint64_t) chrono::duration_cast<chrono::nanoseconds>(elapsed).count();
+    };
+
+    try {
+        json response = SubmitRequest(uri, reqType);
+        uint64_t requestNs = elapsedNs();
+        this->RecordRequest(uri, reqType, requestNs, false);
+        if (this->recording)
+            this->RecordExchange(uri, reqType, startTime, requestNs, &response, nullptr);
+        return response;
+    } catch (ConnectionError& e) {
+        uint64_t requestNs = elapsedNs();
+        this->RecordRequest(uri, reqType, requestNs, true);
+        if (this->recording) this->RecordExchange(uri, reqType, startTime, requestNs, nullptr, &e);
+        this->state = APIState::DISCONNECTED;
+        throw;
+    } catch (std::exception& e) {
+        uint64_t requestNs = elapsedNs();
+        this->RecordRequest(uri, reqType, requestNs, true);
+        if (this->recording) this->RecordExchange(uri, reqType, startTime, requestNs, nullptr, &e);
+        throw;
+    } catch (...) {
+        this->RecordRequest(uri, reqType, elapsedNs(), true);
+        throw;
+    }
+}
+
+/**
+ * @brief Gets the name under which requests to a URI are counted. The API version prefix and
+ * device ID are dropped, and of the query parameters only the variable or command path is kept,
+ * e.g. "PUT device/variables?path=lambda/bit_depth".
+ *
+ * @param uri The full URI of the request
+ * @param reqType The type of HTTP request
+ * @return string The endpoint name
+ */
+string XSPD::API::GetEndpointName(const string& uri, XSPD::RequestType reqType) {
+    string path = uri, query;
+    size_t apiPos = path.find("/api");
+    if (apiPos != string::npos) path = path.substr(apiPos + 1);
+    size_t queryPos = path.find('?');
+    if (queryPos != string::npos) {
+        query = path.substr(queryPos + 1);
+        path = path.substr(0, queryPos);
+    }
+
+    // Strip the "api/vX/" prefix of versioned endpoints
+    if (path.rfind("api/v", 0) == 0) {
+        size_t versionEnd = path.find('/', 5);
+        path = versionEnd == string::npos ? "" : path.substr(versionEnd + 1);
+    }
+
+    // Requests for a specific device are all made to the device this API is connected to
+    if (path.rfind("devices/", 0) == 0) {
+        size_t idEnd = path.find('/', 8);
+        path = "device" + (idEnd == string::npos ? "" : path.substr(idEnd));
+    }
+
+    // Values being written are not part of the endpoint
+    size_t pathPos = query.rfind("path=", 0) == 0 ? 0 : query.find("&path=");
+    if (pathPos != string::npos) {
+        if (pathPos != 0) pathPos++;
+        size_t pathEnd = query.find('&', pathPos);
+        size_t pathLength = pathEnd == string::npos ? string::npos : pathEnd - pathPos;
+        path += "?" + query.substr(pathPos, pathLength);
+    }
+
+    return string(magic_enum::enum_name(reqType)) + " " + path;
+}
+
+/**
+ * @brief Gets the statistics record for an endpoint, creating it if needed. statsMutex must be
+ * held by the caller.
+ */
+XSPD::API::EndpointRecord& XSPD::API::GetEndpointRecord(const string& endpoint) {
+    unique_ptr<EndpointRecord>& record = this->endpointStats[endpoint];
+    if (record == nullptr) record = make_unique<EndpointRecord>();
+    return *record;
+}
+
+/**
+ * @brief Records the outcome of a single request
+ *
+ * @param uri The full URI of the request
+ * @param reqType The type of HTTP request
+ * @param elapsedNs Time from submitting the request to receiving (or failing to receive) a response
+ * @param failed Whether the request threw
+ */
+void XSPD::API::RecordRequest(const string& uri, XSPD::RequestType reqType, uint64_t elapsedNs,
+                              bool failed) {
+    lock_guard<mutex> lock(this->statsMutex);
+    for (EndpointRecord* record :
+         {&this->GetEndpointRecord(GetEndpointName(uri, reqType)), &this->totalStats}) {
+        record->numRequests++;
+        if (failed) record->numErrors++;
+        record->bytesSent += uri.size();
+        record->totalNs += elapsedNs;
+        record->latency.record(elapsedNs);
+    }
+}
+
+/**
+ * @brief Records the size of a response body. Called by SubmitRequest implementations.
+ *
+ * @param uri The full URI of the request
+ * @param reqType The type of HTTP request
+ * @param numBytes Size of the response body
+ */
+void XSPD::API::RecordBytesReceived(const string& uri, XSPD::RequestType reqType,
+                                    size_t numBytes) {
+    lock_guard<mutex> lock(this->statsMutex);
+    this->GetEndpointRecord(GetEndpointName(uri, reqType)).bytesReceived += numBytes;
+    this->totalStats.bytesReceived += numBytes;
+}
+
+XSPD::EndpointStats XSPD::API::SummarizeRecord(const string& endpoint,
+                                                const EndpointRecord& record) {
+    EndpointStats stats;
+    stats.endpoint = endpoint;
+    stats.numRequests = record.numRequests;
+    stats.numErrors = record.numErrors;
+    stats.bytesSent = record.bytesSent;
+    stats.bytesReceived = record.bytesReceived;
+    stats.totalMs = record.totalNs / 1e6;
+    stats.p50Ms = record.latency.percentile(0.5) / 1e6;
+    stats.p99Ms = record.latency.percentile(0.99) / 1e6;
+    stats.maxMs = record.latency.max() / 1e6;
+    return stats;
+}
+
+/**
+ * @brief Gets request statistics for every endpoint used since the last reset
+ *
+ * @return vector<EndpointStats> Statistics per endpoint, sorted by total time spent, descending
+ */
+vector<XSPD::EndpointStats> XSPD::API::GetEndpointStats() {
+    vector<EndpointStats> stats;
+    {
+        lock_guard<mutex> lock(this->statsMutex);
+        for (auto& [endpoint, record] : this->endpointStats) {
+            stats.push_back(SummarizeRecord(endpoint, *record));
+        }
+    }
+    sort(stats.begin(), stats.end(), [](const EndpointStats& a, const EndpointStats& b) {
+        return a.totalMs > b.totalMs;
+    });
+    return stats;
+}
+
+/**
+ * @brief Gets request statistics for all endpoints combined since the last reset
+ */
+XSPD::EndpointStats XSPD::API::GetTotalStats() {
+    lock_guard<mutex> lock(this->statsMutex);
+    return SummarizeRecord("all", this->totalStats);
+}
+
+/**
+ * @brief Clears all request statistics
+ */
+void XSPD::API::ResetEndpointStats() {
+    lock_guard<mutex> lock(this->statsMutex);
+    this->endpointStats.clear();
+    this->totalStats.numRequests = 0;
+    this->totalStats.numErrors = 0;
+    this->totalStats.bytesSent = 0;
+    this->totalStats.bytesReceived = 0;
+    this->totalStats.totalNs = 0;
+    this->totalStats.latency.reset();
+}
+
+/**
+ * @brief Starts logging every request made through this API to a file, one JSON object per line,
+ * with its URI, response or error, and latency. The log can be fed back to the driver with
+ * ReplayAPI. Replaces any recording already in progress.
+ *
+ * @param path File to write the log to, overwritten if it exists
+ */
+void XSPD::API::StartRecording(string path) {
+    lock_guard<mutex> lock(this->recordingMutex);
+    if (this->recordingFile.is_open()) this->recordingFile.close();
+    this->recordingFile.open(path, std::ios::trunc);
+    if (!this->recordingFile.is_open()) {
+        this->recording = false;
+        throw runtime_error("Failed to open REST recording file " + path);
+    }
+    this->recordingStart = chrono::steady_clock::now();
+    this->recording = true;
+}
+
+/**
+ * @brief Stops logging requests, and closes the recording file
+ */
+void XSPD::API::StopRecording() {
+    lock_guard<mutex> lock(this->recordingMutex);
+    this->recording = false;
+    if (this->recordingFile.is_open()) this->recordingFile.close();
+}
+
+/**
+ * @brief Appends a request and its outcome to the recording file. Each line is flushed, so the
+ * log is usable even if the IOC does not exit cleanly.
+ *
+ * @param uri The full URI of the request
+ * @param reqType The type of HTTP request
+ * @param startTime When the request was submitted
+ * @param elapsedNs Time from submitting the request to receiving (or failing to receive) a response
+ * @param response The response, or nullptr if the request threw
+ * @param error The exception thrown by the request, or nullptr if it succeeded
+ */
+void XSPD::API::RecordExchange(const string& uri, XSPD::RequestType reqType,
+                               chrono::steady_clock::time_point startTime, uint64_t elapsedNs,
+                               const json* response, const std::exception* error) {
+    lock_guard<mutex> lock(this->recordingMutex);
+    if (!this->recordingFile.is_open()) return;
+
+    auto offset = chrono::duration_cast<chrono::nanoseconds>(startTime - this->recordingStart);
+    json exchange = {{"t_ns", max((int64_t) 0, (int64_t) offset.count())},
+                     {"type", string(magic_enum::enum_name(reqType))},
+                     {"uri", uri},
+                     {"latency_ns", elapsedNs}};
+    if (response != nullptr) {
+        exchange["response"] = *response;
+    } else {
+        exchange["error"] = error->what();
+        exchange["connection_error"] = dynamic_cast<const ConnectionError*>(error) != nullptr;
+    }
+    this->recordingFile << exchange.dump() << std::endl;
+}
+
 /**
  * @brief Makes a GET request to the XSPD API and returns the parsed JSON response
  *
@@ -321,7 +915,7 @@ json XSPD::API::Get(string endpoint) {
 
     string fullUri = this->baseUri + "/api/v" + this->GetApiVersion() + "/" + endpoint;
 
-    return SubmitRequest(fullUri, XSPD::RequestType::GET);
+    return Submit(fullUri, XSPD::RequestType::GET);
 }
 
 /**
@@ -335,7 +929,7 @@ json XSPD::API::Put(string endpoint) {
 
     string fullUri = this->baseUri + "/api/v" + this->GetApiVersion() + "/" + endpoint;
 
-    return SubmitRequest(fullUri, XSPD::RequestType::PUT);
+    return Submit(fullUri, XSPD::RequestType::PUT);
 }
 
 /**
@@ -358,6 +952,10 @@ void XSPD::API::ExecCommand(string command) {
                                this->deviceId);
 
     Put("devices/" + this->deviceId + "/commands?path=" + command);
+
+    // Commands may change any variable, so cached reads can no longer be trusted
+    lock_guard<mutex> lock(this->varCacheMutex);
+    this->varCache.clear();
 }
 
 /**
@@ -457,3 +1055,107 @@ string XSPD::Detector::GetSerialNumber() {
 //     settings.compressionLevel = compressionLevel;
 //     return settings;
 // }
+
+/**
+ * @brief Construct an API that replays a recording made with API::StartRecording()
+ *
+ * @param hostname Host name requests are made to. Need not match the recorded host, since
+ * requests are matched on the rest of the URI.
+ * @param recordingPath The recording to replay
+ * @param portNum Port number requests are made to
+ * @param timeScale Multiplies the recorded latencies, e.g. 0.5 to replay at twice the speed, or 0
+ * to return responses immediately
+ */
+XSPD::ReplayAPI::ReplayAPI(string hostname, string recordingPath, int portNum, double timeScale)
+    : API(hostname, portNum), timeScale(max(0.0, timeScale)) {
+    std::ifstream file(recordingPath);
+    if (!file.is_open()) throw runtime_error("Failed to open REST recording " + recordingPath);
+
+    string line;
+    int lineNum = 0;
+    while (getline(file, line)) {
+        lineNum++;
+        if (line.empty()) continue;
+        try {
+            json record = json::parse(line);
+            auto reqType = magic_enum::enum_cast<RequestType>(record["type"].get<string>());
+            if (!reqType.has_value()) throw runtime_error("unknown request type");
+
+            RecordedExchange exchange;
+            exchange.latencyNs = record.value("latency_ns", (uint64_t) 0);
+            if (record.contains("response")) {
+                exchange.response = record["response"];
+            } else {
+                exchange.error = record.value("error", string("Recorded request failed"));
+                exchange.connectionError = record.value("connection_error", false);
+            }
+            string key = GetReplayKey(record["uri"].get<string>(), reqType.value());
+            this->requests[key].exchanges.push_back(std::move(exchange));
+            this->numRecorded++;
+        } catch (std::exception& e) {
+            throw runtime_error("Invalid record on line " + to_string(lineNum) + " of " +
+                                recordingPath + ": " + e.what());
+        }
+    }
+}
+
+/**
+ * @brief Gets the key requests are matched on: the request type and the URI without its host, so
+ * that a recording can be replayed under any host name.
+ *
+ * @param uri The full URI of the request
+ * @param reqType The type of HTTP request
+ * @return string The replay key, e.g. "GET /api/v1/devices"
+ */
+string XSPD::ReplayAPI::GetReplayKey(const string& uri, XSPD::RequestType reqType) {
+    size_t apiPos = uri.find("/api");
+    string path = apiPos == string::npos ? uri : uri.substr(apiPos);
+    return string(magic_enum::enum_name(reqType)) + " " + path;
+}
+
+/**
+ * @brief Gets the number of requests served from the recording so far, not counting repeats of
+ * a request's last response.
+ */
+size_t XSPD::ReplayAPI::GetNumReplayed() {
+    lock_guard<mutex> lock(this->replayMutex);
+    size_t numReplayed = 0;
+    for (auto& [key, request] : this->requests)
+        numReplayed += min(request.numReplayed, request.exchanges.size());
+    return numReplayed;
+}
+
+/**
+ * @brief Serves the next recorded response to a request, after its recorded latency
+ *
+ * @param uri The full URI of the request
+ * @param reqType The type of HTTP request
+ * @return json The recorded response
+ */
+json XSPD::ReplayAPI::SubmitRequest(string uri, XSPD::RequestType reqType) {
+    ADXSPDTraceSpan span("rest", "ReplayRequest");
+    if (span.IsActive()) span.SetDetail(GetEndpointName(uri, reqType).c_str());
+
+    RecordedExchange exchange;
+    {
+        lock_guard<mutex> lock(this->replayMutex);
+        auto request = this->requests.find(GetReplayKey(uri, reqType));
+        if (request == this->requests.end())
+            throw runtime_error("No recorded response to " + GetReplayKey(uri, reqType));
+        RecordedRequest& recorded = request->second;
+        exchange = recorded.exchanges[min(recorded.numReplayed, recorded.exchanges.size() - 1)];
+        recorded.numReplayed++;
+    }
+
+    if (this->timeScale > 0 && exchange.latencyNs > 0) {
+        auto latency = chrono::nanoseconds((int64_t) (exchange.latencyNs * this->timeScale));
+        this_thread::sleep_for(latency);
+    }
+
+    if (!exchange.error.empty()) {
+        if (exchange.connectionError) throw ConnectionError(exchange.error);
+        throw runtime_error(exchange.error);
+    }
+    this->RecordBytesReceived(uri, reqType, exchange.response.dump().size());
+    return exchange.response;
+}
@@ -3,12 +3,21 @@
 
 #include <cpr/cpr.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
 #include <iostream>
 #include <magic_enum/magic_enum.hpp>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 
+#include "ADXSPDStats.h"
+#include "ADXSPDTrace.h"
 #include "nlohmann/json.hpp"
 
 using json = nlohmann::json;
@@ -85,6 +94,16 @@ enum class APIState {
     RETRIEVING_DEVICE_LIST = 2,
     RETRIEVING_DEVICE_INFO = 3,
     INITIALIZED = 4,
+    DISCONNECTED = 5,
+};
+
+/**
+ * @brief Thrown when the XSPD server cannot be reached, as opposed to the server rejecting a
+ * request. Once thrown, the API is DISCONNECTED and fails fast until Reconnect() succeeds.
+ */
+class ConnectionError : public runtime_error {
+   public:
+    using runtime_error::runtime_error;
 };
 
 // struct CompressionSettings {
@@ -98,6 +117,19 @@ enum class APIState {
 //     ShuffleMode shuffleMode;
 // };
 
+/**
+ * @brief Summary of the requests made to a single REST endpoint, see API::GetEndpointStats()
+ */
+struct EndpointStats {
+    string endpoint;             // Request type and path, e.g. "GET device/variables?path=x"
+    uint64_t numRequests = 0;    // Requests submitted, including failed ones
+    uint64_t numErrors = 0;      // Requests that threw
+    uint64_t bytesSent = 0;      // Size of the request URIs
+    uint64_t bytesReceived = 0;  // Size of the response bodies
+    double totalMs = 0;          // Total time spent waiting on responses
+    double p50Ms = 0, p99Ms = 0, maxMs = 0;  // Response time distribution
+};
+
 // Default port number for XSPD API
 constexpr int DEFAULT_PORT = 8008;
 
@@ -112,9 +144,45 @@ class API {
    public:
     API(string hostname, int portNum = DEFAULT_PORT)
         : baseUri(hostname + ":" + std::to_string(portNum)) {}
-    Detector* Initialize(string deviceId = "");
+    Detector* Initialize(string deviceId = "", string detectorId = "");
+    Detector* InitializeFromTopology(json topology, bool allowOffline = false);
+    void Reconnect();
     virtual ~API() {}
 
+    APIState GetState() { return this->state; }
+    bool IsConnected() { return this->state == APIState::INITIALIZED; }
+
+    json GetTopology(string detectorId = "");
+    bool ValidateTopology(json topology);
+    void SetMaxConcurrentRequests(int maxRequests);
+    int GetMaxConcurrentRequests();
+    void SetVarCacheTTL(double seconds);
+
+    /**
+     * @brief RAII guard that raises the number of variable requests allowed in flight to at least
+     * maxRequests while it is in scope. Overlapping guards from drivers sharing the API do not
+     * undo each other; the limit is the largest of the configured one and all active guards.
+     */
+    class ScopedConcurrency {
+       public:
+        ScopedConcurrency(API* api, int maxRequests);
+        ~ScopedConcurrency();
+        ScopedConcurrency(const ScopedConcurrency&) = delete;
+        ScopedConcurrency& operator=(const ScopedConcurrency&) = delete;
+
+       private:
+        API* api;
+        multiset<int>::iterator request;
+    };
+
+    vector<EndpointStats> GetEndpointStats();
+    EndpointStats GetTotalStats();
+    void ResetEndpointStats();
+
+    void StartRecording(string path);
+    void StopRecording();
+    bool IsRecording() { return this->recording; }
+
     void GetVersionInfo();
     string GetXSPDVersion();
     string GetLibXSPVersion();
@@ -139,8 +207,12 @@ class API {
      */
     template <typename T>
     T GetVar(string varPath, string key = "value") {
-        std::lock_guard<std::mutex> lock(this->apiMutex);  // Ensure thread safety for API calls
-        json response = Get("devices/" + this->deviceId + "/variables?path=" + varPath);
+        json response;
+        if (!this->GetCachedVar(varPath, response)) {
+            RequestSlot slot(this);  // Limit the number of requests in flight
+            response = Get("devices/" + this->deviceId + "/variables?path=" + varPath);
+            this->CacheVar(varPath, response);
+        }
         return ReadVarFromResp<T>(response, varPath, key);
     }
 
@@ -160,6 +232,19 @@ class API {
         string valueAsStr;
         if constexpr (is_same_v<SetT, string>) {
             valueAsStr = value;
+        } else if constexpr (is_same_v<SetT, Compressor>) {
+            // Reverse of the read side special case - XSPD expects blosc compressors as
+            // "blosc/lz4" etc., and the others in lower case
+            if (IsBloscCompressor(value)) {
+                valueAsStr = "blosc/" + GetBloscSubcompressorName(value);
+            } else {
+                valueAsStr = string(magic_enum::enum_name(value));
+                if (valueAsStr.empty())
+                    throw runtime_error("Failed to convert enum value to string for variable " +
+                                        varPath);
+                transform(valueAsStr.begin(), valueAsStr.end(), valueAsStr.begin(),
+                          [](unsigned char c) { return tolower(c); });
+            }
         } else if constexpr (is_enum_v<SetT>) {
             auto enumString = magic_enum::enum_name(value);
             if (enumString.empty()) {
@@ -171,9 +256,10 @@ class API {
             valueAsStr = to_string(value);
         }
 
-        std::lock_guard<std::mutex> lock(this->apiMutex);  // Ensure thread safety for API calls
+        RequestSlot slot(this);  // Limit the number of requests in flight
         json response = this->Put("devices/" + this->deviceId + "/variables?path=" + varPath +
                                   "&value=" + valueAsStr);
+        this->CacheVar(varPath, response);
         return ReadVarFromResp<GetT>(response, varPath, rbKey);
     }
 
@@ -194,6 +280,8 @@ class API {
 
     void ExecCommand(string command);
 
+    static string GetEndpointName(const string& uri, RequestType reqType);
+
     /**
      * @brief Reads a variable of type T from the JSON response
      *
@@ -238,10 +326,117 @@ class API {
         throw out_of_range("Key " + key + " not found in response for variable " + varName);
     }
 
+   protected:
+    void RecordBytesReceived(const string& uri, RequestType reqType, size_t numBytes);
+
    private:
-    mutex apiMutex;  // Mutex to protect API calls and internal state
+    /**
+     * @brief RAII guard that blocks until fewer than maxConcurrentRequests variable requests are
+     * in flight, and holds one of the request slots until it goes out of scope.
+     */
+    class RequestSlot {
+       public:
+        RequestSlot(API* api);
+        ~RequestSlot();
+
+       private:
+        API* api;
+    };
+
+    void CheckApiVersion();
+    json DiscoverTopology(string detectorId, bool useCachedInfo = false);
+    Detector* LoadTopology(json topology);
+    json Submit(string uri, RequestType reqType);
+
+    struct EndpointRecord {
+        uint64_t numRequests = 0;
+        uint64_t numErrors = 0;
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+        uint64_t totalNs = 0;
+        ADXSPDLatencyHistogram latency;  // Response times in ns
+    };
+
+    EndpointRecord& GetEndpointRecord(const string& endpoint);
+    void RecordRequest(const string& uri, RequestType reqType, uint64_t elapsedNs, bool failed);
+    static EndpointStats SummarizeRecord(const string& endpoint, const EndpointRecord& record);
+
+    void RecordExchange(const string& uri, RequestType reqType,
+                        chrono::steady_clock::time_point startTime, uint64_t elapsedNs,
+                        const json* response, const std::exception* error);
+
+    int GetRequestLimit();
+    bool GetCachedVar(const string& varPath, json& response);
+    void CacheVar(const string& varPath, const json& response);
+
+    atomic<APIState> state{APIState::NOT_INITIALIZED};
+    mutex reconnectMutex;  // Serializes reconnect attempts from drivers sharing this API
+
+    mutex requestMutex;  // Protects the request slot count below
+    condition_variable requestSlotFreed;
+    int maxConcurrentRequests = 1;  // By default, only one request may be in flight at a time
+    int activeRequests = 0;
+    multiset<int> scopedRequestLimits;  // Limits requested by active ScopedConcurrency guards
+
+    mutex sessionMutex;  // Protects the pool of idle HTTP sessions
+    vector<unique_ptr<cpr::Session>> idleSessions;
+
+    mutex varCacheMutex;     // Protects the variable cache
+    double varCacheTTL = 0;  // Maximum age of cached variable reads in seconds, 0 to disable
+    map<string, pair<chrono::steady_clock::time_point, json>> varCache;
+
+    mutex statsMutex;  // Protects the endpoint statistics counters
+    map<string, unique_ptr<EndpointRecord>> endpointStats;  // Keyed by GetEndpointName()
+    EndpointRecord totalStats;                              // All endpoints combined
+
+    mutex recordingMutex;  // Protects the recording file below
+    atomic<bool> recording{false};
+    std::ofstream recordingFile;  // Request log written by StartRecording(), one JSON per line
+    chrono::steady_clock::time_point recordingStart;
+
     string baseUri, apiVersion, xspdVersion, libxspVersion, deviceId, systemId;
-    unique_ptr<Detector> detector;
+
+    mutex topologyMutex;  // Protects the detectors and topologies below
+    json deviceInfo, dataPortInfo;  // Raw device info from the last successful discovery
+    string firstDetectorId;         // First detector initialized, the default for GetTopology()
+    map<string, json> topologies;   // Topology of each initialized detector
+    map<string, unique_ptr<Detector>> detectors;
+};
+
+/**
+ * @brief API that serves the responses logged by API::StartRecording() instead of making requests,
+ * for reproducing field issues and benchmarking REST-heavy paths offline. Each request gets the
+ * next response recorded for the same request type and URI, after waiting for its recorded
+ * latency. Once a request's responses run out, the last one is repeated.
+ */
+class ReplayAPI : public API {
+   public:
+    ReplayAPI(string hostname, string recordingPath, int portNum = DEFAULT_PORT,
+              double timeScale = 1.0);
+    json SubmitRequest(string uri, RequestType reqType) override;
+    size_t GetNumRecorded() { return this->numRecorded; }
+    size_t GetNumReplayed();
+
+    static string GetReplayKey(const string& uri, RequestType reqType);
+
+   private:
+    struct RecordedExchange {
+        json response;
+        string error;  // Empty if the request succeeded
+        bool connectionError = false;
+        uint64_t latencyNs = 0;
+    };
+
+    struct RecordedRequest {
+        vector<RecordedExchange> exchanges;  // In the order they were recorded
+        size_t numReplayed = 0;
+    };
+
+    double timeScale;  // Multiplies recorded latencies, 0 to replay without delays
+    size_t numRecorded = 0;
+
+    mutex replayMutex;  // Protects the replay positions
+    map<string, RecordedRequest> requests;  // Keyed by GetReplayKey()
 };
 
 class APIComponent {
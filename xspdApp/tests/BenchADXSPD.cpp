@@ -0,0 +1,550 @@
+/*
+ * End-to-end acquisition throughput benchmark for the ADXSPD driver
+ *
+ * Runs the driver against a fake XSPD REST layer (BenchXSPDAPI) and an in-process ZMQ publisher
+ * standing in for the detector data port, and measures how fast frames make it from the wire
+ * into NDArrays, across a matrix of bit depths, compressors, shuffle modes, detector sizes and
+ * frame rates. Must be run from the top of the repository, so the sample responses are found.
+ *
+ * Usage: BenchADXSPD [--layouts single,ten] [--bit-depths 6,12,24]
+ *                    [--compressors none,zlib,blosc_lz4,blosc_zstd]
+ *                    [--shuffles no_shuffle,shuffle_byte,shuffle_bit] [--rates 100,1000,0]
+ *                    [--frames 200] [--output bench_adxspd.json]
+ *
+ * A rate of 0 publishes frames as fast as possible.
+ *
+ */
+
+#include <asynFloat64SyncIO.h>
+#include <asynInt32SyncIO.h>
+#include <epicsExit.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include "ADXSPD.h"
+#include "BenchFrames.h"
+#include "BenchXSPDAPI.h"
+
+#define BENCH_FRAME_BANK_SIZE 4           // Distinct frames published in rotation
+#define BENCH_MAX_BYTES_PER_RUN (2ll << 30)  // Raw frame bytes per run, caps frames on large frames
+#define BENCH_MIN_FRAMES_PER_RUN 10        // Frames per run, regardless of the cap
+#define BENCH_PUBLISHER_HWM 64             // Send high water mark of the publisher
+#define BENCH_SETTLE_TIME_S 0.6            // Wait before starting, longer than the receive timeout
+#define BENCH_STALL_TIMEOUT_S 2.0          // Stop waiting once no frame has arrived for this long
+#define BENCH_POLL_INTERVAL_MS 10          // Interval at which acquisition progress is polled
+#define BENCH_ASYN_TIMEOUT_S 10.0          // Timeout of parameter reads and writes
+
+struct BenchLayout {
+    string name;
+    string samplesPath;
+};
+
+static const vector<BenchLayout> benchLayouts = {
+    {"single", "scripts/samples/single_module_xsp_sim.json"},
+    {"ten", "scripts/samples/ten_module_7_5_m.json"},
+};
+
+struct BenchOptions {
+    vector<string> layouts = {"single", "ten"};
+    vector<int> bitDepths = {6, 12, 24};
+    vector<XSPD::Compressor> compressors = {XSPD::Compressor::NONE, XSPD::Compressor::ZLIB,
+                                            XSPD::Compressor::BLOSC_LZ4,
+                                            XSPD::Compressor::BLOSC_ZSTD};
+    vector<XSPD::ShuffleMode> shuffleModes = {XSPD::ShuffleMode::NO_SHUFFLE,
+                                              XSPD::ShuffleMode::SHUFFLE_BYTE,
+                                              XSPD::ShuffleMode::SHUFFLE_BIT};
+    vector<double> rates = {100, 1000, 0};
+    int numFrames = 200;
+    string outputPath = "bench_adxspd.json";
+};
+
+static double threadCpuSeconds(clockid_t clock) {
+    timespec now;
+    clock_gettime(clock, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static double processCpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec +
+           usage.ru_stime.tv_usec * 1e-6;
+}
+
+/**
+ * @brief Stands in for the detector data port. Publishes a bank of pre-encoded frames in the XSPD
+ * wire format, paced against a fixed schedule so that slow sends do not lower the average rate.
+ */
+class BenchPublisher {
+   public:
+    BenchPublisher() {
+        this->context = zmq_ctx_new();
+        this->socket = zmq_socket(this->context, ZMQ_PUB);
+        int hwm = BENCH_PUBLISHER_HWM, linger = 0;
+        zmq_setsockopt(this->socket, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        zmq_setsockopt(this->socket, ZMQ_LINGER, &linger, sizeof(linger));
+        if (zmq_bind(this->socket, "tcp://127.0.0.1:*") != 0)
+            throw runtime_error("Failed to bind publisher: " + string(zmq_strerror(zmq_errno())));
+
+        char endpoint[256];
+        size_t endpointSize = sizeof(endpoint);
+        zmq_getsockopt(this->socket, ZMQ_LAST_ENDPOINT, endpoint, &endpointSize);
+        this->port = stoi(strrchr(endpoint, ':') + 1);
+
+        this->publishThread = thread(&BenchPublisher::Run, this);
+    }
+
+    ~BenchPublisher() {
+        {
+            lock_guard<mutex> lock(this->stateMutex);
+            this->shutdownRequested = true;
+            this->stopRequested = true;
+        }
+        this->stateChanged.notify_all();
+        this->publishThread.join();
+        zmq_close(this->socket);
+        zmq_ctx_term(this->context);
+    }
+
+    int GetPort() const { return this->port; }
+
+    // Sets what the next start command publishes
+    void Arm(const vector<vector<uint8_t>>* frames, int numFrames, double rateHz) {
+        lock_guard<mutex> lock(this->stateMutex);
+        this->frames = frames;
+        this->numFrames = numFrames;
+        this->rateHz = rateHz;
+        this->numSent = 0;
+    }
+
+    // Command handler for the fake REST layer, e.g. "lambda/start"
+    void OnCommand(const string& commandPath) {
+        string command = commandPath.substr(commandPath.rfind('/') + 1);
+        lock_guard<mutex> lock(this->stateMutex);
+        if (command == "start" && this->frames != nullptr) {
+            this->startRequested = true;
+            this->stopRequested = false;
+        } else if (command == "stop") {
+            this->stopRequested = true;
+        }
+        this->stateChanged.notify_all();
+    }
+
+    // Stops the current run, if any, and waits for it to finish, so the frames can be freed
+    void Disarm() {
+        this->OnCommand("stop");
+        this->WaitIdle();
+        this->Arm(nullptr, 0, 0);
+    }
+
+    // Waits for the current run to finish, returning the number of frames sent
+    int WaitIdle() {
+        unique_lock<mutex> lock(this->stateMutex);
+        this->stateChanged.wait(lock, [this] { return !this->startRequested && !this->running; });
+        return this->numSent;
+    }
+
+    bool IsRunning() {
+        lock_guard<mutex> lock(this->stateMutex);
+        return this->startRequested || this->running;
+    }
+
+    // CPU time used by the publishing thread since startup
+    double GetCpuSeconds() const { return this->cpuSeconds.load(); }
+
+   private:
+    void Run() {
+        clockid_t threadClock;
+        pthread_getcpuclockid(pthread_self(), &threadClock);
+
+        unique_lock<mutex> lock(this->stateMutex);
+        while (true) {
+            this->stateChanged.wait(
+                lock, [this] { return this->startRequested || this->shutdownRequested; });
+            if (this->shutdownRequested) return;
+            this->startRequested = false;
+            this->running = true;
+            const vector<vector<uint8_t>>& bank = *this->frames;
+            int numFrames = this->numFrames;
+            double rateHz = this->rateHz;
+            lock.unlock();
+
+            auto startTime = chrono::steady_clock::now();
+            int numSent = 0;
+            for (int i = 0; i < numFrames && !this->stopRequested; i++) {
+                if (rateHz > 0) {
+                    this_thread::sleep_until(startTime +
+                                             chrono::duration<double>(i / rateHz));
+                }
+                const vector<uint8_t>& frame = bank[i % bank.size()];
+                uint8_t header[4] = {(uint8_t) (i & 0xFF), (uint8_t) (i & 0xFF), 0, 0};
+                zmq_send(this->socket, "", 0, ZMQ_SNDMORE);
+                zmq_send(this->socket, header, sizeof(header), ZMQ_SNDMORE);
+                zmq_send(this->socket, frame.data(), frame.size(), 0);
+                numSent++;
+            }
+            this->cpuSeconds = threadCpuSeconds(threadClock);
+
+            lock.lock();
+            this->numSent = numSent;
+            this->running = false;
+            this->stateChanged.notify_all();
+        }
+    }
+
+    void* context;
+    void* socket;
+    int port;
+
+    mutex stateMutex;
+    condition_variable stateChanged;
+    const vector<vector<uint8_t>>* frames = nullptr;
+    int numFrames = 0;
+    double rateHz = 0;
+    int numSent = 0;
+    bool startRequested = false, running = false, shutdownRequested = false;
+    atomic<bool> stopRequested{false};
+    atomic<double> cpuSeconds{0};
+    thread publishThread;
+};
+
+/**
+ * @brief Connects to a parameter of a driver by its drvInfo string
+ */
+static asynUser* connectParam(const string& portName, const char* param, bool isFloat) {
+    asynUser* pasynUser;
+    asynStatus status =
+        isFloat ? pasynFloat64SyncIO->connect(portName.c_str(), 0, &pasynUser, param)
+                : pasynInt32SyncIO->connect(portName.c_str(), 0, &pasynUser, param);
+    if (status != asynSuccess)
+        throw runtime_error("Failed to connect to " + portName + " parameter " + param);
+    return pasynUser;
+}
+
+static void writeInt(const string& portName, const char* param, int value) {
+    asynUser* pasynUser = connectParam(portName, param, false);
+    asynStatus status = pasynInt32SyncIO->write(pasynUser, value, BENCH_ASYN_TIMEOUT_S);
+    pasynInt32SyncIO->disconnect(pasynUser);
+    if (status != asynSuccess)
+        throw runtime_error("Failed to set " + string(param) + " to " + to_string(value));
+}
+
+static void writeDouble(const string& portName, const char* param, double value) {
+    asynUser* pasynUser = connectParam(portName, param, true);
+    asynStatus status = pasynFloat64SyncIO->write(pasynUser, value, BENCH_ASYN_TIMEOUT_S);
+    pasynFloat64SyncIO->disconnect(pasynUser);
+    if (status != asynSuccess)
+        throw runtime_error("Failed to set " + string(param) + " to " + to_string(value));
+}
+
+static int readInt(asynUser* pasynUser) {
+    epicsInt32 value = 0;
+    pasynInt32SyncIO->read(pasynUser, &value, BENCH_ASYN_TIMEOUT_S);
+    return value;
+}
+
+/**
+ * @brief Scrapes the driver's metrics, keyed by metric name and labels as rendered, e.g.
+ * xspd_frames_decoded_total{port="BENCH1"}
+ */
+static map<string, double> scrapeMetrics(ADXSPD* pDriver) {
+    ADXSPDMetricsWriter writer;
+    pDriver->collectMetrics(writer);
+    map<string, double> metrics;
+    istringstream lines(writer.Render());
+    string line;
+    while (getline(lines, line)) {
+        size_t valuePos = line.rfind(' ');
+        if (line.empty() || line[0] == '#' || valuePos == string::npos) continue;
+        metrics[line.substr(0, valuePos)] = strtod(line.c_str() + valuePos + 1, nullptr);
+    }
+    return metrics;
+}
+
+static double getMetric(const map<string, double>& metrics, const string& name,
+                        const ADXSPDMetricLabels& labels) {
+    auto it = metrics.find(name + ADXSPDMetricsWriter::FormatLabels(labels));
+    return it == metrics.end() ? 0 : it->second;
+}
+
+/**
+ * @brief Gets the compressor name as reported by the XSPD server, e.g. "blosc/lz4"
+ */
+static string getServerCompressorName(XSPD::Compressor compressor) {
+    string name(magic_enum::enum_name(compressor));
+    transform(name.begin(), name.end(), name.begin(), ::tolower);
+    size_t separator = name.find('_');
+    if (separator != string::npos) name[separator] = '/';
+    return name;
+}
+
+/**
+ * @brief Runs a single point of the benchmark matrix, and returns its results
+ */
+static json runCase(ADXSPD* pDriver, const string& portName, BenchPublisher& publisher,
+                    const BenchLayout& layout, XSPD::Compressor compressor, int bitDepth,
+                    XSPD::ShuffleMode shuffleMode, double rateHz, int requestedFrames,
+                    int width, int height) {
+    json result = {{"layout", layout.name},
+                   {"width", width},
+                   {"height", height},
+                   {"bit_depth", bitDepth},
+                   {"compressor", string(magic_enum::enum_name(compressor))},
+                   {"shuffle_mode", string(magic_enum::enum_name(shuffleMode))},
+                   {"rate_hz", rateHz}};
+
+    size_t rawFrameSize = (size_t) width * height * BenchFrames::GetBytesPerPixel(bitDepth);
+    int numFrames = (int) min<long long>(
+        requestedFrames,
+        max<long long>(BENCH_MIN_FRAMES_PER_RUN, BENCH_MAX_BYTES_PER_RUN / rawFrameSize));
+
+    vector<vector<uint8_t>> bank;
+    size_t encodedBytes = 0;
+    for (int i = 0; i < BENCH_FRAME_BANK_SIZE; i++) {
+        vector<uint8_t> frame = BenchFrames::Generate(width, height, bitDepth, i + 1);
+        bank.push_back(BenchFrames::Encode(frame, bitDepth, compressor, shuffleMode));
+        encodedBytes += bank.back().size();
+    }
+    result["frames"] = numFrames;
+    result["compression_ratio"] = (double) rawFrameSize * bank.size() / encodedBytes;
+
+    writeInt(portName, ADXSPD_BitDepthString, bitDepth);
+    if (XSPD::IsBloscCompressor(compressor))
+        writeInt(portName, ADXSPD_ShuffleModeString, static_cast<int>(shuffleMode));
+    writeDouble(portName, ADAcquireTimeString, rateHz > 0 ? 1.0 / rateHz : 0.001);
+    writeInt(portName, ADNumImagesString, numFrames);
+    writeInt(portName, ADXSPD_ResetStatsString, 1);
+    publisher.Arm(&bank, numFrames, rateHz);
+
+    // The publisher must be done with the frame bank before it is freed, including on errors
+    struct DisarmGuard {
+        BenchPublisher& publisher;
+        ~DisarmGuard() { this->publisher.Disarm(); }
+    } disarmGuard{publisher};
+
+    // Give the acquisition thread time to apply the stats reset before the first frame
+    this_thread::sleep_for(chrono::duration<double>(BENCH_SETTLE_TIME_S));
+
+    ADXSPDMetricLabels labels = {{"port", portName}};
+    map<string, double> before = scrapeMetrics(pDriver);
+    double cpuBefore = processCpuSeconds(), publisherCpuBefore = publisher.GetCpuSeconds();
+
+    asynUser* acquireUser = connectParam(portName, ADAcquireString, false);
+    asynUser* counterUser = connectParam(portName, NDArrayCounterString, false);
+    int counterStart = readInt(counterUser), lastCounter = counterStart;
+
+    auto startTime = chrono::steady_clock::now();
+    auto lastProgressTime = startTime;
+    writeInt(portName, ADAcquireString, 1);
+    while (readInt(acquireUser)) {
+        this_thread::sleep_for(chrono::milliseconds(BENCH_POLL_INTERVAL_MS));
+        auto now = chrono::steady_clock::now();
+        int counter = readInt(counterUser);
+        if (counter != lastCounter) {
+            lastCounter = counter;
+            lastProgressTime = now;
+        } else if (!publisher.IsRunning() &&
+                   chrono::duration<double>(now - lastProgressTime).count() >
+                       BENCH_STALL_TIMEOUT_S) {
+            // Some frames were lost, so the driver will never reach the requested count
+            writeInt(portName, ADAcquireString, 0);
+            break;
+        }
+    }
+    int numSent = publisher.WaitIdle();
+    double elapsed = chrono::duration<double>(lastProgressTime - startTime).count();
+    double cpu = processCpuSeconds() - cpuBefore - (publisher.GetCpuSeconds() - publisherCpuBefore);
+    pasynInt32SyncIO->disconnect(acquireUser);
+    pasynInt32SyncIO->disconnect(counterUser);
+
+    map<string, double> after = scrapeMetrics(pDriver);
+    auto delta = [&](const string& name) {
+        return getMetric(after, name, labels) - getMetric(before, name, labels);
+    };
+    double numDecoded = delta("xspd_frames_decoded_total");
+    result["frames_sent"] = numSent;
+    result["frames_decoded"] = numDecoded;
+    result["frames_dropped_by_driver"] = delta("xspd_frames_dropped_total");
+    result["drop_rate"] = numSent > 0 ? (numSent - numDecoded) / numSent : 0.0;
+    result["elapsed_s"] = elapsed;
+    result["fps"] = elapsed > 0 ? numDecoded / elapsed : 0.0;
+    result["wire_mb_per_s"] =
+        elapsed > 0 ? delta("xspd_zmq_received_bytes_total") / elapsed / 1e6 : 0.0;
+    result["cpu_us_per_frame"] = numDecoded > 0 ? cpu / numDecoded * 1e6 : 0.0;
+
+    for (auto stage : {ADXSPDFrameStage::DECODE, ADXSPDFrameStage::TOTAL}) {
+        string stageName(magic_enum::enum_name(stage));
+        ADXSPDMetricLabels stageLabels = labels;
+        stageLabels.push_back({"stage", stageName});
+        json latency;
+        for (auto& [quantile, key] : vector<pair<string, string>>{
+                 {"0.5", "p50_us"}, {"0.99", "p99_us"}, {"1", "max_us"}}) {
+            ADXSPDMetricLabels quantileLabels = stageLabels;
+            quantileLabels.push_back({"quantile", quantile});
+            latency[key] = getMetric(after, "xspd_frame_stage_seconds", quantileLabels) * 1e6;
+        }
+        transform(stageName.begin(), stageName.end(), stageName.begin(), ::tolower);
+        result["latency"][stageName] = latency;
+    }
+    return result;
+}
+
+template <typename T>
+static vector<T> parseList(const string& arg, function<T(const string&)> parse) {
+    vector<T> values;
+    stringstream stream(arg);
+    string item;
+    while (getline(stream, item, ',')) values.push_back(parse(item));
+    return values;
+}
+
+template <typename E>
+static E parseEnum(const string& name) {
+    auto value = magic_enum::enum_cast<E>(name, magic_enum::case_insensitive);
+    if (!value.has_value()) throw invalid_argument("Unknown value " + name);
+    return value.value();
+}
+
+static BenchOptions parseOptions(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        string flag = argv[i];
+        if (i + 1 >= argc) throw invalid_argument("Missing value for " + flag);
+        string value = argv[++i];
+        if (flag == "--layouts") {
+            options.layouts = parseList<string>(value, [](const string& s) { return s; });
+        } else if (flag == "--bit-depths") {
+            options.bitDepths = parseList<int>(value, [](const string& s) { return stoi(s); });
+        } else if (flag == "--compressors") {
+            options.compressors = parseList<XSPD::Compressor>(value, parseEnum<XSPD::Compressor>);
+        } else if (flag == "--shuffles") {
+            options.shuffleModes =
+                parseList<XSPD::ShuffleMode>(value, parseEnum<XSPD::ShuffleMode>);
+        } else if (flag == "--rates") {
+            options.rates = parseList<double>(value, [](const string& s) { return stod(s); });
+        } else if (flag == "--frames") {
+            options.numFrames = stoi(value);
+        } else if (flag == "--output") {
+            options.outputPath = value;
+        } else {
+            throw invalid_argument("Unknown option " + flag);
+        }
+    }
+    return options;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        fprintf(stderr,
+                "Usage: %s [--layouts L,..] [--bit-depths N,..] [--compressors C,..] "
+                "[--shuffles S,..] [--rates HZ,..] [--frames N] [--output FILE]\n",
+                argv[0]);
+        return 1;
+    }
+
+    json results = json::array();
+    int driverIndex = 0;
+    for (const BenchLayout& layout : benchLayouts) {
+        if (find(options.layouts.begin(), options.layouts.end(), layout.name) ==
+            options.layouts.end())
+            continue;
+
+        // The compressor is read-only in the driver, and read once at startup, so each layout /
+        // compressor pair gets its own driver, and its own fake server.
+        for (XSPD::Compressor compressor : options.compressors) {
+            driverIndex++;
+            string host = "bench" + to_string(driverIndex);
+            string portName = "BENCH" + to_string(driverIndex);
+
+            BenchPublisher publisher;
+            auto api = make_shared<BenchXSPDAPI>(host, layout.samplesPath, "127.0.0.1",
+                                                 publisher.GetPort());
+            api->SetSampleVar("lambda/compressor", getServerCompressorName(compressor));
+            api->SetCommandHandler(
+                [&publisher](const string& command) { publisher.OnCommand(command); });
+            registerSharedAPI(host, 0, "", api);
+
+            // Deleted by its exit handler
+            ADXSPD* pDriver = new ADXSPD(portName.c_str(), host.c_str(), 0);
+            writeInt(portName, ADXSPD_LogLevelString, static_cast<int>(ADXSPDLogLevel::ERROR));
+            writeInt(portName, ADXSPD_DecompressString, 1);
+            writeInt(portName, NDArrayCallbacksString, 1);
+
+            int width, height;
+            asynUser* sizeUser = connectParam(portName, ADMaxSizeXString, false);
+            width = readInt(sizeUser);
+            pasynInt32SyncIO->disconnect(sizeUser);
+            sizeUser = connectParam(portName, ADMaxSizeYString, false);
+            height = readInt(sizeUser);
+            pasynInt32SyncIO->disconnect(sizeUser);
+
+            vector<XSPD::ShuffleMode> shuffleModes = {XSPD::ShuffleMode::NO_SHUFFLE};
+            if (XSPD::IsBloscCompressor(compressor)) shuffleModes = options.shuffleModes;
+
+            for (int bitDepth : options.bitDepths) {
+                for (XSPD::ShuffleMode shuffleMode : shuffleModes) {
+                    for (double rateHz : options.rates) {
+                        json result;
+                        try {
+                            result = runCase(pDriver, portName, publisher, layout, compressor,
+                                             bitDepth, shuffleMode, rateHz, options.numFrames,
+                                             width, height);
+                        } catch (std::exception& e) {
+                            result = {{"layout", layout.name},
+                                      {"bit_depth", bitDepth},
+                                      {"compressor", string(magic_enum::enum_name(compressor))},
+                                      {"shuffle_mode", string(magic_enum::enum_name(shuffleMode))},
+                                      {"rate_hz", rateHz},
+                                      {"error", e.what()}};
+                        }
+                        results.push_back(result);
+                        if (result.contains("error")) {
+                            printf("%-6s %2d bit %-10s %-12s %6.0f Hz: %s\n", layout.name.c_str(),
+                                   bitDepth, magic_enum::enum_name(compressor).data(),
+                                   magic_enum::enum_name(shuffleMode).data(), rateHz,
+                                   result["error"].get<string>().c_str());
+                        } else {
+                            printf(
+                                "%-6s %2d bit %-10s %-12s %6.0f Hz: %8.1f fps, %5.1f%% dropped, "
+                                "%8.1f us CPU/frame, p50 %8.1f us, p99 %8.1f us\n",
+                                layout.name.c_str(), bitDepth,
+                                magic_enum::enum_name(compressor).data(),
+                                magic_enum::enum_name(shuffleMode).data(), rateHz,
+                                result["fps"].get<double>(),
+                                result["drop_rate"].get<double>() * 100,
+                                result["cpu_us_per_frame"].get<double>(),
+                                result["latency"]["total"]["p50_us"].get<double>(),
+                                result["latency"]["total"]["p99_us"].get<double>());
+                        }
+                        fflush(stdout);
+                    }
+                }
+            }
+
+            // The driver outlives the publisher, so stop forwarding commands to it
+            api->SetCommandHandler(nullptr);
+        }
+    }
+
+    std::ofstream output(options.outputPath);
+    output << json({{"results", results}}).dump(4) << std::endl;
+    printf("Wrote %zu results to %s\n", results.size(), options.outputPath.c_str());
+
+    epicsExit(0);
+    return 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * API-layer microbenchmarks for the XSPD API classes
+ *
+ * Times GetVar / SetVar and Initialize() against a fake REST layer serving canned responses from a
+ * sample dump, so that what is measured is the cost of the API layer itself: building request
+ * strings, parsing and copying JSON responses, and converting enum values, with no network
+ * involved. Must be run from the top of the repository, so the sample responses are found.
+ *
+ * Each operation is timed with responses served as text and parsed, as the real REST layer does,
+ * and served as already parsed JSON, which isolates the API layer from JSON parsing. Variable
+ * reads are also timed with the variable cache enabled.
+ *
+ * Usage: BenchAPI [--samples scripts/samples/ten_module_7_5_m.json] [--min-time 0.2]
+ *                 [--repeats 5] [--label NAME] [--output bench_api.json]
+ *                 [--baseline FILE] [--max-regression 10]
+ *
+ * With --baseline, each result is compared to the result of the same name in a previous output
+ * file, and the exit status is non-zero if any got slower by more than --max-regression percent.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#include "BenchXSPDAPI.h"
+
+#define BENCH_HOST "bench"
+#define BENCH_CACHE_TTL 3600.0  // Variable cache TTL when the cache is enabled, in seconds
+#define BENCH_BATCH_SIZE 64     // Calls per clock read, so timer overhead does not dominate
+
+struct APIBenchOptions {
+    string samplesPath = "scripts/samples/ten_module_7_5_m.json";
+    double minTime = 0.2;
+    int repeats = 5;
+    string label;
+    string outputPath = "bench_api.json";
+    string baselinePath;
+    double maxRegression = 10.0;
+};
+
+/**
+ * @brief Runs a function in batches for at least minTime seconds, after one untimed warmup call
+ *
+ * @return double Mean time per call in ns
+ */
+static double timeCalls(const function<void()>& call, double minTime) {
+    call();
+    uint64_t numCalls = 0;
+    auto startTime = chrono::steady_clock::now();
+    double elapsed = 0;
+    while (elapsed < minTime) {
+        for (int i = 0; i < BENCH_BATCH_SIZE; i++) call();
+        numCalls += BENCH_BATCH_SIZE;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    }
+    return elapsed * 1e9 / numCalls;
+}
+
+/**
+ * @brief Times a function that needs a fresh setup before each call, timing only the call
+ *
+ * @param setup Untimed setup, run before each call
+ * @param call The function to time
+ * @return double Mean time per call in ns
+ */
+static double timeCallsWithSetup(const function<void()>& setup, const function<void()>& call,
+                                 double minTime) {
+    setup();
+    call();
+    uint64_t numCalls = 0;
+    double elapsed = 0;
+    while (elapsed < minTime) {
+        setup();
+        auto startTime = chrono::steady_clock::now();
+        call();
+        elapsed += chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        numCalls++;
+    }
+    return elapsed * 1e9 / numCalls;
+}
+
+/**
+ * @brief Times an operation several times, and appends its median and best time per call
+ *
+ * @param time Runs the operation for the minimum time, returning the mean time per call in ns
+ * @param result Fields identifying the operation
+ */
+static void recordResult(const function<double()>& time, int repeats, json result,
+                         json& results) {
+    vector<double> nsPerOp;
+    for (int i = 0; i < repeats; i++) nsPerOp.push_back(time());
+    sort(nsPerOp.begin(), nsPerOp.end());
+
+    result["ns_per_op"] = nsPerOp[nsPerOp.size() / 2];
+    result["ns_per_op_min"] = nsPerOp.front();
+    printf("%-40s %-6s cache %-3s %10.0f ns/op  (min %.0f)\n",
+           result["operation"].get<string>().c_str(), result["responses"].get<string>().c_str(),
+           result["cache"].get<bool>() ? "on" : "off", result["ns_per_op"].get<double>(),
+           result["ns_per_op_min"].get<double>());
+    results.push_back(result);
+}
+
+/**
+ * @brief Times each variable access on an initialized API
+ *
+ * @param samples Sample response dump to serve
+ * @param parseResponses Whether to serve responses as text, parsed on each request
+ * @param cache Whether to enable the variable cache
+ */
+static void benchVars(const json& samples, bool parseResponses, bool cache,
+                      const APIBenchOptions& options, json& results) {
+    BenchXSPDAPI api(BENCH_HOST, samples, "127.0.0.1", 0);
+    api.SetParseResponses(parseResponses);
+    XSPD::Detector* detector = api.Initialize();
+    XSPD::Module* module = detector->GetModules().front();
+    if (cache) api.SetVarCacheTTL(BENCH_CACHE_TTL);
+
+    json base = {{"responses", parseResponses ? "text" : "json"}, {"cache", cache}};
+    auto bench = [&](const string& operation, const function<void()>& call) {
+        json result = base;
+        result["operation"] = operation;
+        recordResult([&] { return timeCalls(call, options.minTime); }, options.repeats, result,
+                     results);
+    };
+
+    // The fake REST layer alone, the floor for every uncached access below
+    string nFramesUri = string(BENCH_HOST) + ":" + to_string(XSPD::DEFAULT_PORT) +
+                        "/api/v1/devices/" + api.GetSampleDeviceId() + "/variables?path=" +
+                        detector->GetId() + "/n_frames";
+    if (!cache)
+        bench("SubmitRequest", [&] { api.SubmitRequest(nFramesUri, XSPD::RequestType::GET); });
+
+    bench("GetVar<int> n_frames", [&] { detector->GetVar<int>("n_frames"); });
+    bench("GetVar<vector<double>> temperature",
+          [&] { module->GetVar<vector<double>>("temperature"); });
+    bench("GetVar<TriggerMode> trigger_mode",
+          [&] { detector->GetVar<XSPD::TriggerMode>("trigger_mode"); });
+    bench("GetVar<Compressor> compressor",
+          [&] { module->GetVar<XSPD::Compressor>("compressor"); });
+
+    // Writes always go to the device, so are only timed once
+    if (cache) return;
+    int nFrames = 1;
+    bench("SetVar<int> n_frames", [&] { detector->SetVar<int>("n_frames", nFrames++ % 100 + 1); });
+    bool byteShuffle = false;
+    bench("SetVar<ShuffleMode> shuffle_mode", [&] {
+        byteShuffle = !byteShuffle;
+        detector->SetVar<XSPD::ShuffleMode>("shuffle_mode",
+                                            byteShuffle ? XSPD::ShuffleMode::SHUFFLE_BYTE
+                                                        : XSPD::ShuffleMode::NO_SHUFFLE);
+    });
+}
+
+/**
+ * @brief Times Initialize() on a fresh API, i.e. full device and topology discovery
+ */
+static void benchInitialize(const json& samples, bool parseResponses,
+                            const APIBenchOptions& options, json& results) {
+    unique_ptr<BenchXSPDAPI> api;
+    json result = {{"operation", "Initialize"},
+                   {"responses", parseResponses ? "text" : "json"},
+                   {"cache", false}};
+    recordResult(
+        [&] {
+            return timeCallsWithSetup(
+                [&] {
+                    api = make_unique<BenchXSPDAPI>(BENCH_HOST, samples, "127.0.0.1", 0);
+                    api->SetParseResponses(parseResponses);
+                },
+                [&] { api->Initialize(); }, options.minTime);
+        },
+        options.repeats, result, results);
+}
+
+static string getResultKey(const json& result) {
+    return result["operation"].get<string>() + "|" + result["responses"].get<string>() + "|" +
+           (result["cache"].get<bool>() ? "cache" : "nocache");
+}
+
+/**
+ * @brief Compares results to those of a previous run
+ *
+ * @return int The number of operations that got slower by more than the allowed regression
+ */
+static int compareToBaseline(const json& results, const APIBenchOptions& options) {
+    std::ifstream file(options.baselinePath);
+    if (!file.is_open()) throw runtime_error("Failed to open baseline " + options.baselinePath);
+    json baseline = json::parse(file);
+
+    map<string, double> baselineNs;
+    for (const auto& result : baseline["results"])
+        baselineNs[getResultKey(result)] = result["ns_per_op"].get<double>();
+
+    printf("\nCompared to %s", options.baselinePath.c_str());
+    if (baseline.contains("label")) printf(" (%s)", baseline["label"].get<string>().c_str());
+    printf(":\n");
+
+    int numRegressions = 0;
+    for (const auto& result : results) {
+        auto previous = baselineNs.find(getResultKey(result));
+        if (previous == baselineNs.end()) continue;
+        double change = 100.0 * (result["ns_per_op"].get<double>() / previous->second - 1.0);
+        bool regressed = change > options.maxRegression;
+        if (regressed) numRegressions++;
+        printf("%-40s %-6s cache %-3s %10.0f -> %10.0f ns/op  %+6.1f%%%s\n",
+               result["operation"].get<string>().c_str(),
+               result["responses"].get<string>().c_str(),
+               result["cache"].get<bool>() ? "on" : "off", previous->second,
+               result["ns_per_op"].get<double>(), change, regressed ? "  REGRESSED" : "");
+    }
+    return numRegressions;
+}
+
+static APIBenchOptions parseOptions(int argc, char** argv) {
+    APIBenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        string flag = argv[i];
+        if (i + 1 >= argc) throw invalid_argument("Missing value for " + flag);
+        string value = argv[++i];
+        if (flag == "--samples") {
+            options.samplesPath = value;
+        } else if (flag == "--min-time") {
+            options.minTime = stod(value);
+        } else if (flag == "--repeats") {
+            options.repeats = max(1, stoi(value));
+        } else if (flag == "--label") {
+            options.label = value;
+        } else if (flag == "--output") {
+            options.outputPath = value;
+        } else if (flag == "--baseline") {
+            options.baselinePath = value;
+        } else if (flag == "--max-regression") {
+            options.maxRegression = stod(value);
+        } else {
+            throw invalid_argument("Unknown option " + flag);
+        }
+    }
+    return options;
+}
+
+int main(int argc, char** argv) {
+    APIBenchOptions options;
+    json samples;
+    try {
+        options = parseOptions(argc, argv);
+        samples = BenchXSPDAPI::LoadSampleResponses(options.samplesPath);
+    } catch (std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        fprintf(stderr,
+                "Usage: %s [--samples FILE] [--min-time S] [--repeats N] [--label NAME] "
+                "[--output FILE] [--baseline FILE] [--max-regression PCT]\n",
+                argv[0]);
+        return 1;
+    }
+
+    printf("Sample responses: %s\n", options.samplesPath.c_str());
+
+    json results = json::array();
+    try {
+        for (bool parseResponses : {true, false}) {
+            benchInitialize(samples, parseResponses, options, results);
+            for (bool cache : {false, true})
+                benchVars(samples, parseResponses, cache, options, results);
+        }
+    } catch (std::exception& e) {
+        fprintf(stderr, "Benchmark failed: %s\n", e.what());
+        return 1;
+    }
+
+    json output = {{"label", options.label},
+                   {"timestamp", (int64_t) time(nullptr)},
+                   {"samples", options.samplesPath},
+                   {"hardware_threads", thread::hardware_concurrency()},
+                   {"results", results}};
+    std::ofstream file(options.outputPath);
+    file << output.dump(4) << std::endl;
+    printf("Wrote %zu results to %s\n", results.size(), options.outputPath.c_str());
+
+    if (!options.baselinePath.empty()) {
+        try {
+            if (compareToBaseline(results, options) > 0) return 2;
+        } catch (std::exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,409 @@
+/*
+ * Decompression and frame kernel microbenchmarks for the ADXSPD driver
+ *
+ * Times the decode paths of the acquisition thread (memcpy passthrough, zlib uncompress, and
+ * blosc_decompress_ctx for every Blosc sub-codec, shuffle mode and thread count) and the frame
+ * kernels in ADXSPDKernels.h, on synthetic frames following the simulator's noise / streak model
+ * at several bit depths and threshold settings, or on a recorded raw frame. Reports throughput in
+ * GB/s of decoded data, and the speedup of each Blosc thread count over a single thread. Each
+ * decode path is timed both as a generic call and through the specialized frame handler the
+ * driver selects for it (ADXSPDFrameHandler.h), with the speedup of the handler. Rotating zlib
+ * frames by 90 degrees is timed both fused into decoding, by a tiled handler, and as a separate
+ * pass after it, as NDPluginTransform would do it, and 24 bit frames are timed converting to
+ * uint16 with saturation.
+ *
+ * Usage: BenchDecode [--bit-depths 1,6,12,24] [--thresholds 1.5,3,6] [--threads 1,2,4,8]
+ *                    [--width 1556] [--height 516] [--raw FILE] [--min-time 0.2]
+ *                    [--output bench_decode.json]
+ *
+ * With --raw, FILE holds a single frame of width x height pixels, in the NDArray data type of the
+ * one bit depth given.
+ *
+ */
+
+#include <blosc.h>
+#include <zlib.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+#include "ADXSPDFrameHandler.h"
+#include "ADXSPDKernels.h"
+#include "BenchFrames.h"
+
+#define BENCH_MIN_ITERATIONS 3  // Timed iterations per measurement, regardless of --min-time
+
+struct DecodeOptions {
+    vector<int> bitDepths = {1, 6, 12, 24};
+    vector<double> thresholds = {1.5, 3.0, 6.0};
+    vector<int> threadCounts = {1, 2, 4, 8};
+    int width = 1556;  // A single Lambda module
+    int height = 516;
+    string rawPath;
+    double minTime = 0.2;
+    string outputPath = "bench_decode.json";
+};
+
+/**
+ * @brief Runs a function repeatedly for at least minTime seconds, after one untimed warmup call
+ *
+ * @return double Mean time per call in seconds
+ */
+static double timeCall(const function<void()>& call, double minTime) {
+    call();
+    int numCalls = 0;
+    auto startTime = chrono::steady_clock::now();
+    double elapsed = 0;
+    while (numCalls < BENCH_MIN_ITERATIONS || elapsed < minTime) {
+        call();
+        numCalls++;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    }
+    return elapsed / numCalls;
+}
+
+/**
+ * @brief Times the frame kernels on frames of pixel type T, accumulating into AccT
+ */
+template <typename T, typename AccT>
+static void benchKernels(const vector<uint8_t>& current, const vector<uint8_t>& previous,
+                         double minTime, json& result, json& results) {
+    size_t numElements = current.size() / sizeof(T);
+    vector<T> output(numElements);
+    vector<AccT> accumulator(numElements);
+
+    double seconds = timeCall(
+        [&] {
+            ADXSPDKernels::SubtractFrames((const T*) current.data(), (const T*) previous.data(),
+                                          output.data(), numElements);
+        },
+        minTime);
+    result["operation"] = "subtract";
+    result["seconds"] = seconds;
+    result["gb_per_s"] = current.size() / seconds / 1e9;
+    results.push_back(result);
+
+    seconds = timeCall(
+        [&] {
+            ADXSPDKernels::AccumulateFrame((const T*) current.data(), accumulator.data(),
+                                           numElements);
+        },
+        minTime);
+    result["operation"] = "accumulate";
+    result["seconds"] = seconds;
+    result["gb_per_s"] = current.size() / seconds / 1e9;
+    results.push_back(result);
+
+    if constexpr (is_same_v<T, uint32_t>) {
+        // 24 bit frames output as UInt16, saturating and counting saturated pixels
+        vector<uint16_t> converted(numElements);
+        seconds = timeCall(
+            [&] {
+                ADXSPDKernels::ConvertPixels((const T*) current.data(), converted.data(),
+                                             numElements);
+            },
+            minTime);
+        result["operation"] = "convert uint16";
+        result["seconds"] = seconds;
+        result["gb_per_s"] = current.size() / seconds / 1e9;
+        results.push_back(result);
+    }
+}
+
+/**
+ * @brief Times rotating zlib frames of pixel type T by 90 degrees, as a separate pass after
+ * decoding and fused into decoding
+ */
+template <typename T>
+static void benchTransform(const vector<uint8_t>& frame, int bitDepth, const DecodeOptions& options,
+                           json& result, json& results) {
+    vector<uint8_t> encoded =
+        BenchFrames::Encode(frame, bitDepth, XSPD::Compressor::ZLIB, XSPD::ShuffleMode::NO_SHUFFLE);
+    vector<uint8_t> decoded(frame.size()), output(frame.size());
+    size_t width = options.width, height = options.height;
+
+    ADXSPDFrameFormat format;
+    format.bitDepth = bitDepth;
+    format.compressor = XSPD::Compressor::ZLIB;
+    format.width = options.width;
+    format.height = options.height;
+    auto handler = ADXSPDFrameHandler::Create(format);
+    double separateSeconds = timeCall(
+        [&] {
+            handler->Decode(encoded.data(), encoded.size(), decoded.data(), decoded.size());
+            const T* input = (const T*) decoded.data();
+            T* rotated = (T*) output.data();
+            for (size_t y = 0; y < height; y++)
+                for (size_t x = 0; x < width; x++)
+                    rotated[x * height + height - 1 - y] = input[y * width + x];
+        },
+        options.minTime);
+
+    format.transform = ADXSPDFrameTransform::ROT90;
+    auto fusedHandler = ADXSPDFrameHandler::Create(format);
+    double seconds = timeCall(
+        [&] {
+            fusedHandler->Decode(encoded.data(), encoded.size(), decoded.data(), decoded.size());
+        },
+        options.minTime);
+    result["operation"] = "zlib rot90";
+    result["separate_seconds"] = separateSeconds;
+    result["seconds"] = seconds;
+    result["gb_per_s"] = frame.size() / seconds / 1e9;
+    result["speedup"] = separateSeconds / seconds;
+    if (decoded != output) result["error"] = "fused and separate rotations do not match";
+    results.push_back(result);
+}
+
+/**
+ * @brief Times every decode path and kernel on one frame, appending the results
+ *
+ * @param frame Raw frame
+ * @param previous A second raw frame of the same size, the other input of the kernels
+ * @param base Fields identifying the frame, copied into each result
+ */
+static void benchFrame(const vector<uint8_t>& frame, const vector<uint8_t>& previous, int bitDepth,
+                       const DecodeOptions& options, const json& base, json& results) {
+    vector<uint8_t> output(frame.size());
+
+    for (XSPD::Compressor compressor : magic_enum::enum_values<XSPD::Compressor>()) {
+        vector<XSPD::ShuffleMode> shuffleModes = {XSPD::ShuffleMode::NO_SHUFFLE};
+        vector<int> threadCounts = {1};
+        if (XSPD::IsBloscCompressor(compressor)) {
+            shuffleModes = {XSPD::ShuffleMode::NO_SHUFFLE, XSPD::ShuffleMode::SHUFFLE_BYTE,
+                            XSPD::ShuffleMode::SHUFFLE_BIT};
+            threadCounts = options.threadCounts;
+        }
+
+        for (XSPD::ShuffleMode shuffleMode : shuffleModes) {
+            json result = base;
+            result["operation"] = "decode";
+            result["codec"] = string(magic_enum::enum_name(compressor));
+            result["shuffle_mode"] = string(magic_enum::enum_name(shuffleMode));
+
+            vector<uint8_t> encoded;
+            try {
+                encoded = BenchFrames::Encode(frame, bitDepth, compressor, shuffleMode);
+            } catch (std::exception& e) {
+                // e.g. a Blosc sub-codec that was not built into the library
+                result["error"] = e.what();
+                results.push_back(result);
+                continue;
+            }
+            result["input_bytes"] = encoded.size();
+            result["output_bytes"] = frame.size();
+            result["ratio"] = (double) frame.size() / encoded.size();
+
+            double firstSeconds = 0;
+            for (int numThreads : threadCounts) {
+                function<void()> decode;
+                if (compressor == XSPD::Compressor::NONE) {
+                    decode = [&] { memcpy(output.data(), encoded.data(), encoded.size()); };
+                } else if (compressor == XSPD::Compressor::ZLIB) {
+                    decode = [&] {
+                        uLongf decodedSize = output.size();
+                        uncompress(output.data(), &decodedSize, encoded.data(), encoded.size());
+                    };
+                } else {
+                    decode = [&, numThreads] {
+                        blosc_decompress_ctx(encoded.data(), output.data(), output.size(),
+                                             numThreads);
+                    };
+                }
+
+                // Make sure the path under test actually round trips before timing it
+                memset(output.data(), 0xFF, output.size());
+                decode();
+                if (output != frame) {
+                    result["error"] = "decoded frame does not match the original";
+                    results.push_back(result);
+                    break;
+                }
+
+                double seconds = timeCall(decode, options.minTime);
+                result["seconds"] = seconds;
+                result["gb_per_s"] = frame.size() / seconds / 1e9;
+
+                // The same path through the handler, which keeps its decompression state
+                ADXSPDFrameFormat format;
+                format.bitDepth = bitDepth;
+                format.compressor = compressor;
+                format.shuffleMode = shuffleMode;
+                format.numThreads = numThreads;
+                auto handler = ADXSPDFrameHandler::Create(format);
+                double handlerSeconds = timeCall(
+                    [&] {
+                        handler->Decode(encoded.data(), encoded.size(), output.data(),
+                                        output.size());
+                    },
+                    options.minTime);
+                result["handler_seconds"] = handlerSeconds;
+                result["handler_gb_per_s"] = frame.size() / handlerSeconds / 1e9;
+                result["handler_speedup"] = seconds / handlerSeconds;
+                if (XSPD::IsBloscCompressor(compressor)) {
+                    // Scaling is relative to the first thread count, normally 1
+                    if (numThreads == threadCounts.front()) firstSeconds = seconds;
+                    result["threads"] = numThreads;
+                    result["speedup"] = firstSeconds / seconds;
+                }
+                results.push_back(result);
+            }
+        }
+    }
+
+    json kernelResult = base, transformResult = base;
+    switch (BenchFrames::GetBytesPerPixel(bitDepth)) {
+        case 1:
+            benchKernels<uint8_t, uint32_t>(frame, previous, options.minTime, kernelResult,
+                                            results);
+            benchTransform<uint8_t>(frame, bitDepth, options, transformResult, results);
+            break;
+        case 2:
+            benchKernels<uint16_t, uint32_t>(frame, previous, options.minTime, kernelResult,
+                                             results);
+            benchTransform<uint16_t>(frame, bitDepth, options, transformResult, results);
+            break;
+        default:
+            benchKernels<uint32_t, uint64_t>(frame, previous, options.minTime, kernelResult,
+                                             results);
+            benchTransform<uint32_t>(frame, bitDepth, options, transformResult, results);
+            break;
+    }
+}
+
+static void printResult(const json& result) {
+    string label = result["operation"].get<string>();
+    if (result.contains("codec")) label = result["codec"].get<string>();
+    if (result.contains("threads")) label += " " + result["shuffle_mode"].get<string>();
+
+    char threshold[16] = "raw";
+    if (!result["threshold_kev"].is_null())
+        snprintf(threshold, sizeof(threshold), "%.1f", result["threshold_kev"].get<double>());
+    printf("%2d bit %4s keV %-26s", result["bit_depth"].get<int>(), threshold, label.c_str());
+
+    if (result.contains("error")) {
+        printf(" %s\n", result["error"].get<string>().c_str());
+        return;
+    }
+    if (result.contains("threads"))
+        printf(" %2d threads", result["threads"].get<int>());
+    else
+        printf("           ");
+    printf(" %8.2f GB/s", result["gb_per_s"].get<double>());
+    if (result.contains("ratio")) printf("  ratio %6.2f", result["ratio"].get<double>());
+    if (result.contains("speedup")) printf("  x%.2f", result["speedup"].get<double>());
+    if (result.contains("handler_speedup"))
+        printf("  handler %8.2f GB/s x%.2f", result["handler_gb_per_s"].get<double>(),
+               result["handler_speedup"].get<double>());
+    printf("\n");
+}
+
+template <typename T>
+static vector<T> parseList(const string& arg, function<T(const string&)> parse) {
+    vector<T> values;
+    stringstream stream(arg);
+    string item;
+    while (getline(stream, item, ',')) values.push_back(parse(item));
+    return values;
+}
+
+static DecodeOptions parseOptions(int argc, char** argv) {
+    DecodeOptions options;
+    for (int i = 1; i < argc; i++) {
+        string flag = argv[i];
+        if (i + 1 >= argc) throw invalid_argument("Missing value for " + flag);
+        string value = argv[++i];
+        if (flag == "--bit-depths") {
+            options.bitDepths = parseList<int>(value, [](const string& s) { return stoi(s); });
+        } else if (flag == "--thresholds") {
+            options.thresholds =
+                parseList<double>(value, [](const string& s) { return stod(s); });
+        } else if (flag == "--threads") {
+            options.threadCounts = parseList<int>(value, [](const string& s) { return stoi(s); });
+        } else if (flag == "--width") {
+            options.width = stoi(value);
+        } else if (flag == "--height") {
+            options.height = stoi(value);
+        } else if (flag == "--raw") {
+            options.rawPath = value;
+        } else if (flag == "--min-time") {
+            options.minTime = stod(value);
+        } else if (flag == "--output") {
+            options.outputPath = value;
+        } else {
+            throw invalid_argument("Unknown option " + flag);
+        }
+    }
+    if (!options.rawPath.empty() && options.bitDepths.size() != 1)
+        throw invalid_argument("--raw requires a single bit depth");
+    return options;
+}
+
+int main(int argc, char** argv) {
+    DecodeOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        fprintf(stderr,
+                "Usage: %s [--bit-depths N,..] [--thresholds KEV,..] [--threads N,..] "
+                "[--width W] [--height H] [--raw FILE] [--min-time S] [--output FILE]\n",
+                argv[0]);
+        return 1;
+    }
+
+    printf("%u hardware threads, %d x %d frames\n", thread::hardware_concurrency(), options.width,
+           options.height);
+
+    json results = json::array();
+    for (int bitDepth : options.bitDepths) {
+        json base = {{"bit_depth", bitDepth}, {"width", options.width}, {"height", options.height}};
+        size_t frameSize =
+            (size_t) options.width * options.height * BenchFrames::GetBytesPerPixel(bitDepth);
+
+        if (!options.rawPath.empty()) {
+            std::ifstream file(options.rawPath, std::ios::binary);
+            vector<uint8_t> frame(frameSize);
+            if (!file.read((char*) frame.data(), frameSize)) {
+                fprintf(stderr, "Failed to read %zu bytes from %s\n", frameSize,
+                        options.rawPath.c_str());
+                return 1;
+            }
+            base["threshold_kev"] = nullptr;
+            base["source"] = options.rawPath;
+            // Kernels take the frame and its reversed copy, so they see realistic pixel values
+            vector<uint8_t> previous(frame.rbegin(), frame.rend());
+            size_t firstResult = results.size();
+            benchFrame(frame, previous, bitDepth, options, base, results);
+            for (size_t i = firstResult; i < results.size(); i++) printResult(results[i]);
+            continue;
+        }
+
+        for (double threshold : options.thresholds) {
+            double occupancy = BenchFrames::GetOccupancy(threshold);
+            base["threshold_kev"] = threshold;
+            base["occupancy"] = occupancy;
+            vector<uint8_t> frame = BenchFrames::Generate(options.width, options.height, bitDepth,
+                                                          1, occupancy);
+            vector<uint8_t> previous = BenchFrames::Generate(options.width, options.height,
+                                                             bitDepth, 2, occupancy);
+            size_t firstResult = results.size();
+            benchFrame(frame, previous, bitDepth, options, base, results);
+            for (size_t i = firstResult; i < results.size(); i++) printResult(results[i]);
+        }
+    }
+
+    std::ofstream output(options.outputPath);
+    output << json({{"hardware_threads", thread::hardware_concurrency()}, {"results", results}})
+                  .dump(4)
+           << std::endl;
+    printf("Wrote %zu results to %s\n", results.size(), options.outputPath.c_str());
+    return 0;
+}
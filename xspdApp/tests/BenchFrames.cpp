@@ -0,0 +1,168 @@
+#include "BenchFrames.h"
+
+#include <blosc.h>
+#include <zlib.h>
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * @brief Small, fast PRNG (xorshift64*), so that generating large frames takes a fraction of the
+ * time spent decoding them.
+ */
+class BenchRandom {
+   public:
+    explicit BenchRandom(uint64_t seed) : state(seed * 2685821657736338717ull + 1) {}
+
+    uint64_t Next() {
+        this->state ^= this->state >> 12;
+        this->state ^= this->state << 25;
+        this->state ^= this->state >> 27;
+        return this->state * 2685821657736338717ull;
+    }
+
+    // Uniform in [0, 1)
+    double NextDouble() { return (this->Next() >> 11) * (1.0 / 9007199254740992.0); }
+
+   private:
+    uint64_t state;
+};
+
+/**
+ * @brief Gets the size of a pixel in the NDArray data type the driver uses for a bit depth
+ */
+size_t BenchFrames::GetBytesPerPixel(int bitDepth) {
+    if (bitDepth <= 8) return 1;
+    if (bitDepth <= 16) return 2;
+    return 4;
+}
+
+/**
+ * @brief Gets the fraction of pixels with a non-zero count at a lower threshold setting, following
+ * the model of generate_module_image in scripts/xspdSimulator.py: most pixels see noise below 2
+ * keV, falling off exponentially to nearly empty frames above 5 keV.
+ */
+double BenchFrames::GetOccupancy(double thresholdKeV) {
+    if (thresholdKeV < 2.0) return 0.8;
+    if (thresholdKeV <= 5.0) return 0.8 * exp(-0.864 * (thresholdKeV - 2.0));
+    return 0.06 * exp(-2.5 * (thresholdKeV - 5.0));
+}
+
+template <typename T>
+static void fillFrame(T* pixels, int width, int height, int bitDepth, BenchRandom& random,
+                      double occupancy) {
+    uint32_t maxValue = (uint32_t) ((1ull << bitDepth) - 1);
+    uint32_t maxCount = maxValue < 64 ? maxValue : 64;
+
+    // Sparse, low photon counts, as at a typical threshold setting
+    size_t numPixels = (size_t) width * height;
+    for (size_t i = 0; i < numPixels; i++) {
+        if (random.NextDouble() < occupancy)
+            pixels[i] = (T) (1 + random.Next() % maxCount);
+        else
+            pixels[i] = 0;
+    }
+
+    // A few bright, roughly straight streaks, like cosmic rays
+    int numStreaks = (int) (random.Next() % 4);
+    for (int streak = 0; streak < numStreaks; streak++) {
+        double x = (double) (random.Next() % width), y = (double) (random.Next() % height);
+        double angle = random.NextDouble() * 2 * M_PI;
+        int length = 5 + (int) (random.Next() % 96);
+        for (int step = 0; step < length; step++) {
+            x += cos(angle);
+            y += sin(angle);
+            if (x < 0 || y < 0 || x >= width || y >= height) break;
+            uint32_t value = maxValue / 3 + (uint32_t) (random.Next() % (maxValue - maxValue / 3));
+            pixels[(size_t) y * width + (size_t) x] = (T) value;
+        }
+    }
+}
+
+/**
+ * @brief Generates a frame of sparse photon counts with a few streaks
+ *
+ * @param width Frame width in pixels
+ * @param height Frame height in pixels
+ * @param bitDepth Detector bit depth, e.g. 6, 12 or 24. Pixel values never exceed it.
+ * @param seed Seed for the frame contents. Frames with the same seed are identical.
+ * @param occupancy Fraction of pixels with a non-zero count
+ * @return vector<uint8_t> Raw pixel data, in the NDArray data type for the bit depth
+ */
+vector<uint8_t> BenchFrames::Generate(int width, int height, int bitDepth, uint64_t seed,
+                                      double occupancy) {
+    if (bitDepth < 1 || bitDepth > 32)
+        throw invalid_argument("Unsupported bit depth " + to_string(bitDepth));
+
+    BenchRandom random(seed);
+    vector<uint8_t> frame((size_t) width * height * GetBytesPerPixel(bitDepth));
+    switch (GetBytesPerPixel(bitDepth)) {
+        case 1:
+            fillFrame((uint8_t*) frame.data(), width, height, bitDepth, random, occupancy);
+            break;
+        case 2:
+            fillFrame((uint16_t*) frame.data(), width, height, bitDepth, random, occupancy);
+            break;
+        default:
+            fillFrame((uint32_t*) frame.data(), width, height, bitDepth, random, occupancy);
+            break;
+    }
+    return frame;
+}
+
+/**
+ * @brief Encodes a frame as the XSPD server publishes it with the given compression settings
+ *
+ * @param frame Raw pixel data
+ * @param bitDepth Detector bit depth, which sets the element size used for shuffling
+ * @param compressor Compressor to encode with
+ * @param shuffleMode Shuffle filter applied before Blosc compression. Ignored for other
+ * compressors.
+ * @param compressionLevel Compression level, 0-9
+ * @return vector<uint8_t> The encoded frame
+ */
+vector<uint8_t> BenchFrames::Encode(const vector<uint8_t>& frame, int bitDepth,
+                                    XSPD::Compressor compressor, XSPD::ShuffleMode shuffleMode,
+                                    int compressionLevel) {
+    if (compressor == XSPD::Compressor::NONE) return frame;
+
+    vector<uint8_t> encoded;
+    if (compressor == XSPD::Compressor::ZLIB) {
+        uLongf encodedSize = compressBound(frame.size());
+        encoded.resize(encodedSize);
+        int zlibStatus = compress2(encoded.data(), &encodedSize, frame.data(), frame.size(),
+                                   compressionLevel);
+        if (zlibStatus != Z_OK)
+            throw runtime_error("zlib compression failed with status " + to_string(zlibStatus));
+        encoded.resize(encodedSize);
+        return encoded;
+    }
+
+    size_t typeSize = GetBytesPerPixel(bitDepth);
+    int shuffle;
+    switch (shuffleMode) {
+        case XSPD::ShuffleMode::SHUFFLE_BYTE:
+            shuffle = BLOSC_SHUFFLE;
+            break;
+        case XSPD::ShuffleMode::SHUFFLE_BIT:
+            shuffle = BLOSC_BITSHUFFLE;
+            break;
+        case XSPD::ShuffleMode::AUTO_SHUFFLE:
+            shuffle = typeSize > 1 ? BLOSC_SHUFFLE : BLOSC_BITSHUFFLE;
+            break;
+        default:
+            shuffle = BLOSC_NOSHUFFLE;
+            break;
+    }
+
+    encoded.resize(frame.size() + BLOSC_MAX_OVERHEAD);
+    string subcompressor = XSPD::GetBloscSubcompressorName(compressor);
+    int encodedSize =
+        blosc_compress_ctx(compressionLevel, shuffle, typeSize, frame.size(), frame.data(),
+                           encoded.data(), encoded.size(), subcompressor.c_str(), 0, 1);
+    if (encodedSize <= 0)
+        throw runtime_error("Blosc compression failed with status " + to_string(encodedSize));
+    encoded.resize(encodedSize);
+    return encoded;
+}
@@ -0,0 +1,27 @@
+#ifndef BENCH_FRAMES_H
+#define BENCH_FRAMES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "XSPDAPI.h"
+
+/**
+ * @brief Synthetic detector frames for benchmarks, and encoding them as the XSPD server would
+ * before publishing them on a data port.
+ */
+class BenchFrames {
+   public:
+    static size_t GetBytesPerPixel(int bitDepth);
+    static double GetOccupancy(double thresholdKeV);
+
+    static vector<uint8_t> Generate(int width, int height, int bitDepth, uint64_t seed,
+                                    double occupancy = 0.05);
+
+    static vector<uint8_t> Encode(const vector<uint8_t>& frame, int bitDepth,
+                                  XSPD::Compressor compressor, XSPD::ShuffleMode shuffleMode,
+                                  int compressionLevel = 2);
+};
+
+#endif  // BENCH_FRAMES_H
@@ -0,0 +1,127 @@
+#include "BenchXSPDAPI.h"
+
+#include <fstream>
+
+/**
+ * @brief Loads a sample response dump, e.g. scripts/samples/single_module_xsp_sim.json
+ */
+json BenchXSPDAPI::LoadSampleResponses(string sampleResponsesPath) {
+    std::ifstream file(sampleResponsesPath);
+    if (!file.is_open())
+        throw std::runtime_error("Failed to open sample responses JSON file at " +
+                                 sampleResponsesPath);
+    return json::parse(file);
+}
+
+/**
+ * @brief Construct a new fake XSPD API, serving responses from a sample dump
+ *
+ * @param hostname Host name the drivers connect to. Only used to build request URIs.
+ * @param sampleResponsesPath Path to a sample response dump, e.g.
+ * scripts/samples/single_module_xsp_sim.json
+ * @param dataPortIp Address the data ports in the dump are rewritten to
+ * @param dataPortPort Port the data ports in the dump are rewritten to
+ */
+BenchXSPDAPI::BenchXSPDAPI(string hostname, string sampleResponsesPath, string dataPortIp,
+                           int dataPortPort)
+    : BenchXSPDAPI(hostname, LoadSampleResponses(sampleResponsesPath), dataPortIp, dataPortPort) {}
+
+/**
+ * @brief Construct a new fake XSPD API from an already loaded sample dump, so that many APIs can
+ * be created without reading the file each time.
+ */
+BenchXSPDAPI::BenchXSPDAPI(string hostname, json sampleResponses, string dataPortIp,
+                           int dataPortPort)
+    : XSPD::API(hostname, XSPD::DEFAULT_PORT), sampleResponses(std::move(sampleResponses)) {
+    this->sampleDeviceId = this->sampleResponses["api/v1/devices"]["devices"][0]["id"];
+
+    // Point the data ports at the publisher the benchmark runs, rather than the real detector
+    json& deviceResponse = this->sampleResponses["api/v1/devices/" + this->sampleDeviceId];
+    for (auto& dataPort : deviceResponse["system"]["data-ports"]) {
+        dataPort["ip"] = dataPortIp;
+        dataPort["port"] = dataPortPort;
+    }
+}
+
+void BenchXSPDAPI::SetCommandHandler(function<void(const string&)> handler) {
+    lock_guard<mutex> lock(this->responsesMutex);
+    this->commandHandler = handler;
+}
+
+void BenchXSPDAPI::SetSampleVar(string varPath, json value) {
+    lock_guard<mutex> lock(this->responsesMutex);
+    string key = "api/v1/devices/" + this->sampleDeviceId + "/variables?path=" + varPath;
+    if (!this->sampleResponses.contains(key))
+        throw std::invalid_argument("Variable " + varPath + " not found in sample responses");
+    this->sampleResponses[key]["value"] = value;
+    this->responseTexts.erase(key);
+}
+
+void BenchXSPDAPI::SetParseResponses(bool parseResponses) {
+    lock_guard<mutex> lock(this->responsesMutex);
+    this->parseResponses = parseResponses;
+}
+
+/**
+ * @brief Answers a request from the sample dump. Variable writes update the stored response, so
+ * later reads return the new value, and commands are passed to the command handler. When parsing
+ * responses, the stored response is returned as the real REST layer would, by parsing its text.
+ *
+ * @param uri Full request URI, e.g. bench:8008/api/v1/devices/lambda01/variables?path=x&value=1
+ * @param reqType Request type
+ * @return json The stored response
+ */
+json BenchXSPDAPI::SubmitRequest(string uri, XSPD::RequestType reqType) {
+    string endpoint = uri.substr(uri.find('/') + 1);
+
+    function<void(const string&)> handler;
+    string command;
+    json response;
+    string responseText;
+    {
+        lock_guard<mutex> lock(this->responsesMutex);
+        if (reqType == XSPD::RequestType::PUT && endpoint.find("/commands?path=") != string::npos) {
+            command = endpoint.substr(endpoint.find('=') + 1);
+            handler = this->commandHandler;
+            response = {{"path", command}};
+        } else if (reqType == XSPD::RequestType::PUT) {
+            size_t valuePos = endpoint.find("&value=");
+            string key = endpoint.substr(0, valuePos);
+            if (valuePos == string::npos || !this->sampleResponses.contains(key))
+                throw std::runtime_error("Failed to put data to " + uri);
+
+            // Values are sent unquoted, so anything that is not valid JSON is an enum name
+            string newValue = endpoint.substr(valuePos + 7);
+            if (key.find("thresholds") != string::npos) newValue = "[" + newValue + "]";
+            json newValueJson = json::parse(newValue, nullptr, false);
+            if (newValueJson.is_discarded()) newValueJson = newValue;
+
+            this->sampleResponses[key]["value"] = newValueJson;
+            this->responseTexts.erase(key);
+            endpoint = key;
+        } else if (!this->sampleResponses.contains(endpoint)) {
+            throw std::runtime_error("Failed to get data from " + uri);
+        }
+
+
+        if (command.empty() && this->parseResponses) {
+            // Serialized once per value, so only the parse is paid on each request
+            auto text = this->responseTexts.find(endpoint);
+            if (text == this->responseTexts.end())
+                text = this->responseTexts.emplace(endpoint, this->sampleResponses[endpoint].dump())
+                           .first;
+            responseText = text->second;
+        } else if (command.empty()) {
+            response = this->sampleResponses[endpoint];
+        }
+    }
+
+    if (!responseText.empty()) {
+        this->RecordBytesReceived(uri, reqType, responseText.size());
+        return json::parse(responseText, nullptr, true, false, true);
+    }
+
+    // Called without the lock held, so the handler may make requests of its own
+    if (handler) handler(command);
+    return response;
+}
@@ -0,0 +1,45 @@
+#ifndef BENCH_XSPDAPI_H
+#define BENCH_XSPDAPI_H
+
+#include <functional>
+#include <map>
+#include <mutex>
+
+#include "XSPDAPI.h"
+
+/**
+ * @brief Fake XSPD REST layer for benchmarks. Answers requests from a sample response dump
+ * (see scripts/samples), applies variable writes so that readbacks match, and forwards commands
+ * such as start / stop to a handler, which plays the part of the detector. Unlike MockXSPDAPI it
+ * sets no expectations, so any number of requests may be made in any order, from any thread.
+ */
+class BenchXSPDAPI : public XSPD::API {
+   public:
+    BenchXSPDAPI(string hostname, string sampleResponsesPath, string dataPortIp, int dataPortPort);
+    BenchXSPDAPI(string hostname, json sampleResponses, string dataPortIp, int dataPortPort);
+
+    static json LoadSampleResponses(string sampleResponsesPath);
+
+    json SubmitRequest(string uri, XSPD::RequestType reqType) override;
+
+    // Called with the path of each command executed, e.g. "lambda/start". Must not block.
+    void SetCommandHandler(function<void(const string&)> handler);
+
+    // Sets the value of a variable of the sample device, e.g. one the driver cannot write
+    void SetSampleVar(string varPath, json value);
+
+    string GetSampleDeviceId() const { return this->sampleDeviceId; }
+
+    // Serve responses as text and parse each one, as the real REST layer does. Off by default.
+    void SetParseResponses(bool parseResponses);
+
+   private:
+    mutex responsesMutex;
+    json sampleResponses;
+    map<string, string> responseTexts;  // Serialized responses, when parsing responses
+    string sampleDeviceId;               // ID of the first device in the dump
+    bool parseResponses = false;
+    function<void(const string&)> commandHandler;
+};
+
+#endif  // BENCH_XSPDAPI_H
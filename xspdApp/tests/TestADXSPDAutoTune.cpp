@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "ADXSPDAutoTune.h"
+
+class TestADXSPDAutoTune : public ::testing::Test {
+   protected:
+    // Measures a series of 100 frames of 1 MB received 1 ms apart, i.e. 1 GB/s of decoded data, so
+    // that a decode time of 1 ms per frame is 100% utilization
+    optional<ADXSPDTuneDecision> runSeries(const ADXSPDTuneSetting& setting, double ratio,
+                                           double utilization, int bitDepth = 12,
+                                           int numFrames = 100) {
+        this->tuner.StartSeries(setting, bitDepth);
+        auto startTime = chrono::steady_clock::now();
+        for (int i = 0; i < numFrames; i++) {
+            this->tuner.RecordFrame((uint64_t) (1000000 / ratio), 1000000,
+                                    (uint64_t) (utilization * 1e6),
+                                    startTime + chrono::milliseconds(i));
+        }
+        return this->tuner.EndSeries();
+    }
+
+    static ADXSPDTuneSetting withThreads(ADXSPDTuneSetting setting, int numThreads) {
+        setting.numThreads = numThreads;
+        return setting;
+    }
+
+    ADXSPDAutoTuner tuner{0.5, 8};
+};
+
+TEST_F(TestADXSPDAutoTune, TestTriesStrongerCompressionWithHeadroom) {
+    auto decision = this->runSeries(ADXSPDAutoTuner::ladder[0], 1.0, 0.05);
+    ASSERT_TRUE(decision.has_value());
+    ASSERT_TRUE(decision->setting.SameCodec(ADXSPDAutoTuner::ladder[1]));
+    ASSERT_NE(decision->reason.find("under the 50% target"), string::npos);
+
+    auto observation = this->tuner.GetObservation(ADXSPDAutoTuner::ladder[0], 12);
+    ASSERT_TRUE(observation.has_value());
+    ASSERT_NEAR(observation->ratio, 1.0, 1e-6);
+    ASSERT_NEAR(observation->decodeNsPerByte, 0.05, 1e-6);
+}
+
+TEST_F(TestADXSPDAutoTune, TestAddsThreadsOverTarget) {
+    ADXSPDTuneSetting zstd = ADXSPDAutoTuner::ladder[4];
+    auto decision = this->runSeries(zstd, 5.0, 0.9);
+    ASSERT_TRUE(decision.has_value());
+    ASSERT_EQ(decision->setting, withThreads(zstd, 2));
+    ASSERT_NE(decision->reason.find("over the 50% target"), string::npos);
+
+    // Thread counts are capped, after which the best setting measured is used
+    this->tuner.SetMaxThreads(2);
+    this->runSeries(ADXSPDAutoTuner::ladder[3], 4.0, 0.2);
+    decision = this->runSeries(withThreads(zstd, 2), 5.0, 0.6);
+    ASSERT_TRUE(decision.has_value());
+    ASSERT_TRUE(decision->setting.SameCodec(ADXSPDAutoTuner::ladder[3]));
+    ASSERT_NE(decision->reason.find("Best measured"), string::npos);
+}
+
+TEST_F(TestADXSPDAutoTune, TestPicksBestRatioUnderTarget) {
+    this->runSeries(ADXSPDAutoTuner::ladder[0], 1.0, 0.05);
+    this->runSeries(ADXSPDAutoTuner::ladder[1], 3.0, 0.1);
+    this->runSeries(ADXSPDAutoTuner::ladder[2], 4.0, 0.3);
+    this->runSeries(ADXSPDAutoTuner::ladder[3], 4.5, 0.45);
+    auto decision = this->runSeries(ADXSPDAutoTuner::ladder[4], 5.0, 0.7);
+    ASSERT_TRUE(decision.has_value());
+    // Over the target with one thread, so more threads are tried first
+    ASSERT_EQ(decision->setting, withThreads(ADXSPDAutoTuner::ladder[4], 2));
+
+    decision = this->runSeries(withThreads(ADXSPDAutoTuner::ladder[4], 2), 5.0, 0.55);
+    ASSERT_EQ(decision->setting, withThreads(ADXSPDAutoTuner::ladder[4], 4));
+    decision = this->runSeries(withThreads(ADXSPDAutoTuner::ladder[4], 4), 5.0, 0.3);
+    ASSERT_TRUE(decision.has_value());
+    ASSERT_EQ(decision->setting, withThreads(ADXSPDAutoTuner::ladder[4], 4));
+    ASSERT_NE(decision->reason.find("ratio 5.00"), string::npos);
+}
+
+TEST_F(TestADXSPDAutoTune, TestNothingUnderTarget) {
+    this->tuner.SetMaxThreads(1);
+    this->runSeries(ADXSPDAutoTuner::ladder[1], 3.0, 0.8);
+    this->runSeries(ADXSPDAutoTuner::ladder[0], 1.0, 0.6);
+    auto decision = this->runSeries(ADXSPDAutoTuner::ladder[2], 4.0, 0.9);
+    ASSERT_TRUE(decision.has_value());
+    ASSERT_TRUE(decision->setting.SameCodec(ADXSPDAutoTuner::ladder[0]));
+    ASSERT_NE(decision->reason.find("No measured setting"), string::npos);
+}
+
+TEST_F(TestADXSPDAutoTune, TestBitDepthsMeasuredSeparately) {
+    this->runSeries(ADXSPDAutoTuner::ladder[1], 3.0, 0.1, 12);
+    ASSERT_TRUE(this->tuner.GetObservation(ADXSPDAutoTuner::ladder[1], 12).has_value());
+    ASSERT_FALSE(this->tuner.GetObservation(ADXSPDAutoTuner::ladder[1], 24).has_value());
+
+    this->tuner.Reset();
+    ASSERT_FALSE(this->tuner.GetObservation(ADXSPDAutoTuner::ladder[1], 12).has_value());
+}
+
+TEST_F(TestADXSPDAutoTune, TestShortSeriesIgnored) {
+    ASSERT_FALSE(this->runSeries(ADXSPDAutoTuner::ladder[1], 3.0, 0.1, 12, 5).has_value());
+    ASSERT_FALSE(this->tuner.GetObservation(ADXSPDAutoTuner::ladder[1], 12).has_value());
+    ASSERT_FALSE(this->tuner.EndSeries().has_value());
+}
+
+TEST_F(TestADXSPDAutoTune, TestLadderSettingsValid) {
+    // Auto-tuning writes these straight to the detector's compressor bindings, which are not
+    // writable from records, so each must be a combination the detector accepts
+    for (auto& setting : ADXSPDAutoTuner::ladder) {
+        if (setting.compressor == XSPD::Compressor::NONE) {
+            ASSERT_EQ(setting.level, 0);
+            ASSERT_EQ(setting.shuffleMode, XSPD::ShuffleMode::NO_SHUFFLE);
+        } else {
+            ASSERT_TRUE(XSPD::IsBloscCompressor(setting.compressor));
+            ASSERT_GE(setting.level, 1);
+            ASSERT_LE(setting.level, 9);
+        }
+        ASSERT_EQ(setting.numThreads, 1);
+    }
+}
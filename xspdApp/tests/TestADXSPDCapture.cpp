@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "ADXSPDCapture.h"
+
+class TestADXSPDCapture : public ::testing::Test {
+   protected:
+    void TearDown() override {
+        remove(this->capturePath.c_str());
+        remove((this->capturePath + ".idx").c_str());
+    }
+
+    // Writes numFrames three part messages, as published by a data port, received 1 ms apart
+    void writeFrames(ADXSPDCaptureWriter& writer, int numFrames) {
+        auto startTime = chrono::steady_clock::now();
+        for (int frame = 0; frame < numFrames; frame++) {
+            uint8_t header[4] = {(uint8_t) frame, 0, 0, 0};
+            string payload(100 + frame, (char) ('a' + frame % 26));
+            ADXSPDCapturePart parts[3] = {
+                {"", 0}, {header, sizeof(header)}, {payload.data(), payload.size()}};
+            writer.Append(parts, 3, startTime + chrono::milliseconds(frame));
+        }
+    }
+
+    static string partString(const ADXSPDCapturePart& part) {
+        return string((const char*) part.data, part.size);
+    }
+
+    string capturePath = "TestADXSPDCapture.cap";
+};
+
+TEST_F(TestADXSPDCapture, TestRoundTrip) {
+    {
+        ADXSPDCaptureWriter writer(this->capturePath);
+        this->writeFrames(writer, 10);
+        ASSERT_EQ(writer.GetNumRecords(), 10u);
+    }
+
+    ADXSPDCaptureReader reader(this->capturePath);
+    ASSERT_EQ(reader.GetNumRecords(), 10u);
+    ASSERT_GT(reader.GetStartTimeNs(), 0);
+    for (size_t i = 0; i < reader.GetNumRecords(); i++) {
+        ADXSPDCaptureRecord record = reader.GetRecord(i);
+        ASSERT_EQ(record.parts.size(), 3u);
+        ASSERT_EQ(record.parts[0].size, 0u);
+        ASSERT_EQ(record.parts[1].size, 4u);
+        ASSERT_EQ(((const uint8_t*) record.parts[1].data)[0], i);
+        ASSERT_EQ(partString(record.parts[2]), string(100 + i, (char) ('a' + i % 26)));
+    }
+    ASSERT_THROW(reader.GetRecord(10), out_of_range);
+}
+
+TEST_F(TestADXSPDCapture, TestSeek) {
+    {
+        ADXSPDCaptureWriter writer(this->capturePath);
+        this->writeFrames(writer, 10);
+    }
+
+    ADXSPDCaptureReader reader(this->capturePath);
+    uint64_t firstNs = reader.GetRecord(0).receivedNs;
+    ASSERT_EQ(reader.GetDurationNs() - firstNs, 9000000u);
+    ASSERT_EQ(reader.FindRecord(0), 0u);
+    ASSERT_EQ(reader.FindRecord(firstNs + 3000000), 3u);
+    ASSERT_EQ(reader.FindRecord(firstNs + 3000001), 4u);
+    ASSERT_EQ(reader.FindRecord(firstNs + 10000000), 10u);
+}
+
+TEST_F(TestADXSPDCapture, TestReadWhileWriting) {
+    ADXSPDCaptureWriter writer(this->capturePath);
+    this->writeFrames(writer, 5);
+
+    // Records appended so far are readable before the capture is closed, from the header alone
+    remove((this->capturePath + ".idx").c_str());
+    ADXSPDCaptureReader reader(this->capturePath);
+    ASSERT_EQ(reader.GetNumRecords(), 5u);
+    ASSERT_EQ(partString(reader.GetRecord(4).parts[2]), string(104, 'e'));
+}
+
+TEST_F(TestADXSPDCapture, TestTruncatedIndex) {
+    {
+        ADXSPDCaptureWriter writer(this->capturePath);
+        this->writeFrames(writer, 8);
+    }
+
+    // Drop the last few index entries, as if the IOC stopped before they were flushed
+    string indexPath = this->capturePath + ".idx";
+    std::ifstream indexIn(indexPath, std::ios::binary);
+    string index((std::istreambuf_iterator<char>(indexIn)), std::istreambuf_iterator<char>());
+    indexIn.close();
+    std::ofstream indexOut(indexPath, std::ios::binary | std::ios::trunc);
+    indexOut.write(index.data(), 3 * sizeof(ADXSPDCaptureIndexEntry));
+    indexOut.close();
+
+    ADXSPDCaptureReader reader(this->capturePath);
+    ASSERT_EQ(reader.GetNumRecords(), 8u);
+    ASSERT_EQ(partString(reader.GetRecord(7).parts[2]), string(107, 'h'));
+}
+
+TEST_F(TestADXSPDCapture, TestNotACapture) {
+    std::ofstream file(this->capturePath);
+    file << string(128, 'x');
+    file.close();
+    ASSERT_THROW(ADXSPDCaptureReader reader(this->capturePath), runtime_error);
+    ASSERT_THROW(ADXSPDCaptureReader reader("not_a_capture.cap"), runtime_error);
+}
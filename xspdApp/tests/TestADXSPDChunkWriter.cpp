@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include <hdf5.h>
+#include <zlib.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ADXSPDAutoTune.h"
+#include "ADXSPDChunkWriter.h"
+
+#define TEST_WIDTH 16
+#define TEST_HEIGHT 8
+
+class TestADXSPDChunkWriter : public ::testing::Test {
+   protected:
+    void TearDown() override { remove(this->filePath.c_str()); }
+
+    // A 16 bit frame whose pixels depend on the frame index
+    static vector<uint16_t> makeFrame(int index) {
+        vector<uint16_t> frame(TEST_WIDTH * TEST_HEIGHT);
+        for (size_t i = 0; i < frame.size(); i++) frame[i] = (uint16_t) (index * 7 + i % 13);
+        return frame;
+    }
+
+    static string zlibCompress(const vector<uint16_t>& frame) {
+        uLongf size = compressBound(frame.size() * sizeof(uint16_t));
+        string compressed(size, '\0');
+        compress2((Bytef*) &compressed[0], &size, (const Bytef*) frame.data(),
+                  frame.size() * sizeof(uint16_t), 3);
+        compressed.resize(size);
+        return compressed;
+    }
+
+    static ADXSPDChunkFrameInfo frameInfo(int index) {
+        return {(uint8_t) index, (uint8_t) (index % 2), 0, 1000.0 + index};
+    }
+
+    string filePath = "TestADXSPDChunkWriter.h5";
+};
+
+TEST_F(TestADXSPDChunkWriter, TestZlibRoundTrip) {
+    int numFrames = 5;
+    {
+        ADXSPDChunkWriter writer(this->filePath, TEST_WIDTH, TEST_HEIGHT, 2,
+                                 XSPD::Compressor::ZLIB, XSPD::ShuffleMode::NO_SHUFFLE, 3);
+        for (int i = 0; i < numFrames; i++) {
+            string payload = zlibCompress(makeFrame(i));
+            writer.WriteFrame(payload.data(), payload.size(), frameInfo(i));
+        }
+        ASSERT_EQ(writer.GetNumFrames(), (uint64_t) numFrames);
+    }
+
+    // Chunks written directly decompress through HDF5's own deflate filter
+    hid_t file = H5Fopen(this->filePath.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    ASSERT_GE(file, 0);
+    hid_t dataset = H5Dopen2(file, "/entry/data/data", H5P_DEFAULT);
+    hid_t space = H5Dget_space(dataset);
+    hsize_t dims[3];
+    H5Sget_simple_extent_dims(space, dims, nullptr);
+    ASSERT_EQ(dims[0], (hsize_t) numFrames);
+    ASSERT_EQ(dims[1], (hsize_t) TEST_HEIGHT);
+    ASSERT_EQ(dims[2], (hsize_t) TEST_WIDTH);
+
+    vector<uint16_t> data(numFrames * TEST_WIDTH * TEST_HEIGHT);
+    ASSERT_GE(H5Dread(dataset, H5T_NATIVE_UINT16, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data()), 0);
+    for (int i = 0; i < numFrames; i++) {
+        vector<uint16_t> expected = makeFrame(i);
+        ASSERT_EQ(memcmp(&data[i * expected.size()], expected.data(), expected.size() * 2), 0);
+    }
+
+    H5Sclose(space);
+    H5Dclose(dataset);
+    H5Fclose(file);
+}
+
+TEST_F(TestADXSPDChunkWriter, TestBloscFilterMetadata) {
+    // Blosc chunks are stored exactly as received, so any payload will do here
+    string payload = "blosc compressed frame";
+    {
+        ADXSPDChunkWriter writer(this->filePath, TEST_WIDTH, TEST_HEIGHT, 2,
+                                 XSPD::Compressor::BLOSC_LZ4, XSPD::ShuffleMode::SHUFFLE_BIT, 5);
+        writer.WriteFrame(payload.data(), payload.size(), frameInfo(0));
+    }
+
+    hid_t file = H5Fopen(this->filePath.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t dataset = H5Dopen2(file, "/entry/data/data", H5P_DEFAULT);
+    hid_t dcpl = H5Dget_create_plist(dataset);
+    unsigned int flags;
+    size_t numValues = 7;
+    unsigned int cdValues[7];
+    ASSERT_GE(H5Pget_filter_by_id2(dcpl, ADXSPD_CHUNK_BLOSC_FILTER_ID, &flags, &numValues,
+                                   cdValues, 0, nullptr, nullptr),
+              0);
+    ASSERT_EQ(numValues, 7u);
+    ASSERT_EQ(cdValues[2], 2u);
+    ASSERT_EQ(cdValues[3], (unsigned int) (TEST_WIDTH * TEST_HEIGHT * 2));
+    ASSERT_EQ(cdValues[4], 5u);
+    ASSERT_EQ(cdValues[5], (unsigned int) XSPD::ShuffleMode::SHUFFLE_BIT);
+    ASSERT_EQ(cdValues[6],
+              (unsigned int) XSPD::GetBloscSubcompressorId(XSPD::Compressor::BLOSC_LZ4));
+
+    hsize_t offset[3] = {0, 0, 0};
+    hsize_t chunkSize;
+    ASSERT_GE(H5Dget_chunk_storage_size(dataset, offset, &chunkSize), 0);
+    ASSERT_EQ(chunkSize, payload.size());
+    string chunk(chunkSize, '\0');
+    uint32_t filterMask;
+    ASSERT_GE(H5Dread_chunk(dataset, H5P_DEFAULT, offset, &filterMask, &chunk[0]), 0);
+    ASSERT_EQ(chunk, payload);
+
+    H5Pclose(dcpl);
+    H5Dclose(dataset);
+    H5Fclose(file);
+}
+
+TEST_F(TestADXSPDChunkWriter, TestTunedSettingFilterMetadata) {
+    // An uncompressed series with plenty of decode headroom makes the tuner pick a blosc setting,
+    // which the driver applies before opening the writer for the next series
+    ADXSPDAutoTuner tuner;
+    tuner.StartSeries(ADXSPDAutoTuner::ladder[0], 16);
+    auto startTime = chrono::steady_clock::now();
+    for (int i = 0; i < ADXSPD_TUNE_MIN_FRAMES; i++)
+        tuner.RecordFrame(1000000, 1000000, 1000, startTime + chrono::milliseconds(i));
+    optional<ADXSPDTuneDecision> decision = tuner.EndSeries();
+    ASSERT_TRUE(decision.has_value());
+    const ADXSPDTuneSetting& setting = decision->setting;
+    ASSERT_TRUE(XSPD::IsBloscCompressor(setting.compressor));
+
+    string payload = "blosc compressed frame";
+    {
+        ADXSPDChunkWriter writer(this->filePath, TEST_WIDTH, TEST_HEIGHT, 2, setting.compressor,
+                                 setting.shuffleMode, setting.level);
+        writer.WriteFrame(payload.data(), payload.size(), frameInfo(0));
+    }
+
+    hid_t file = H5Fopen(this->filePath.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t dataset = H5Dopen2(file, "/entry/data/data", H5P_DEFAULT);
+    hid_t dcpl = H5Dget_create_plist(dataset);
+    unsigned int flags;
+    size_t numValues = 7;
+    unsigned int cdValues[7];
+    ASSERT_GE(H5Pget_filter_by_id2(dcpl, ADXSPD_CHUNK_BLOSC_FILTER_ID, &flags, &numValues,
+                                   cdValues, 0, nullptr, nullptr),
+              0);
+    ASSERT_EQ(cdValues[4], (unsigned int) setting.level);
+    ASSERT_EQ(cdValues[5], (unsigned int) setting.shuffleMode);
+    ASSERT_EQ(cdValues[6], (unsigned int) XSPD::GetBloscSubcompressorId(setting.compressor));
+
+    H5Pclose(dcpl);
+    H5Dclose(dataset);
+    H5Fclose(file);
+}
+
+TEST_F(TestADXSPDChunkWriter, TestFrameAttributes) {
+    // More frames than are buffered or pre-allocated at once, so both are exercised
+    int numFrames = ADXSPD_CHUNK_ATTR_BATCH + 100;
+    {
+        ADXSPDChunkWriter writer(this->filePath, TEST_WIDTH, TEST_HEIGHT, 2,
+                                 XSPD::Compressor::NONE, XSPD::ShuffleMode::NO_SHUFFLE, 0);
+        for (int i = 0; i < numFrames; i++) {
+            vector<uint16_t> frame = makeFrame(i);
+            writer.WriteFrame(frame.data(), frame.size() * 2, frameInfo(i));
+        }
+        vector<uint16_t> shortFrame(10);
+        ASSERT_THROW(writer.WriteFrame(shortFrame.data(), 20, frameInfo(0)), invalid_argument);
+        ASSERT_EQ(writer.GetNumFrames(), (uint64_t) numFrames);
+    }
+
+    hid_t file = H5Fopen(this->filePath.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t dataset = H5Dopen2(file, "/entry/instrument/NDAttributes/TimeStamp", H5P_DEFAULT);
+    hid_t space = H5Dget_space(dataset);
+    hsize_t dims[1];
+    H5Sget_simple_extent_dims(space, dims, nullptr);
+    ASSERT_EQ(dims[0], (hsize_t) numFrames);
+    vector<double> timeStamps(numFrames);
+    H5Dread(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, timeStamps.data());
+    for (int i = 0; i < numFrames; i++) ASSERT_EQ(timeStamps[i], 1000.0 + i);
+    H5Sclose(space);
+    H5Dclose(dataset);
+
+    dataset = H5Dopen2(file, "/entry/instrument/NDAttributes/CompressedSize", H5P_DEFAULT);
+    vector<uint32_t> sizes(numFrames);
+    H5Dread(dataset, H5T_NATIVE_UINT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, sizes.data());
+    ASSERT_EQ(sizes.back(), (uint32_t) (TEST_WIDTH * TEST_HEIGHT * 2));
+    H5Dclose(dataset);
+
+    dataset = H5Dopen2(file, "/entry/data/data", H5P_DEFAULT);
+    space = H5Dget_space(dataset);
+    hsize_t frameDims[3];
+    H5Sget_simple_extent_dims(space, frameDims, nullptr);
+    ASSERT_EQ(frameDims[0], (hsize_t) numFrames);
+    H5Sclose(space);
+    H5Dclose(dataset);
+    H5Fclose(file);
+}
+
+TEST_F(TestADXSPDChunkWriter, TestInvalidFrameSize) {
+    ASSERT_THROW(ADXSPDChunkWriter writer(this->filePath, TEST_WIDTH, TEST_HEIGHT, 3,
+                                          XSPD::Compressor::NONE, XSPD::ShuffleMode::NO_SHUFFLE, 0),
+                 invalid_argument);
+    ASSERT_THROW(ADXSPDChunkWriter writer("no_such_dir/file.h5", TEST_WIDTH, TEST_HEIGHT, 2,
+                                          XSPD::Compressor::NONE, XSPD::ShuffleMode::NO_SHUFFLE, 0),
+                 runtime_error);
+}
@@ -0,0 +1,309 @@
+#include <gtest/gtest.h>
+#include <zlib.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ADXSPDFrameHandler.h"
+
+class TestADXSPDFrameHandler : public ::testing::Test {
+   protected:
+    // A 16 bit frame whose pixels depend on the seed
+    static vector<uint16_t> makeFrame(int seed, size_t numPixels = 1024) {
+        vector<uint16_t> frame(numPixels);
+        for (size_t i = 0; i < frame.size(); i++) frame[i] = (uint16_t) (seed * 31 + i % 17);
+        return frame;
+    }
+
+    template <typename T>
+    static string zlibCompress(const vector<T>& frame) {
+        uLongf size = compressBound(frame.size() * sizeof(T));
+        string compressed(size, '\0');
+        compress2((Bytef*) &compressed[0], &size, (const Bytef*) frame.data(),
+                  frame.size() * sizeof(T), 3);
+        compressed.resize(size);
+        return compressed;
+    }
+
+    static ADXSPDFrameFormat zlibFormat() {
+        ADXSPDFrameFormat format;
+        format.compressor = XSPD::Compressor::ZLIB;
+        return format;
+    }
+
+    // Decodes the 3x2 frame [[1, 2, 3], [4, 5, 6]] with a transform
+    static vector<uint16_t> transformSmallFrame(ADXSPDFrameTransform transform) {
+        ADXSPDFrameFormat format;
+        format.width = 3;
+        format.height = 2;
+        format.transform = transform;
+        auto handler = ADXSPDFrameHandler::Create(format);
+        vector<uint16_t> input = {1, 2, 3, 4, 5, 6}, output(6);
+        EXPECT_EQ(handler->Decode(input.data(), 12, output.data(), 12), 12u);
+        return output;
+    }
+};
+
+TEST_F(TestADXSPDFrameHandler, TestInflateReusesStream) {
+    auto handler = ADXSPDFrameHandler::Create(zlibFormat());
+    ASSERT_EQ(handler->GetFormat().GetDecodePath(), ADXSPDDecodePath::INFLATE);
+    ASSERT_EQ(handler->GetName(), "uint16 inflate");
+
+    // The same handler decodes one frame after another
+    for (int i = 0; i < 3; i++) {
+        vector<uint16_t> expected = makeFrame(i);
+        string payload = zlibCompress(expected);
+        vector<uint16_t> frame(expected.size());
+        size_t decodedBytes =
+            handler->Decode(payload.data(), payload.size(), frame.data(), frame.size() * 2);
+        ASSERT_EQ(decodedBytes, frame.size() * 2);
+        ASSERT_EQ(frame, expected);
+    }
+}
+
+TEST_F(TestADXSPDFrameHandler, TestInflateErrors) {
+    auto handler = ADXSPDFrameHandler::Create(zlibFormat());
+    string payload = zlibCompress(makeFrame(1));
+
+    // Frame buffers too small or too large for the payload
+    vector<uint16_t> frame(2048);
+    ASSERT_THROW(handler->Decode(payload.data(), payload.size(), frame.data(), 1024),
+                 runtime_error);
+    ASSERT_THROW(handler->Decode(payload.data(), payload.size(), frame.data(), 4096),
+                 runtime_error);
+
+    string corrupt = payload;
+    corrupt[4] ^= 0xFF;
+    corrupt[5] ^= 0xFF;
+    ASSERT_THROW(handler->Decode(corrupt.data(), corrupt.size(), frame.data(), 2048),
+                 runtime_error);
+
+    // A failed frame leaves the handler usable for the next
+    ASSERT_EQ(handler->Decode(payload.data(), payload.size(), frame.data(), 2048), 2048u);
+}
+
+TEST_F(TestADXSPDFrameHandler, TestCopyAndPassthrough) {
+    ADXSPDFrameFormat format;
+    format.bitDepth = 24;
+    auto handler = ADXSPDFrameHandler::Create(format);
+    ASSERT_EQ(handler->GetName(), "uint32 copy");
+    vector<uint32_t> input = {1, 2, 3, 4}, output(4);
+    ASSERT_EQ(handler->Decode(input.data(), 16, output.data(), 16), 16u);
+    ASSERT_EQ(output, input);
+    ASSERT_THROW(handler->Decode(input.data(), 16, output.data(), 12), invalid_argument);
+
+    // Compressed payloads not decompressed are copied as they are
+    format = zlibFormat();
+    format.decompress = false;
+    handler = ADXSPDFrameHandler::Create(format);
+    ASSERT_EQ(handler->GetName(), "uint16 passthrough");
+    string payload = zlibCompress(makeFrame(2));
+    vector<uint16_t> frame(1024);
+    ASSERT_EQ(handler->Decode(payload.data(), payload.size(), frame.data(), 2048), payload.size());
+    ASSERT_EQ(memcmp(frame.data(), payload.data(), payload.size()), 0);
+}
+
+TEST_F(TestADXSPDFrameHandler, TestHandlerTable) {
+    for (int bitDepth : {1, 6, 12, 24}) {
+        for (XSPD::Compressor compressor : magic_enum::enum_values<XSPD::Compressor>()) {
+            for (bool decompress : {true, false}) {
+                ADXSPDFrameFormat format;
+                format.bitDepth = bitDepth;
+                format.compressor = compressor;
+                format.decompress = decompress;
+                format.numThreads = 4;
+                auto handler = ADXSPDFrameHandler::Create(format);
+                ASSERT_NE(handler, nullptr);
+                ASSERT_EQ(handler->GetFormat().bitDepth, bitDepth);
+            }
+        }
+    }
+
+    ADXSPDFrameFormat format;
+    format.compressor = XSPD::Compressor::BLOSC_ZSTD;
+    format.numThreads = 4;
+    ASSERT_EQ(ADXSPDFrameHandler::Create(format)->GetName(), "uint16 blosc, 4 threads");
+
+    format.bitDepth = 16;
+    ASSERT_THROW(ADXSPDFrameHandler::Create(format), invalid_argument);
+}
+
+TEST_F(TestADXSPDFrameHandler, TestTransforms) {
+    using Transform = ADXSPDFrameTransform;
+    ASSERT_EQ(transformSmallFrame(Transform::NONE), vector<uint16_t>({1, 2, 3, 4, 5, 6}));
+    ASSERT_EQ(transformSmallFrame(Transform::ROT90), vector<uint16_t>({4, 1, 5, 2, 6, 3}));
+    ASSERT_EQ(transformSmallFrame(Transform::ROT180), vector<uint16_t>({6, 5, 4, 3, 2, 1}));
+    ASSERT_EQ(transformSmallFrame(Transform::ROT270), vector<uint16_t>({3, 6, 2, 5, 1, 4}));
+    ASSERT_EQ(transformSmallFrame(Transform::MIRROR), vector<uint16_t>({3, 2, 1, 6, 5, 4}));
+    ASSERT_EQ(transformSmallFrame(Transform::ROT90_MIRROR), vector<uint16_t>({1, 4, 2, 5, 3, 6}));
+    ASSERT_EQ(transformSmallFrame(Transform::ROT180_MIRROR),
+              vector<uint16_t>({4, 5, 6, 1, 2, 3}));
+    ASSERT_EQ(transformSmallFrame(Transform::ROT270_MIRROR),
+              vector<uint16_t>({6, 3, 5, 2, 4, 1}));
+
+    ADXSPDFrameFormat format;
+    format.width = 3;
+    format.height = 2;
+    format.transform = Transform::ROT90;
+    ASSERT_EQ(format.GetOutputWidth(), 2);
+    ASSERT_EQ(format.GetOutputHeight(), 3);
+    ASSERT_EQ(ADXSPDFrameHandler::Create(format)->GetName(), "uint16 copy, rot90 to uint16");
+}
+
+TEST_F(TestADXSPDFrameHandler, TestInflateTransformed) {
+    // Large enough for several bands of rows and tiles of columns, neither a multiple of the tile
+    const int width = 150, height = 131;
+    vector<uint16_t> input = makeFrame(3, width * height);
+    for (size_t i = 0; i < input.size(); i++) input[i] += (uint16_t) (i / 7);
+    string payload = zlibCompress(input);
+
+    ADXSPDFrameFormat format = zlibFormat();
+    format.width = width;
+    format.height = height;
+    format.transform = ADXSPDFrameTransform::ROT90;
+    auto handler = ADXSPDFrameHandler::Create(format);
+
+    vector<uint16_t> expected(input.size());
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            expected[x * height + height - 1 - y] = input[y * width + x];
+
+    for (int i = 0; i < 2; i++) {
+        vector<uint16_t> output(input.size());
+        ASSERT_EQ(handler->Decode(payload.data(), payload.size(), output.data(), output.size() * 2),
+                  output.size() * 2);
+        ASSERT_EQ(output, expected);
+    }
+
+    // Frames of the wrong size are rejected, and the stream is reset for the next frame
+    vector<uint16_t> output(input.size() + 1);
+    string shortPayload = zlibCompress(makeFrame(3, width * height - 1));
+    ASSERT_THROW(handler->Decode(shortPayload.data(), shortPayload.size(), output.data(),
+                                 output.size() * 2),
+                 runtime_error);
+    string longPayload = zlibCompress(makeFrame(3, width * height + 1));
+    ASSERT_THROW(handler->Decode(longPayload.data(), longPayload.size(), output.data(),
+                                 output.size() * 2),
+                 runtime_error);
+    ASSERT_EQ(handler->Decode(payload.data(), payload.size(), output.data(), output.size() * 2),
+              input.size() * 2);
+}
+
+TEST_F(TestADXSPDFrameHandler, TestConversions) {
+    ADXSPDFrameFormat format;
+    format.bitDepth = 24;
+    format.width = 2;
+    format.height = 2;
+    format.outputType = ADXSPDPixelType::UINT16;
+    auto handler = ADXSPDFrameHandler::Create(format);
+    ASSERT_EQ(handler->GetName(), "uint32 copy, none to uint16");
+    vector<uint32_t> input = {1, 65535, 65536, 1 << 23};
+    vector<uint16_t> output(4);
+    ASSERT_EQ(handler->Decode(input.data(), 16, output.data(), 8), 8u);
+    ASSERT_EQ(output, vector<uint16_t>({1, 65535, 65535, 65535}));
+    ASSERT_THROW(handler->Decode(input.data(), 16, output.data(), 6), invalid_argument);
+
+    format = zlibFormat();
+    format.width = 32;
+    format.height = 32;
+    format.transform = ADXSPDFrameTransform::MIRROR;
+    format.outputType = ADXSPDPixelType::FLOAT32;
+    handler = ADXSPDFrameHandler::Create(format);
+    vector<uint16_t> frame = makeFrame(4);
+    string payload = zlibCompress(frame);
+    vector<float> converted(frame.size());
+    ASSERT_EQ(handler->Decode(payload.data(), payload.size(), converted.data(), 4096), 4096u);
+    for (int y = 0; y < 32; y++)
+        for (int x = 0; x < 32; x++) ASSERT_EQ(converted[y * 32 + 31 - x], frame[y * 32 + x]);
+
+    // Native output is the input type, so needs no tiled handler
+    format.outputType = ADXSPDPixelType::UINT16;
+    format.transform = ADXSPDFrameTransform::NONE;
+    ASSERT_FALSE(format.IsTiled());
+    ASSERT_EQ(ADXSPDFrameHandler::GetPixelSize(format.GetOutputType()), 2u);
+    ASSERT_THROW(ADXSPDFrameHandler::GetPixelSize(ADXSPDPixelType::NATIVE), invalid_argument);
+
+    // Frames passed on compressed cannot be transformed, nor frames of unknown size
+    format.transform = ADXSPDFrameTransform::ROT180;
+    format.decompress = false;
+    ASSERT_THROW(ADXSPDFrameHandler::Create(format), invalid_argument);
+    format.decompress = true;
+    format.width = 0;
+    ASSERT_THROW(ADXSPDFrameHandler::Create(format), invalid_argument);
+}
+
+TEST_F(TestADXSPDFrameHandler, TestSaturationCounted) {
+    ADXSPDFrameFormat format = zlibFormat();
+    format.bitDepth = 24;
+    format.width = 100;
+    format.height = 70;
+    format.outputType = ADXSPDPixelType::UINT16;
+    ASSERT_TRUE(format.CanSaturate());
+
+    // Every 10th pixel is over the uint16 maximum
+    vector<uint32_t> input(format.width * format.height);
+    for (size_t i = 0; i < input.size(); i++) input[i] = i % 10 == 0 ? 70000 + i : i % 60000;
+    string payload = zlibCompress(input);
+    vector<uint16_t> output(input.size());
+
+    // Counted both when rows are converted whole and when written out a tile at a time
+    for (auto transform : {ADXSPDFrameTransform::NONE, ADXSPDFrameTransform::ROT90}) {
+        format.transform = transform;
+        auto handler = ADXSPDFrameHandler::Create(format);
+        for (int i = 0; i < 2; i++) {
+            handler->Decode(payload.data(), payload.size(), output.data(), output.size() * 2);
+            ASSERT_EQ(handler->GetNumSaturated(), input.size() / 10);
+        }
+    }
+
+    // Frames that are not narrowed never saturate
+    format.outputType = ADXSPDPixelType::FLOAT32;
+    ASSERT_FALSE(format.CanSaturate());
+    format.outputType = ADXSPDPixelType::NATIVE;
+    ASSERT_FALSE(format.CanSaturate());
+    auto handler = ADXSPDFrameHandler::Create(format);
+    vector<uint32_t> copy(input.size());
+    handler->Decode(payload.data(), payload.size(), copy.data(), copy.size() * 4);
+    ASSERT_EQ(handler->GetNumSaturated(), 0u);
+}
+
+TEST_F(TestADXSPDFrameHandler, TestSaturationFallbackBetweenSeries) {
+    ADXSPDSaturationGuard guard;
+    ADXSPDFrameFormat format;
+    format.bitDepth = 24;
+
+    // Runs a series of 5 frames of 10000 pixels with UInt16 output and a 0.5% limit, returning the
+    // output type of each frame
+    auto runSeries = [&](uint64_t numSaturated) {
+        guard.StartSeries();
+        vector<ADXSPDPixelType> outputTypes;
+        for (int i = 0; i < 5; i++) {
+            format.outputType = guard.GetOutputType(ADXSPDPixelType::UINT16);
+            outputTypes.push_back(format.GetOutputType());
+            if (format.CanSaturate()) guard.RecordFrame(10000, numSaturated, 0.5);
+        }
+        return outputTypes;
+    };
+    auto allOf = [](ADXSPDPixelType type) { return vector<ADXSPDPixelType>(5, type); };
+
+    // Going over the limit does not change the type within the series, only from the next
+    ASSERT_EQ(runSeries(100), allOf(ADXSPDPixelType::UINT16));
+    ASSERT_TRUE(guard.IsFallbackPending());
+    ASSERT_FALSE(guard.IsFallback());
+    ASSERT_EQ(runSeries(100), allOf(ADXSPDPixelType::UINT32));
+    ASSERT_TRUE(guard.IsFallback());
+
+    // The fallback stays until reset, and a reset also waits for the next series
+    ASSERT_EQ(runSeries(0), allOf(ADXSPDPixelType::UINT32));
+    guard.RequestReset();
+    ASSERT_EQ(guard.GetOutputType(ADXSPDPixelType::UINT16), ADXSPDPixelType::NATIVE);
+    ASSERT_EQ(runSeries(10), allOf(ADXSPDPixelType::UINT16));
+    ASSERT_FALSE(guard.IsFallbackPending());
+
+    // With the limit disabled there is no fallback
+    ASSERT_FALSE(guard.StartSeries());
+    ASSERT_FALSE(guard.RecordFrame(10000, 10000, 0));
+    ASSERT_FALSE(guard.StartSeries());
+    ASSERT_FALSE(guard.IsFallback());
+}
@@ -0,0 +1,32 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "ADXSPDKernels.h"
+
+TEST(TestADXSPDKernels, TestSubtractFloorsAtZero) {
+    std::vector<uint16_t> current = {5, 10, 0, 65535};
+    std::vector<uint16_t> previous = {3, 12, 0, 1};
+    std::vector<uint16_t> output(4);
+    ADXSPDKernels::SubtractFrames(current.data(), previous.data(), output.data(), 4);
+    ASSERT_EQ(output, (std::vector<uint16_t>{2, 0, 0, 65534}));
+}
+
+TEST(TestADXSPDKernels, TestAccumulateWidens) {
+    std::vector<uint8_t> frame = {255, 1, 0};
+    std::vector<uint32_t> accumulator(3);
+    for (int i = 0; i < 10; i++)
+        ADXSPDKernels::AccumulateFrame(frame.data(), accumulator.data(), 3);
+    ASSERT_EQ(accumulator, (std::vector<uint32_t>{2550, 10, 0}));
+}
+
+TEST(TestADXSPDKernels, TestConvertSaturates) {
+    std::vector<uint32_t> frame = {0, 1000, 65535, 65536, 16777215};
+    std::vector<uint16_t> narrow(5);
+    ASSERT_EQ(ADXSPDKernels::ConvertPixels(frame.data(), narrow.data(), 5), 2u);
+    ASSERT_EQ(narrow, (std::vector<uint16_t>{0, 1000, 65535, 65535, 65535}));
+
+    std::vector<float> wide(5);
+    ASSERT_EQ(ADXSPDKernels::ConvertPixels(frame.data(), wide.data(), 5), 0u);
+    ASSERT_EQ(wide, (std::vector<float>{0.0f, 1000.0f, 65535.0f, 65536.0f, 16777215.0f}));
+}
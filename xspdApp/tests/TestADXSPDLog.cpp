@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ADXSPDLog.h"
+
+static mutex capturedMutex;
+static vector<string> capturedLines;
+
+static void captureLine(ADXSPDLogLevel, const char* line) {
+    lock_guard<mutex> lock(capturedMutex);
+    capturedLines.push_back(line);
+}
+
+class TestADXSPDLog : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        ADXSPDLog::Flush();
+        ADXSPDLog::SetSink(captureLine);
+        lock_guard<mutex> lock(capturedMutex);
+        capturedLines.clear();
+    }
+
+    void TearDown() override {
+        ADXSPDLog::Flush();
+        ADXSPDLog::SetSink(nullptr);
+    }
+
+    vector<string> getLines() {
+        ADXSPDLog::Flush();
+        lock_guard<mutex> lock(capturedMutex);
+        return capturedLines;
+    }
+};
+
+TEST_F(TestADXSPDLog, TestMessageFormat) {
+    static ADXSPDLogSite site(ADXSPDLogLevel::WARNING, "ADXSPD", "testFunc");
+    ASSERT_TRUE(site.Allow());
+    ADXSPDLog::Write(site, "value is %d", 42);
+
+    vector<string> lines = this->getLines();
+    ASSERT_EQ(lines.size(), 1u);
+    ASSERT_EQ(lines[0], "WARNING | ADXSPD::testFunc: value is 42");
+}
+
+TEST_F(TestADXSPDLog, TestRateLimitPerSite) {
+    // Sites that suppress messages are checked by the logging thread, so must not go out of scope
+    static ADXSPDLogSite noisySite(ADXSPDLogLevel::ERROR, "ADXSPD", "noisy");
+    static ADXSPDLogSite quietSite(ADXSPDLogLevel::ERROR, "ADXSPD", "quiet");
+
+    int numAllowed = 0;
+    for (int i = 0; i < ADXSPD_LOG_RATE_LIMIT + 30; i++) {
+        if (noisySite.Allow()) {
+            ADXSPDLog::Write(noisySite, "message %d", i);
+            numAllowed++;
+        }
+    }
+    ASSERT_EQ(numAllowed, ADXSPD_LOG_RATE_LIMIT);
+
+    // Other call sites are limited independently
+    ASSERT_TRUE(quietSite.Allow());
+    ADXSPDLog::Write(quietSite, "%s", "still logged");
+    ASSERT_EQ(this->getLines().size(), (size_t) ADXSPD_LOG_RATE_LIMIT + 1);
+
+    // Once the rate window has passed, the suppressed messages are summarized
+    this_thread::sleep_for(chrono::milliseconds(ADXSPD_LOG_RATE_WINDOW_MS + 50));
+    ADXSPDLog::Flush();
+    this_thread::sleep_for(chrono::milliseconds(5 * ADXSPD_LOG_DRAIN_INTERVAL_MS));
+
+    vector<string> lines = this->getLines();
+    ASSERT_EQ(lines.size(), (size_t) ADXSPD_LOG_RATE_LIMIT + 2);
+    ASSERT_EQ(lines.back(), "ERROR | ADXSPD::noisy: suppressed 30 messages");
+
+    ASSERT_TRUE(noisySite.Allow());
+}
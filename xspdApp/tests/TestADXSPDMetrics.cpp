@@ -0,0 +1,102 @@
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include "ADXSPDMetrics.h"
+
+TEST(TestADXSPDMetrics, TestRenderGroupsFamilies) {
+    ADXSPDMetricsWriter writer;
+    writer.Counter("xspd_frames_total", "Frames received", {{"port", "XSPD1"}}, 12);
+    writer.Gauge("xspd_rate_hz", "Frame rate", {}, 2.5);
+    writer.Counter("xspd_frames_total", "Frames received", {{"port", "XSPD2"}}, 1e12);
+
+    ASSERT_EQ(writer.Render(),
+              "# HELP xspd_frames_total Frames received\n"
+              "# TYPE xspd_frames_total counter\n"
+              "xspd_frames_total{port=\"XSPD1\"} 12\n"
+              "xspd_frames_total{port=\"XSPD2\"} 1000000000000\n"
+              "# HELP xspd_rate_hz Frame rate\n"
+              "# TYPE xspd_rate_hz gauge\n"
+              "xspd_rate_hz 2.5\n");
+}
+
+TEST(TestADXSPDMetrics, TestLabelEscaping) {
+    ASSERT_EQ(ADXSPDMetricsWriter::FormatLabels({{"a", "x\"y"}, {"b", "c:\\d\ne"}}),
+              "{a=\"x\\\"y\",b=\"c:\\\\d\\ne\"}");
+    ASSERT_EQ(ADXSPDMetricsWriter::FormatLabels({}), "");
+}
+
+TEST(TestADXSPDMetrics, TestHistogramSummary) {
+    ADXSPDLatencyHistogram histogram;
+    histogram.record(10);
+    histogram.record(30);
+
+    ADXSPDMetricsWriter writer;
+    writer.Summary("xspd_decode_seconds", "Decode time", {{"port", "XSPD1"}}, histogram, 1e-3);
+
+    ASSERT_EQ(writer.Render(),
+              "# HELP xspd_decode_seconds Decode time\n"
+              "# TYPE xspd_decode_seconds summary\n"
+              "xspd_decode_seconds{port=\"XSPD1\",quantile=\"0.5\"} 0.01\n"
+              "xspd_decode_seconds{port=\"XSPD1\",quantile=\"0.99\"} 0.03\n"
+              "xspd_decode_seconds{port=\"XSPD1\",quantile=\"1\"} 0.03\n"
+              "xspd_decode_seconds_sum{port=\"XSPD1\"} 0.04\n"
+              "xspd_decode_seconds_count{port=\"XSPD1\"} 2\n");
+}
+
+// Sends a raw HTTP request to the metrics server and returns the full response
+static string sendRequest(int port, const string& request) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((uint16_t) port);
+    if (connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+        close(fd);
+        return "";
+    }
+    send(fd, request.data(), request.size(), 0);
+
+    string response;
+    char buffer[1024];
+    ssize_t numRead;
+    while ((numRead = recv(fd, buffer, sizeof(buffer), 0)) > 0) response.append(buffer, numRead);
+    close(fd);
+    return response;
+}
+
+TEST(TestADXSPDMetrics, TestServerScrape) {
+    int numScrapes = 0;
+    ADXSPDMetricsServer server(0, [&numScrapes](ADXSPDMetricsWriter& writer) {
+        writer.Counter("xspd_scrapes_total", "Scrapes served", {}, ++numScrapes);
+    });
+    ASSERT_GT(server.GetPort(), 0);
+
+    string response = sendRequest(server.GetPort(), "GET /metrics HTTP/1.1\r\n\r\n");
+    ASSERT_EQ(response.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+    ASSERT_NE(response.find("Content-Type: text/plain; version=0.0.4"), string::npos);
+    ASSERT_NE(response.find("\r\n\r\n# HELP xspd_scrapes_total"), string::npos);
+    ASSERT_NE(response.find("xspd_scrapes_total 1\n"), string::npos);
+
+    response = sendRequest(server.GetPort(), "GET /metrics?x=1 HTTP/1.1\r\nHost: a\r\n\r\n");
+    ASSERT_NE(response.find("xspd_scrapes_total 2\n"), string::npos);
+
+    response = sendRequest(server.GetPort(), "GET / HTTP/1.1\r\n\r\n");
+    ASSERT_EQ(response.rfind("HTTP/1.1 404 Not Found\r\n", 0), 0u);
+    response = sendRequest(server.GetPort(), "POST /metrics HTTP/1.1\r\n\r\n");
+    ASSERT_EQ(response.rfind("HTTP/1.1 405 Method Not Allowed\r\n", 0), 0u);
+    ASSERT_EQ(numScrapes, 2);
+}
+
+TEST(TestADXSPDMetrics, TestServerCollectorError) {
+    ADXSPDMetricsServer server(0, [](ADXSPDMetricsWriter&) {
+        throw std::runtime_error("Collector failed");
+    });
+    string response = sendRequest(server.GetPort(), "GET /metrics HTTP/1.1\r\n\r\n");
+    ASSERT_EQ(response.rfind("HTTP/1.1 500 Internal Server Error\r\n", 0), 0u);
+    ASSERT_NE(response.find("\r\n\r\nCollector failed\n"), string::npos);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "ADXSPDStats.h"
+
+TEST(TestADXSPDStats, TestHistogramBucketsRoundTrip) {
+    // Every value must be no larger than the upper bound of its bucket, and bucket bounds must
+    // stay within ~3% of the value (1 / 32 sub-buckets)
+    for (uint64_t value : {0ull, 1ull, 31ull, 32ull, 33ull, 1000ull, 123456ull, 987654321ull}) {
+        size_t index = ADXSPDLatencyHistogram::bucketIndex(value);
+        ASSERT_LT(index, ADXSPDLatencyHistogram::NUM_BUCKETS);
+        uint64_t upper = ADXSPDLatencyHistogram::bucketUpperBound(index);
+        ASSERT_GE(upper, value);
+        ASSERT_LE(upper - value, value / 32 + 1);
+        if (index > 0) {
+            ASSERT_LT(ADXSPDLatencyHistogram::bucketUpperBound(index - 1), value);
+        }
+    }
+    ASSERT_EQ(ADXSPDLatencyHistogram::bucketIndex(~0ull), ADXSPDLatencyHistogram::NUM_BUCKETS - 1);
+}
+
+TEST(TestADXSPDStats, TestHistogramPercentiles) {
+    ADXSPDLatencyHistogram histogram;
+    ASSERT_EQ(histogram.percentile(0.5), 0u);
+
+    for (uint64_t i = 1; i <= 1000; i++) histogram.record(i * 1000);
+
+    ASSERT_EQ(histogram.count(), 1000u);
+    ASSERT_EQ(histogram.max(), 1000000u);
+    ASSERT_EQ(histogram.sum(), 500500000u);
+    ASSERT_NEAR((double) histogram.percentile(0.5), 500000.0, 500000.0 * 0.04);
+    ASSERT_NEAR((double) histogram.percentile(0.99), 990000.0, 990000.0 * 0.04);
+    ASSERT_EQ(histogram.percentile(1.0), 1000000u);
+
+    histogram.reset();
+    ASSERT_EQ(histogram.count(), 0u);
+    ASSERT_EQ(histogram.max(), 0u);
+}
+
+TEST(TestADXSPDStats, TestRateMeter) {
+    ADXSPDRateMeter meter;
+    auto start = std::chrono::steady_clock::time_point(std::chrono::seconds(1000));
+    ASSERT_EQ(meter.eventRate(start), 0.0);
+
+    // 100 frames of 1 MB each, evenly spread over 2 s
+    for (int i = 0; i < 100; i++)
+        meter.record(1000000, start + std::chrono::milliseconds(i * 20));
+
+    auto end = start + std::chrono::seconds(2);
+    ASSERT_NEAR(meter.eventRate(end), 50.0, 0.5);
+    ASSERT_NEAR(meter.byteRate(end), 50e6, 0.5e6);
+
+    // Once the window has passed with no new frames, the rates decay to zero
+    ASSERT_EQ(meter.eventRate(end + std::chrono::seconds(10)), 0.0);
+
+    meter.reset();
+    ASSERT_EQ(meter.eventRate(end), 0.0);
+}
+
+TEST(TestADXSPDStats, TestCodecStats) {
+    ADXSPDCodecStats stats;
+    ASSERT_EQ(stats.outputRate(), 0.0);
+
+    // 10 frames of 1 MB compressed to 250 kB, decoded in 2 ms each
+    for (int i = 0; i < 10; i++) stats.record(250000, 1000000, 2000000);
+
+    ASSERT_EQ(stats.numFrames(), 10u);
+    ASSERT_EQ(stats.inputBytes(), 2500000u);
+    ASSERT_EQ(stats.outputBytes(), 10000000u);
+    ASSERT_DOUBLE_EQ(stats.totalSeconds(), 0.02);
+    ASSERT_DOUBLE_EQ(stats.outputRate(), 500e6);
+    ASSERT_DOUBLE_EQ(stats.inputRate(), 125e6);
+
+    stats.reset();
+    ASSERT_EQ(stats.numFrames(), 0u);
+    ASSERT_EQ(stats.outputRate(), 0.0);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include "ADXSPDTrace.h"
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+class TestADXSPDTrace : public ::testing::Test {
+   protected:
+    void SetUp() override { ADXSPDTrace::Clear(); }
+
+    void TearDown() override {
+        ADXSPDTrace::Enable(false);
+        ADXSPDTrace::Clear();
+        remove(this->tracePath.c_str());
+    }
+
+    json dumpTrace() {
+        ADXSPDTrace::Dump(this->tracePath);
+        ifstream file(this->tracePath);
+        return json::parse(file);
+    }
+
+    // Complete ("X") events, i.e. spans, in a dumped trace
+    static vector<json> getSpans(const json& trace) {
+        vector<json> spans;
+        for (auto& event : trace["traceEvents"]) {
+            if (event["ph"] == "X") spans.push_back(event);
+        }
+        return spans;
+    }
+
+    string tracePath = "TestADXSPDTrace.json";
+};
+
+TEST_F(TestADXSPDTrace, TestDisabledRecordsNothing) {
+    {
+        TRACE_SPAN("test", "disabled span");
+    }
+    ASSERT_TRUE(getSpans(this->dumpTrace()).empty());
+}
+
+TEST_F(TestADXSPDTrace, TestSpansAreDumped) {
+    ADXSPDTrace::Enable(true);
+    ADXSPDTrace::SetThreadName("testThread");
+    {
+        TRACE_SPAN_DETAIL("test", "outer", "some detail");
+        ADXSPDTraceSpan inner("test", "inner");
+        inner.End();
+    }
+
+    // Spans recorded on another thread end up on their own track
+    thread other([]() {
+        ADXSPDTrace::SetThreadName("otherThread");
+        TRACE_SPAN("test", "other");
+    });
+    other.join();
+
+    json trace = this->dumpTrace();
+    vector<json> spans = getSpans(trace);
+    ASSERT_EQ(spans.size(), 3u);
+
+    // Spans are recorded as they end
+    ASSERT_EQ(spans[0]["name"], "inner");
+    ASSERT_EQ(spans[1]["name"], "outer");
+    ASSERT_EQ(spans[1]["args"]["detail"], "some detail");
+    ASSERT_EQ(spans[1]["cat"], "test");
+    ASSERT_LE(spans[1]["ts"].get<double>(), spans[0]["ts"].get<double>());
+    ASSERT_EQ(spans[0]["tid"], spans[1]["tid"]);
+    ASSERT_EQ(spans[2]["name"], "other");
+    ASSERT_NE(spans[2]["tid"], spans[0]["tid"]);
+
+    map<int, string> threadNames;
+    for (auto& event : trace["traceEvents"]) {
+        if (event["ph"] == "M") threadNames[event["tid"]] = event["args"]["name"];
+    }
+    ASSERT_EQ(threadNames[spans[0]["tid"]], "testThread");
+    ASSERT_EQ(threadNames[spans[2]["tid"]], "otherThread");
+}
+
+TEST_F(TestADXSPDTrace, TestBufferKeepsNewestEvents) {
+    ADXSPDTrace::Enable(true);
+    for (int i = 0; i < ADXSPD_TRACE_BUFFER_SIZE + 10; i++) {
+        TRACE_SPAN("test", "span");
+    }
+    ASSERT_EQ(getSpans(this->dumpTrace()).size(), (size_t) ADXSPD_TRACE_BUFFER_SIZE);
+}
+
+TEST_F(TestADXSPDTrace, TestExitedThreadBuffersReused) {
+    ADXSPDTrace::Enable(true);
+    auto runThread = []() {
+        thread worker([]() { TRACE_SPAN("test", "worker"); });
+        worker.join();
+    };
+    auto countThreads = [](const json& trace) {
+        size_t numThreads = 0;
+        for (auto& event : trace["traceEvents"]) numThreads += event["ph"] == "M";
+        return numThreads;
+    };
+
+    // Events of exited threads are kept until dumped
+    runThread();
+    json trace = this->dumpTrace();
+    ASSERT_EQ(getSpans(trace).size(), 1u);
+    size_t numThreads = countThreads(trace);
+
+    // Once dumped, their buffers go to the next new threads
+    for (int i = 0; i < 4; i++) {
+        runThread();
+        this->dumpTrace();
+    }
+    trace = this->dumpTrace();
+    ASSERT_EQ(countThreads(trace), numThreads);
+    ASSERT_EQ(getSpans(trace).size(), 1u);
+
+    // Without a dump, only a limited number of exited threads' buffers are kept
+    for (int i = 0; i < 2 * ADXSPD_TRACE_MAX_EXITED; i++) runThread();
+    trace = this->dumpTrace();
+    ASSERT_LE(countThreads(trace), numThreads + ADXSPD_TRACE_MAX_EXITED);
+    ASSERT_GE(getSpans(trace).size(), (size_t) ADXSPD_TRACE_MAX_EXITED);
+}
+
+TEST_F(TestADXSPDTrace, TestDumpToInvalidPath) {
+    ASSERT_THROW(ADXSPDTrace::Dump("/nonexistent/dir/trace.json"), runtime_error);
+}
@@ -3,6 +3,10 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <future>
+
 TEST_F(TestXSPDAPI, TestParseVersionString) {
     auto [major, minor, patch] = XSPD::ParseVersionString("1.2.3");
     ASSERT_EQ(major, 1);
@@ -330,6 +334,24 @@ TEST_F(TestXSPDAPI, TestReadVarFromRespCompressorSpecialCase) {
     ASSERT_EQ(compressor, XSPD::Compressor::BLOSC_LZ4);
 }
 
+TEST_F(TestXSPDAPI, TestSetCompressorWireFormat) {
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+
+    // Compressors are written in the same form XSPD reads them back in
+    vector<pair<XSPD::Compressor, string>> cases = {{XSPD::Compressor::BLOSC_LZ4, "blosc/lz4"},
+                                                    {XSPD::Compressor::BLOSC_ZSTD, "blosc/zstd"},
+                                                    {XSPD::Compressor::ZLIB, "zlib"},
+                                                    {XSPD::Compressor::NONE, "none"}};
+    for (auto& [compressor, wireValue] : cases) {
+        json response = {{"path", "lambda/compressor"}, {"value", wireValue}};
+        EXPECT_CALL(*this->mapi,
+                    SubmitRequest(testing::EndsWith("path=lambda/compressor&value=" + wireValue),
+                                  XSPD::RequestType::PUT))
+            .WillOnce(Return(response));
+        ASSERT_EQ(pdet->SetVar<XSPD::Compressor>("compressor", compressor), compressor);
+    }
+}
+
 TEST_F(TestXSPDAPI, TestIsBloscCompressor) {
     ASSERT_TRUE(XSPD::IsBloscCompressor(XSPD::Compressor::BLOSC_BLOSCLZ));
     ASSERT_TRUE(XSPD::IsBloscCompressor(XSPD::Compressor::BLOSC_LZ4));
@@ -524,3 +546,418 @@ TEST_F(TestXSPDAPI, TestGetBloscSubcompressorId) {
                 testing::ThrowsMessage<std::invalid_argument>(
                     testing::HasSubstr("Compressor ZLIB is not a Blosc compressor")));
 }
+
+TEST_F(TestXSPDAPI, TestGetTopologyNotInitialized) {
+    EXPECT_THAT(
+        [&]() { this->mapi->GetTopology(); },
+        testing::ThrowsMessage<std::runtime_error>(testing::HasSubstr("XSPD API not initialized")));
+}
+
+TEST_F(TestXSPDAPI, TestGetTopologyAfterInitialization) {
+    this->mapi->MockInitialization();
+    json topology = this->mapi->GetTopology();
+    ASSERT_EQ(topology["system_id"], "SYSTEM");
+    ASSERT_EQ(topology["device_id"], "lambda01");
+    ASSERT_EQ(topology["detector_id"], "lambda");
+    ASSERT_EQ(topology["libxsp_version"], "2.7.6");
+    ASSERT_EQ(topology["modules"].size(), static_cast<size_t>(1));
+    ASSERT_EQ(topology["modules"][0]["id"], "lambda/1");
+    ASSERT_EQ(topology["modules"][0]["chip_ids"].size(), static_cast<size_t>(12));
+    ASSERT_EQ(topology["data_ports"].size(), static_cast<size_t>(1));
+    ASSERT_EQ(topology["data_ports"][0]["id"], "port-1");
+    ASSERT_EQ(topology["data_ports"][0]["port"], 4300);
+}
+
+TEST_F(TestXSPDAPI, TestInitializeFromTopology) {
+    this->mapi->MockInitialization();
+    json topology = this->mapi->GetTopology();
+
+    // A warm start only needs to check the API version.
+    StrictMock<MockXSPDAPI> warmApi;
+    warmApi.MockAPIVersionCheck();
+    XSPD::Detector* pdet = warmApi.InitializeFromTopology(topology);
+
+    ASSERT_EQ(pdet->GetId(), "lambda");
+    ASSERT_EQ(warmApi.GetDeviceId(), "lambda01");
+    ASSERT_EQ(warmApi.GetSystemId(), "SYSTEM");
+    ASSERT_EQ(warmApi.GetLibXSPVersion(), "2.7.6");
+    ASSERT_EQ(pdet->GetModules().size(), static_cast<size_t>(1));
+    ASSERT_EQ(pdet->GetModules()[0]->GetChipIds()[11], "w12-A01,CRN,0x00000c11");
+    ASSERT_EQ(pdet->GetActiveDataPort()->GetURI(), "tcp://0.0.0.0:4300");
+    ASSERT_EQ(warmApi.GetTopology(), topology);
+}
+
+TEST_F(TestXSPDAPI, TestInitializeFromInvalidTopology) {
+    this->mapi->MockAPIVersionCheck();
+    json topology = json{{"system_id", "SYSTEM"}};
+    EXPECT_THAT([&]() { this->mapi->InitializeFromTopology(topology); },
+                testing::ThrowsMessage<std::runtime_error>(
+                    testing::HasSubstr("Invalid cached topology")));
+}
+
+TEST_F(TestXSPDAPI, TestValidateTopology) {
+    this->mapi->MockInitialization();
+    json topology = this->mapi->GetTopology();
+
+    this->mapi->MockGetRequest("devices/lambda01/variables?path=info");
+    this->mapi->MockGetRequest("devices/lambda01");
+    ASSERT_TRUE(this->mapi->ValidateTopology(topology));
+
+    topology["modules"][0]["firmware"] = "1.0.0";
+    this->mapi->MockGetRequest("devices/lambda01/variables?path=info");
+    this->mapi->MockGetRequest("devices/lambda01");
+    ASSERT_FALSE(this->mapi->ValidateTopology(topology));
+}
+
+TEST_F(TestXSPDAPI, TestConcurrentRequests) {
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+
+    // Each request blocks until both have been submitted, so this only completes if the two
+    // requests are allowed to be in flight at the same time.
+    std::mutex barrierMutex;
+    std::condition_variable barrier;
+    int numWaiting = 0;
+    json response = this->mapi->GetSampleResp("devices/lambda01/variables?path=lambda/bit_depth");
+    EXPECT_CALL(*this->mapi, SubmitRequest(testing::HasSubstr("lambda/bit_depth"),
+                                           XSPD::RequestType::GET))
+        .Times(2)
+        .WillRepeatedly(Invoke([&](string, XSPD::RequestType) {
+            std::unique_lock<std::mutex> lock(barrierMutex);
+            numWaiting++;
+            barrier.notify_all();
+            barrier.wait_for(lock, std::chrono::seconds(5), [&]() { return numWaiting == 2; });
+            return response;
+        }));
+
+    this->mapi->SetMaxConcurrentRequests(2);
+    auto start = std::chrono::steady_clock::now();
+    auto first = std::async(std::launch::async, [&]() { return pdet->GetVar<int>("bit_depth"); });
+    auto second = std::async(std::launch::async, [&]() { return pdet->GetVar<int>("bit_depth"); });
+    ASSERT_EQ(first.get(), second.get());
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST_F(TestXSPDAPI, TestScopedConcurrencyOverlap) {
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+
+    std::mutex barrierMutex;
+    std::condition_variable barrier;
+    int numWaiting = 0;
+    json response = this->mapi->GetSampleResp("devices/lambda01/variables?path=lambda/bit_depth");
+    EXPECT_CALL(*this->mapi, SubmitRequest(testing::HasSubstr("lambda/bit_depth"),
+                                           XSPD::RequestType::GET))
+        .Times(2)
+        .WillRepeatedly(Invoke([&](string, XSPD::RequestType) {
+            std::unique_lock<std::mutex> lock(barrierMutex);
+            numWaiting++;
+            barrier.notify_all();
+            barrier.wait_for(lock, std::chrono::seconds(5), [&]() { return numWaiting == 2; });
+            return response;
+        }));
+
+    // A guard ending while another is still active must not drop back to the configured limit
+    XSPD::API::ScopedConcurrency outer(this->mapi.get(), 2);
+    {
+        XSPD::API::ScopedConcurrency inner(this->mapi.get(), 4);
+    }
+    ASSERT_EQ(this->mapi->GetMaxConcurrentRequests(), 1);
+
+    auto start = std::chrono::steady_clock::now();
+    auto first = std::async(std::launch::async, [&]() { return pdet->GetVar<int>("bit_depth"); });
+    auto second = std::async(std::launch::async, [&]() { return pdet->GetVar<int>("bit_depth"); });
+    ASSERT_EQ(first.get(), second.get());
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST_F(TestXSPDAPI, TestStateAfterInitialization) {
+    ASSERT_EQ(this->mapi->GetState(), XSPD::APIState::NOT_INITIALIZED);
+    ASSERT_FALSE(this->mapi->IsConnected());
+    this->mapi->MockInitialization();
+    ASSERT_EQ(this->mapi->GetState(), XSPD::APIState::INITIALIZED);
+    ASSERT_TRUE(this->mapi->IsConnected());
+}
+
+TEST_F(TestXSPDAPI, TestConnectionLossFailsFast) {
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+
+    EXPECT_CALL(*this->mapi, SubmitRequest(testing::HasSubstr("lambda/bit_depth"),
+                                           XSPD::RequestType::GET))
+        .WillOnce(testing::Throw(XSPD::ConnectionError("Failed to get data: refused")));
+    ASSERT_THROW(pdet->GetVar<int>("bit_depth"), XSPD::ConnectionError);
+    ASSERT_EQ(this->mapi->GetState(), XSPD::APIState::DISCONNECTED);
+
+    // Further requests must not reach the server until reconnected
+    EXPECT_THAT([&]() { pdet->SetVar<int>("bit_depth", 12); },
+                testing::ThrowsMessage<XSPD::ConnectionError>(
+                    testing::HasSubstr("Not connected to XSPD server")));
+}
+
+TEST_F(TestXSPDAPI, TestServerErrorDoesNotDisconnect) {
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+    this->mapi->MockGetVarRequest("lambda/not_a_variable");
+    ASSERT_THROW(pdet->GetVar<int>("not_a_variable"), std::runtime_error);
+    ASSERT_TRUE(this->mapi->IsConnected());
+}
+
+TEST_F(TestXSPDAPI, TestReconnect) {
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+    EXPECT_CALL(*this->mapi, SubmitRequest(testing::HasSubstr("lambda/bit_depth"),
+                                           XSPD::RequestType::GET))
+        .WillOnce(testing::Throw(XSPD::ConnectionError("Failed to get data: refused")));
+    ASSERT_THROW(pdet->GetVar<int>("bit_depth"), XSPD::ConnectionError);
+
+    // Server is still down
+    EXPECT_CALL(*this->mapi, SubmitRequest("localhost:8008/api", XSPD::RequestType::GET))
+        .WillOnce(testing::Throw(XSPD::ConnectionError("Failed to get data: refused")));
+    ASSERT_THROW(this->mapi->Reconnect(), XSPD::ConnectionError);
+    ASSERT_EQ(this->mapi->GetState(), XSPD::APIState::DISCONNECTED);
+
+    // Server is back, with the same detector
+    this->mapi->MockAPIVersionCheck();
+    this->mapi->MockGetRequest("devices/lambda01/variables?path=info");
+    this->mapi->MockGetRequest("devices/lambda01");
+    this->mapi->Reconnect();
+    ASSERT_TRUE(this->mapi->IsConnected());
+
+    this->mapi->MockGetVarRequest("lambda/bit_depth");
+    ASSERT_EQ(pdet->GetVar<int>("bit_depth"), 12);
+}
+
+TEST_F(TestXSPDAPI, TestReconnectTopologyChanged) {
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+    EXPECT_CALL(*this->mapi, SubmitRequest(testing::HasSubstr("lambda/bit_depth"),
+                                           XSPD::RequestType::GET))
+        .WillOnce(testing::Throw(XSPD::ConnectionError("Failed to get data: refused")));
+    ASSERT_THROW(pdet->GetVar<int>("bit_depth"), XSPD::ConnectionError);
+
+    json deviceInfo = this->mapi->GetSampleResp("devices/lambda01/variables?path=info");
+    deviceInfo["value"]["detectors"][0]["modules"][0]["firmware"] = "1.0.0";
+    this->mapi->MockAPIVersionCheck();
+    this->mapi->MockGetRequest("devices/lambda01/variables?path=info", &deviceInfo);
+    this->mapi->MockGetRequest("devices/lambda01");
+    EXPECT_THAT([&]() { this->mapi->Reconnect(); },
+                testing::ThrowsMessage<std::runtime_error>(
+                    testing::HasSubstr("topology changed while disconnected")));
+    ASSERT_EQ(this->mapi->GetState(), XSPD::APIState::DISCONNECTED);
+}
+
+TEST_F(TestXSPDAPI, TestInitializeFromTopologyOffline) {
+    this->mapi->MockInitialization();
+    json topology = this->mapi->GetTopology();
+
+    StrictMock<MockXSPDAPI> offlineApi;
+    EXPECT_CALL(offlineApi, SubmitRequest("localhost:8008/api", XSPD::RequestType::GET))
+        .Times(2)
+        .WillRepeatedly(testing::Throw(XSPD::ConnectionError("Failed to get data: refused")));
+    ASSERT_THROW(offlineApi.InitializeFromTopology(topology), XSPD::ConnectionError);
+
+    XSPD::Detector* pdet = offlineApi.InitializeFromTopology(topology, true);
+    ASSERT_EQ(pdet->GetId(), "lambda");
+    ASSERT_EQ(pdet->GetModules().size(), static_cast<size_t>(1));
+    ASSERT_EQ(offlineApi.GetState(), XSPD::APIState::DISCONNECTED);
+    ASSERT_THROW(pdet->GetVar<int>("bit_depth"), std::runtime_error);
+}
+
+TEST_F(TestXSPDAPI, TestReconnectWhileConnected) {
+    // Another driver sharing the API may already have reconnected
+    this->mapi->MockInitialization();
+    this->mapi->Reconnect();
+    ASSERT_TRUE(this->mapi->IsConnected());
+}
+
+/**
+ * @brief Adds a second detector, "lambda2" with one module and its own data port, to the device
+ */
+static void AddSecondDetector(MockXSPDAPI* mapi) {
+    json deviceInfo = mapi->GetSampleResp("devices/lambda01/variables?path=info");
+    json secondDetector = deviceInfo["value"]["detectors"][0];
+    secondDetector["detector-id"] = "lambda2";
+    secondDetector["modules"][0]["module"] = "lambda2/1";
+    deviceInfo["value"]["detectors"].push_back(secondDetector);
+    mapi->UpdateSampleResp("devices/lambda01/variables?path=info", deviceInfo);
+
+    json device = mapi->GetSampleResp("devices/lambda01");
+    device["system"]["data-ports"].push_back(
+        {{"ref", "lambda2/1"}, {"id", "port-2"}, {"ip", "0.0.0.0"}, {"port", 4301}});
+    mapi->UpdateSampleResp("devices/lambda01", device);
+}
+
+TEST_F(TestXSPDAPI, TestInitializeSelectedDetector) {
+    AddSecondDetector(this->mapi.get());
+    this->mapi->MockInitializationSeq();
+    XSPD::Detector* pdet = this->mapi->Initialize("lambda01", "lambda2");
+    ASSERT_EQ(pdet->GetId(), "lambda2");
+    ASSERT_EQ(pdet->GetModules()[0]->GetId(), "lambda2/1");
+    ASSERT_EQ(pdet->GetDataPortIds(), vector<string>{"port-2"});
+    ASSERT_EQ(pdet->GetActiveDataPort()->GetURI(), "tcp://0.0.0.0:4301");
+}
+
+TEST_F(TestXSPDAPI, TestInitializeUnknownDetector) {
+    InSequence seq;
+    this->mapi->MockAPIVersionCheck();
+    this->mapi->MockGetRequest("devices");
+    this->mapi->MockGetVarRequest("info");
+    EXPECT_THAT([&]() { this->mapi->Initialize("lambda01", "lambda9"); },
+                testing::ThrowsMessage<std::invalid_argument>(
+                    testing::HasSubstr("Detector with ID lambda9 not found on device lambda01")));
+}
+
+TEST_F(TestXSPDAPI, TestInitializeSharedDetectors) {
+    AddSecondDetector(this->mapi.get());
+    XSPD::Detector* first = this->mapi->MockInitialization();
+    ASSERT_EQ(first->GetDataPortIds(), vector<string>{"port-1"});
+
+    // The second detector is initialized from the device info already retrieved for the first,
+    // without any further requests.
+    XSPD::Detector* second = this->mapi->Initialize("lambda01", "lambda2");
+    ASSERT_NE(first, second);
+    ASSERT_EQ(second->GetId(), "lambda2");
+    ASSERT_EQ(this->mapi->GetTopology()["detector_id"], "lambda");
+    ASSERT_EQ(this->mapi->GetTopology("lambda2")["detector_id"], "lambda2");
+
+    EXPECT_THAT([&]() { this->mapi->Initialize("lambda01", "lambda2"); },
+                testing::ThrowsMessage<std::invalid_argument>(
+                    testing::HasSubstr("Detector lambda2 is already initialized")));
+}
+
+TEST_F(TestXSPDAPI, TestVarCache) {
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+
+    // Disabled by default
+    json response = this->mapi->GetSampleResp("devices/lambda01/variables?path=lambda/bit_depth");
+    EXPECT_CALL(*this->mapi, SubmitRequest(testing::HasSubstr("lambda/bit_depth"),
+                                           XSPD::RequestType::GET))
+        .Times(2)
+        .WillRepeatedly(Return(response));
+    ASSERT_EQ(pdet->GetVar<int>("bit_depth"), 12);
+    ASSERT_EQ(pdet->GetVar<int>("bit_depth"), 12);
+    testing::Mock::VerifyAndClearExpectations(this->mapi.get());
+
+    this->mapi->SetVarCacheTTL(60);
+    this->mapi->MockGetVarRequest("lambda/bit_depth");
+    ASSERT_EQ(pdet->GetVar<int>("bit_depth"), 12);
+    ASSERT_EQ(pdet->GetVar<int>("bit_depth"), 12);
+
+    // Writes update the cached value with their readback
+    this->mapi->MockSetVarRequest("lambda/bit_depth&value=6");
+    ASSERT_EQ(pdet->SetVar<int>("bit_depth", 6), 6);
+    ASSERT_EQ(pdet->GetVar<int>("bit_depth"), 6);
+}
+
+TEST_F(TestXSPDAPI, TestGetEndpointName) {
+    ASSERT_EQ(XSPD::API::GetEndpointName("localhost:8008/api", XSPD::RequestType::GET),
+              "GET api");
+    ASSERT_EQ(XSPD::API::GetEndpointName("localhost:8008/api/v1/devices", XSPD::RequestType::GET),
+              "GET devices");
+    ASSERT_EQ(
+        XSPD::API::GetEndpointName("localhost:8008/api/v1/devices/lambda01", XSPD::RequestType::GET),
+        "GET device");
+    ASSERT_EQ(XSPD::API::GetEndpointName(
+                  "localhost:8008/api/v1/devices/lambda01/variables?path=lambda/bit_depth&value=6",
+                  XSPD::RequestType::PUT),
+              "PUT device/variables?path=lambda/bit_depth");
+    ASSERT_EQ(XSPD::API::GetEndpointName("localhost:8008/api/v1/devices/lambda01/commands",
+                                         XSPD::RequestType::GET),
+              "GET device/commands");
+}
+
+TEST_F(TestXSPDAPI, TestEndpointStats) {
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+    ASSERT_EQ(this->mapi->GetTotalStats().numRequests, 4u);
+
+    this->mapi->ResetEndpointStats();
+    ASSERT_EQ(this->mapi->GetTotalStats().numRequests, 0u);
+    ASSERT_TRUE(this->mapi->GetEndpointStats().empty());
+
+    json response = this->mapi->GetSampleResp("devices/lambda01/variables?path=lambda/bit_depth");
+    EXPECT_CALL(*this->mapi, SubmitRequest(testing::HasSubstr("lambda/bit_depth"),
+                                           XSPD::RequestType::GET))
+        .WillOnce(Return(response))
+        .WillOnce(Return(response))
+        .WillOnce(testing::Throw(runtime_error("Internal server error")));
+    ASSERT_EQ(pdet->GetVar<int>("bit_depth"), 12);
+    ASSERT_EQ(pdet->GetVar<int>("bit_depth"), 12);
+    ASSERT_THROW(pdet->GetVar<int>("bit_depth"), runtime_error);
+
+    this->mapi->MockSetVarRequest("lambda/bit_depth&value=6");
+    ASSERT_EQ(pdet->SetVar<int>("bit_depth", 6), 6);
+
+    vector<XSPD::EndpointStats> stats = this->mapi->GetEndpointStats();
+    ASSERT_EQ(stats.size(), 2u);
+    map<string, XSPD::EndpointStats> byEndpoint;
+    for (auto& endpoint : stats) byEndpoint[endpoint.endpoint] = endpoint;
+
+    XSPD::EndpointStats getStats = byEndpoint.at("GET device/variables?path=lambda/bit_depth");
+    ASSERT_EQ(getStats.numRequests, 3u);
+    ASSERT_EQ(getStats.numErrors, 1u);
+    ASSERT_GT(getStats.bytesSent, 0u);
+    ASSERT_GE(getStats.maxMs, getStats.p50Ms);
+
+    XSPD::EndpointStats putStats = byEndpoint.at("PUT device/variables?path=lambda/bit_depth");
+    ASSERT_EQ(putStats.numRequests, 1u);
+    ASSERT_EQ(putStats.numErrors, 0u);
+
+    XSPD::EndpointStats total = this->mapi->GetTotalStats();
+    ASSERT_EQ(total.numRequests, 4u);
+    ASSERT_EQ(total.numErrors, 1u);
+    ASSERT_EQ(total.bytesSent, getStats.bytesSent + putStats.bytesSent);
+}
+
+TEST_F(TestXSPDAPI, TestRecordAndReplay) {
+    string recordingPath = "TestXSPDAPIRecording.jsonl";
+    this->mapi->StartRecording(recordingPath);
+    ASSERT_TRUE(this->mapi->IsRecording());
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+
+    this->mapi->MockSetVarRequest("lambda/bit_depth&value=6");
+    ASSERT_EQ(pdet->SetVar<int>("bit_depth", 6), 6);
+    EXPECT_CALL(*this->mapi, SubmitRequest(testing::HasSubstr("lambda/bit_depth"),
+                                           XSPD::RequestType::GET))
+        .WillOnce(testing::Throw(runtime_error("Internal server error")));
+    ASSERT_THROW(pdet->GetVar<int>("bit_depth"), runtime_error);
+    this->mapi->StopRecording();
+    ASSERT_FALSE(this->mapi->IsRecording());
+
+    // Requests are matched without the host, and replayed in the order they were recorded
+    XSPD::ReplayAPI replay("replayhost", recordingPath, XSPD::DEFAULT_PORT, 0);
+    ASSERT_EQ(replay.GetNumRecorded(), 6u);
+    XSPD::Detector* replayDet = replay.Initialize();
+    ASSERT_EQ(replayDet->GetId(), pdet->GetId());
+    ASSERT_EQ(replay.GetDeviceId(), "lambda01");
+    ASSERT_EQ(replayDet->SetVar<int>("bit_depth", 6), 6);
+    EXPECT_THAT([&]() { replayDet->GetVar<int>("bit_depth"); },
+                testing::ThrowsMessage<std::runtime_error>(
+                    testing::HasSubstr("Internal server error")));
+    ASSERT_EQ(replay.GetNumReplayed(), 6u);
+
+    // Once a request's responses run out, the last one is repeated
+    ASSERT_THROW(replayDet->GetVar<int>("bit_depth"), runtime_error);
+    EXPECT_THAT([&]() { replayDet->GetVar<int>("n_frames"); },
+                testing::ThrowsMessage<std::runtime_error>(
+                    testing::HasSubstr("No recorded response to GET /api/v1/devices/lambda01/"
+                                       "variables?path=lambda/n_frames")));
+    std::remove(recordingPath.c_str());
+}
+
+TEST_F(TestXSPDAPI, TestReplayConnectionError) {
+    string recordingPath = "TestXSPDAPIRecording.jsonl";
+    this->mapi->StartRecording(recordingPath);
+    XSPD::Detector* pdet = this->mapi->MockInitialization();
+    EXPECT_CALL(*this->mapi, SubmitRequest(testing::HasSubstr("lambda/bit_depth"),
+                                           XSPD::RequestType::GET))
+        .WillOnce(testing::Throw(XSPD::ConnectionError("Failed to get data: refused")));
+    ASSERT_THROW(pdet->GetVar<int>("bit_depth"), XSPD::ConnectionError);
+    this->mapi->StopRecording();
+
+    XSPD::ReplayAPI replay("localhost", recordingPath, XSPD::DEFAULT_PORT, 0);
+    XSPD::Detector* replayDet = replay.Initialize();
+    ASSERT_THROW(replayDet->GetVar<int>("bit_depth"), XSPD::ConnectionError);
+    ASSERT_EQ(replay.GetState(), XSPD::APIState::DISCONNECTED);
+    std::remove(recordingPath.c_str());
+}
+
+TEST_F(TestXSPDAPI, TestReplayMissingRecording) {
+    EXPECT_THAT([&]() { XSPD::ReplayAPI("localhost", "not_a_recording.jsonl"); },
+                testing::ThrowsMessage<std::runtime_error>(
+                    testing::HasSubstr("Failed to open REST recording")));
+}
@@ -0,0 +1,376 @@
+/*
+ * High-rate stand-in for the XSPD data ports, for load testing the ADXSPD driver
+ *
+ * Publishes a bank of pre-encoded frames on one or more ZMQ PUB sockets in the same wire format as
+ * publisher_thread in scripts/xspdSimulator.py: an empty part, a 4 byte header (frame number,
+ * trigger number, status, size) and the pixel data. Frames are encoded once at startup, and sent
+ * without copying on a fixed schedule, so the publisher can sustain rates well beyond what the
+ * simulator can generate, up to what the network and the driver can absorb.
+ *
+ * Run it alongside the simulator (started with --no-stitched for one port per module) or another
+ * REST layer pointing the driver at these ports, and start the driver acquiring.
+ *
+ * Usage: xspdPublisher [--data-port 4300] [--num-ports 1] [--bind *] [--width 1556]
+ *                      [--height 516] [--bit-depth 12] [--compressor none]
+ *                      [--shuffle no_shuffle] [--level 2] [--threshold 3] [--dual]
+ *                      [--threshold-high 6] [--rate 1000] [--frames 0] [--bank 16] [--hwm 1000]
+ *                      [--spin-us 200] [--no-wait]
+ *
+ * A rate of 0 publishes as fast as possible, and 0 frames publishes until interrupted.
+ *
+ */
+
+#include <signal.h>
+#include <zmq.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#include "BenchFrames.h"
+
+#define PUBLISHER_SUBSCRIBE_POLL_MS 100  // Interval at which subscriptions are checked for
+#define PUBLISHER_START_DELAY_S 0.1      // Lead time given to every port before the first frame
+
+struct PublisherOptions {
+    int dataPort = 4300;  // First port, further ports follow on consecutive numbers
+    int numPorts = 1;
+    string bindAddress = "*";
+    int width = 1556;  // A single Lambda module
+    int height = 516;
+    int bitDepth = 12;
+    XSPD::Compressor compressor = XSPD::Compressor::NONE;
+    XSPD::ShuffleMode shuffleMode = XSPD::ShuffleMode::NO_SHUFFLE;
+    int compressionLevel = 2;
+    double threshold = 3.0;      // Lower threshold in keV, sets the occupancy of frames
+    bool dual = false;           // Send a pair of frames per trigger, as in dual counter mode
+    double thresholdHigh = 6.0;  // Upper threshold in keV, for the second frame of each pair
+    double rateHz = 1000;
+    int64_t numFrames = 0;
+    int bankSize = 16;
+    int hwm = 1000;
+    double spinUs = 200;  // Busy-wait this close to each deadline, rather than sleeping
+    bool waitForSubscribers = true;
+};
+
+// A pre-encoded frame, and for dual counter mode the second frame of its pair
+struct PublisherFrame {
+    vector<uint8_t> counters[2];
+};
+
+struct PortStats {
+    atomic<int64_t> numSent{0};
+    atomic<int64_t> bytesSent{0};
+    atomic<int64_t> numLate{0};  // Frames sent a full period or more after their deadline
+    atomic<int64_t> maxLatenessNs{0};
+};
+
+static atomic<bool> stopRequested{false};
+
+static void onSignal(int) { stopRequested = true; }
+
+/**
+ * @brief Sends one part of a message without copying. The data must outlive the ZMQ context.
+ */
+static bool sendPart(void* socket, const void* data, size_t size, int flags) {
+    zmq_msg_t message;
+    zmq_msg_init_data(&message, (void*) data, size, nullptr, nullptr);
+    if (zmq_msg_send(&message, socket, flags) < 0) {
+        zmq_msg_close(&message);
+        return false;
+    }
+    return true;
+}
+
+static bool sendFrame(void* socket, const vector<uint8_t>& frame, int64_t frameNumber,
+                      int triggerNumber) {
+    // Small parts are copied, as zmq_send does anyway for messages this size
+    uint8_t header[4] = {(uint8_t) (frameNumber & 0xFF), (uint8_t) (triggerNumber & 0xFF), 0, 0};
+    return zmq_send(socket, "", 0, ZMQ_SNDMORE) == 0 &&
+           zmq_send(socket, header, sizeof(header), ZMQ_SNDMORE) == sizeof(header) &&
+           sendPart(socket, frame.data(), frame.size(), 0);
+}
+
+/**
+ * @brief Publishes frames on one port against a fixed schedule, starting at startTime. Sends
+ * that fall behind schedule are made immediately, so the average rate is held where possible.
+ */
+static void publishPort(void* socket, const vector<PublisherFrame>& bank,
+                        const PublisherOptions& options, chrono::steady_clock::time_point startTime,
+                        PortStats& stats) {
+    auto spin = chrono::duration<double, micro>(options.spinUs);
+    auto period = chrono::duration<double>(options.rateHz > 0 ? 1.0 / options.rateHz : 0);
+    int numCounters = options.dual ? 2 : 1;
+
+    for (int64_t i = 0; !stopRequested && (options.numFrames == 0 || i < options.numFrames);
+         i++) {
+        if (options.rateHz > 0) {
+            auto deadline = startTime + chrono::duration_cast<chrono::steady_clock::duration>(
+                                            chrono::duration<double>(i / options.rateHz));
+            auto wakeTime = deadline - chrono::duration_cast<chrono::steady_clock::duration>(spin);
+            if (chrono::steady_clock::now() < wakeTime) this_thread::sleep_until(wakeTime);
+            while (chrono::steady_clock::now() < deadline) {
+            }
+
+            int64_t latenessNs =
+                chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - deadline)
+                    .count();
+            if (latenessNs >= chrono::duration_cast<chrono::nanoseconds>(period).count())
+                stats.numLate++;
+            if (latenessNs > stats.maxLatenessNs) stats.maxLatenessNs = latenessNs;
+        }
+
+        const PublisherFrame& frame = bank[i % bank.size()];
+        for (int counter = 0; counter < numCounters; counter++) {
+            if (!sendFrame(socket, frame.counters[counter], i, counter)) {
+                if (zmq_errno() == ETERM || zmq_errno() == EINTR) return;
+                fprintf(stderr, "Failed to send frame: %s\n", zmq_strerror(zmq_errno()));
+                stopRequested = true;
+                return;
+            }
+            stats.bytesSent += frame.counters[counter].size();
+        }
+        stats.numSent++;
+    }
+}
+
+/**
+ * @brief Waits until every socket has a subscriber, so the first frames are not dropped
+ *
+ * @return bool false if interrupted first
+ */
+static bool waitForSubscribers(const vector<void*>& sockets, int firstPort) {
+    vector<bool> subscribed(sockets.size(), false);
+    size_t numSubscribed = 0;
+    while (numSubscribed < sockets.size()) {
+        if (stopRequested) return false;
+        for (size_t i = 0; i < sockets.size(); i++) {
+            if (subscribed[i]) continue;
+            // XPUB sockets receive subscriptions as messages starting with 1
+            uint8_t subscription[256];
+            zmq_pollitem_t item = {sockets[i], 0, ZMQ_POLLIN, 0};
+            if (zmq_poll(&item, 1, PUBLISHER_SUBSCRIBE_POLL_MS / sockets.size()) > 0 &&
+                zmq_recv(sockets[i], subscription, sizeof(subscription), ZMQ_DONTWAIT) > 0 &&
+                subscription[0] == 1) {
+                subscribed[i] = true;
+                numSubscribed++;
+                printf("Subscriber connected on port %zu\n", firstPort + i);
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Generates and encodes the frames published on one port
+ */
+static vector<PublisherFrame> buildBank(const PublisherOptions& options, int portIndex) {
+    vector<PublisherFrame> bank(options.bankSize);
+    for (int i = 0; i < options.bankSize; i++) {
+        uint64_t seed = (uint64_t) portIndex * options.bankSize + i + 1;
+        vector<uint8_t> raw =
+            BenchFrames::Generate(options.width, options.height, options.bitDepth, seed,
+                                  BenchFrames::GetOccupancy(options.threshold));
+        bank[i].counters[0] = BenchFrames::Encode(raw, options.bitDepth, options.compressor,
+                                                  options.shuffleMode, options.compressionLevel);
+        if (options.dual) {
+            // The second counter sits above the upper threshold, so sees fewer photons
+            double occupancy = BenchFrames::GetOccupancy(options.thresholdHigh);
+            raw = BenchFrames::Generate(options.width, options.height, options.bitDepth, seed << 32,
+                                        occupancy);
+            bank[i].counters[1] =
+                BenchFrames::Encode(raw, options.bitDepth, options.compressor,
+                                    options.shuffleMode, options.compressionLevel);
+        }
+    }
+    return bank;
+}
+
+template <typename E>
+static E parseEnum(string name) {
+    // Compressors are also accepted as the XSPD server names them, e.g. blosc/lz4
+    replace(name.begin(), name.end(), '/', '_');
+    auto value = magic_enum::enum_cast<E>(name, magic_enum::case_insensitive);
+    if (!value.has_value()) throw invalid_argument("Unknown value " + name);
+    return value.value();
+}
+
+static PublisherOptions parseOptions(int argc, char** argv) {
+    PublisherOptions options;
+    for (int i = 1; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--dual") {
+            options.dual = true;
+            continue;
+        } else if (flag == "--no-wait") {
+            options.waitForSubscribers = false;
+            continue;
+        }
+
+        if (i + 1 >= argc) throw invalid_argument("Missing value for " + flag);
+        string value = argv[++i];
+        if (flag == "--data-port") {
+            options.dataPort = stoi(value);
+        } else if (flag == "--num-ports") {
+            options.numPorts = stoi(value);
+        } else if (flag == "--bind") {
+            options.bindAddress = value;
+        } else if (flag == "--width") {
+            options.width = stoi(value);
+        } else if (flag == "--height") {
+            options.height = stoi(value);
+        } else if (flag == "--bit-depth") {
+            options.bitDepth = stoi(value);
+        } else if (flag == "--compressor") {
+            options.compressor = parseEnum<XSPD::Compressor>(value);
+        } else if (flag == "--shuffle") {
+            options.shuffleMode = parseEnum<XSPD::ShuffleMode>(value);
+        } else if (flag == "--level") {
+            options.compressionLevel = stoi(value);
+        } else if (flag == "--threshold") {
+            options.threshold = stod(value);
+        } else if (flag == "--threshold-high") {
+            options.thresholdHigh = stod(value);
+        } else if (flag == "--rate") {
+            options.rateHz = stod(value);
+        } else if (flag == "--frames") {
+            options.numFrames = stoll(value);
+        } else if (flag == "--bank") {
+            options.bankSize = stoi(value);
+        } else if (flag == "--hwm") {
+            options.hwm = stoi(value);
+        } else if (flag == "--spin-us") {
+            options.spinUs = stod(value);
+        } else {
+            throw invalid_argument("Unknown option " + flag);
+        }
+    }
+    if (options.numPorts < 1 || options.bankSize < 1)
+        throw invalid_argument("--num-ports and --bank must be at least 1");
+    return options;
+}
+
+int main(int argc, char** argv) {
+    PublisherOptions options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        fprintf(stderr,
+                "Usage: %s [--data-port PORT] [--num-ports N] [--bind ADDR] [--width W] "
+                "[--height H] [--bit-depth N] [--compressor C] [--shuffle S] [--level N] "
+                "[--threshold KEV] [--dual] [--threshold-high KEV] [--rate HZ] [--frames N] "
+                "[--bank N] [--hwm N] [--spin-us US] [--no-wait]\n",
+                argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    // Banks are declared before the context, so they outlive any message still referencing them
+    vector<vector<PublisherFrame>> banks;
+    size_t bankBytes = 0;
+    try {
+        for (int port = 0; port < options.numPorts; port++) {
+            banks.push_back(buildBank(options, port));
+            for (const PublisherFrame& frame : banks.back())
+                bankBytes += frame.counters[0].size() + frame.counters[1].size();
+        }
+    } catch (std::exception& e) {
+        fprintf(stderr, "Failed to encode frames: %s\n", e.what());
+        return 1;
+    }
+    size_t rawFrameBytes =
+        (size_t) options.width * options.height * BenchFrames::GetBytesPerPixel(options.bitDepth);
+    int numCounters = options.dual ? 2 : 1;
+    printf("%d x %d frames, %d bit, %s: %.2f MB raw, %.2f MB encoded per port and frame\n",
+           options.width, options.height, options.bitDepth,
+           string(magic_enum::enum_name(options.compressor)).c_str(),
+           rawFrameBytes * numCounters / 1e6,
+           bankBytes / 1e6 / options.bankSize / options.numPorts);
+
+    void* context = zmq_ctx_new();
+    vector<void*> sockets;
+    for (int port = 0; port < options.numPorts; port++) {
+        void* socket = zmq_socket(context, ZMQ_XPUB);
+        int linger = 0;
+        zmq_setsockopt(socket, ZMQ_SNDHWM, &options.hwm, sizeof(options.hwm));
+        zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+        string endpoint =
+            "tcp://" + options.bindAddress + ":" + to_string(options.dataPort + port);
+        if (zmq_bind(socket, endpoint.c_str()) != 0) {
+            fprintf(stderr, "Failed to bind %s: %s\n", endpoint.c_str(),
+                    zmq_strerror(zmq_errno()));
+            stopRequested = true;
+        }
+        sockets.push_back(socket);
+        printf("Publishing on %s\n", endpoint.c_str());
+    }
+
+    if (!stopRequested && options.waitForSubscribers) {
+        printf("Waiting for subscribers...\n");
+        waitForSubscribers(sockets, options.dataPort);
+    }
+
+    vector<PortStats> stats(options.numPorts);
+    vector<thread> threads;
+    auto startTime = chrono::steady_clock::now() +
+                     chrono::duration_cast<chrono::steady_clock::duration>(
+                         chrono::duration<double>(PUBLISHER_START_DELAY_S));
+    if (!stopRequested) {
+        for (int port = 0; port < options.numPorts; port++) {
+            threads.emplace_back(publishPort, sockets[port], cref(banks[port]), cref(options),
+                                 startTime, ref(stats[port]));
+        }
+    }
+
+    // Report progress once a second, until every port is done
+    auto allDone = [&] {
+        if (stopRequested) return true;
+        for (const PortStats& portStats : stats) {
+            if (options.numFrames == 0 || portStats.numSent < options.numFrames) return false;
+        }
+        return true;
+    };
+    int64_t lastSent = 0, lastBytes = 0;
+    auto lastReport = chrono::steady_clock::now();
+    while (!threads.empty() && !allDone()) {
+        this_thread::sleep_for(chrono::milliseconds(PUBLISHER_SUBSCRIBE_POLL_MS));
+        auto now = chrono::steady_clock::now();
+        double elapsed = chrono::duration<double>(now - lastReport).count();
+        if (elapsed < 1.0) continue;
+
+        int64_t numSent = 0, bytesSent = 0, numLate = 0, maxLatenessNs = 0;
+        for (const PortStats& portStats : stats) {
+            numSent += portStats.numSent;
+            bytesSent += portStats.bytesSent;
+            numLate += portStats.numLate;
+            maxLatenessNs = max(maxLatenessNs, portStats.maxLatenessNs.load());
+        }
+        printf("%10.1f fps per port %10.1f MB/s  %lld late, max lateness %.1f us\n",
+               (numSent - lastSent) / elapsed / options.numPorts,
+               (bytesSent - lastBytes) / elapsed / 1e6, (long long) numLate,
+               maxLatenessNs / 1e3);
+        lastSent = numSent;
+        lastBytes = bytesSent;
+        lastReport = now;
+    }
+    for (thread& publisher : threads) publisher.join();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    for (int port = 0; port < options.numPorts; port++) {
+        printf("Port %d: %lld frames in %.2f s (%.1f fps), %.2f MB, %lld late\n",
+               options.dataPort + port, (long long) stats[port].numSent.load(), seconds,
+               stats[port].numSent / seconds, stats[port].bytesSent / 1e6,
+               (long long) stats[port].numLate.load());
+    }
+
+    for (void* socket : sockets) zmq_close(socket);
+    zmq_ctx_term(context);
+    return 0;
+}